@@ -506,6 +506,7 @@ bool active_protocol_c::cmdhandler(ipcr r)
             amsmonotonic = msmonotonic;
 #endif // _DEBUG
 
+            TRACE_SPAN( "audio.play" );
             if (av_contact_s *avc = g_app->avcontacts().find_inprogress( contact_key_s() | contact_key_s(gid, cid, id) ))
                 avc->add_audio( msmonotonic, fmt, data, dsz );
         }
@@ -533,7 +534,7 @@ bool active_protocol_c::cmdhandler(ipcr r)
 #ifdef _DEBUG
             vmsmonotonic = f->msmonotonic;
 #endif // _DEBUG
-            TSNEW( video_frame_decoder_c, this, f ); // not memory leak!
+            video_frame_decoder_c::post( this, f );
         }
         break;
     case XX_CONTROL_FILE:
@@ -655,6 +656,15 @@ bool active_protocol_c::cmdhandler(ipcr r)
             m->send_to_main_thread();
         }
         break;
+    case HA_TRACE_DATA:
+        {
+            int dsz;
+            const void *data = r.get_data(dsz);
+            gmsg<ISOGM_TRACE_DATA> *m = TSNEW(gmsg<ISOGM_TRACE_DATA>);
+            m->json.set( ts::asptr( (const char *)data, dsz ) );
+            m->send_to_main_thread();
+        }
+        break;
     case HQ_TYPING:
         {
             gmsg<ISOGM_TYPING> *m = TSNEW(gmsg<ISOGM_TYPING>);
@@ -701,6 +711,7 @@ void active_protocol_c::tlm_statistic_s::newdata( const tlm_data_s *d, bool full
     } else
     {
         ts::Time c = ts::Time::current();
+        last = d->sz;
         accum += d->sz;
         accumcur += d->sz;
         int dt = ( c - last_update );
@@ -1040,6 +1051,12 @@ ts::uint32 active_protocol_c::gm_handler(gmsg<ISOGM_CHANGED_SETTINGS>&ch)
     return 0;
 }
 
+void active_protocol_c::dump_trace()
+{
+    if (ipcp)
+        ipcp->send(ipcw(AQ_TRACE_DUMP) << ts::str_c(CONSTASTR("plghost ")).append(get_tag()));
+}
+
 void active_protocol_c::push_debug_settings()
 {
     if (prf_options().is(OPTOPT_POWER_USER))
@@ -1468,7 +1485,7 @@ void active_protocol_c::send_proto_data(contact_id_s cid, const ts::blob_c &pdat
     ipcp->send(ipcw(AQ_CONTACT) << cid << pdata);
 }
 
-void active_protocol_c::send_video_frame(contact_id_s cid, const ts::bmpcore_exbody_s &eb, uint64 msmonotonic )
+void active_protocol_c::send_video_frame(contact_id_s cid, const ts::bmpcore_exbody_s &eb, uint64 msmonotonic, ts::buf_c &i420cache, const ts::irect *damage, ts::aint ndamage )
 {
     if (!ipcp) return;
     isotoxin_ipc_s *ipcc = ipcp;
@@ -1486,9 +1503,31 @@ void active_protocol_c::send_video_frame(contact_id_s cid, const ts::bmpcore_exb
 
     const ts::imgdesc_s &src_info = eb.info();
 
-    int i420sz = src_info.sz.x * src_info.sz.y;
-    i420sz += i420sz / 2;
-    i420sz += sizeof(data_header_s) + sizeof(inf_s);
+    int y_sz = src_info.sz.x * src_info.sz.y;
+    int framesz = y_sz + y_sz / 2;
+    int i420sz = framesz + sizeof(data_header_s) + sizeof(inf_s);
+
+    // convert to i420 only changed areas; unchanged ones are already in cache
+    int uv_pitch = src_info.sz.x / 2;
+    if ( damage == nullptr || i420cache.size() != framesz )
+    {
+        i420cache.set_size( framesz, false );
+        damage = nullptr;
+    }
+    ts::uint8 *cy = i420cache.data();
+    ts::uint8 *cu = cy + y_sz;
+    ts::uint8 *cv = cu + y_sz / 4;
+    if ( damage )
+    {
+        for ( ts::aint i = 0; i < ndamage; ++i )
+        {
+            const ts::irect &r = damage[ i ];
+            int x = r.lt.x & ~1, y = r.lt.y & ~1; // chroma is 2x2
+            int w = ts::tmin( r.rb.x, src_info.sz.x ) - x, h = ts::tmin( r.rb.y, src_info.sz.y ) - y;
+            ts::img_helper_ARGB_to_i420( eb() + y * src_info.pitch + x * 4, src_info.pitch, cy + y * src_info.sz.x + x, src_info.sz.x, cu + ( y / 2 ) * uv_pitch + x / 2, uv_pitch, cv + ( y / 2 ) * uv_pitch + x / 2, uv_pitch, w, h );
+        }
+    } else
+        ts::img_helper_ARGB_to_i420( eb(), src_info.pitch, cy, src_info.sz.x, cu, uv_pitch, cv, uv_pitch, src_info.sz.x, src_info.sz.y );
 
     if (data_header_s *dh = (data_header_s *)ipcc->junct.lock_buffer( i420sz ))
     {
@@ -1500,11 +1539,7 @@ void active_protocol_c::send_video_frame(contact_id_s cid, const ts::bmpcore_exb
         inf->fmt = VFMT_I420;
         inf->msmonotonic = msmonotonic;
 
-        ts::uint8 *dst_y = ((ts::uint8 *)(dh + 1)) + sizeof(inf_s);
-        int y_sz = src_info.sz.x * inf->h;
-        ts::uint8 *dst_u = dst_y + y_sz;
-        ts::uint8 *dst_v = dst_u + y_sz / 4;
-        ts::img_helper_ARGB_to_i420(eb(), src_info.pitch, dst_y, src_info.sz.x, dst_u, src_info.sz.x / 2, dst_v, src_info.sz.x / 2, src_info.sz.x, src_info.sz.y);
+        memcpy( ((ts::uint8 *)(dh + 1)) + sizeof(inf_s), cy, framesz );
 
         ipcc->junct.unlock_send_buffer(dh, i420sz);
     }
@@ -1734,7 +1769,11 @@ void active_protocol_c::draw_telemtry( rectengine_c&e, const uint64& uid, const
         CONSTWSTR( "Video data recv: " ),
         CONSTWSTR( "File data send: " ),
         CONSTWSTR( "File data recv: " ),
+        CONSTWSTR( "Video encode time: " ),
+        CONSTWSTR( "Video encode queue: " ),
+        CONSTWSTR( "Video frames dropped: " ),
     };
+    static_assert( ARRAY_SIZE( tlmss ) == TLM_COUNT, "tlmss!" );
 
     ts::wstr_c text;
 
@@ -1774,10 +1813,23 @@ void active_protocol_c::draw_telemtry( rectengine_c&e, const uint64& uid, const
             {
                 if ( !text.is_empty() ) text.append( CONSTWSTR( "<br>" ) );
                 text.append( tlmss[i] );
-                appendsz( s->accumps );
-                text.append( CONSTWSTR( " per sec, " ) );
-                appendsz( s->accum );
-                text.append( CONSTWSTR(" total") );
+                switch ( i )
+                {
+                case TLM_VIDEO_ENCODE_TIME: // reported once per second
+                    text.append_as_num( s->last / 1000 ).append_char( '.' ).append_as_num( ( s->last % 1000 ) / 100 ).append( CONSTWSTR( " ms per frame" ) );
+                    break;
+                case TLM_VIDEO_ENCODE_QUEUE:
+                    text.append_as_num( s->last ).append( CONSTWSTR( " frames" ) );
+                    break;
+                case TLM_VIDEO_DROPPED_FRAMES:
+                    text.append_as_num( s->last ).append( CONSTWSTR( " per sec, " ) ).append_as_num( s->accum ).append( CONSTWSTR( " total" ) );
+                    break;
+                default:
+                    appendsz( s->accumps );
+                    text.append( CONSTWSTR( " per sec, " ) );
+                    appendsz( s->accum );
+                    text.append( CONSTWSTR(" total") );
+                }
                 if ( delta > 1500 )
                 {
                     text.append( CONSTWSTR( ", no data " ) );
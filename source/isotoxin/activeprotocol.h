@@ -219,6 +219,7 @@ class active_protocol_c : public ts::safe_object
         uint64 accum = 0;
         uint64 accumps = 0; // per second
         uint64 accumcur = 0;
+        uint64 last = 0; // last reported value
         ts::Time last_update = ts::Time::past();
         int updatecnt = 0;
 
@@ -255,6 +256,7 @@ class active_protocol_c : public ts::safe_object
     void run();
 
     void push_debug_settings();
+    void dump_trace(); // answer is ISOGM_TRACE_DATA
 
     void setup_audio_fmt( ts::str_c& s );
     void setup_avatar_restrictions( ts::str_c& s );
@@ -351,7 +353,7 @@ public:
 
     void refresh_details( const contact_key_s &ck );
 
-    void send_video_frame(contact_id_s cid, const ts::bmpcore_exbody_s &eb, uint64 timestamp );
+    void send_video_frame(contact_id_s cid, const ts::bmpcore_exbody_s &eb, uint64 timestamp, ts::buf_c &i420cache, const ts::irect *damage = nullptr, ts::aint ndamage = 0 );
     void send_audio(contact_id_s cid, const void *data, int size, uint64 timestamp );
     void call(contact_id_s cid, int seconds, bool videocall);
     void set_stream_options(contact_id_s cid, int so, const ts::ivec2 &vr); // tell to proto/other peer about recommended video resolution (if I see video in 320x240, why you send 640x480?)
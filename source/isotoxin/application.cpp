@@ -40,9 +40,10 @@ namespace
 {
 struct load_spellcheckers_s : public ts::task_c
 {
-    ts::array_del_t< Hunspell, 0 > spellcheckers;
+    ts::array_del_t< Hunspell, 0 > spellcheckers[ application_c::splchk_c::MAX_WORKERS ];
     ts::wstrings_c fns;
     ts::blob_c aff, dic, zip;
+    int nworkers = ts::CLAMP( g_cpu_cores - 1, 1, (int)application_c::splchk_c::MAX_WORKERS );
     bool stopjob = false;
     bool nofiles = false;
 
@@ -81,11 +82,14 @@ struct load_spellcheckers_s : public ts::task_c
         if (zip.size())
             ts::zip_open(zip.data(), zip.size(), DELEGATE(this, extract_zip));
 
-        hunspell_file_s aff_file_data(aff.data(), aff.size());
-        hunspell_file_s dic_file_data(dic.data(), dic.size());
+        for ( int i = 0; i < nworkers; ++i )
+        {
+            hunspell_file_s aff_file_data(aff.data(), aff.size());
+            hunspell_file_s dic_file_data(dic.data(), dic.size());
 
-        Hunspell *hspl = TSNEW(Hunspell, aff_file_data, dic_file_data);
-        spellcheckers.add(hspl);
+            Hunspell *hspl = TSNEW(Hunspell, aff_file_data, dic_file_data);
+            spellcheckers[ i ].add(hspl);
+        }
 
         return fns.size() ? R_RESULT_EXCLUSIVE : R_DONE;
     }
@@ -128,7 +132,7 @@ struct load_spellcheckers_s : public ts::task_c
     {
         if (!canceled && g_app)
         {
-            g_app->spellchecker.set_spellcheckers(std::move(spellcheckers));
+            g_app->spellchecker.set_spellcheckers(spellcheckers, nworkers);
 
             g_app->F_SHOW_SPELLING_WARN(nofiles);
             if (nofiles)
@@ -161,20 +165,22 @@ struct check_word_task : public ts::task_c
     {
     }
 
+    /*virtual*/ int priority() const override { return PRI_HIGH; }
     /*virtual*/ int iterate(ts::task_executor_c *) override
     {
         if (!g_app) return R_CANCEL;
-        auto lr = g_app->spellchecker.lock(this);
+        int worker;
+        auto lr = g_app->spellchecker.lock(this, worker);
         if (application_c::splchk_c::LOCK_EMPTY == lr || application_c::splchk_c::LOCK_DIE == lr) return R_CANCEL;
         if ( application_c::splchk_c::LOCK_OK == lr )
         {
             w = checkwords.get_last_remove();
             is_valid = false;
             UNSAFE_BLOCK_BEGIN
-            is_valid = g_app->spellchecker.check_one(w, suggestions);
+            is_valid = g_app->spellchecker.check_one(worker, w, suggestions);
             UNSAFE_BLOCK_END
 
-            if (g_app->spellchecker.unlock(this))
+            if (g_app->spellchecker.unlock(this, worker))
                 return R_CANCEL;
             return checkwords.size() ? R_RESULT_EXCLUSIVE : R_DONE;
         }
@@ -213,17 +219,24 @@ struct check_word_task : public ts::task_c
 
 }
 
-bool application_c::splchk_c::check_one( const ts::str_c &w, ts::astrings_c &suggestions )
+bool application_c::splchk_c::check_one( int worker, const ts::str_c &w, ts::astrings_c &suggestions )
 {
-    ASSERT( busy );
+    ASSERT( busy[ worker ] );
+
+    bool valid;
+    if ( cached( w, valid, suggestions ) )
+        return valid; // checked by other worker while this one waited
 
     suggestions.clear();
 
     ts::tmp_pointers_t<Hunspell, 2> sugg;
-    for( Hunspell *hspl : spellcheckers )
+    for( Hunspell *hspl : spellcheckers[ worker ] )
     {
         if (hspl->spell( w.cstr() ))
+        {
+            cache_result( w, true, suggestions );
             return true; // good word
+        }
         sugg.add( hspl );
     }
 
@@ -249,31 +262,88 @@ bool application_c::splchk_c::check_one( const ts::str_c &w, ts::astrings_c &sug
     }
 
     suggestions.kill_dups_and_sort();
+    cache_result( w, false, suggestions );
+    return false;
+}
+
+bool application_c::splchk_c::cached( const ts::str_c &w, bool &valid, ts::astrings_c &suggestions )
+{
+    SIMPLELOCK( cachesync );
+
+    for ( ts::hashmap_t< ts::str_c, word_result_s > &c : cache )
+        if ( const word_result_s *r = c.get( w ) )
+        {
+            // strings are not shared between threads: make own copies
+            valid = r->valid;
+            suggestions = r->suggestions;
+            for ( ts::str_c &s : suggestions )
+                s.clone();
+            return true;
+        }
     return false;
 }
 
-application_c::splchk_c::lock_rslt_e application_c::splchk_c::lock(void *prm)
+void application_c::splchk_c::cache_result( const ts::str_c &w, bool valid, const ts::astrings_c &suggestions )
+{
+    SIMPLELOCK( cachesync );
+
+    if ( cache[ 0 ].size() >= CACHE_WORDS )
+    {
+        // current generation is full: it becomes previous one; words of previous one are forgotten
+        cache[ 1 ] = std::move( cache[ 0 ] );
+        cache[ 0 ].clear();
+    }
+
+    ts::str_c k( w );
+    k.clone();
+    word_result_s &r = cache[ 0 ].add( k );
+    r.valid = valid;
+    r.suggestions = suggestions;
+    for ( ts::str_c &s : r.suggestions )
+        s.clone();
+}
+
+application_c::splchk_c::lock_rslt_e application_c::splchk_c::lock(void *prm, int &worker)
 {
     SIMPLELOCK(sync);
 
     if (after_unlock == AU_DIE) return LOCK_DIE;
-    if ( busy ) return LOCK_BUSY;
     if ( EMPTY == state || after_unlock == AU_UNLOAD ) return LOCK_EMPTY;
-    if ( READY != state ) return LOCK_BUSY;
+    if ( READY != state || AU_RELOAD == after_unlock ) return LOCK_BUSY;
+
+    for ( int i = 0; i < nworkers; ++i )
+        if ( !busy[ i ] )
+        {
+            busy[ i ] = prm;
+            ++nbusy;
+            worker = i;
+            return LOCK_OK;
+        }
 
-    busy = prm;
-    return LOCK_OK;
+    return LOCK_BUSY;
 }
 
-bool application_c::splchk_c::unlock(void *prm)
+bool application_c::splchk_c::unlock(void *prm, int worker)
 {
     SIMPLELOCK(sync);
 
-    ASSERT( busy == prm );
-    busy = nullptr;
+    ASSERT( busy[ worker ] == prm );
+    busy[ worker ] = nullptr;
+    --nbusy;
     return after_unlock != AU_NOTHING;
 }
 
+void application_c::splchk_c::clear_spellcheckers()
+{
+    for ( ts::array_del_t< Hunspell, 0 > &sa : spellcheckers )
+        sa.clear();
+    nworkers = 0;
+
+    SIMPLELOCK( cachesync );
+    cache[ 0 ].clear();
+    cache[ 1 ].clear();
+}
+
 
 void application_c::splchk_c::load()
 {
@@ -281,7 +351,7 @@ void application_c::splchk_c::load()
 
     if (AU_DIE == after_unlock) return;
 
-    if (nullptr != busy || LOADING == state)
+    if (nbusy > 0 || LOADING == state)
     {
         after_unlock = AU_RELOAD;
         return;
@@ -289,7 +359,7 @@ void application_c::splchk_c::load()
 
     if (EMPTY == state || READY == state)
     {
-        spellcheckers.clear();
+        clear_spellcheckers();
         state = LOADING;
         g_app->add_task(TSNEW(load_spellcheckers_s));
     }
@@ -301,24 +371,27 @@ void application_c::splchk_c::unload()
 
     if (AU_DIE == after_unlock) return;
 
-    if (nullptr != busy || LOADING == state)
+    if (nbusy > 0 || LOADING == state)
     {
         after_unlock = AU_UNLOAD;
         return;
     }
     if (READY == state)
     {
-        spellcheckers.clear();
+        clear_spellcheckers();
         state = EMPTY;
     }
 }
 
 void application_c::splchk_c::spell_check_work_done()
 {
+    SIMPLELOCK(sync);
+
     if (AU_DIE == after_unlock) return;
+    if (nbusy > 0) return; // other worker still checks; it will call this again
     if (AU_UNLOAD == after_unlock)
     {
-        spellcheckers.clear();
+        clear_spellcheckers();
         after_unlock = AU_NOTHING;
         state = EMPTY;
     } else if (AU_RELOAD == after_unlock)
@@ -329,16 +402,16 @@ void application_c::splchk_c::spell_check_work_done()
     }
 }
 
-void application_c::splchk_c::set_spellcheckers(ts::array_del_t< Hunspell, 0 > &&sa)
+void application_c::splchk_c::set_spellcheckers(ts::array_del_t< Hunspell, 0 > *sa, int n)
 {
     SIMPLELOCK(sync);
 
-    if (nullptr != busy || AU_DIE == after_unlock)
+    if (nbusy > 0 || AU_DIE == after_unlock)
         return;
 
     if (AU_UNLOAD == after_unlock)
     {
-        spellcheckers.clear();
+        clear_spellcheckers();
         after_unlock = AU_NOTHING;
         state = EMPTY;
         return;
@@ -352,23 +425,48 @@ void application_c::splchk_c::set_spellcheckers(ts::array_del_t< Hunspell, 0 > &
         return;
     }
 
-    spellcheckers = std::move( sa );
-    state = spellcheckers.size() ? READY : EMPTY;
+    clear_spellcheckers(); // also drops cached results of previous dictionaries
+    for ( int i = 0; i < n; ++i )
+        spellcheckers[ i ] = std::move( sa[ i ] );
+    nworkers = spellcheckers[ 0 ].size() ? n : 0;
+    state = nworkers ? READY : EMPTY;
 }
 
 void application_c::splchk_c::check(ts::astrings_c &&checkwords, spellchecker_s *rsltrcvr)
 {
-    SIMPLELOCK(sync);
-    if (after_unlock != AU_NOTHING || spellcheckers.size() == 0 || LOADING == state)
+    int workers;
     {
-        rsltrcvr->undo_check(checkwords);
-        return;
+        SIMPLELOCK(sync);
+        if (after_unlock != AU_NOTHING || nworkers == 0 || LOADING == state)
+        {
+            rsltrcvr->undo_check(checkwords);
+            return;
+        }
+        workers = nworkers;
+    }
+
+    // recently checked words are answered right now
+    ts::astrings_c suggestions;
+    for ( ts::aint i = checkwords.size() - 1; i >= 0; --i )
+    {
+        bool valid;
+        if ( cached( checkwords.get( i ), valid, suggestions ) )
+        {
+            rsltrcvr->check_result( checkwords.get( i ), valid, std::move( suggestions ) );
+            checkwords.remove_fast( i );
+        }
     }
 
-    check_word_task *t = TSNEW(check_word_task);
-    t->checkwords = std::move(checkwords);
-    t->splchk = rsltrcvr;
-    g_app->add_task(t);
+    // others are spread over workers
+    ts::aint ntasks = ts::tmin( (ts::aint)workers, checkwords.size() );
+    for ( ts::aint t = 0; t < ntasks; ++t )
+    {
+        check_word_task *task = TSNEW(check_word_task);
+        for ( ts::aint i = t; i < checkwords.size(); i += ntasks )
+            task->checkwords.add( checkwords.get( i ) );
+        task->splchk = rsltrcvr;
+        g_app->add_task(task);
+    }
 }
 
 void application_c::get_local_spelling_files(ts::wstrings_c &names)
@@ -402,6 +500,7 @@ void application_c::resetup_spelling()
 application_c::application_c(const ts::wchar * cmdl)
 {
     global_allocator = TSNEW( ts::dynamic_allocator_s );
+    ts::trace_thread_name( "main" );
 
     ts::master().on_init = DELEGATE( this, on_init );
     ts::master().on_exit = DELEGATE( this, on_exit );
@@ -563,6 +662,57 @@ void application_c::apply_debug_options()
 #endif
 
     F_SHOW_CONTACTS_IDS(d.get(CONSTASTR("contactids")).as_int() != 0);
+    ts::trace_enable( d.get( CONSTASTR( DEBUG_OPT_TRACE ) ).as_int() != 0 );
+}
+
+void application_c::save_trace()
+{
+    if (!main) return;
+
+    ts::wstr_c fromdir;
+    if (prf().is_loaded())
+        fromdir = prf().last_filedir();
+    if (fromdir.is_empty())
+        fromdir = ts::fn_get_path(ts::get_exe_full_name());
+
+    ts::filefilter_s e[1];
+    e[0].desc = CONSTWSTR("Chrome trace (*.json)");
+    e[0].wildcard = CONSTWSTR("*.json");
+    ts::filefilters_s ff(e, 1);
+
+    ts::wstr_c fn = HOLD(main)().getroot()->save_filename_dialog(fromdir, CONSTWSTR("trace.json"), ff, WIDE2("Save trace"));
+    if (fn.is_empty())
+        return;
+
+    m_trace_fn = fn;
+    m_trace.clear();
+    ts::trace_json( m_trace, CONSTASTR( "isotoxin" ) );
+    save_trace_file();
+
+    // plghosts answer later; each answer rewrites file with its events appended
+    if (prf().is_loaded())
+        prf().iterate_aps([](active_protocol_c &ap) { ap.dump_trace(); });
+}
+
+void application_c::save_trace_file()
+{
+    ts::buf_c b;
+    b.append_buf("[", 1);
+    b.append_buf(m_trace.cstr(), m_trace.get_length());
+    b.append_buf("]", 1);
+    b.save_to_file(m_trace_fn);
+}
+
+ts::uint32 application_c::gm_handler(gmsg<ISOGM_TRACE_DATA>&d)
+{
+    if (m_trace_fn.is_empty() || d.json.is_empty())
+        return 0;
+
+    if (!m_trace.is_empty())
+        m_trace.append(CONSTASTR(",\n"));
+    m_trace.append(d.json);
+    save_trace_file();
+    return 0;
 }
 
 ts::uint32 application_c::gm_handler(gmsg<ISOGM_CHANGED_SETTINGS>&ch)
@@ -1082,6 +1232,11 @@ const avatar_s * application_c::gen_identicon_avatar( const ts::str_c &pubid )
     return &desktop_shade_c::summon(r);
 }
 
+/*virtual*/ ts::wstr_c application_c::app_theme_cache_path( const ts::wsptr &thn )
+{
+    return ts::fn_join( ts::fn_get_path( cfg().get_path() ), CONSTWSTR( "themecache" ), thn ).append( CONSTWSTR( ".bin" ) );
+}
+
 /*virtual*/ void application_c::do_post_effect()
 {
     while( m_post_effect.is(PEF_APP) )
@@ -2183,6 +2338,8 @@ void application_c::load_profile_and_summon_main_rect(bool minimize)
     s3::DEVICE device = device_from_string( cfg().device_mic() );
     s3::set_capture_device( &device );
 
+    m_mediasystem.preload_sounds();
+
     ts::wstr_c profname = g_commandline().profilename ? *g_commandline().profilename : cfg().profile();
     g_commandline().profilename.reset();
 
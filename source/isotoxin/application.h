@@ -172,6 +172,8 @@ public:
     /*virtual*/ void do_post_effect() override;
     /*virtual*/ void app_font_par(const ts::str_c&, ts::font_params_s&fprm) override;
     /*virtual*/ guirect_c * app_create_shade(const ts::irect &r) override;
+    /*virtual*/ bool app_add_task( ts::task_c *t ) override { add_task( t ); return true; }
+    /*virtual*/ ts::wstr_c app_theme_cache_path( const ts::wsptr &thn ) override;
 
     ///////////// application_c itself
 
@@ -250,6 +252,7 @@ public:
     GM_RECEIVER( application_c, GM_UI_EVENT );
     GM_RECEIVER( application_c, ISOGM_DELIVERED );
     GM_RECEIVER( application_c, ISOGM_EXPORT_PROTO_DATA );
+    GM_RECEIVER( application_c, ISOGM_TRACE_DATA );
     GM_RECEIVER( application_c, ISOGM_GRABDESKTOPEVENT );
     
     av_contacts_c m_avcontacts;
@@ -265,6 +268,10 @@ public:
     ts::array_del_t<file_transfer_s, 2> m_files;
     ts::array_del_t<folder_share_c, 4> m_foldershares;
 
+    ts::wstr_c m_trace_fn;
+    ts::str_c m_trace; // events of app and plghosts answered so far
+    void save_trace_file();
+
     struct blinking_reason_s : public ts::movable_flag<true>
     {
         time_t last_update = ts::now();
@@ -487,6 +494,13 @@ public:
 
     class splchk_c
     {
+    public:
+        enum
+        {
+            MAX_WORKERS = 2, // words are checked in parallel; each worker has own instances of dictionaries (Hunspell is not thread safe)
+            CACHE_WORDS = 2048, // per cache generation
+        };
+    private:
         mutable spinlock::long3264 sync = 0;
         enum
         {
@@ -494,7 +508,9 @@ public:
             LOADING,
             READY,
         } state = EMPTY;
-        void *busy = nullptr;
+        void *busy[ MAX_WORKERS ] = {};
+        int nbusy = 0;
+        int nworkers = 0;
 
         enum
         {
@@ -504,7 +520,19 @@ public:
             AU_DIE,
         } after_unlock = AU_NOTHING;
 
-        ts::array_del_t< Hunspell, 0 > spellcheckers;
+        ts::array_del_t< Hunspell, 0 > spellcheckers[ MAX_WORKERS ];
+        void clear_spellcheckers();
+
+        struct word_result_s
+        {
+            ts::astrings_c suggestions;
+            bool valid = false;
+        };
+        // word -> result; two generations: when current is full, it replaces previous one
+        // cleared when dictionaries changed
+        ts::hashmap_t< ts::str_c, word_result_s > cache[ 2 ];
+        spinlock::long3264 cachesync = 0;
+        void cache_result( const ts::str_c &w, bool valid, const ts::astrings_c &suggestions );
     public:
 
         enum lock_rslt_e
@@ -524,17 +552,18 @@ public:
         void load();
         void unload();
         void spell_check_work_done();
-        void set_spellcheckers(ts::array_del_t< Hunspell, 0 > &&sa);
+        void set_spellcheckers(ts::array_del_t< Hunspell, 0 > *sa, int n); // takes content of n arrays
         void check(ts::astrings_c &&checkwords, spellchecker_s *rsltrcvr);
-        lock_rslt_e lock( void *prm );
-        bool unlock( void *prm );
-        bool check_one( const ts::str_c &w, ts::astrings_c &suggestions );
+        lock_rslt_e lock( void *prm, int &worker );
+        bool unlock( void *prm, int worker );
+        bool check_one( int worker, const ts::str_c &w, ts::astrings_c &suggestions ); // worker must be locked
+        bool cached( const ts::str_c &w, bool &valid, ts::astrings_c &suggestions );
 
         bool is_locked( bool set_dip )
         {
             SIMPLELOCK(sync);
             if (set_dip) after_unlock = AU_DIE;
-            return busy != nullptr;
+            return nbusy > 0;
         }
 
     } spellchecker;
@@ -548,6 +577,7 @@ public:
     const avatar_s * gen_identicon_avatar( const ts::str_c &pubid );
 
     void apply_debug_options();
+    void save_trace(); // ask file name; then trace of app and all plghosts is written there
 
     static ts::str_c get_downloaded_ver();
     bool b_update_ver(RID, GUIPARAM);
@@ -637,6 +667,7 @@ public:
     bool folder_share_recv_announce_present() const;
 
     void add_task( ts::task_c *t ) { m_tasks_executor.add(t); }
+    void wake_task( ts::task_c *t ) { m_tasks_executor.wake(t); } // any thread; t must be alive
     ts::uint32 base_tid() const { return  m_tasks_executor.base_tid(); }
 
     void update_ringtone( contact_root_c *rt, contact_c *sub, bool play_stop_snd = true );
@@ -266,12 +266,15 @@ void av_contact_s::camera_tick()
 
 }
 
-void av_contact_s::on_frame_ready( const ts::bmpcore_exbody_s &ebm )
+void av_contact_s::on_frame_ready( const ts::bmpcore_exbody_s &ebm, const ts::irect *damage, ts::aint ndamage )
 {
     if ( 0 == ( remote_so & SO_RECEIVING_VIDEO ) || core->ap == nullptr )
+    {
+        core->i420.clear(); // frames are not sent, so cached one becomes obsolete
         return;
+    }
 
-    core->ap->send_video_frame( contact_key_s(avkey).gidcid(), ebm, core->mstime );
+    core->ap->send_video_frame( contact_key_s(avkey).gidcid(), ebm, core->mstime, core->i420, damage, ndamage );
 }
 
 
@@ -289,14 +292,14 @@ void av_contact_s::add_audio( uint64 timestamp, const s3::Format &fmt, const voi
     {
         // no video, no need to synchronize
         // play now
-        play_audio( fmt, data, size );
+        play_audio( fmt, data, size, timestamp );
         return;
     }
 
-    play_audio( fmt, data, size );
+    play_audio( fmt, data, size, timestamp );
 }
 
-void av_contact_s::play_audio( const s3::Format &fmt, const void *data, ts::aint size )
+void av_contact_s::play_audio( const s3::Format &fmt, const void *data, ts::aint size, uint64 timestamp )
 {
     if (core->mute)
     {
@@ -308,7 +311,7 @@ void av_contact_s::play_audio( const s3::Format &fmt, const void *data, ts::aint
     if ( 0 != ( speaker_dsp_flags & DSP_SPEAKERS_NOISE ) ) dspf |= fmt_converter_s::FO_NOISE_REDUCTION;
     if ( 0 != ( speaker_dsp_flags & DSP_SPEAKERS_AGC ) ) dspf |= fmt_converter_s::FO_GAINER;
 
-    g_app->mediasystem().play_voice( avkey, fmt, data, size, volume, dspf );
+    g_app->mediasystem().play_voice( avkey, fmt, data, size, volume, dspf, 1000, timestamp );
 }
 
 
@@ -25,6 +25,7 @@ public:
         int ticktag = 0;
 
         fmt_converter_s cvt;
+        ts::buf_c i420; // last sent video frame; only damaged areas of next frame are converted
 
         vsb_descriptor_s currentvsb;
         ts::wstrmap_c cpar;
@@ -65,7 +66,7 @@ public:
 
     void call_tick();
 
-    void on_frame_ready( const ts::bmpcore_exbody_s &ebm );
+    void on_frame_ready( const ts::bmpcore_exbody_s &ebm, const ts::irect *damage, ts::aint ndamage );
     void camera_tick();
 
     bool is_mic_off() const { return 0 == ( cur_so() & SO_SENDING_AUDIO ); }
@@ -102,7 +103,7 @@ public:
 
 
     void add_audio( uint64 timestamp, const s3::Format &fmt, const void *data, ts::aint size );
-    void play_audio( const s3::Format &fmt, const void *data, ts::aint size );
+    void play_audio( const s3::Format &fmt, const void *data, ts::aint size, uint64 timestamp );
     void send_audio( const s3::Format& ifmt, const void *data, ts::aint size, bool clear_cvt_buffer );
 };
 
@@ -8,7 +8,10 @@ MAKE_CHILD<gui_contact_item_c>::~MAKE_CHILD()
 {
     ASSERT(parent);
     get().update_text();
-    MODIFY(get()).visible(is_visible);
+    if ( CIR_ME == role )
+        MODIFY( get() ).visible( is_visible );
+    else
+        get().vis_filter( is_visible );
 }
 
 MAKE_CHILD<gui_conversation_header_c>::~MAKE_CHILD()
@@ -28,6 +31,8 @@ gui_contact_item_c::gui_contact_item_c(MAKE_ROOT<gui_contact_item_c> &data) :gui
 gui_contact_item_c::gui_contact_item_c(MAKE_CHILD<gui_contact_item_c> &data) : gui_clist_base_c(data, data.role), contact(data.contact)
 {
     flags.set( F_VIS_FILTER | F_VIS_GROUP );
+    if ( CIR_LISTITEM == role || CIR_METACREATE == role )
+        flags.set( F_DORMANT ); // list will wake it up when it becomes visible
     if (contact && (CIR_LISTITEM == role || CIR_ME == role))
         if (ASSERT(contact->is_rootcontact()))
         {
@@ -250,10 +255,28 @@ bool gui_contact_item_c::animate_typing(RID, GUIPARAM)
     return true;
 }
 
+void gui_contact_item_c::dormant( bool f )
+{
+    if ( f == flags.is( F_DORMANT ) )
+        return;
+
+    flags.init( F_DORMANT, f );
+    if ( f )
+    {
+        textrect.set_text_only( ts::wstr_c(), false );
+        textrect.clear_glyphs();
+        textrect.textures_no_need(); // back to pool
+    } else
+        update_text();
+}
+
 void gui_contact_item_c::update_text()
 {
     MEMT( MEMT_CONTACT_ITEM_TEXT );
 
+    if ( flags.is( F_DORMANT ) )
+        return; // text will be built on wake up
+
     ts::wstr_c ctext;
 
     if (contact)
@@ -552,6 +575,9 @@ bool gui_contact_item_c::allow_drop() const
         if ( !prf().is_loaded() )
             return gui_control_c::sq_evt( qp, rid, data );
 
+        if ( flags.is( F_DORMANT ) )
+            dormant( false ); // should not happen: list wakes up visible items
+
         if ( flags.is( F_DNDDRAW ) )
         {
             if ( gui->dragndrop_underproc() == this )
@@ -1456,6 +1482,71 @@ bool gui_contact_item_c::is_after(gui_contact_item_c &ci)
     return cap2 > cap1;
 }
 
+clist_sort_key_s gui_contact_item_c::sort_key( bool group ) const
+{
+    clist_sort_key_s k;
+    k.item = true;
+    if ( !contact )
+    {
+        k.power = minimum<int>::value;
+        return k;
+    }
+
+    if ( group )
+        k.psf = proto_sort_factor();
+    k.power = statev( contact->get_meta_state() ) + sort_power();
+    k.activity = contacts().contact_activity_power( contact->getkey() );
+    k.id = contact->getkey().contactid;
+    return k;
+}
+
+bool clist_resort( ts::tbuf0_t<clist_sort_item_s> &seq )
+{
+    auto less = []( const clist_sort_item_s *s1, const clist_sort_item_s *s2 ) -> bool
+    {
+        int c = s1->key.compare( s2->key );
+        return c == 0 ? s1->itm < s2->itm : c < 0;
+    };
+
+    ts::tbuf0_t<clist_sort_item_s> moved, kept;
+    bool kept_sorted = true;
+    for ( const clist_sort_item_s &s : seq )
+    {
+        if ( s.changed )
+        {
+            moved.add( s );
+            continue;
+        }
+        if ( kept.count() && less( &s, &kept.get( kept.count() - 1 ) ) )
+            kept_sorted = false;
+        kept.add( s );
+    }
+
+    if ( !kept_sorted )
+        return seq.q_sort<clist_sort_item_s>( less ); // order changed not by resort (moved manually); sort all
+
+    if ( moved.count() == 0 )
+        return false;
+
+    moved.q_sort<clist_sort_item_s>( less );
+
+    bool changed = false;
+    ts::aint i = 0, j = 0;
+    for ( ts::aint k = 0, cnt = seq.count(); k < cnt; ++k )
+    {
+        const clist_sort_item_s *s;
+        if ( j >= moved.count() || ( i < kept.count() && less( &kept.get( i ), &moved.get( j ) ) ) )
+            s = &kept.get( i++ );
+        else
+            s = &moved.get( j++ );
+
+        if ( seq.get( k ).itm != s->itm )
+            changed = true;
+        seq.get( k ) = *s;
+    }
+    return changed;
+}
+
 bool gui_contact_item_c::redraw_now(RID, GUIPARAM)
 {
     update_text();
@@ -2681,6 +2772,7 @@ bool gui_contactlist_c::on_filter_deactivate(RID, GUIPARAM)
             c->flag_full_search_result = false;
             redraw = true;
         }
+        c->flag_filter_hidden = false;
         if (c->gui_item)
         {
             c->gui_item->vis_filter(true);
@@ -3034,7 +3126,10 @@ ts::uint32 gui_contactlist_c::gm_handler( gmsg<ISOGM_V_UPDATE_CONTACT> & c )
 
         MAKE_CHILD<gui_contact_item_c> mc(getrid(), cc);
         if (filter)
-            mc.is_visible = filter->check_one(mc.contact);
+        {
+            cc->flag_filter_hidden = !filter->check_one( cc );
+            mc.is_visible = !cc->flag_filter_hidden;
+        }
 
         if ( insindex >= 0 )
             getengine().child_move_to( insindex, &mc.get().getengine(), skipctl );
@@ -3057,118 +3152,44 @@ ts::uint32 gui_contactlist_c::gm_handler(gmsg<GM_HEARTBEAT> &)
 
     if (contacts().sort_tag() != sort_tag && role == CLR_MAIN_LIST && gui->dragndrop_underproc() == nullptr)
     {
-        struct sss
-        {
-            ts::tmp_pointers_t<gui_contact_item_c, 128> sp;
-            ts::hashmap_t<size_t, uint64 > sortv;
-
-            size_t ch( gui_clist_base_c *c )
-            {
-                return calc_hash( &c, sizeof( gui_clist_base_c * ) );
-            }
-
-            uint64 &addh( gui_clist_base_c *c )
-            {
-                return sortv.add( ch(c) );
-            }
-
-            bool swap_them( rectengine_c *e1, rectengine_c *e2 )
-            {
-                if ( e1 == nullptr || e2 == nullptr ) return false;
-                if ( e1 == e2 ) return false;
-                gui_clist_base_c * ci1 = dynamic_cast<gui_clist_base_c *>( &e1->getrect() );
-                if ( ci1 == nullptr ) return false;
-                gui_clist_base_c * ci2 = dynamic_cast<gui_clist_base_c *>( &e2->getrect() );
-                if ( ci2 == nullptr ) return false;
-
-                if ( ci1->getrole() == CIR_ME || ci2->getrole() == CIR_ME )
-                    return false;
-
-                auto *f1 = sortv.find( ch(ci1) );
-                if ( !f1 ) return false;
-                auto *f2 = sortv.find( ch(ci2) );
-                if ( !f2 ) return false;
-
-                return f1->value > f2->value;
-
-                /*
-                if ( ci1->getrole() == CIR_LISTITEM && ci2->getrole() == CIR_LISTITEM )
-                {
-                gui_contact_item_c *i1 = ci1->as_item();
-                gui_contact_item_c *i2 = ci2->as_item();
-                if ( !prf_options().is( CLOPT_GROUP_CONTACTS_PROTO ) || i1->same_prots(*i2))
-                return i1->is_after( *i2 );
-                }
-
-                if ( ci1->getrole() == CIR_SEPARATOR && ci2->getrole() == CIR_LISTITEM )
-                {
-                gui_contact_separator_c *sep = ci1->as_separator();
-                gui_contact_item_c *itm = ci2->as_item();
-                if ( sep->is_prots_same_as_contact( &itm->getcontact() ) )
-                return false;
-                }
-                if ( ci2->getrole() == CIR_SEPARATOR && ci1->getrole() == CIR_LISTITEM )
-                {
-                gui_contact_separator_c *sep = ci2->as_separator();
-                gui_contact_item_c *itm = ci1->as_item();
-                if ( sep->is_prots_same_as_contact( &itm->getcontact() ) )
-                return true;
-                }
-
-
-                int sf1 = ci1->proto_sort_factor();
-                int sf2 = ci2->proto_sort_factor();
-
-                if ( sf1 == sf2 )
-                return ci1 < ci2;
-                return sf1 > sf2;
-                */
-            };
-
-        } ss;
+        // recalc keys; only items with changed keys are moved
+        bool group = prf_options().is( CLOPT_GROUP_CONTACTS_PROTO );
+        ts::tbuf0_t<clist_sort_item_s> seq;
 
         ts::aint count = getengine().children_count();
         for ( ts::aint i = skipctl; i < count; ++i )
         {
             if ( rectengine_c *e = getengine().get_child( i ) )
             {
-                gui_clist_base_c * b = dynamic_cast<gui_clist_base_c *>( &e->getrect() );
+                gui_clist_base_c *b = ts::ptr_cast<gui_clist_base_c *>( &e->getrect() );
+                clist_sort_key_s k;
                 if ( gui_contact_item_c *ci = b->as_item() )
-                {
-                    bool a = false;
-                    for ( ts::aint z = 0, c = ss.sp.size(); z < c; ++z )
-                        if ( ss.sp.get( z )->is_after( *ci ) )
-                        {
-                            a = true;
-                            ss.sp.insert( z, ci );
-                            break;
-                        }
-                    if ( !a )
-                        ss.sp.add(ci);
-                } else if ( gui_contact_separator_c *sep = b->as_separator() )
-                    ss.addh( sep ) = static_cast<uint64>( sep->proto_sort_factor() ) << 32;
+                    k = ci->sort_key( group );
+                else
+                    k.psf = b->proto_sort_factor();
+
+                clist_sort_item_s &s = seq.add();
+                s.key = k;
+                s.itm = e;
+                s.changed = !b->sortkey_valid || !( b->sortkey == k );
+                b->sortkey = k;
+                b->sortkey_valid = true;
             }
         }
 
-        bool group = prf_options().is( CLOPT_GROUP_CONTACTS_PROTO );
-
-        for ( ts::aint i = 0, c = ss.sp.size(); i < c; ++i )
+        if ( clist_resort( seq ) )
         {
-            uint64 v = i + 1;
-
-            if ( group )
-                v |= ( ( (uint64)ss.sp.get( i )->proto_sort_factor() ) << 32 );
-
-            ss.addh( ss.sp.get( i ) ) = v;
-        }
-
+            ts::tmp_tbuf_t<rectengine_c *> order;
+            for ( const clist_sort_item_s &s : seq )
+                order.add( (rectengine_c *)s.itm );
 
-        if (getengine().children_sort( DELEGATE( &ss, swap_them ) ))
-        {
-            if (g_app->active_contact_item)
-                scroll_to_child(&g_app->active_contact_item->getengine(), ST_ANY_POS);
+            if ( getengine().children_reorder( skipctl, order.begin(), order.count() ) )
+            {
+                if (g_app->active_contact_item)
+                    scroll_to_child(&g_app->active_contact_item->getengine(), ST_ANY_POS);
 
-            gui->repos_children(this);
+                gui->repos_children(this);
+            }
         }
         fix_sep_visibility();
         sort_tag = contacts().sort_tag();
@@ -3184,6 +3205,59 @@ ts::uint32 gui_contactlist_c::gm_handler(gmsg<GM_HEARTBEAT> &)
     super::on_manual_scroll(ms);
 }
 
+/*virtual*/ void gui_contactlist_c::children_repos()
+{
+    TRACE_SPAN( "clist.repos" );
+    TRACE_COUNTER( "clist.items", getengine().children_count() - skipctl );
+
+    itemsize = ts::ivec2( 0 );
+    super::children_repos();
+
+    if ( visible_from < 0 )
+        return;
+
+    // only items of visible window (and overscan) have text, glyphs and textures; all others are dormant
+    ++wndmark;
+    ts::aint from = ts::tmax<ts::aint>( skipctl, visible_from - OVERSCAN_ITEMS );
+    ts::aint to = ts::tmin<ts::aint>( getengine().children_count() - 1, visible_to + OVERSCAN_ITEMS );
+    for ( ts::aint i = from; i <= to; ++i )
+        if ( rectengine_c *e = getengine().get_child( i ) )
+            if ( gui_contact_item_c *itm = ts::ptr_cast<gui_clist_base_c *>( &e->getrect() )->as_item() )
+            {
+                itm->wndmark = wndmark;
+                if ( itm->is_dormant() )
+                {
+                    itm->dormant( false );
+                    awake.add( itm );
+                }
+            }
+
+    for ( ts::aint i = awake.size() - 1; i >= 0; --i )
+    {
+        gui_contact_item_c *itm = awake.get( i );
+        if ( itm && itm->wndmark == wndmark )
+            continue;
+        if ( itm )
+            itm->dormant( true );
+        awake.remove_fast( i );
+    }
+
+    TRACE_COUNTER( "clist.awake", awake.size() );
+}
+
+/*virtual*/ int gui_contactlist_c::child_height( const guirect_c &r, int width, int height_need, int &maxw ) const
+{
+    // all list items have same size defined by theme, so only first one is asked
+    const gui_contact_item_c *itm = ts::ptr_cast<const gui_clist_base_c *>( &r )->as_item();
+    if ( !itm || ( CIR_LISTITEM != itm->getrole() && CIR_METACREATE != itm->getrole() ) )
+        return super::child_height( r, width, height_need, maxw );
+
+    if ( itemsize.y == 0 )
+        itemsize.y = super::child_height( r, width, height_need, itemsize.x );
+    maxw = itemsize.x;
+    return itemsize.y;
+}
+
 /*virtual*/ void gui_contactlist_c::children_repos_info(cri_s &info) const
 {
     info.area = get_client_area();
@@ -40,6 +40,38 @@ template<> struct MAKE_CHILD<gui_conversation_header_c> : public _PCHILD( gui_co
     ~MAKE_CHILD();
 };
 
+struct clist_sort_key_s // position of item in contact list
+{
+    int psf = 0; // proto group sort factor (ascending)
+    int power = 0; // state + sort power (descending)
+    ts::aint activity = -1; // last active first
+    int id = 0; // descending
+    bool item = false; // separator is first in its group
+
+    int compare( const clist_sort_key_s &k ) const
+    {
+        if ( psf != k.psf ) return psf < k.psf ? -1 : 1;
+        if ( item != k.item ) return item ? 1 : -1;
+        if ( power != k.power ) return power > k.power ? -1 : 1;
+        if ( activity != k.activity ) return activity > k.activity ? -1 : 1;
+        if ( id != k.id ) return id > k.id ? -1 : 1;
+        return 0;
+    }
+    bool operator==( const clist_sort_key_s &k ) const { return compare( k ) == 0; }
+};
+
+struct clist_sort_item_s : public ts::movable_flag<true>
+{
+    clist_sort_key_s key;
+    void *itm;
+    bool changed; // key changed since last resort (or new item)
+};
+
+// seq - items in current order with actual keys
+// unchanged items are expected in order already, so only changed ones are sorted and merged in: O(n + k log k)
+// returns true if order changed
+bool clist_resort( ts::tbuf0_t<clist_sort_item_s> &seq );
+
 class gui_clist_base_c : public gui_label_c
 {
 protected:
@@ -48,6 +80,9 @@ public:
     gui_clist_base_c() {}
     gui_clist_base_c( initial_rect_data_s &data, contact_item_role_e role ) :gui_label_c( data ), role(role) {}
 
+    clist_sort_key_s sortkey; // key at last resort
+    bool sortkey_valid = false;
+
     contact_item_role_e getrole() const { return role; }
     virtual int proto_sort_factor() const = 0;
 
@@ -100,9 +135,10 @@ class gui_contact_item_c : public gui_clist_base_c
 
     static const ts::flags32_s::BITS  F_VIS_FILTER = FLAGS_FREEBITSTART_LABEL << 3;
     static const ts::flags32_s::BITS  F_VIS_GROUP = FLAGS_FREEBITSTART_LABEL << 4;
+    static const ts::flags32_s::BITS  F_DORMANT = FLAGS_FREEBITSTART_LABEL << 5;
 
 protected:
-    static const ts::flags32_s::BITS  FLAGS_FREEBITSTART_CITM = FLAGS_FREEBITSTART_LABEL << 5;
+    static const ts::flags32_s::BITS  FLAGS_FREEBITSTART_CITM = FLAGS_FREEBITSTART_LABEL << 6;
 
     ts::shared_ptr<contact_root_c> contact;
 
@@ -128,6 +164,10 @@ public:
     bool is_vis_filter() const { return flags.is( F_VIS_FILTER ); }
     bool is_vis_group() const { return flags.is( F_VIS_GROUP ); }
 
+    void dormant( bool f ); // dormant item is out of visible window of list: no text, no glyphs, no textures
+    bool is_dormant() const { return flags.is( F_DORMANT ); }
+    int wndmark = 0; // see gui_contactlist_c::children_repos
+
     ts::wstr_c tt();
 
     void typing();
@@ -170,6 +210,7 @@ public:
     virtual void update_text();
 
     bool is_after(gui_contact_item_c &ci); // sort comparison
+    clist_sort_key_s sort_key( bool group ) const; // same order as is_after
     /*virtual*/ int proto_sort_factor() const override;
     //bool same_prots(const gui_contact_item_c &itm) const;
 
@@ -363,12 +404,23 @@ class gui_contactlist_c : public gui_vscrollgroup_c
 
     ts::array_inplace_t<contact_key_s, 2> * arr = nullptr;
 
+    // partial virtualization: every contact still has its own item rect (contact_c::gui_item is used all over the app) and layout still walks all rects,
+    // but per rect layout is only cached theme size (see child_height) and only items of visible window have text, glyphs and textures (see children_repos);
+    // dormant items give textures back to gui pool and items coming into window take them from there
+    // cost is visible in trace: "clist.repos" span with "clist.items" / "clist.awake" counters, "clist.filter" span
+    static const int OVERSCAN_ITEMS = 8; // items above and below visible window, kept materialized
+    ts::array_safe_t<gui_contact_item_c, 5> awake; // materialized (not dormant) items
+    int wndmark = 0;
+    mutable ts::ivec2 itemsize = ts::ivec2(0); // max width and height of list item; valid during children_repos
+
     void recreate_ctls(bool focus_filter = false);
     /*virtual*/ bool i_leeched( guirect_c &to ) override;
     bool filter_proc(system_query_e qp, evt_data_s &data);
 
     /*virtual*/ void on_manual_scroll(manual_scroll_e ms) override;
     /*virtual*/ void children_repos_info(cri_s &info) const override;
+    /*virtual*/ void children_repos() override;
+    /*virtual*/ int child_height( const guirect_c &r, int width, int height_need, int &maxw ) const override;
     /*virtual*/ bool test_under_point( const guirect_c &r, const ts::ivec2& screenpos ) const override;
 
     bool refresh_list(RID, GUIPARAM);
@@ -2488,20 +2488,12 @@ void contacts_c::contact_activity( const contact_key_s &ck )
 {
     ASSERT(ck.is_meta() || ck.is_conference());
 
-    ts::aint cnt = activity.count();
-    if ( cnt && activity.last(contact_key_s()) == ck )
-        return;
+    bool added;
+    int &stamp = activity.add(ck, added);
+    if ( !added && stamp == activitystamp )
+        return; // already last active
 
-    for( int i=0;i<cnt; ++i )
-    {
-        if (activity.get(i) == ck)
-        {
-            activity.remove_slow(i);
-            break;
-        }
-    }
-
-    activity.add(ck);
+    stamp = ++activitystamp;
     resort_list();
 }
 
@@ -3289,16 +3281,15 @@ void contact_root_c::load_history( ts::aint n_last_items )
         unload_history();
 
         // do not use profile history table view to for whole history
+        // only index (utag, time, sender, type) is loaded; texts are paged in by conversation on demand (see history_page_in)
         struct loader
         {
             contact_root_c *me;
-            ts::shared_ptr<crallocator> a = TSNEW( crallocator );
             ts::uint8 mt = 0;
-            static post_s *alcpost( const ts::asptr&t, void *prm )
+            static post_s *alcpost( const ts::asptr&, void *prm )
             {
                 loader *ldr = (loader *)prm;
                 post_s *p = ldr->me->add_history_unsafe();
-                p->message_utf8 = ts::refstring_t<char>::build( t, ldr->a );
                 p->type = ldr->mt;
                 return p;
             }
@@ -3307,7 +3298,7 @@ void contact_root_c::load_history( ts::aint n_last_items )
         l.me = this;
         l.mt = getkey().is_conference() ? message_type_app_values : 0;
 
-        prf().load_history( getkey(), loader::alcpost, &l );
+        prf().load_history( getkey(), loader::alcpost, &l, false );
         flag_history_need_load = false;
         return;
     }
@@ -3355,6 +3346,72 @@ void contact_root_c::load_history( ts::aint n_last_items )
     }
 }
 
+void contact_root_c::history_evict( ts::aint index )
+{
+    post_s *p = history.get( index );
+    if ( p->utag != 0 && keep_history() )
+        p->message_utf8 = nullptr;
+}
+
+void contact_root_c::history_page_in( const post_s &cp, ts::aint index )
+{
+    if ( cp.message_utf8 )
+        return;
+
+    MEMT( MEMT_PROFILE_HISTORY );
+
+    // collapsed posts are split one by one while they come to visible range, so neighbours of this post will be needed soon too
+    // load all evicted texts around by one query instead of query per post
+    const ts::aint batch = 32;
+    ASSERT( index < 0 || history.get( index ) == &cp );
+    ts::aint from = index < 0 ? 0 : ts::tmax<ts::aint>( 0, index - batch );
+    ts::aint to = index < 0 ? 0 : ts::tmin( history.size(), index + batch + 1 );
+
+    ts::tmp_tbuf_t<uint64> utags;
+    if ( index < 0 )
+        utags.add( cp.utag );
+    for ( ts::aint i = from; i < to; ++i )
+    {
+        const post_s *p = history.get( i );
+        if ( p->utag != 0 && !p->message_utf8 )
+            utags.add( p->utag );
+    }
+
+    struct pagein
+    {
+        contact_root_c *me;
+        post_s *p; // requested post
+        ts::aint from, to;
+        static void settext( uint64 utag, const ts::asptr&t, void *prm )
+        {
+            pagein *pi = (pagein *)prm;
+            if ( pi->p->utag == utag )
+            {
+                pi->p->set_message_text( t );
+                return;
+            }
+            for ( ts::aint i = pi->from; i < pi->to; ++i )
+            {
+                post_s *p = pi->me->history.get( i );
+                if ( p->utag == utag )
+                {
+                    p->set_message_text( t );
+                    break;
+                }
+            }
+        }
+    } pi;
+
+    pi.me = this;
+    pi.p = const_cast<post_s *>( &cp ); // all posts of history are mutable
+    pi.from = from;
+    pi.to = to;
+    prf().load_history_texts( getkey(), utags.begin(), utags.count(), pagein::settext, &pi );
+
+    if ( !cp.message_utf8 )
+        pi.p->set_message_text( ts::asptr() ); // lost in db: empty text; don't use '?' - it is marker of unfinished file transfer
+}
+
 const avatar_s *contact_root_c::get_avatar() const
 {
     MEMT( MEMT_AVATARS );
@@ -44,7 +44,7 @@ INLINE bool is_special_mt(message_type_app_e mt)
     return mt > message_type_app_values;
 }
 
-// also fix gui_filterbar_c::full_search_s::iterate
+// also fix profile_c::find_history_items
 #define CASE_MESSAGE case MTA_MESSAGE: \
                      case MTA_UNDELIVERED_MESSAGE: \
                      case MTA_HIGHLIGHT_MESSAGE: \
@@ -302,7 +302,7 @@ template<> struct gmsg<ISOGM_UPDATE_CONTACT> : public gmsgbase
 
 template<> struct gmsg<ISOGM_PEER_STREAM_OPTIONS> : public gmsgbase
 {
-    gmsg( uint64 avkey, int so, const ts::ivec2 &sz) :gmsgbase(ISOGM_PEER_STREAM_OPTIONS), avkey( avkey ), so(so), videosize(sz) {}
+    gmsg( uint64 avkey, int so, const ts::ivec2 &sz) :gmsgbase(ISOGM_PEER_STREAM_OPTIONS, avkey), avkey( avkey ), so(so), videosize(sz) {}
     uint64 avkey;
     ts::ivec2 videosize;
     int so;
@@ -427,6 +427,7 @@ public:
             unsigned flag_folder_share_mode : 1;
             unsigned flag_last_activity : 1;
             unsigned flag_caps_received : 1;
+            unsigned flag_filter_hidden : 1; // hidden by filter bar; list items follow this flag
         };
     };
 
@@ -791,6 +792,8 @@ public:
     }
 
     void load_history( ts::aint n_last_items);
+    void history_evict( ts::aint index ); // drop text of stored post; text will be paged in from db on demand
+    void history_page_in( const post_s &p, ts::aint index ); // p - post of this history, possible evicted; index - index of p in history or -1, if unknown
     void unload_history()
     {
         for ( post_s *p : history )
@@ -1000,7 +1003,7 @@ contact_root_c *get_historian(contact_c *sender, contact_c * receiver);
 
 template<> struct gmsg<ISOGM_V_UPDATE_CONTACT> : public gmsgbase
 {
-    gmsg(contact_c *c, bool refilter) :gmsgbase(ISOGM_V_UPDATE_CONTACT),contact(c), refilter( refilter ) { }
+    gmsg(contact_c *c, bool refilter) :gmsgbase(ISOGM_V_UPDATE_CONTACT, c->getkey()),contact(c), refilter( refilter ) { }
     ts::shared_ptr<contact_c> contact;
     bool refilter;
 };
@@ -1050,7 +1053,7 @@ template<> struct gmsg<ISOGM_FOLDER_SHARE> : public gmsgbase
         DT_QUERY,
     };
 
-    gmsg(uint64 utag, int apid, data_type_e dt) :gmsgbase(ISOGM_FOLDER_SHARE), utag(utag), apid(apid), dt(dt) {}
+    gmsg(uint64 utag, int apid, data_type_e dt) :gmsgbase(ISOGM_FOLDER_SHARE, utag), utag(utag), apid(apid), dt(dt) {}
     uint64 utag;
     ts::blob_c toc;
     ts::str_c tocname;
@@ -1062,7 +1065,7 @@ template<> struct gmsg<ISOGM_FOLDER_SHARE> : public gmsgbase
 
 template<> struct gmsg<ISOGM_FOLDER_SHARE_UPDATE> : public gmsgbase
 {
-    gmsg(uint64 utag) :gmsgbase(ISOGM_FOLDER_SHARE_UPDATE), utag(utag) {}
+    gmsg(uint64 utag) :gmsgbase(ISOGM_FOLDER_SHARE_UPDATE, utag), utag(utag) {}
     uint64 utag;
 };
 
@@ -1136,7 +1139,8 @@ class contacts_c
     GM_RECEIVER(contacts_c, ISOGM_PROTO_CRASHED);
     GM_RECEIVER(contacts_c, ISOGM_PROTO_LOADED);
 
-    ts::tbuf_t<contact_key_s> activity; // last active historian at end of array
+    ts::hashmap_t<contact_key_s, int> activity; // activity stamps of historians; bigger - later
+    int activitystamp = 0;
     contacts_array_t arr;
     ts::shared_ptr<contact_root_c> self;
 
@@ -1254,10 +1258,8 @@ public:
     ts::aint contact_activity_power(const contact_key_s &ck) const
     {
         ASSERT(ck.is_meta() || ck.is_conference());
-        ts::aint cnt = activity.count();
-        for ( ts::aint i = 0; i < cnt; ++i)
-            if (activity.get(i) == ck)
-                return i;
+        if (const int *stamp = activity.get(ck))
+            return *stamp;
         return -1;
     }
 
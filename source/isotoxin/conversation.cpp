@@ -17,8 +17,9 @@ struct memstat_s
     static void memcb(int typ, int num, size_t size, void *prm)
     {
         memstat_s *mst = (memstat_s *)prm;
+        if ( typ >= MEMT_count ) return;
         mst->szs[typ] += size;
-        mst->nums[typ] += 1;
+        mst->nums[typ] += num;
     }
 };
 
@@ -84,7 +85,7 @@ bool special_command( contact_root_c *h, contact_c *r, ts::str_c utf8t )
     {
         memstat_s mst;
 
-        mspy_getallocated_info( memstat_s::memcb, &mst );
+        mspy_getallocated_stat( memstat_s::memcb, &mst );
 
         ts::str_c s;
         for( int i=0;i<MEMT_count;++i )
@@ -97,6 +98,28 @@ bool special_command( contact_root_c *h, contact_c *r, ts::str_c utf8t )
         return true;
     }
 
+    if ( utf8t.begins( CONSTASTR( "/tasks" ) ) )
+    {
+        ts::task_executor_c::stat_s st;
+        g_app->m_tasks_executor.get_stat( st );
+
+        ts::str_c s( CONSTASTR( "workers: " ) );
+        s.append_as_int( st.workers ).append( CONSTASTR( ", queued: " ) ).append_as_int( st.queued ).append( CONSTASTR( ", sleeping: " ) ).append_as_int( st.sleeping ).append( CONSTASTR( "\n" ) );
+        for ( int i = 0; i < ts::task_executor_c::MAX_WORKERS; ++i )
+        {
+            const ts::task_executor_c::worker_stat_s &w = st.worker[ i ];
+            if ( !w.executed ) continue;
+            s.append_as_int( i ).append( CONSTASTR( ": depth " ) ).append_as_int( w.queue_depth )
+                .append( CONSTASTR( ", executed " ) ).append_as_int( w.executed )
+                .append( CONSTASTR( ", stolen " ) ).append_as_int( w.stolen )
+                .append( CONSTASTR( ", latency avg/max " ) ).append_as_int( w.latency_avg ).append_char( '/' ).append_as_int( w.latency_max ).append( CONSTASTR( "ms\n" ) );
+        }
+
+        h->add_message( s );
+
+        return true;
+    }
+
     if (utf8t.begins(CONSTASTR("/conf")))
     {
         DEFERRED_EXECUTION_BLOCK_BEGIN(1.0)
@@ -1012,6 +1035,7 @@ void gui_notice_conference_c::setup(notice_s *pars)
         notice_t<NOTICE_CONFERENCE> *p = static_cast<notice_t<NOTICE_CONFERENCE> *>(pars);
         historian = p->owner;
         sender = nullptr;
+        GM_KEY( ISOGM_V_UPDATE_CONTACT, historian->getkey() );
     }
 
     if (historian->flag_is_av)
@@ -1597,6 +1621,8 @@ void gui_notice_foldershare_c::setup(notice_s *pars)
 {
     notice_t<NOTICE_FOLDERSHARE> *p = static_cast<notice_t<NOTICE_FOLDERSHARE> *>(pars);
     utag = p->utag;
+    GM_KEY( ISOGM_FOLDER_SHARE, utag );
+    GM_KEY( ISOGM_FOLDER_SHARE_UPDATE, utag );
     historian = p->get_owner();
     name = p->name;
     type = p->type;
@@ -1718,7 +1744,7 @@ const ts::irect *gui_notice_callinprogress_c::vrect()
                     common.vsb_draw(getengine(), common.display, common.display_position, common.display_size, false, true );
 
                     if ( active_protocol_c *ap = prf().ap( sender->getkey().protoid ) )
-                        ap->draw_telemtry( getengine(), sender->getkey().contactid, ts::irect::from_center_and_size( common.display_position, common.display_size ), SETBIT( TLM_AUDIO_SEND_BYTES ) | SETBIT( TLM_AUDIO_RECV_BYTES ) | SETBIT( TLM_VIDEO_SEND_BYTES ) | SETBIT( TLM_VIDEO_RECV_BYTES ) ), tlm = true;;
+                        ap->draw_telemtry( getengine(), sender->getkey().contactid, ts::irect::from_center_and_size( common.display_position, common.display_size ), SETBIT( TLM_AUDIO_SEND_BYTES ) | SETBIT( TLM_AUDIO_RECV_BYTES ) | SETBIT( TLM_VIDEO_SEND_BYTES ) | SETBIT( TLM_VIDEO_RECV_BYTES ) | SETBIT( TLM_VIDEO_ENCODE_TIME ) | SETBIT( TLM_VIDEO_ENCODE_QUEUE ) | SETBIT( TLM_VIDEO_DROPPED_FRAMES ) ), tlm = true;;
 
                     if (camera && (common.cam_previewsize >> ts::ivec2(0)))
                     {
@@ -4368,7 +4394,7 @@ void gui_message_item_c::add_post_index( ts::aint post_index, ts::aint cnt )
     }
 }
 
-bool gui_message_item_c::setup_normal( const post_s&p )
+bool gui_message_item_c::setup_normal( const post_s&p, ts::aint post_index )
 {
     mt = static_cast<ts::uint16>(p.mt());
     addition.reset();
@@ -4407,7 +4433,7 @@ bool gui_message_item_c::setup_normal( const post_s&p )
         author = contacts().find_subself( receiver->getkey().protoid );
 
     set_theme_rect( ts::str_c( CONSTASTR( "message." ), skin ), false );
-    setup_text( p );
+    setup_text( p, post_index );
 
     const found_item_s *found_item = nullptr;
     if ( historian->flag_full_search_result && g_app->found_items )
@@ -4445,7 +4471,7 @@ rectengine_c *gui_message_item_c::split_super_message( ts::aint index, rectengin
     {
         // unsplittable
         // remove super message flag
-        setup_normal( historian->get_history( sm->from ) );
+        setup_normal( historian->get_history( sm->from ), sm->from );
 
         if (gui_messagelist_c *ml = list())
         {
@@ -4520,7 +4546,7 @@ rectengine_c *gui_message_item_c::split_super_message( ts::aint index, rectengin
 
     if ( sm->to == sm->from )
     {
-        setup_normal( historian->get_history( sm->from ) );
+        setup_normal( historian->get_history( sm->from ), sm->from );
 
         if (splt == SMSPLIT_FIRST)
             r1 = &this->getengine();
@@ -4565,6 +4591,7 @@ void gui_message_item_c::setup_super_message( gui_message_item_c *other )
         }
 
         sm->to = sm->from;
+        historian->history_evict( sm->from ); // collapsed posts keep only index; text will be paged in on split
 
         addition.reset( sm );
         mt = MTA_SUPERMESSAGE;
@@ -4579,6 +4606,7 @@ void gui_message_item_c::setup_super_message( gui_message_item_c *other )
     if ( !other->is_super_message() && ASSERT( historian->history_size() > sm->to + 1 && other->utag == historian->get_history(sm->to + 1).utag ) )
     {
         ++sm->to;
+        historian->history_evict( sm->to );
         TSDEL( other );
         return;
     }
@@ -4599,7 +4627,7 @@ bool gui_message_item_c::setup_super_message( contact_root_c *cr, ts::aint post_
     if ( post_index2 == post_index )
     {
         // looks like split to normal message
-        setup_normal( historian->get_history(post_index) );
+        setup_normal( historian->get_history(post_index), post_index );
         return true;
     }
 
@@ -4761,7 +4789,7 @@ void gui_message_item_c::setup_found_item( uint64 prev, uint64 next )
     MODIFY( *this ).highlight(true);
 }
 
-void gui_message_item_c::setup_text( const post_s &post )
+void gui_message_item_c::setup_text( const post_s &post, ts::aint post_index )
 {
     if ( is_super_message() )
     {
@@ -4775,6 +4803,9 @@ void gui_message_item_c::setup_text( const post_s &post )
         return;
     }
 
+    if ( historian )
+        historian->history_page_in( post, post_index ); // text of far post could be evicted
+
     prepare_text_time( post.get_crtime() );
 
     utag = post.utag;
@@ -6939,7 +6970,7 @@ ts::uint32 gui_messagelist_c::gm_handler(gmsg<ISOGM_SUMMON_POST> &p)
 
                 MEMT( MEMT_MESSAGE_ITEM_2 );
 
-                mi->setup_text( p.post );
+                mi->setup_text( p.post, p.post_index );
                 if ( p.replace_post && p.post.mt() != MTA_RECV_FILE && p.post.mt() != MTA_SEND_FILE )
                     h->reselect();
             }
@@ -322,7 +322,7 @@ public:
 };
 
 struct av_contact_s;
-class gui_notice_callinprogress_c : public gui_notice_c
+class gui_notice_callinprogress_c : public gui_notice_c, public video_display_owner_s
 {
     typedef gui_notice_c super;
 
@@ -423,7 +423,7 @@ class gui_notice_conference_c : public gui_notice_c
 {
     typedef gui_notice_c super;
 
-    GM_RECEIVER(gui_notice_conference_c, ISOGM_V_UPDATE_CONTACT);
+    GM_RECEIVER_KEYED(gui_notice_conference_c, ISOGM_V_UPDATE_CONTACT);
 
     static const ts::flags32_s::BITS F_FIRST_TIME = F_FREEBITSTART_NOTICE << 0;
     static const ts::flags32_s::BITS F_COLLAPSED = F_FREEBITSTART_NOTICE << 1;
@@ -470,8 +470,8 @@ public:
 class folder_share_c;
 class gui_notice_foldershare_c : public gui_notice_c
 {
-    GM_RECEIVER(gui_notice_foldershare_c, ISOGM_FOLDER_SHARE);
-    GM_RECEIVER(gui_notice_foldershare_c, ISOGM_FOLDER_SHARE_UPDATE);
+    GM_RECEIVER_KEYED(gui_notice_foldershare_c, ISOGM_FOLDER_SHARE);
+    GM_RECEIVER_KEYED(gui_notice_foldershare_c, ISOGM_FOLDER_SHARE_UPDATE);
 
     typedef gui_notice_c super;
 
@@ -879,7 +879,7 @@ public:
     void set_no_author( bool f = true ) { bool ona = flags.is(F_NO_AUTHOR); flags.init(F_NO_AUTHOR, f); if (ona != f) flags.set(F_DIRTY_HEIGHT_CACHE); }
 
     void setup_found_item( uint64 prev, uint64 next );
-    void setup_text( const post_s &post );
+    void setup_text( const post_s &post, ts::aint post_index = -1 ); // post_index - index of post in history of historian, if known
     bool delivered(uint64 utag);
     uint64 get_utag() const {return utag;}
 
@@ -900,7 +900,7 @@ public:
     void setup_super_message( gui_message_item_c *other );
     void add_post_index( ts::aint post_index, ts::aint cnt = 1 );
     rectengine_c * split_super_message( ts::aint index, rectengine_c &e_parent, smsplit_e splt, ts::aint index_split = -1 );
-    bool setup_normal( const post_s&p ); // true if deletes self
+    bool setup_normal( const post_s&p, ts::aint post_index = -1 ); // true if deletes self
     ts::ivec2 smrange() const
     {
         ASSERT( is_super_message() && addition.get() );
@@ -1090,10 +1090,10 @@ struct spellchecker_s
 
     void check_text(const ts::wsptr &t, int caret);
     void undo_check(const ts::astrings_c &words);
-    void check_result(const ts::str_c &w, bool is_valid, ts::astrings_c &&suggestions);
+    virtual void check_result(const ts::str_c &w, bool is_valid, ts::astrings_c &&suggestions); // base thread; virtual for receivers other than message editor (tests)
     bool update_bad_words(RID r = RID(), GUIPARAM p = nullptr);
 
-    ~spellchecker_s();
+    virtual ~spellchecker_s();
 
     DECLARE_EYELET(spellchecker_s);
 };
@@ -622,6 +622,7 @@ void emoticons_c::reload()
     }
 
     generate_full_frame();
+    build_matcher();
 
     for( backup_s &b : bse )
     {
@@ -639,6 +640,114 @@ void emoticons_c::reload()
     }
 }
 
+void emoticons_c::build_matcher()
+{
+    acstates.clear();
+    acgoto.clear();
+
+    acstate_s &root = acstates.add();
+    root.fail = 0;
+    root.mpi = -1;
+    root.dict = 0;
+
+    // trie
+    ts::aint cnt = matchs.size();
+    for ( int i = 0; i < cnt; ++i )
+    {
+        match_point_s &mp = matchs.get( i );
+
+        mp.shortsmile = true;
+        if ( mp.s.get_length() > 4 )
+            mp.shortsmile = false;
+        else if ( mp.s.get_char( 0 ) == mp.s.get_last_char() && ')' != mp.s.get_char( 0 ) && '(' != mp.s.get_char( 0 ) )
+            mp.shortsmile = false;
+        else if ( skip_utf8_char( mp.s, 0 ) == mp.s.get_length() )
+            mp.shortsmile = false;
+
+        int state = 0;
+        for ( int j = 0; j < mp.s.get_length(); ++j )
+        {
+            bool added;
+            int &next = acgoto.add( state * 256 + (ts::uint8)mp.s.get_char( j ), added );
+            if ( added )
+            {
+                next = static_cast<int>( acstates.count() );
+                acstate_s &st = acstates.add();
+                st.fail = 0;
+                st.mpi = -1;
+                st.dict = 0;
+            }
+            state = next;
+        }
+        acstates.get( state ).mpi = i;
+    }
+
+    // fail links, breadth first
+    struct edge_s
+    {
+        int parent;
+        int child;
+        int depth;
+        ts::uint8 c;
+    };
+    ts::tmp_tbuf_t<edge_s> edges;
+    ts::tmp_tbuf_t<int> depth;
+    depth.set_count( acstates.count() );
+    depth.get( 0 ) = 0;
+    for ( int i = 0; i < cnt; ++i )
+    {
+        const match_point_s &mp = matchs.get( i );
+        int state = 0;
+        for ( int j = 0; j < mp.s.get_length(); ++j )
+        {
+            ts::uint8 c = (ts::uint8)mp.s.get_char( j );
+            state = *acgoto.get( state * 256 + c );
+            depth.get( state ) = j + 1;
+        }
+    }
+    for ( auto it = acgoto.begin(); it; ++it )
+    {
+        edge_s &e = edges.add();
+        e.parent = it.key() >> 8;
+        e.c = (ts::uint8)( it.key() & 255 );
+        e.child = *it;
+        e.depth = depth.get( e.child );
+    }
+    edges.q_sort<edge_s>( []( const edge_s *e1, const edge_s *e2 ) { return e1->depth < e2->depth; } );
+
+    for ( const edge_s &e : edges )
+    {
+        int fail = 0;
+        if ( e.parent )
+        {
+            for ( int f = acstates.get( e.parent ).fail;; f = acstates.get( f ).fail )
+            {
+                if ( const int *n = acgoto.get( f * 256 + e.c ) )
+                {
+                    fail = *n;
+                    break;
+                }
+                if ( f == 0 ) break;
+            }
+        }
+        acstate_s &st = acstates.get( e.child );
+        st.fail = fail;
+        const acstate_s &fst = acstates.get( fail );
+        st.dict = fst.mpi >= 0 ? fail : fst.dict;
+    }
+}
+
+int emoticons_c::acnext( int state, ts::uint8 c ) const
+{
+    for ( ;; state = acstates.get( state ).fail )
+    {
+        if ( const int *n = acgoto.get( state * 256 + c ) )
+            return *n;
+        if ( state == 0 )
+            return 0;
+    }
+}
+
 void emoticons_c::parse( ts::str_c &t, bool to_unicode )
 {
     struct rpl_s
@@ -699,76 +808,82 @@ void emoticons_c::parse( ts::str_c &t, bool to_unicode )
 
     bool skip_short = !prf_options().is(MSGOP_REPLACE_SHORT_SMILEYS);
 
-    for( const match_point_s&mp : matchs )
+    // find all occurrences of all match points by one pass
+    struct occ_s
+    {
+        int mpi;
+        int index;
+    };
+    ts::tmp_tbuf_t<occ_s> occs;
+    int state = 0;
+    for ( int i = 0, l = acstates.count() ? t.get_length() : 0; i < l; ++i )
     {
-        if (skip_short)
+        state = acnext( state, (ts::uint8)t.get_char( i ) );
+        for ( int o = acstates.get( state ).mpi >= 0 ? state : acstates.get( state ).dict; o; o = acstates.get( o ).dict )
         {
-            if (mp.s.get_length() > 4)
-                goto process;
-            if (mp.s.get_char(0) == mp.s.get_last_char() && ')' != mp.s.get_char(0) && '(' != mp.s.get_char(0))
-                goto process;
-            if (skip_utf8_char(mp.s, 0) == mp.s.get_length())
-                goto process;
-            continue;
+            int mpi = acstates.get( o ).mpi;
+            if ( skip_short && matchs.get( mpi ).shortsmile )
+                continue;
+            occ_s &occ = occs.add();
+            occ.mpi = mpi;
+            occ.index = i + 1 - matchs.get( mpi ).s.get_length();
         }
+    }
 
-        process:
+    // longer match points have priority (matchs is sorted by length), so process occurrences in order of match points
+    occs.q_sort<occ_s>( []( const occ_s *o1, const occ_s *o2 ) { return o1->mpi < o2->mpi || ( o1->mpi == o2->mpi && o1->index < o2->index ); } );
 
-        int sf = 0;
-        for(;;)
-        {
-            int i = t.find_pos( sf, mp.s );
-            if (i >= 0)
-            {
-                if ( mp.s.get_length() == 2 )
-                {
-                    // special hardcode
-                    // 2 char length smiles must be space-separated from other text
-                    if (i > 0 && t.get_char(i-1) != ' ')
-                    {
-                        sf += 2;
-                        continue;
-                    }
-                    if ( i+2 < t.get_length() && t.get_char( i+2 ) != ' ' )
-                    {
-                        sf += 2;
-                        continue;
-                    }
-                }
+    int sf = 0;
+    for ( ts::aint oi = 0, ocnt = occs.count(); oi < ocnt; ++oi )
+    {
+        const occ_s &occ = occs.get( oi );
+        if ( oi == 0 || occs.get( oi - 1 ).mpi != occ.mpi )
+            sf = 0;
+        int i = occ.index;
+        if ( i < sf )
+            continue; // overlaps previous occurrence of same match point
 
+        const match_point_s &mp = matchs.get( occ.mpi );
 
-                int r0 = i;
-                int r1 = i + mp.s.get_length();
-                sf = r1;
+        if ( mp.s.get_length() == 2 )
+        {
+            // special hardcode
+            // 2 char length smiles must be space-separated from other text
+            if ( ( i > 0 && t.get_char( i - 1 ) != ' ' ) || ( i + 2 < t.get_length() && t.get_char( i + 2 ) != ' ' ) )
+            {
+                while ( sf <= i ) sf += 2;
+                continue;
+            }
+        }
 
-                ts::aint insi = rpl.count();
-                bool fail = false;
-                for( const rpl_s & r : rpl )
-                {
-                    if (r0 < r.index)
-                    {
-                        ts::aint ii = &r - rpl.begin();
-                        if (ii < insi)
-                            insi = ii;
-                    }
+        int r0 = i;
+        int r1 = i + mp.s.get_length();
+        sf = r1;
 
-                    if (r1 > r.index && r0 < (r.index+r.sz))
-                    {
-                        fail = true;
-                        break;
-                    }
-                }
-                if (fail)
-                    continue;
+        ts::aint insi = rpl.count();
+        bool fail = false;
+        for ( const rpl_s & r : rpl )
+        {
+            if ( r0 < r.index )
+            {
+                ts::aint ii = &r - rpl.begin();
+                if ( ii < insi )
+                    insi = ii;
+            }
 
-                rpl_s &r = rpl.insert(insi);
-                r.index = r0;
-                r.sz = r1 - r0;
-                r.e = mp.e;
-                continue;
+            if ( r1 > r.index && r0 < ( r.index + r.sz ) )
+            {
+                fail = true;
+                break;
             }
-            break;
         }
+        if ( fail )
+            continue;
+
+        rpl_s &r = rpl.insert( insi );
+        r.index = r0;
+        r.sz = r1 - r0;
+        r.e = mp.e;
     }
 
     int addindex = 0;
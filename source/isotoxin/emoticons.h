@@ -34,11 +34,25 @@ class emoticons_c
     {
         const emoticon_s *e;
         ts::str_c s;
+        bool shortsmile; // replaced only if MSGOP_REPLACE_SHORT_SMILEYS
     };
 
     ts::bitmap_c fullframe;
     ts::array_inplace_t< match_point_s, 128 > matchs;
 
+    // Aho-Corasick automaton of all matchs (utf8 bytes); state 0 is root
+    struct acstate_s
+    {
+        int fail;
+        int mpi; // index of match point ends in this state or -1
+        int dict; // nearest state by fail links with mpi >= 0, or 0
+    };
+    ts::tbuf_t<acstate_s> acstates;
+    ts::flat_hashmap_t<int, int> acgoto; // state * 256 + char -> state
+
+    void build_matcher();
+    int acnext( int state, ts::uint8 c ) const;
+
     struct emo_gif_s : public emoticon_s, public picture_gif_c
     {
         emo_gif_s(int unicode):emoticon_s(unicode) {}
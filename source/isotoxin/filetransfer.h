@@ -24,6 +24,7 @@ struct file_transfer_s : public unfinished_file_transfer_s, public ts::task_c
         job_s() {}
     };
 
+    /*virtual*/ int priority() const override { return PRI_LOW; }
     /*virtual*/ int iterate(ts::task_executor_c *e) override;
     /*virtual*/ void done(bool canceled) override;
     /*virtual*/ void result() override;
@@ -372,6 +372,8 @@ void gui_filterbar_c::full_search_result( found_stuff_s::FOUND_STUFF_T &&stuff )
 
 bool gui_filterbar_c::do_contact_check(RID, GUIPARAM p)
 {
+    TRACE_SPAN( "clist.filter" );
+
     for ( ts::aint n = ts::tmax(1, contacts().count() / 10 ); contact_index < contacts().count() && n > 0; --n)
     {
         contact_c &c = contacts().get(contact_index++);
@@ -385,10 +387,12 @@ bool gui_filterbar_c::do_contact_check(RID, GUIPARAM p)
                 if (cr->gui_item) cr->gui_item->update_text();
             }
 
-            if ( cr->gui_item )
+            // filter works on contacts; item rect is touched only if its visibility really changes
+            cr->flag_filter_hidden = !check_one( cr );
+            if ( cr->gui_item && cr->gui_item->is_vis_filter() == cr->flag_filter_hidden )
             {
                 ASSERT( cr->gui_item->getrole() != CIR_ME );
-                cr->gui_item->vis_filter( check_one( cr ) );
+                cr->gui_item->vis_filter( !cr->flag_filter_hidden );
             }
         }
     }
@@ -416,6 +420,7 @@ void gui_filterbar_c::apply_full_text_search_result()
         if (contact_root_c *c = contacts().rfind(itm.historian))
         {
             c->flag_full_search_result = true;
+            c->flag_filter_hidden = false;
             if (c->gui_item)
             {
                 c->gui_item->update_text();
@@ -695,10 +700,8 @@ ts::uint32 gui_filterbar_c::gm_handler(gmsg<ISOGM_CHANGED_SETTINGS>&ch)
     return 0;
 }
 
-gui_filterbar_c::full_search_s::full_search_s( gui_filterbar_c *owner, const ts::wstrings_c &flt_ ) : db( db ), owner( owner )
+gui_filterbar_c::full_search_s::full_search_s( gui_filterbar_c *owner, const ts::wstrings_c &flt_ ) : owner( owner )
 {
-    db = prf().get_db();
-
     for ( const ts::wstr_c &s : flt_ )
         cc.fsplit.add( s.as_sptr() );
 
@@ -723,54 +726,9 @@ bool gui_filterbar_c::full_search_s::anm( RID, GUIPARAM )
 }
 
 
-bool gui_filterbar_c::full_search_s::reader(int row, ts::SQLITE_DATAGETTER getta)
-{
-    if (no_need)
-        return false;
-
-    ts::data_value_s v;
-
-    if (CHECK(ts::data_type_e::t_int == getta(history_s::C_ID, v))) // always id
-    {
-        if (CHECK(ts::data_type_e::t_int == getta(history_s::C_HISTORIAN, v)))
-        {
-            found_item_s &itm = add( contact_key_s::buildfromdbvalue(v.i, true) );
-
-            getta(history_s::C_UTAG, v);
-            if (ASSERT( itm.utags.find_index((uint64)v.i) < 0 ))
-                itm.utags.add( v.i );
-
-            if (itm.mintime == 0)
-            {
-                getta(history_s::C_RECV_TIME, v);
-                itm.mintime = v.i;
-            } else
-            {
-#ifdef _DEBUG
-                getta(history_s::C_RECV_TIME, v);
-                ASSERT( itm.mintime <= v.i );
-#endif
-            }
-
-        }
-    }
-    return true;
-}
-
 /*virtual*/ int gui_filterbar_c::full_search_s::iterate(ts::task_executor_c *e)
 {
-    // mtype 0 == MTA_MESSAGE
-    // mtype 1 == MTA_SYSTEM_MESSAGE
-    // mtype 107 == MTA_UNDELIVERED_MESSAGE
-    // mtype 110 == MTA_HIGHLIGHT_MESSAGE
-
-    // see is_message_mt()
-
-    cc.wstr.set_size( 4096 ); // most messages have smaller size
-
-    ts::str_c where(CONSTASTR("(mtype == 0 or mtype == 1 or mtype == 107 or mtype == 110) and msg like \"%" ) );
-    where.encode_pointer( &cc ).append( CONSTASTR( "\" order by mtime" ) );
-    db->read_table(CONSTASTR("history"), DELEGATE(this, reader), where);
+    prf().find_history_items( cc, found_stuff, no_need );
     return R_DONE;
 }
 /*virtual*/ void gui_filterbar_c::full_search_s::done(bool canceled)
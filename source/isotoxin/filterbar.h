@@ -7,19 +7,6 @@ template<> struct MAKE_CHILD<gui_filterbar_c> : public _PCHILD(gui_filterbar_c)
     ~MAKE_CHILD();
 };
 
-struct found_item_s : public ts::movable_flag<true>
-{
-    time_t mintime = 0;
-    contact_key_s historian;
-    ts::tbuf_t<uint64> utags;
-};
-struct found_stuff_s
-{
-    typedef ts::array_inplace_t<found_item_s, 32> FOUND_STUFF_T;
-    ts::wstrings_c fsplit;
-    FOUND_STUFF_T items;
-};
-
 class gui_filterbar_c : public gui_label_ex_c
 {
     DUMMY(gui_filterbar_c);
@@ -32,7 +19,6 @@ class gui_filterbar_c : public gui_label_ex_c
     struct full_search_s : public ts::task_c
     {
         ts::safe_ptr<gui_filterbar_c> owner;
-        ts::sqlitedb_c *db = nullptr;
         compare_context_s cc;
         process_animation_s pa;
         bool no_need = false;
@@ -44,18 +30,8 @@ class gui_filterbar_c : public gui_label_ex_c
         bool anm( RID, GUIPARAM );
 
         found_stuff_s::FOUND_STUFF_T found_stuff;
-        found_item_s &add( const contact_key_s &historian )
-        {
-            for( found_item_s &itm : found_stuff )
-                if (itm.historian == historian)
-                    return itm;
-            found_item_s &itm = found_stuff.add();
-            itm.historian = historian;
-            return itm;
-        }
-
-        bool reader(int row, ts::SQLITE_DATAGETTER getta);
 
+        /*virtual*/ int priority() const override { return PRI_HIGH; }
         /*virtual*/ int iterate(ts::task_executor_c *e) override;
         /*virtual*/ void done(bool canceled) override;
     };
@@ -138,7 +138,7 @@ public:
 
 class folder_share_send_c : public folder_share_c, public ts::folder_spy_handler_s
 {
-    GM_RECEIVER(folder_share_send_c, ISOGM_FOLDER_SHARE);
+    GM_RECEIVER_KEYED(folder_share_send_c, ISOGM_FOLDER_SHARE);
 
     folder_share_toc_packed_s toc;
 
@@ -160,6 +160,7 @@ class folder_share_send_c : public folder_share_c, public ts::folder_spy_handler
 public:
     folder_share_send_c(contact_key_s k, const ts::str_c &name_, uint64 utag) :folder_share_c(k, name_, utag)
     {
+        GM_KEY( ISOGM_FOLDER_SHARE, utag );
     }
     bool is_scaning() const { return scaning; }
 
@@ -174,7 +175,7 @@ public:
 
 class folder_share_recv_c : public folder_share_c
 {
-    GM_RECEIVER(folder_share_recv_c, ISOGM_FOLDER_SHARE);
+    GM_RECEIVER_KEYED(folder_share_recv_c, ISOGM_FOLDER_SHARE);
     GM_RECEIVER(folder_share_recv_c, ISOGM_V_UPDATE_CONTACT);
 
     void * worker = nullptr;
@@ -192,6 +193,7 @@ public:
 
     folder_share_recv_c(contact_key_s k, const ts::str_c &name_, uint64 utag) :folder_share_c(k, name_, utag)
     {
+        GM_KEY( ISOGM_FOLDER_SHARE, utag );
     }
     bool recv_waiting_file(int xtag, ts::wstr_c &fnpath);
     void accept(); // doesnt update notice
@@ -442,6 +442,7 @@ namespace
                 return no_need || should_stop(papa);
             }
 
+            /*virtual*/ int priority() const override { return PRI_HIGH; }
             /*virtual*/ int iterate(ts::task_executor_c *e) override
             {
                 papa = e;
@@ -1,13 +1,22 @@
 #include "isotoxin.h"
+#include "s3/decoder.h"
 
 //-V:cvt:807
 
 #define DEINIT_TIME 120000
 
+static void detach_preload_task( volatile void *task );
+
 mediasystem_c::~mediasystem_c()
 {
     deinit();
 
+    if (preloading)
+    {
+        detach_preload_task( preloading );
+        preloading = nullptr;
+    }
+
     while( ref > 0 )
     {
         s3::Update();
@@ -230,7 +239,200 @@ void mediasystem_c::play(const ts::blob_c &buf, float volume, bool signal_device
 
 }
 
-static ts::blob_c load_snd( sound_e snd, float &vol )
+namespace
+{
+    struct file_reader_s
+    {
+        const ts::blob_c &file;
+        ts::aint pos = 0;
+        file_reader_s( const ts::blob_c &file ):file( file ) {}
+        file_reader_s &operator=( const file_reader_s & ) = delete;
+
+        static s3::s3int read( char *dest, s3::s3int size, void *userPtr )
+        {
+            file_reader_s *r = (file_reader_s *)userPtr;
+            ts::aint sz = ts::tmin( (ts::aint)size, r->file.size() - r->pos );
+            memcpy( dest, r->file.data() + r->pos, sz );
+            r->pos += sz;
+            return sz;
+        }
+    };
+
+    struct sound_preload_task_s : public ts::task_c
+    {
+        struct snd_s
+        {
+            ts::wstr_c fn;
+            ts::blob_c file; // loaded in base thread
+            ts::blob_c raw; // decoded by worker
+        };
+        ts::array_inplace_t< snd_s, 4 > snds;
+        mediasystem_c *msys;
+
+        sound_preload_task_s( mediasystem_c *msys ):msys( msys ) {}
+
+        /*virtual*/ int iterate( ts::task_executor_c *e ) override
+        {
+            for ( snd_s &s : snds )
+            {
+                if ( should_stop( e ) )
+                    return R_CANCEL;
+                s.raw = mediasystem_c::decode_snd( s.file );
+            }
+            return R_DONE;
+        }
+        /*virtual*/ void done( bool canceled ) override
+        {
+            if ( msys && msys->get_preloading_object() == this )
+            {
+                if ( !canceled )
+                    for ( const snd_s &s : snds )
+                        if ( s.raw )
+                            msys->add_decoded( s.fn, s.raw );
+                msys->preloaded();
+            }
+
+            ts::task_c::done( canceled );
+        }
+    };
+}
+
+static void detach_preload_task( volatile void *task )
+{
+    ( (sound_preload_task_s *)task )->msys = nullptr;
+}
+
+s3::Format mediasystem_c::output_format()
+{
+    s3::InitParams ip; // players are initialized with default output format (see sound_init_task_s)
+    s3::Format fmt;
+    fmt.sampleRate = ip.sampleRate;
+    fmt.channels = (short)ip.channels;
+    fmt.bitsPerSample = (short)ip.bitsPerSample;
+    return fmt;
+}
+
+ts::blob_c mediasystem_c::decode_snd( const ts::blob_c &file )
+{
+    file_reader_s rdr( file );
+    s3::Decoder decoder;
+    if ( !decoder.init( file_reader_s::read, &rdr ) )
+        return ts::blob_c();
+
+    s3::Format ofmt = output_format();
+    ofmt.channels = decoder.format.channels; // mono sounds are mixed to all channels by player itself
+
+    ts::blob_c raw;
+    raw.append_buf( "RAW ", 4 );
+    raw.append_buf( &ofmt, sizeof( ofmt ) );
+    ts::aint hdrsize = raw.size();
+
+#pragma warning(push)
+#pragma warning(disable:4822) 
+    struct s //-V690
+    {
+        ts::blob_c &raw;
+        s( ts::blob_c &raw ):raw( raw ) {}
+        void operator=( const s& ) UNUSED;
+        void addpcm( const s3::Format&, const void *d, ts::aint sz )
+        {
+            if ( sz ) raw.append_buf( d, sz );
+        }
+
+    } ss( raw );
+#pragma warning(pop)
+
+    fmt_converter_s cvt;
+    cvt.ofmt = ofmt;
+    cvt.acceptor = DELEGATE( &ss, addpcm );
+
+    ts::tmp_buf_c portion;
+    portion.set_size( decoder.sampleSize * 4096, false );
+    for (;;)
+    {
+        s3::s3int sz = decoder.read( portion.data(), portion.size() );
+        sz -= sz % decoder.sampleSize;
+        if ( sz <= 0 )
+            break;
+        cvt.cvt( decoder.format, portion.data(), sz );
+    }
+
+    if ( raw.size() == hdrsize )
+        return ts::blob_c();
+
+    return raw;
+}
+
+void mediasystem_c::preload_sounds()
+{
+    ts::wstr_c fns[ snd_count ];
+#define SND(s) fns[ snd_##s ] = cfg().snd_##s();
+    SOUNDS
+#undef SND
+
+    // forget sounds that are not configured anymore
+    ts::hashmap_t< ts::wstr_c, ts::blob_c > keep;
+    pcm_size = 0;
+    for ( const ts::wstr_c &fn : fns )
+        if ( const ts::blob_c *raw = pcm.get( fn ) )
+        {
+            bool added;
+            ts::blob_c &b = keep.add( fn, added );
+            if ( added )
+                b = *raw, pcm_size += raw->size();
+        }
+    pcm = std::move( keep );
+
+    if ( preloading )
+    {
+        detach_preload_task( preloading );
+        preloading = nullptr;
+    }
+
+    sound_preload_task_s *task = nullptr;
+    for ( int i = 0; i < snd_count; ++i )
+    {
+        const ts::wstr_c &fn = fns[ i ];
+        if ( fn.is_empty() || pcm.get( fn ) )
+            continue;
+
+        bool dup = false;
+        for ( int j = 0; j < i && !dup; ++j )
+            dup = fns[ j ] == fn;
+        if ( dup )
+            continue;
+
+        if ( ts::blob_c file = ts::g_fileop->load( ts::fn_join( ts::pwstr_c( CONSTWSTR( "sounds" ) ), fn ) ) )
+        {
+            if ( !task )
+                task = TSNEW( sound_preload_task_s, this );
+            sound_preload_task_s::snd_s &s = task->snds.add();
+            s.fn = fn;
+            s.file = file;
+        }
+    }
+
+    if ( task )
+    {
+        preloading = task;
+        g_app->add_task( task );
+    }
+}
+
+void mediasystem_c::add_decoded( const ts::wstr_c &fn, const ts::blob_c &raw )
+{
+    if ( pcm_size + raw.size() > PCM_CACHE_LIMIT )
+        return; // too big; it will be played from file
+
+    bool added;
+    ts::blob_c &b = pcm.add( fn, added );
+    if ( !added )
+        pcm_size -= b.size();
+    b = raw;
+    pcm_size += raw.size();
+}
+
+ts::blob_c mediasystem_c::load_snd( sound_e snd, float &vol )
 {
     ts::wstr_c fn;
     switch (snd)
@@ -240,10 +442,13 @@ static ts::blob_c load_snd( sound_e snd, float &vol )
 #undef SND
     }
 
-    if (!fn.is_empty())
-        return ts::g_fileop->load(ts::fn_join(ts::pwstr_c(CONSTWSTR("sounds")),fn));
+    if (fn.is_empty())
+        return ts::blob_c();
+
+    if (const ts::blob_c *raw = pcm.get(fn))
+        return *raw;
 
-    return ts::blob_c();
+    return ts::g_fileop->load(ts::fn_join(ts::pwstr_c(CONSTWSTR("sounds")),fn));
 }
 
 bool mediasystem_c::stop_looped(sound_e snd)
@@ -285,30 +490,8 @@ void mediasystem_c::play_looped(sound_e snd, float volume, bool signal_device)
         loops[snd].reset( TSNEW( loop_play, player, buf, volume * vol ) );
 }
 
-void mediasystem_c::voice_player::add_data(const s3::Format &fmt, float vol, int dsp /* see fmt_converter_s::FO_* bits */, const void *d_in, ts::aint dsz, int clampms)
+void mediasystem_c::voice_player::add_data(const s3::Format &fmt, float vol, int dsp /* see fmt_converter_s::FO_* bits */, const void *d_in, ts::aint dsz, int clampms, uint64 msmonotonic)
 {
-    const void *d = d_in;
-
-    int avr = asum / ARRAY_SIZE(vals);
-    if (player->nodata || avr < 62)
-    {
-        DMSG("average " << avr);
-        DMSG("msms " << vals[0] << vals[1] << vals[2] << vals[3] << vals[4] << vals[5] << vals[6] << vals[7] << vals[8] << vals[9] << vals[10] << vals[11] << vals[12] << vals[13] << vals[14] << vals[15]);
-
-        void *dd = _alloca(dsz * 2);
-        d = dd;
-        int ss = fmt.sampleSize();
-        
-        for (int i = 0; i < dsz; i += ss)
-        {
-            memcpy(dd, (char*)d_in + i, ss);
-            memcpy((char *)dd + ss, (char*)d_in + i, ss);
-            dd = (char *)dd + (ss + ss);
-        }
-        dsz *= 2;
-        player->nodata = false;
-    }
-
     auto w = data.lock_write();
 
     if (fmt != format)
@@ -318,16 +501,11 @@ void mediasystem_c::voice_player::add_data(const s3::Format &fmt, float vol, int
         format = fmt;
     }
 
-    if (d == d_in)
-    {
-        if (avr > threshold && valptr == 0)
-        {
-            DMSG("average dec" << avr);
-
-            int ss = fmt.sampleSize();
-            dsz = ts::lround((dsz / ss) * 0.8f) * ss;
-        }
-    }
+    // jitter buffer stretches or shrinks packet to keep buffer level near target delay
+    w().stretched.clear();
+    w().jb.put( ts::Time::current().raw(), msmonotonic, format.bytesToMSec( (int)w().available() ), isPlaying(), fmt, d_in, dsz, w().stretched );
+    const void *d = w().stretched.data();
+    dsz = w().stretched.size();
 
     bool filter = false;
     if (vol > 1.0f || dsp)
@@ -376,36 +554,209 @@ void mediasystem_c::voice_player::add_data(const s3::Format &fmt, float vol, int
 
     }
 
-    asum -= vals[valptr];
-    int ms = format.bytesToMSec((int)w().available());
-    asum += ms;
-    vals[valptr] = ms;
-    valptr = (valptr + 1) & (ARRAY_SIZE(vals) - 1);
-
-    if (valptr == 0)
-    {
-        if (threshold > 80)
-            --threshold;
-
-        DMSG("average info" << avr << threshold);
-    }
-
-    //if (format.bytesToMSec(w().available()) > 200)
-    //{
-    //    player->SetPitch(player->GetPitch() * 1.05f); // make it play little faster
-    //}
-
     ts::aint clampbytes = format.avgBytesPerMSecs( clampms );
     ts::aint a = w().available();
     if (a > clampbytes)
         w().remove_data( a - clampbytes );
 
+    // start playing when target delay is buffered
+    bool start = format.bytesToMSec( (int)w().available() ) >= ts::tmin( w().jb.target(), clampms );
+
     w.unlock();
 
-    if (!isPlaying())
+    if (start && !isPlaying())
         play();
 }
 
+void voice_jitter_c::reset()
+{
+    last_arrival = 0;
+    last_sent = 0;
+    synth_sent = 0;
+    jitter16 = 0;
+    target_ms = MIN_TARGET_MS;
+    history.clear();
+    period.clear();
+    conceal_pos = 0;
+    conceal_max = 0;
+    concealing = false;
+}
+
+int voice_jitter_c::pitch_period( const ts::int16 *x, int n, int ch, int tmin, int tmax, bool from_end, float &corr )
+{
+    // best normalized correlation of two neighbour segments of length T; segments are at begining or at end of x
+    tmax = ts::tmin( tmax, n / 2 );
+    int best = -1;
+    corr = -1.0f;
+    for ( int t = tmin; t <= tmax; ++t )
+    {
+        const ts::int16 *a = from_end ? ( x + ( n - 2 * t ) * ch ) : x;
+        const ts::int16 *b = a + t * ch;
+        int step = ts::tmax( 1, t / 64 ) * ch; // coarse, but enough to find period of voice
+        double ab = 0, aa = 0, bb = 0;
+        for ( int i = 0, c = t * ch; i < c; i += step )
+        {
+            ab += (double)a[ i ] * b[ i ];
+            aa += (double)a[ i ] * a[ i ];
+            bb += (double)b[ i ] * b[ i ];
+        }
+        float cr = ( aa > 0 && bb > 0 ) ? (float)( ab / sqrt( aa * bb ) ) : 1.0f; // silence is perfectly periodic
+        if ( cr > corr )
+            corr = cr, best = t;
+    }
+    return best;
+}
+
+void voice_jitter_c::put( ts::uint64 arrival_ms, ts::uint64 sent_ms, int buffered_ms, bool playing, const s3::Format &fmt, const void *d, ts::aint sz, ts::buf_c &out )
+{
+    int packet_ms = fmt.bytesToMSec( (int)sz );
+
+    if ( 0 == sent_ms )
+    {
+        if ( 0 == synth_sent ) synth_sent = arrival_ms;
+        sent_ms = synth_sent;
+        synth_sent += packet_ms;
+    }
+
+    if ( last_arrival )
+    {
+        int dd = (int)( arrival_ms - last_arrival ) - (int)( sent_ms - last_sent );
+        jitter16 += ( dd < 0 ? -dd : dd ) - ( ( jitter16 + 8 ) >> 4 );
+
+        // grow fast, shrink slowly
+        int t = ts::CLAMP( packet_ms + 4 * jitter(), MIN_TARGET_MS, MAX_TARGET_MS );
+        target_ms = t > target_ms ? t : target_ms - ( target_ms - t + 15 ) / 16;
+    }
+    last_arrival = arrival_ms;
+    last_sent = sent_ms;
+
+    ++st.packets;
+    st.delay_sum += buffered_ms;
+
+    int ch = fmt.channels;
+    int n = (int)( sz / fmt.sampleSize() );
+    if ( fmt.bitsPerSample != 16 || n == 0 )
+    {
+        out.append_buf( d, sz );
+        return;
+    }
+
+    const ts::int16 *x = (const ts::int16 *)d;
+    int tmin = fmt.sampleRate / 400; // 2.5 ms, 400 Hz
+    int tmax = fmt.sampleRate / 100; // 10 ms, 100 Hz
+
+    bool accelerate = buffered_ms > target_ms + ts::tmax( 20, target_ms / 2 );
+    bool expand = playing && buffered_ms + packet_ms < target_ms;
+
+    float corr;
+    int t = ( ( accelerate || expand ) && n >= 2 * tmin ) ? pitch_period( x, n, ch, tmin, tmax, false, corr ) : -1;
+    if ( t > 0 && corr < 0.6f )
+        t = -1; // not periodic: stretching will be audible
+
+    auto crossfade = [ch]( ts::int16 *o, const ts::int16 *fadeout, const ts::int16 *fadein, int t )
+    {
+        for ( int i = 0; i < t; ++i )
+            for ( int c = 0; c < ch; ++c )
+                o[ i * ch + c ] = (ts::int16)( ( fadeout[ i * ch + c ] * ( t - i ) + fadein[ i * ch + c ] * i ) / t );
+    };
+
+    ts::int16 *o;
+    if ( t > 0 && accelerate )
+    {
+        // [0..T) and [T..2T) become one period
+        o = (ts::int16 *)out.expand( ( n - t ) * fmt.sampleSize() );
+        crossfade( o, x, x + t * ch, t );
+        memcpy( o + t * ch, x + 2 * t * ch, ( n - 2 * t ) * fmt.sampleSize() );
+        n -= t;
+        ++st.accelerated;
+
+    } else if ( t > 0 && expand )
+    {
+        // [0..T), then [T..2T) fading to [0..T), then [T..n)
+        o = (ts::int16 *)out.expand( ( n + t ) * fmt.sampleSize() );
+        memcpy( o, x, t * fmt.sampleSize() );
+        crossfade( o + t * ch, x + t * ch, x, t );
+        memcpy( o + 2 * t * ch, x + t * ch, ( n - t ) * fmt.sampleSize() );
+        n += t;
+        ++st.expanded;
+
+    } else
+    {
+        o = (ts::int16 *)out.expand( sz );
+        memcpy( o, x, sz );
+    }
+
+}
+
+void voice_jitter_c::played( const s3::Format &fmt, char *d, ts::aint size )
+{
+    if ( fmt.bitsPerSample != 16 || size <= 0 )
+        return;
+
+    int ch = fmt.channels;
+    ts::aint n = size / 2;
+    ts::int16 *x = (ts::int16 *)d;
+
+    if ( concealing )
+    {
+        // smooth join of concealment and real data
+        concealing = false;
+        int f = (int)ts::tmin( n / ch, (ts::aint)( fmt.sampleRate / 200 ) );
+        for ( int i = 0; i < f; ++i )
+            for ( int c = 0; c < ch; ++c )
+                x[ i * ch + c ] = (ts::int16)( x[ i * ch + c ] * i / f );
+    }
+    conceal_pos = 0;
+    conceal_max = fmt.sampleRate * CONCEAL_MS / 1000;
+
+    // keep last 20 ms
+    ts::aint keep = fmt.sampleRate / 50 * ch;
+    if ( n >= keep )
+    {
+        history.clear();
+        history.append_buf( x + n - keep, keep * 2 );
+        return;
+    }
+    history.append_buf( x, n * 2 );
+    if ( history.count() > keep )
+        history.cut( 0, ( history.count() - keep ) * 2 );
+}
+
+void voice_jitter_c::conceal( const s3::Format &fmt, char *dest, ts::aint size )
+{
+    int ch = fmt.channels;
+    int n = (int)( size / fmt.sampleSize() );
+    if ( fmt.bitsPerSample != 16 || history.count() < ch * 2 )
+    {
+        memset( dest, fmt.bitsPerSample == 8 ? 0x80 : 0, size );
+        return;
+    }
+
+    int hn = (int)( history.count() / ch );
+    if ( !concealing )
+    {
+        concealing = true;
+        ++st.underruns;
+
+        float corr;
+        int t = pitch_period( history.begin(), hn, ch, fmt.sampleRate / 400, fmt.sampleRate / 100, true, corr );
+        if ( t <= 0 ) t = hn;
+        period.clear();
+        period.append_buf( history.begin() + ( hn - t ) * ch, t * ch * 2 );
+    }
+
+    int t = (int)( period.count() / ch );
+    ts::int16 *o = (ts::int16 *)dest;
+    for ( int i = 0; i < n; ++i, ++conceal_pos )
+    {
+        int g = conceal_pos < conceal_max ? conceal_max - conceal_pos : 0; // linear fade to silence
+        const ts::int16 *s = period.begin() + ( conceal_pos % t ) * ch;
+        for ( int c = 0; c < ch; ++c )
+            o[ i * ch + c ] = (ts::int16)( (int)s[ c ] * g / conceal_max );
+    }
+    st.concealed_ms += fmt.bytesToMSec( (int)size );
+}
+
 void mediasystem_c::voice_player::protected_data_s::remove_data( ts::aint size )
 {
     if ( size < ( buf[ readbuf ].size() - readpos ) )
@@ -486,16 +837,31 @@ ts::aint mediasystem_c::voice_player::protected_data_s::read_data(const s3::Form
 
     ts::Time ndt = ts::Time::current();
 
-    if (!mute && w().available() == 0)
+    ts::aint avail = w().available();
+    if (!mute && avail == 0)
     {
-        int avg = (asum / ARRAY_SIZE(vals));
-        if (avg > threshold)
-            threshold = avg;
+        if ( w().jb.can_conceal() && !( ndt > nodatatime ) )
+        {
+            w().jb.conceal( format, dest, size );
+            return size;
+        }
 
         return (ndt > nodatatime) ? -1 : 0;
     }
     nodatatime = ndt + 1000;
-    return w().read_data(format, dest, size);
+
+    if ( !mute && avail < size && !w().begining )
+    {
+        // underrun: play rest of data, then conceal
+        ts::aint r = w().read_data( format, dest, avail );
+        w().jb.played( format, dest, r );
+        w().jb.conceal( format, dest + r, size - r );
+        return size;
+    }
+
+    ts::aint r = w().read_data(format, dest, size);
+    w().jb.played( format, dest, r );
+    return r;
 }
 
 void mediasystem_c::voice_player::shutdown()
@@ -529,7 +895,7 @@ void mediasystem_c::voice_volume( const uint64 &key, float vol )
 }
 
 
-bool mediasystem_c::play_voice( const uint64 &key, const s3::Format &fmt, const void *data, ts::aint size, float vol, int dsp, int clampms )
+bool mediasystem_c::play_voice( const uint64 &key, const s3::Format &fmt, const void *data, ts::aint size, float vol, int dsp, int clampms, uint64 msmonotonic )
 {
     if (!initialized)
     {
@@ -550,7 +916,7 @@ bool mediasystem_c::play_voice( const uint64 &key, const s3::Format &fmt, const
             if (vp(i).mute)
                 return true;
         namana:
-            vp(i).add_data(fmt, vol, dsp, data, size, clampms );
+            vp(i).add_data(fmt, vol, dsp, data, size, clampms, msmonotonic );
             return true;
         } else 
         {
@@ -610,7 +976,7 @@ void play_sound( sound_e sss, bool looped, bool forced )
     }
 
     float vol;
-    if (ts::blob_c buf = load_snd(sss, vol)) 
+    if (ts::blob_c buf = g_app->mediasystem().load_snd(sss, vol)) 
         g_app->mediasystem().play(buf, vol);
 }
 
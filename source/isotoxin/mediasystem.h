@@ -49,6 +49,61 @@ struct play_event_s
     }
 };
 
+/*
+    adaptive jitter buffer of voice channel
+    target delay follows interarrival jitter (RFC 3550 estimator), computed from sender timestamps or, if there are no timestamps, from packet durations
+    buffer level is moved to target by pitch-synchronous time-stretching (WSOLA-like) of incoming packets: one pitch period is removed or repeated with crossfade
+    underrun is concealed by repeating last pitch period with fading
+    only 16 bit pcm is stretched and concealed; other formats are passed as is
+*/
+class voice_jitter_c
+{
+public:
+    static const int MIN_TARGET_MS = 40;
+    static const int MAX_TARGET_MS = 400;
+    static const int CONCEAL_MS = 60; // after that concealment is silence
+
+    struct stats_s
+    {
+        int packets = 0;
+        int accelerated = 0; // packets shortened by one pitch period
+        int expanded = 0; // packets lengthened by one pitch period
+        int underruns = 0; // concealment events
+        int concealed_ms = 0;
+        ts::int64 delay_sum = 0; // sum of buffered ms measured on packet arrival
+    };
+
+private:
+    ts::uint64 last_arrival = 0;
+    ts::uint64 last_sent = 0;
+    ts::uint64 synth_sent = 0; // sender time built from packet durations
+    int jitter16 = 0; // jitter, 1/16 ms
+    int target_ms = MIN_TARGET_MS;
+
+    ts::tbuf0_t<ts::int16> history; // last played samples
+    ts::tbuf0_t<ts::int16> period; // pitch period used for concealment
+    int conceal_pos = 0; // frames generated by current concealment
+    int conceal_max = 0; // CONCEAL_MS in frames
+    bool concealing = false;
+
+    stats_s st;
+
+    static int pitch_period( const ts::int16 *x, int n, int ch, int tmin, int tmax, bool from_end, float &corr );
+
+public:
+
+    void reset();
+    int target() const { return target_ms; }
+    int jitter() const { return jitter16 / 16; }
+    const stats_s &stats() const { return st; }
+    bool can_conceal() const { return history.count() > 0 && conceal_pos < conceal_max; }
+
+    // arrival_ms - local time of arrival; sent_ms - sender timestamp (0 - unknown); buffered_ms - data waiting for play
+    void put( ts::uint64 arrival_ms, ts::uint64 sent_ms, int buffered_ms, bool playing, const s3::Format &fmt, const void *d, ts::aint sz, ts::buf_c &out );
+    void conceal( const s3::Format &fmt, char *dest, ts::aint size ); // no data to play
+    void played( const s3::Format &fmt, char *d, ts::aint size ); // data goes to device; first data after concealment is faded in
+};
+
 class mediasystem_c
 {
     s3::Player talks;
@@ -70,14 +125,12 @@ class mediasystem_c
     struct voice_player : s3::RawSource
     {
         ts::Time nodatatime = ts::Time::past();
-        int threshold = 80;
-        int asum = 0;
-        int valptr = 0;
-        int vals[16] = {};
 
         struct protected_data_s
         {
             UNIQUE_PTR(fmt_converter_s) cvt;
+            voice_jitter_c jb;
+            ts::buf_c stretched; // jitter buffer output
             ts::buf_c buf[2];
             int readbuf = 0;
             int newdata = 0;
@@ -91,6 +144,7 @@ class mediasystem_c
                 newdata = 0;
                 readpos = 0;
                 begining = true;
+                jb.reset();
             }
             void add_data(const void *d, ts::aint s)
             {
@@ -109,7 +163,7 @@ class mediasystem_c
             format.bitsPerSample = 16;
         }
 
-        void add_data(const s3::Format &fmt, float vol, int dsp /* see fmt_converter_s::FO_* bits */, const void *dest, ts::aint size, int clampms);
+        void add_data(const s3::Format &fmt, float vol, int dsp /* see fmt_converter_s::FO_* bits */, const void *dest, ts::aint size, int clampms, uint64 msmonotonic);
         /*virtual*/ s3::s3int rawRead(char *dest, s3::s3int size) override;
 
         void shutdown();
@@ -122,11 +176,17 @@ class mediasystem_c
     char rawps[ MAX_RAW_PLAYERS * sizeof( voice_player ) ] = {};
     UNIQUE_PTR( loop_play ) loops[ snd_count ];
 
+    // decoded sounds by file name; blob is "RAW " + s3::Format + pcm in output format, so MSource plays it without decoding
+    // base thread only (blob_c refs are not atomic)
+    ts::hashmap_t< ts::wstr_c, ts::blob_c > pcm;
+    ts::aint pcm_size = 0;
+
     int ref = 0;
 
     ts::Time deinit_time = ts::Time::current() + 60000;
     volatile bool initialized = false;
     volatile void *initializing = nullptr;
+    volatile void *preloading = nullptr;
 
     voice_player &vp(int i) { return *(voice_player *)(rawps + i * sizeof(voice_player)); }
     void init( play_event_s &&evt ); // loads params from cfg
@@ -149,6 +209,16 @@ public:
     volatile void *get_initializing_object() { return initializing; }
     s3::Player *set_players( s3::Player &&talks, s3::Player *notifs );
 
+    static const ts::aint PCM_CACHE_LIMIT = 16 * 1024 * 1024; // bytes of decoded sounds
+
+    static s3::Format output_format();
+    static ts::blob_c decode_snd( const ts::blob_c &file ); // any supported sound file -> "RAW " blob in output format; can be called from any thread
+    void preload_sounds(); // decode configured sounds in background; also drops cached sounds that are not configured anymore
+    volatile void *get_preloading_object() { return preloading; }
+    void preloaded() { preloading = nullptr; }
+    void add_decoded( const ts::wstr_c &fn, const ts::blob_c &raw );
+    ts::blob_c load_snd( sound_e snd, float &vol ); // decoded sound from cache or sound file as is
+
     void test_talk(float vol);
     void test_signal(float vol);
 
@@ -168,7 +238,7 @@ public:
     }
     void voice_mute(const uint64 &key, bool mute);
     void voice_volume( const uint64 &key, float vol ); 
-    bool play_voice( const uint64 &key, const s3::Format &fmt, const void *data, ts::aint size, float vol, int dsp, int clampms = 1000 );
+    bool play_voice( const uint64 &key, const s3::Format &fmt, const void *data, ts::aint size, float vol, int dsp, int clampms = 1000, uint64 msmonotonic = 0 /* sender timestamp, if known */ );
     void free_voice_channel( const uint64 &key ); 
 };
 
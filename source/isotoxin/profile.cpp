@@ -1156,63 +1156,32 @@ template<typename T, profile_table_e tabi> bool tableview_t<T, tabi>::flush( ts:
 {
     if ( !db ) return false;
 
+    TRACE_SPAN( tabi == pt_history ? "history.flush" : "profile.flush" );
     ts::db_transaction_c __transaction( db );
 
     MEMT( MEMT_SQLITE );
 
-    ts::tmp_array_inplace_t<ts::data_pair_s, 0> vals( T::columns );
     const int n_per_call = 10;
     int n_done = 0;
     bool some_action = false;
+    bool stopped = false;
+    ts::tmp_pointers_t<row_s, 0> insrows[ 2 ]; // [0] - new rows (id will be assigned by db), [1] - rows with id
     for(row_s &r: rows)
     {
         switch (r.st)
         {
         case row_s::s_new:
-            if ( n_done >= n_per_call ) return true;
         case row_s::s_changed:
-            if ( n_done >= n_per_call ) return true;
+            if ( n_done >= n_per_call ) { stopped = true; break; }
             if (ASSERT(r.id != 0))
             {
-                vals.clear();
-                if (r.id > 0)
-                {
-                    ts::data_pair_s &dpair = vals.add();
-                    dpair.type_ = ts::data_type_e::t_int;
-                    dpair.name = CONSTASTR("id");
-                    dpair.i = r.id;
-                }
-
-                for(int i=1;i<T::columns;++i)
-                {
-                    ts::data_pair_s &dpair = vals.add();
-                    r.other.get(i,dpair);
-                }
-                some_action = true;
-                int newid = db->insert(T::get_table_name(), vals.array());
-                if (r.id < 0)
-                {
-                    if (limit_id<T>::value > 0 && newid > limit_id<T>::value)
-                    {
-                        int other_newid = db->find_free(T::get_table_name(), CONSTASTR("id"));
-                        ts::data_pair_s idp;
-                        idp.name = CONSTASTR("id");
-                        idp.type_ = ts::data_type_e::t_int;
-                        idp.i = other_newid;
-                        db->update(T::get_table_name(), ts::array_wrapper_c<const ts::data_pair_s>(&idp, 1), ts::amake<uint>(CONSTASTR("id="), newid));
-                        newid = other_newid;
-                    }
-
-                    new2ins[r.id] = newid;
-                }
-                r.id = newid;
-                r.st = row_s::s_unchanged;
+                insrows[ r.id > 0 ? 1 : 0 ].add( &r );
                 if ( !all )
                     ++n_done;
             }
             continue;
         case row_s::s_delete:
-            if ( n_done >= n_per_call ) return true;
+            if ( n_done >= n_per_call ) { stopped = true; break; }
             some_action = true;
             db->delrow(T::get_table_name(), r.id);
             r.st = row_s::s_deleted;
@@ -1223,8 +1192,75 @@ template<typename T, profile_table_e tabi> bool tableview_t<T, tabi>::flush( ts:
         case row_s::s_temp:
             continue;
         }
+        if ( stopped ) break;
+    }
+
+    // rows of each group are inserted by one prepared statement
+    ts::tmp_array_inplace_t<ts::data_pair_s, 0> vals( T::columns );
+    ts::tmp_tbuf_t<int> newids;
+    for ( int g = 0; g < 2; ++g )
+    {
+        ts::aint cnt = insrows[ g ].size();
+        if ( cnt == 0 ) continue;
+
+        vals.clear();
+        for ( row_s *r : insrows[ g ] )
+        {
+            if ( g == 1 )
+            {
+                ts::data_pair_s &dpair = vals.add();
+                dpair.type_ = ts::data_type_e::t_int;
+                dpair.name = CONSTASTR( "id" );
+                dpair.i = r->id;
+            }
+
+            for ( int i = 1; i < T::columns; ++i )
+            {
+                ts::data_pair_s &dpair = vals.add();
+                r->other.get( i, dpair );
+            }
+        }
+
+        some_action = true;
+        newids.set_count( cnt, false );
+        db->insert_rows( T::get_table_name(), vals.array(), g == 1 ? T::columns : T::columns - 1, newids.begin() );
+
+        for ( ts::aint j = 0; j < cnt; ++j )
+        {
+            row_s &r = *insrows[ g ].get( j );
+            int newid = newids.get( j );
+            if (r.id < 0)
+            {
+                if (limit_id<T>::value > 0 && newid > limit_id<T>::value)
+                {
+                    int other_newid = db->find_free(T::get_table_name(), CONSTASTR("id"));
+                    ts::data_pair_s idp;
+                    idp.name = CONSTASTR("id");
+                    idp.type_ = ts::data_type_e::t_int;
+                    idp.i = other_newid;
+                    db->update(T::get_table_name(), ts::array_wrapper_c<const ts::data_pair_s>(&idp, 1), ts::amake<uint>(CONSTASTR("id="), newid));
+                    newid = other_newid;
+                }
+
+                new2ins[r.id] = newid;
+            }
+            if ( r.id != newid )
+            {
+                int ri = static_cast<int>( &r - &rows.get( 0 ) );
+                if ( ri < indexed )
+                {
+                    idindex.remove( r.id );
+                    idindex[ newid ] = ri;
+                }
+            }
+            r.id = newid;
+            r.st = row_s::s_unchanged;
+        }
     }
 
+    if ( stopped )
+        return true;
+
     __transaction.end();
     if (notify_saved && some_action) gmsg<ISOGM_PROFILE_TABLE_SL>( tabi, true ).send();
     return false;
@@ -1247,8 +1283,11 @@ template<typename T> typename tableview_t<T>::row_s tableview_t<T>::del(int id)
 template<typename T, profile_table_e tabi> typename tableview_t<T, tabi>::row_s &tableview_t<T, tabi>::getcreate(int id)
 {
     if (id)
-        for(row_s &r : rows)
-            if(r.id == id) return r;
+    {
+        update_index();
+        if ( const int *ri = idindex.get( id ) )
+            return rows.get( *ri );
+    }
 
     row_s &r = rows.add();
     if (id != 0)
@@ -1288,13 +1327,17 @@ template<typename T, profile_table_e tabi> bool tableview_t<T, tabi>::reader(int
 template<typename T, profile_table_e tabi> void tableview_t<T, tabi>::read( ts::sqlitedb_c *db )
 {
     db->read_table( T::get_table_name(), DELEGATE(this, reader) );
+    update_timeindex(); // one sort of all loaded rows
     gmsg<ISOGM_PROFILE_TABLE_SL>( tabi, false ).send();
 }
 
 template<typename T, profile_table_e tabi> void tableview_t<T, tabi>::read( ts::sqlitedb_c *db, const ts::asptr &where_items )
 {
     if (db)
+    {
         db->read_table(T::get_table_name(), DELEGATE(this, reader), where_items);
+        update_timeindex();
+    }
 }
 
 ts::wstr_c& profile_c::path_by_name(ts::wstr_c &profname)
@@ -1450,7 +1493,7 @@ int profile_c::min_history_load(bool for_button)
 
 void profile_c::kill_history_item(uint64 utag)
 {
-    if(auto *row = table_history.find<true>([&](history_s &h) ->bool { return h.utag == utag; }))
+    if(auto *row = table_history.find_by_utag<true>(utag))
         if ( row->deleted() )
         {
             changed();
@@ -1475,6 +1518,7 @@ void profile_c::unload_history( const contact_key_s&historian )
         if ( table_history.rows.get(i).other.historian == historian )
             table_history.rows.remove_slow( i );
     }
+    table_history.reindex();
 }
 
 void profile_c::change_history_items( const contact_key_s &historian, const contact_key_s &old_sender, const contact_key_s &new_sender )
@@ -1504,18 +1548,16 @@ bool profile_c::change_history_item(uint64 utag, contact_key_s & historian)
     ts::db_transaction_c __transaction( db );
 
     bool ok = false;
-    table_history.cleanup();
-    table_history.find<true>([&](history_s &h) ->bool
+    auto *row = table_history.find_by_utag<true>( utag );
+    if ( row && row->other.type != MTA_UNDELIVERED_MESSAGE ) // not unique utag?
+        row = table_history.find<true>( [&]( history_s &h ) ->bool { return h.utag == utag && h.type == MTA_UNDELIVERED_MESSAGE; } );
+    if ( row )
     {
-        if (h.utag == utag && h.type == MTA_UNDELIVERED_MESSAGE)
-        {
-            h.type = MTA_MESSAGE;
-            historian = h.historian;
-            ok = true;
-            return true;
-        }
-        return false;
-    });
+        history_s &h = row->other;
+        h.type = MTA_MESSAGE;
+        historian = h.historian;
+        ok = true;
+    }
 
     ts::tmp_str_c whr(CONSTASTR("utag=")); whr.append_as_num<int64>(ts::ref_cast<int64>(utag));
     whr.append(CONSTASTR(" and sender=0"));
@@ -1535,18 +1577,16 @@ void profile_c::change_history_item(const contact_key_s&historian, const post_s
     if (!change_what) return;
     ts::db_transaction_c __transaction( db );
 
-    table_history.cleanup();
-    table_history.find<true>([&](history_s &h) ->bool
+    auto *row = table_history.find_by_utag<true>( post.utag );
+    if ( row && row->other.historian != historian ) // not unique utag?
+        row = table_history.find<true>( [&]( history_s &h ) ->bool { return h.historian == historian && h.utag == post.utag; } );
+    if ( row )
     {
-        if (h.historian == historian && h.utag == post.utag)
-        {
-            if (0 != (change_what & HITM_MT)) h.type = post.type;
-            if (0 != (change_what & HITM_TIME)) h.recv_time = post.recv_time, h.cr_time = post.cr_time;;
-            if (0 != (change_what & HITM_MESSAGE)) h.message_utf8 = post.message_utf8;
-            return true;
-        }
-        return false;
-    });
+        history_s &h = row->other;
+        if (0 != (change_what & HITM_MT)) h.type = post.type;
+        if (0 != (change_what & HITM_TIME)) h.recv_time = post.recv_time, h.cr_time = post.cr_time, table_history.reindex();
+        if (0 != (change_what & HITM_MESSAGE)) h.message_utf8 = post.message_utf8;
+    }
 
     ts::tmp_str_c whr(CONSTASTR("historian=")); whr.append_as_num(historian.dbvalue());
     whr.append( CONSTASTR(" and utag=") ).append_as_num<int64>(ts::ref_cast<int64>(post.utag));
@@ -1593,7 +1633,7 @@ void profile_c::kill_message( uint64 msgutag )
 
 }
 
-void profile_c::load_history( const contact_key_s&historian, allocpost *cb, void *prm )
+void profile_c::load_history( const contact_key_s&historian, allocpost *cb, void *prm, bool texts )
 {
     ts::tmp_str_c whr( CONSTASTR( "historian=" ) ); whr.append_as_num( historian.dbvalue() );
     whr.append( CONSTASTR( " order by mtime" ) );
@@ -1603,12 +1643,14 @@ void profile_c::load_history( const contact_key_s&historian, allocpost *cb, void
         allocpost *cb;
         void *prm;
         ts::data_value_s dv;
+        bool texts;
 
         bool dr( int row, ts::SQLITE_DATAGETTER dg )
         {
-            dg( history_s::C_MSG, dv );
+            if ( texts )
+                dg( history_s::C_MSG, dv );
 
-            post_s *p = cb( dv.text, prm );
+            post_s *p = cb( texts ? dv.text.as_sptr() : ts::asptr(), prm );
 
             dg( history_s::C_RECV_TIME, dv );
             p->recv_time = dv.i;
@@ -1650,7 +1692,56 @@ void profile_c::load_history( const contact_key_s&historian, allocpost *cb, void
 
     r.cb = cb;
     r.prm = prm;
+    r.texts = texts;
+
+    db->read_table( history_s::get_table_name(), DELEGATE( &r, dr ), whr );
+}
+
+void profile_c::load_history_texts( const contact_key_s&historian, const uint64 *utags, ts::aint n, loadtext *cb, void *prm )
+{
+    ts::tmp_str_c whr( CONSTASTR( "historian=" ) ); whr.append_as_num( historian.dbvalue() );
+    whr.append( CONSTASTR( " and utag in (" ) );
+    bool indb = false;
+    for ( ts::aint i = 0; i < n; ++i )
+    {
+        uint64 utag = utags[ i ];
+        auto *row = table_history.find_by_utag<true>( utag );
+        if ( row && row->other.historian != historian ) // not unique utag?
+            row = table_history.find<true>( [&]( history_s &h ) ->bool { return h.historian == historian && h.utag == utag; } );
+        if ( row )
+        {
+            // not yet flushed or just loaded
+            cb( utags[ i ], row->other.message_utf8->cstr(), prm );
+            continue;
+        }
+        if ( indb )
+            whr.append_char( ',' );
+        whr.append_as_num<int64>( ts::ref_cast<int64>( utags[ i ] ) );
+        indb = true;
+    }
+    if ( !indb )
+        return;
+    whr.append_char( ')' );
+
+    struct rht
+    {
+        loadtext *cb;
+        void *prm;
+        ts::data_value_s dv;
+
+        bool dr( int row, ts::SQLITE_DATAGETTER dg )
+        {
+            dg( history_s::C_UTAG, dv );
+            uint64 utag = dv.i;
+            dg( history_s::C_MSG, dv );
+            cb( utag, dv.text.as_sptr(), prm );
+            return true;
+        }
 
+    } r;
+
+    r.cb = cb;
+    r.prm = prm;
     db->read_table( history_s::get_table_name(), DELEGATE( &r, dr ), whr );
 }
 
@@ -1684,6 +1775,7 @@ void profile_c::load_history( const contact_key_s&historian, time_t time, ts::ai
         {
             if (row.other.historian != historian || row.other.recv_time < time) continue;
             row.other.recv_time = (++ct);
+            table_history.reindex();
             bool fixed = fix(row.other);
 
             whr.set(CONSTASTR("utag=")); whr.append_as_num<int64>(ts::ref_cast<int64>(row.other.utag));
@@ -1706,17 +1798,11 @@ void profile_c::load_history( const contact_key_s&historian, time_t time, ts::ai
 
     typedef tableview_t<history_s, pt_history>::row_s hitm;
     ts::tmp_pointers_t< hitm, 16 > candidates;
-    for (auto &hi : table_history.rows)
-        if (!hi.is_deleted())
-            if (hi.other.historian == historian && hi.other.recv_time < time)
-                candidates.add(&hi);
-    if (candidates.size() > nload)
-    {
-        candidates.sort([](hitm *p1, hitm *p2)->bool {
-            return p1->other.recv_time > p2->other.recv_time;
-        });
-        candidates.truncate(nload);
-    } // else - no else here
+    if ( nload > 0 )
+        table_history.iterate_history<true>( historian.dbvalue(), time, [&]( hitm &hi ) ->bool {
+            candidates.add( &hi );
+            return candidates.size() < nload;
+        } ); // newest first, so candidates are already sorted and truncated
     if (candidates.size() == nload)
     {
         for (auto *hi : candidates)
@@ -1787,6 +1873,7 @@ void profile_c::detach_history( const contact_key_s&prev_historian, const contac
     }
     if (changed)
     {
+        table_history.reindex();
         this->changed();
         table_history.flush(db, true, false); // very important to save now
     }
@@ -1829,7 +1916,10 @@ void profile_c::merge_history( const contact_key_s&base_historian, const contact
         }
     }
     if (changed)
+    {
+        table_history.reindex();
         this->changed();
+    }
 }
 
 void profile_c::flush_history_now()
@@ -1838,6 +1928,118 @@ void profile_c::flush_history_now()
     table_history.cleanup();
 }
 
+bool profile_c::build_history_fts( RID, GUIPARAM )
+{
+    // batches are indexed in gui thread: db connection is not shared with workers and savepoint of batch can't interleave flush transactions
+    if (!db || profile_flags.is( F_HISTORY_FTS | F_CLOSING ))
+        return true;
+
+    if (db->fts_build( history_s::get_table_name(), CONSTASTR("msg"), 300 ))
+        profile_flags.set( F_HISTORY_FTS );
+    else
+        DEFERRED_UNIQUE_CALL( 0.05, DELEGATE( this, build_history_fts ), nullptr );
+    return true;
+}
+
+void profile_c::prepare_history_fts()
+{
+    stop_history_fts();
+    if (db->fts_prepare( history_s::get_table_name(), CONSTASTR("msg") ))
+    {
+        profile_flags.set( F_HISTORY_FTS );
+        return;
+    }
+
+    if (!g_app->F_READONLY_MODE())
+    {
+        // one-time index build of history, recorded before index was created
+        DEFERRED_UNIQUE_CALL( 0.5, DELEGATE( this, build_history_fts ), nullptr );
+    }
+}
+
+void profile_c::stop_history_fts()
+{
+    gui->delete_event( DELEGATE( this, build_history_fts ) );
+    profile_flags.clear( F_HISTORY_FTS );
+}
+
+void profile_c::find_history_items( compare_context_s &cc, found_stuff_s::FOUND_STUFF_T &found, const bool &stop )
+{
+    if ( !db ) return;
+
+    struct rdr
+    {
+        found_stuff_s::FOUND_STUFF_T &found;
+        const bool &stop;
+
+        rdr( found_stuff_s::FOUND_STUFF_T &found, const bool &stop ):found(found), stop(stop) {}
+        rdr &operator=( const rdr & ) UNUSED;
+
+        found_item_s &add( const contact_key_s &historian )
+        {
+            for ( found_item_s &itm : found )
+                if (itm.historian == historian)
+                    return itm;
+            found_item_s &itm = found.add();
+            itm.historian = historian;
+            return itm;
+        }
+
+        bool dr( int row, ts::SQLITE_DATAGETTER getta )
+        {
+            if (stop)
+                return false;
+
+            ts::data_value_s v;
+
+            if (CHECK(ts::data_type_e::t_int == getta(history_s::C_ID, v))) // always id
+            {
+                if (CHECK(ts::data_type_e::t_int == getta(history_s::C_HISTORIAN, v)))
+                {
+                    found_item_s &itm = add( contact_key_s::buildfromdbvalue(v.i, true) );
+
+                    getta(history_s::C_UTAG, v);
+                    if (ASSERT( itm.utags.find_index((uint64)v.i) < 0 ))
+                        itm.utags.add( v.i );
+
+                    if (itm.mintime == 0)
+                    {
+                        getta(history_s::C_RECV_TIME, v);
+                        itm.mintime = v.i;
+                    } else
+                    {
+#ifdef _DEBUG
+                        getta(history_s::C_RECV_TIME, v);
+                        ASSERT( itm.mintime <= v.i );
+#endif
+                    }
+
+                }
+            }
+            return true;
+        }
+
+    } r( found, stop );
+
+    // mtype 0 == MTA_MESSAGE
+    // mtype 1 == MTA_SYSTEM_MESSAGE
+    // mtype 107 == MTA_UNDELIVERED_MESSAGE
+    // mtype 110 == MTA_HIGHLIGHT_MESSAGE
+
+    // see is_message_mt()
+
+    cc.wstr.set_size( 4096 ); // most messages have smaller size
+
+    ts::str_c where(CONSTASTR("(mtype == 0 or mtype == 1 or mtype == 107 or mtype == 110) and msg like \"%" ) );
+    where.encode_pointer( &cc ).append( CONSTASTR( "\" order by mtime" ) );
+
+    // index only preselects rows with all 3+ chars words; like override still checks each row, so result is same as full scan
+    if (profile_flags.is( F_HISTORY_FTS ) && db->fts_read_table( history_s::get_table_name(), DELEGATE( &r, dr ), cc.fsplit, where ))
+        return;
+
+    db->read_table( history_s::get_table_name(), DELEGATE( &r, dr ), where );
+}
+
 int  profile_c::calc_history( const contact_key_s&historian, bool ignore_invites )
 {
     if ( !db ) return 0;
@@ -1922,6 +2124,7 @@ profile_load_result_e profile_c::xload(const ts::wstr_c& pfn, const ts::uint8 *k
 
     if (db)
     {
+        stop_history_fts();
         save_dirty(RID(), as_param(1));
         db->close();
         db = nullptr;
@@ -2086,6 +2289,7 @@ profile_load_result_e profile_c::xload(const ts::wstr_c& pfn, const ts::uint8 *k
         unique_profile_tag( utag );
 
     cleanup_tables();
+    prepare_history_fts();
 
     #define TAB(tab) if (load_on_start<tab##_s>::value) { MEMT( MEMT_PROFILE_##tab ); table_##tab.read( db ); }
     PROFILE_TABLES
@@ -2189,6 +2393,7 @@ contact_root_c *profile_c::find_corresponding_historian(const contact_key_s &sub
 
 profile_c::~profile_c()
 {
+    stop_history_fts();
     if (db)
         shutdown_aps();
 }
@@ -2237,6 +2442,7 @@ namespace
             encrypt_process_n = n;
         }
 
+        /*virtual*/ int priority() const override { return PRI_LOW; }
         /*virtual*/ int iterate(ts::task_executor_c *) override
         {
             if (remove_enc)
@@ -2482,6 +2688,7 @@ void profile_c::shutdown_aps()
 /*virtual*/ void profile_c::onclose()
 {
     profile_flags.set(F_CLOSING);
+    stop_history_fts();
 
     for (active_protocol_c *ap : protocols)
         if (ap) ap->save_config(true);
@@ -205,6 +205,20 @@ struct history_s : public post_s
 DECLARE_MOVABLE(history_s, true)
 
 typedef post_s * allocpost( const ts::asptr&t, void *prm );
+typedef void loadtext( uint64 utag, const ts::asptr&t, void *prm );
+
+struct found_item_s : public ts::movable_flag<true>
+{
+    time_t mintime = 0;
+    contact_key_s historian;
+    ts::tbuf_t<uint64> utags;
+};
+struct found_stuff_s
+{
+    typedef ts::array_inplace_t<found_item_s, 32> FOUND_STUFF_T;
+    ts::wstrings_c fsplit;
+    FOUND_STUFF_T items;
+};
 
 struct unfinished_file_transfer_s
 {
@@ -375,6 +389,23 @@ template<> struct load_on_start<backup_protocol_s> { static const bool value = f
 template<typename T> struct limit_id { static const int value = 0; };
 template<> struct limit_id<active_protocol_s> { static const int value = 65000; };
 
+template<typename T> struct index_keys // optional indexes of tableview_t (row id index is always present)
+{
+    static const bool utag = false; // utag -> row
+    static const bool historian_time = false; // rows ordered by historian, mtime
+    static uint64 get_utag( const T & ) { return 0; }
+    static int64 get_historian( const T & ) { return 0; }
+    static time_t get_time( const T & ) { return 0; }
+};
+template<> struct index_keys<history_s>
+{
+    static const bool utag = true;
+    static const bool historian_time = true;
+    static uint64 get_utag( const history_s &h ) { return h.utag; }
+    static int64 get_historian( const history_s &h ) { return h.historian.dbvalue(); }
+    static time_t get_time( const history_s &h ) { return h.recv_time; }
+};
+
 template<typename T, profile_table_e tabi> struct tableview_t
 {
     typedef T ROWTYPE;
@@ -412,13 +443,101 @@ template<typename T, profile_table_e tabi> struct tableview_t
     int newidpool = -1;
     bool cleanup_requred = false;
 
+    // indexes; values are indices of rows
+    // appended rows are indexed on demand (fields of new row should be set before next lookup), removing rows drops indexes
+    // reindex() must be called after change of utag, historian or mtime of already indexed row
+    ts::hashmap_t<int, int> idindex;
+    ts::hashmap_t<uint64, int> utagindex;
+    ts::tbuf_t<int> timeindex; // sorted by historian, mtime
+    int indexed = 0;
+    int time_indexed = 0; // timeindex is updated only by time lookups, so loading of rows one by one doesn't keep it sorted
+
+    void reindex()
+    {
+        indexed = 0;
+        time_indexed = 0;
+        idindex.clear();
+        utagindex.clear();
+        timeindex.clear();
+    }
+
+    bool timeless( int r1, int r2 ) const
+    {
+        const T &t1 = rows.get( r1 ).other;
+        const T &t2 = rows.get( r2 ).other;
+        int64 h1 = index_keys<T>::get_historian( t1 ), h2 = index_keys<T>::get_historian( t2 );
+        if ( h1 != h2 ) return h1 < h2;
+        time_t tm1 = index_keys<T>::get_time( t1 ), tm2 = index_keys<T>::get_time( t2 );
+        if ( tm1 != tm2 ) return tm1 < tm2;
+        return r1 < r2;
+    }
+
+    void update_index() // id and utag indexes
+    {
+        int cnt = static_cast<int>( rows.size() );
+        if ( indexed == cnt && time_indexed <= cnt ) return;
+        if ( indexed > cnt || time_indexed > cnt ) reindex();
+
+        for ( int i = indexed; i < cnt; ++i )
+        {
+            const row_s &r = rows.get( i );
+            idindex[ r.id ] = i;
+            if ( index_keys<T>::utag )
+                utagindex[ index_keys<T>::get_utag( r.other ) ] = i;
+        }
+
+        indexed = cnt;
+    }
+
+    void update_timeindex()
+    {
+        update_index();
+        int cnt = indexed;
+        if ( time_indexed == cnt ) return;
+
+        int from = time_indexed;
+        if ( index_keys<T>::historian_time )
+        {
+            auto tless = [this]( const int *r1, const int *r2 )->bool { return timeless( *r1, *r2 ); };
+            if ( ( cnt - from ) * 8 < timeindex.count() )
+            {
+                // few rows appended - insert them into sorted index
+                for ( int i = from; i < cnt; ++i )
+                {
+                    ts::aint lo = 0, hi = timeindex.count();
+                    while ( lo < hi )
+                    {
+                        ts::aint m = ( lo + hi ) / 2;
+                        if ( timeless( timeindex.get( m ), i ) ) lo = m + 1; else hi = m;
+                    }
+                    timeindex.insert( lo, i );
+                }
+            } else
+            {
+                for ( int i = from; i < cnt; ++i )
+                    timeindex.add( i );
+                timeindex.q_sort<int>( tless );
+            }
+        }
+
+        time_indexed = cnt;
+    }
+
+    static bool lookup_ok( const row_s &r, bool skip_deleted )
+    {
+        return ( !skip_deleted || r.st != row_s::s_delete ) && r.st != row_s::s_deleted;
+    }
+
     void cleanup()
     {
         // remove s_deleted
         if (cleanup_requred)
+        {
             for( ts::aint i=rows.size()-1; i>=0; --i)
                 if (rows.get(i).st == row_s::s_deleted)
                     rows.remove_slow(i);
+            reindex();
+        }
         cleanup_requred = false;
     }
     tableview_t() {}
@@ -426,6 +545,7 @@ template<typename T, profile_table_e tabi> struct tableview_t
     tableview_t(tableview_t &&) UNUSED;
     void operator=(const tableview_t& other)
     {
+        reindex();
         rows = other.rows;
         newidpool = other.newidpool;
         cleanup_requred = other.cleanup_requred;
@@ -433,6 +553,8 @@ template<typename T, profile_table_e tabi> struct tableview_t
     }
     void operator=(tableview_t&& other)
     {
+        reindex();
+        other.reindex();
         rows = std::move(other.rows);
         SWAP(newidpool, other.newidpool);
         cleanup_requred = other.cleanup_requred;
@@ -474,15 +596,67 @@ template<typename T, profile_table_e tabi> struct tableview_t
     template<bool skip_deleted> row_s *find( int id )
     {
         cleanup();
-        for (row_s &r : rows)
-            if ( ( !skip_deleted || r.st != row_s::s_delete ) && r.st != row_s::s_deleted )
-                if (r.id == id) return &r;
+        update_index();
+        if ( const int *ri = idindex.get( id ) )
+        {
+            row_s &r = rows.get( *ri );
+            if ( ASSERT( r.id == id ) && lookup_ok( r, skip_deleted ) )
+                return &r;
+        }
+        return nullptr;
+    }
+
+    template<bool skip_deleted> row_s *find_by_utag( uint64 utag )
+    {
+        TS_STATIC_CHECK( index_keys<T>::utag, "no utag index" );
+        cleanup();
+        update_index();
+        if ( const int *ri = utagindex.get( utag ) )
+        {
+            row_s &r = rows.get( *ri );
+            if ( index_keys<T>::get_utag( r.other ) != utag )
+            {
+                // utag of row was changed without reindex
+                reindex();
+                return find_by_utag<skip_deleted>( utag );
+            }
+            if ( lookup_ok( r, skip_deleted ) )
+                return &r;
+
+            // same utag of deleted row and of present one - rare case
+            return find<skip_deleted>( [utag]( const T &t ) { return index_keys<T>::get_utag( t ) == utag; } );
+        }
         return nullptr;
     }
+
+    // call f for rows of historian with mtime < before, newest first, while f returns true
+    template<bool skip_deleted, typename F> void iterate_history( int64 historian, time_t before, F f )
+    {
+        TS_STATIC_CHECK( index_keys<T>::historian_time, "no historian/mtime index" );
+        cleanup();
+        update_timeindex();
+
+        // first item not less than (historian, before)
+        ts::aint lo = 0, hi = timeindex.count();
+        while ( lo < hi )
+        {
+            ts::aint m = ( lo + hi ) / 2;
+            const T &t = rows.get( timeindex.get( m ) ).other;
+            int64 h = index_keys<T>::get_historian( t );
+            if ( h < historian || ( h == historian && index_keys<T>::get_time( t ) < before ) ) lo = m + 1; else hi = m;
+        }
+
+        for ( ts::aint i = lo - 1; i >= 0; --i )
+        {
+            row_s &r = rows.get( timeindex.get( i ) );
+            if ( index_keys<T>::get_historian( r.other ) != historian ) break;
+            if ( lookup_ok( r, skip_deleted ) && !f( r ) ) break;
+        }
+    }
     row_s &getcreate(int id);
     bool reader(int row, ts::SQLITE_DATAGETTER);
 
-    void clear() { newidpool = -1; rows.clear(); new2ins.clear(); }
+    void clear() { newidpool = -1; rows.clear(); new2ins.clear(); reindex(); }
     bool prepare( ts::sqlitedb_c *db );
     void read( ts::sqlitedb_c *db );
     void read( ts::sqlitedb_c *db, const ts::asptr &where_items );
@@ -593,6 +767,7 @@ class profile_c : public config_base_c
     static const ts::flags32_s::BITS F_ENCRYPTED = SETBIT(3);
     static const ts::flags32_s::BITS F_ENCRYPT_PROCESS = SETBIT(4);
     static const ts::flags32_s::BITS F_LOADED_TABLES = SETBIT(5);
+    static const ts::flags32_s::BITS F_HISTORY_FTS = SETBIT(6); // full text index of history is complete
 
     ts::flags32_s profile_flags;
     ts::flags32_s current_options;
@@ -607,6 +782,10 @@ class profile_c : public config_base_c
     uint64 uuid = 0; // zero - freezed; cant be used
     uint num_locked_uids = 0;
 
+    bool build_history_fts( RID, GUIPARAM );
+    void prepare_history_fts();
+    void stop_history_fts();
+
     void load_protosort();
     void save_protosort();
 
@@ -722,7 +901,8 @@ public:
     void kill_history_item( uint64 utag );
     void kill_history(const contact_key_s&historian);
 
-    void load_history( const contact_key_s&historian, allocpost *cb, void *prm ); // just callback, no table
+    void load_history( const contact_key_s&historian, allocpost *cb, void *prm, bool texts = true ); // just callback, no table; texts == false - empty texts passed to callback
+    void load_history_texts( const contact_key_s&historian, const uint64 *utags, ts::aint n, loadtext *cb, void *prm ); // texts of history items (table or db) by one query; cb called only for found items
 
     void kill_message( uint64 msgutag );
 
@@ -734,6 +914,7 @@ public:
     bool change_history_item(uint64 utag, contact_key_s & historian); // find item by tag and change type form MTA_UNDELIVERED_MESSAGE to MTA_MESSAGE, then return historian (if loaded)
     void change_history_items( const contact_key_s &historian, const contact_key_s &old_sender, const contact_key_s &new_sender );
     void flush_history_now();
+    void find_history_items( compare_context_s &cc, found_stuff_s::FOUND_STUFF_T &found, const bool &stop ); // full search; can be called from any thread
     void load_undelivered();
     contact_root_c *find_corresponding_historian(const contact_key_s &subcontact, ts::array_wrapper_c<contact_root_c * const> possible_historians);
 
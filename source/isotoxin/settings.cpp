@@ -2007,6 +2007,17 @@ void dialog_settings_c::mod()
 
 
 
+static ts::wstr_c theme_load_text()
+{
+    ts::wstr_c t(CONSTWSTR("Theme load time, ms: cold "));
+    int cold = gui->theme().load_time(false);
+    int warm = gui->theme().load_time(true);
+    if (cold < 0) t.append(CONSTWSTR("n/a")); else t.append_as_int(cold);
+    t.append(CONSTWSTR(", warm (from cache) "));
+    if (warm < 0) t.append(CONSTWSTR("n/a")); else t.append_as_int(warm);
+    return t;
+}
+
 /*virtual*/ int dialog_settings_c::additions( ts::irect & edges )
 {
     PREPARE( force_change, 0 );
@@ -2547,13 +2558,20 @@ void dialog_settings_c::mod()
     dopts |= debug.get(CONSTASTR(DEBUG_OPT_FULL_DUMP)).as_int() ? 1 : 0;
     dopts |= debug.get(CONSTASTR(DEBUG_OPT_LOGGING)).as_int() ? 2 : 0;
     dopts |= debug.get(CONSTASTR("contactids")).as_int() ? 4 : 0;
+    dopts |= debug.get(CONSTASTR(DEBUG_OPT_TRACE)).as_int() ? 16 : 0;
 
     dm().checkb(ts::wstr_c(), DELEGATE(this, debug_handler), dopts).setmenu(
         menu_c().add(CONSTWSTR("Create full memory dump on crash"), 0, MENUHANDLER(), CONSTASTR("1"))
                 .add(CONSTWSTR("Enable logging"), 0, MENUHANDLER(), CONSTASTR("2"))
                 //.add( CONSTWSTR("Enable telemetry"), 0, MENUHANDLER(), CONSTASTR( "8" ))
                 .add(CONSTWSTR("Show contacts id's"), 0, MENUHANDLER(), CONSTASTR("4"))
+                .add(CONSTWSTR("Enable tracing"), 0, MENUHANDLER(), CONSTASTR("16"))
         );
+    dm().button(HGROUP_MEMBER, CONSTWSTR("Save trace..."), DELEGATE(this, debug_save_trace)).height(35);
+
+    dm().vspace();
+    dm().label(theme_load_text()).setname(CONSTASTR("themeload"));
+    dm().button(HGROUP_MEMBER, CONSTWSTR("Measure theme load"), DELEGATE(this, debug_theme_load)).height(35);
 
     dm().vspace();
     dm().textfield(CONSTWSTR("Addition updates URL"), to_wstr(debug.get(CONSTASTR("local_upd_url"))), DELEGATE(this, debug_local_upd_url));
@@ -2631,10 +2649,31 @@ bool dialog_settings_c::debug_handler(RID, GUIPARAM p)
     else
         debug.set(CONSTASTR("contactids")) = CONSTASTR("1");
 
+    if (0 == (opts & 16))
+        debug.unset(CONSTASTR(DEBUG_OPT_TRACE));
+    else
+        debug.set(CONSTASTR(DEBUG_OPT_TRACE)) = CONSTASTR("1");
+
     mod();
     return true;
 }
 
+bool dialog_settings_c::debug_save_trace(RID, GUIPARAM)
+{
+    g_app->save_trace(); // tracing is enabled when settings are applied
+    return true;
+}
+
+bool dialog_settings_c::debug_theme_load(RID, GUIPARAM)
+{
+    // drop cache to get cold load, then load again from just saved cache
+    ts::kill_file(g_app->app_theme_cache_path(cfg().theme()));
+    g_app->load_theme(cfg().theme());
+    g_app->load_theme(cfg().theme());
+    set_label_text(CONSTASTR("themeload"), theme_load_text());
+    return true;
+}
+
 bool dialog_settings_c::debug_handler2(RID, GUIPARAM p)
 {
     int opts = as_int(p);
@@ -3508,9 +3547,11 @@ bool dialog_settings_c::save_and_close(RID, GUIPARAM)
     gui->enable_special_border( ( misc_flags & MISCF_DISABLEBORDER ) == 0 );
 
 
-#define SND(s) cfg().snd_##s(sndfn[snd_##s]); cfg().snd_vol_##s(sndvol[snd_##s]);
+    bool sndfnch = false;
+#define SND(s) sndfnch |= cfg().snd_##s(sndfn[snd_##s]); cfg().snd_vol_##s(sndvol[snd_##s]);
     SOUNDS
 #undef SND
+    if (sndfnch) g_app->mediasystem().preload_sounds();
 
 
     for (const theme_info_s& thi : m_themes)
@@ -514,6 +514,8 @@ private:
     ts::astrmap_c debug;
     bool debug_handler(RID, GUIPARAM p);
     bool debug_handler2(RID, GUIPARAM p);
+    bool debug_save_trace(RID, GUIPARAM p);
+    bool debug_theme_load(RID, GUIPARAM p);
     bool debug_local_upd_url(const ts::wstr_c &, bool );
 
 protected:
@@ -70,7 +70,23 @@ void crash()
 
 isotoxin_ipc_s *ipcx;
 int nnnn = 0;
-int npersec = 0;
+
+// ping-pong passes: small packets show round trip latency, big ones - throughput
+struct ipc_pass_s
+{
+    int size;
+    int count;
+    DWORD ms;
+} ipc_passes[] = { { 16, 20000, 0 }, { 4096, 10000, 0 }, { 16384, 5000, 0 }, { 120000, 1000, 0 } };
+int ipc_pass = 0;
+DWORD ipc_pass_start = 0;
+
+void send_ping()
+{
+    static ts::uint8 data[ 120000 ];
+    ipcx->send(ipcw(XX_PING) << data_block_s(data, ipc_passes[ ipc_pass ].size));
+}
+
 bool cmdhandlerx(ipcr r)
 {
     switch (r.header().cmd)
@@ -78,12 +94,15 @@ bool cmdhandlerx(ipcr r)
         case XX_PONG:
         {
             ++nnnn;
-            if (nnnn >= 5000) return false;
-
-            ts::uint8 data[16384];
-            memset(data, 1, sizeof(data));
-            ipcx->send(ipcw(XX_PING) << data_block_s(data,sizeof(data)));
-
+            if (nnnn >= ipc_passes[ ipc_pass ].count)
+            {
+                ipc_passes[ ipc_pass ].ms = timeGetTime() - ipc_pass_start;
+                nnnn = 0;
+                if (++ipc_pass >= ARRAY_SIZE( ipc_passes )) return false;
+                ipc_pass_start = timeGetTime();
+            }
+
+            send_ping();
         }
     }
     return true;
@@ -99,16 +118,20 @@ void test_ipc()
     isotoxin_ipc_s ipcs(ts::str_c(CONSTASTR("testtest")), cmdhandlerx);
     if (ipcs.ipc_ok)
     {
-        ts::Time stime = ts::Time::current();
-        ts::uint8 data[16384];
-        memset(data,1,sizeof(data));
         ipcx = &ipcs; //-V506
-        ipcs.send(ipcw(XX_PING) << data_block_s(data,sizeof(data)));
+        ipc_pass = 0;
+        nnnn = 0;
+        ipc_pass_start = timeGetTime();
+        send_ping();
         ipcs.wait_loop(tickx);
 
-        ts::Time::update_thread_time();
-        npersec = nnnn * 1000 / ( ts::Time::current() - stime);
-        DEBUG_BREAK();
+        for ( const ipc_pass_s &p : ipc_passes )
+        {
+            DWORD ms = ts::tmax( p.ms, 1 );
+            int us_per_roundtrip = (int)( (ts::uint64)ms * 1000 / p.count );
+            int mb_per_sec = (int)( (ts::uint64)p.size * p.count * 2 * 1000 / ms / ( 1024 * 1024 ) );
+            DMSG( "ipc ping-pong, size:" << p.size << "count:" << p.count << "time:" << (int)ms << "ms, roundtrip:" << us_per_roundtrip << "us, throughput:" << mb_per_sec << "MB/s" );
+        }
     }
 }
 
@@ -149,6 +172,727 @@ void test_cairo()
     }
 }
 
+void test_history_flush()
+{
+    // insert 100k history rows: row by row with cached prepared statement, row by row with statement prepared for each row, batched by tableview flush
+    const int nrows = 100000;
+    ts::wstr_c fn = ts::fn_fix_path( ts::wstr_c( CONSTWSTR( "%TEMP%" NATIVE_SLASH_S "$$$isotoxin_flushtest.db" ) ), FNO_FULLPATH | FNO_PARSENENV );
+    static const char *names[] = { "per row insert, stmt cache on", "per row insert, stmt cache off", "batched flush" };
+
+    for( int pass = 0; pass < 3; ++pass )
+    {
+        ts::kill_file( fn );
+        ts::sqlitedb_c *db = ts::sqlitedb_c::connect( fn, nullptr, false );
+        if ( !db ) return;
+        db->set_stmt_cache( pass != 1 );
+
+        tableview_history_s tab;
+        tab.prepare( db );
+
+        for ( int i = 0; i < nrows; ++i )
+        {
+            history_s &h = tab.getcreate( 0 ).other;
+            h.historian = contact_key_s( 1 + (i & 15) );
+            h.sender = h.historian;
+            h.receiver = contact_key_s( true );
+            h.recv_time = 1450000000 + i;
+            h.cr_time = h.recv_time;
+            h.type = MTA_MESSAGE;
+            h.utag = i + 1;
+            h.message_utf8 = ts::refstring_t<char>::build( ts::tmp_str_c( CONSTASTR( "test message " ) ).append_as_int( i ), g_app->global_allocator );
+        }
+
+        DWORD st = timeGetTime();
+        if ( pass < 2 )
+        {
+            ts::db_transaction_c __transaction( db ); // same single transaction as flush does
+            ts::tmp_array_inplace_t<ts::data_pair_s, 0> vals( history_s::columns );
+            for ( auto &row : tab )
+            {
+                vals.clear();
+                for ( int i = 1; i < history_s::columns; ++i )
+                    row.other.get( i, vals.add() );
+                db->insert( history_s::get_table_name(), vals.array() );
+            }
+        } else
+            tab.flush( db, true, false );
+        DWORD ms = timeGetTime() - st;
+
+        DMSG( "history insert (" << names[ pass ] << ") rows:" << nrows << "time:" << (int)ms << "ms" );
+
+        db->close();
+    }
+    ts::kill_file( fn );
+}
+
+template<typename HM, typename KEYGEN> int bench_hashmap( KEYGEN kg, int n )
+{
+    DWORD st = timeGetTime();
+    for ( int pass = 0; pass < 10; ++pass )
+    {
+        HM hm;
+        for ( int i = 0; i < n; ++i )
+            hm.add( kg( i ) ) = i;
+        int found = 0;
+        for ( int i = 0; i < n * 2; ++i )
+            if ( hm.get( kg( i ) ) ) ++found;
+        ASSERT( found == n );
+        for ( int i = 0; i < n; i += 2 )
+            hm.remove( kg( i ) );
+        for ( auto it = hm.begin(); it; ++it )
+            ++found;
+        ASSERT( found == n + n / 2 );
+    }
+    return (int)( timeGetTime() - st );
+}
+
+void test_hashmaps()
+{
+    const int n = 100000;
+
+    auto ckgen = []( int i ) { return contact_key_s( contact_id_s( contact_id_s::CONTACT, i ), 1 + ( i & 3 ) ); };
+    auto utaggen = []( int i ) { return (uint64)i * 0x9E3779B97F4A7C15ull; };
+    ts::strings_c strs;
+    for ( int i = 0; i < n * 2; ++i )
+        strs.add( ts::str_c( CONSTASTR( "key" ) ).append_as_int( i ) );
+    auto strgen = [&]( int i ) -> const ts::str_c & { return strs.get( i ); };
+
+    int t1 = bench_hashmap< ts::hashmap_t<contact_key_s, int> >( ckgen, n );
+    int t2 = bench_hashmap< ts::flat_hashmap_t<contact_key_s, int> >( ckgen, n );
+    DMSG( "contact_key_s: chained" << t1 << "ms, flat" << t2 << "ms" );
+
+    t1 = bench_hashmap< ts::hashmap_t<uint64, int> >( utaggen, n );
+    t2 = bench_hashmap< ts::flat_hashmap_t<uint64, int> >( utaggen, n );
+    DMSG( "utag: chained" << t1 << "ms, flat" << t2 << "ms" );
+
+    t1 = bench_hashmap< ts::hashmap_t<ts::str_c, int> >( strgen, n );
+    t2 = bench_hashmap< ts::flat_hashmap_t<ts::str_c, int> >( strgen, n );
+    DMSG( "str_c: chained" << t1 << "ms, flat" << t2 << "ms" );
+}
+
+namespace
+{
+    struct memspy_bench_s
+    {
+        int iterations;
+        DWORD ms;
+    };
+
+    DWORD WINAPI memspy_bench_thread( LPVOID prm )
+    {
+        memspy_bench_s *b = (memspy_bench_s *)prm;
+        void *keep[ 64 ] = {};
+        ts::random_modnar_c rnd( (ts::uint32)( (size_t)prm ) );
+
+        DWORD st = timeGetTime();
+        for ( int i = 0; i < b->iterations; ++i )
+        {
+            int k = rnd.get_next( ARRAY_SIZE( keep ) );
+            if ( keep[ k ] )
+                MM_FREE( keep[ k ] );
+            keep[ k ] = MM_ALLOC_T( MEMT_TEMP, 16 + rnd.get_next( 512 ) );
+            if ( 0 == ( i & 7 ) )
+                keep[ k ] = MM_RESIZE_T( MEMT_TEMP, keep[ k ], 16 + rnd.get_next( 2048 ) );
+        }
+        for ( void *p : keep )
+            if ( p ) MM_FREE( p );
+        b->ms = timeGetTime() - st;
+        return 0;
+    }
+}
+
+void test_memspy_mt()
+{
+    // allocation stress: same total amount of allocations done by 1, 2, 4, 8 threads
+    const int total = 4000000;
+
+    for ( int nthreads = 1; nthreads <= 8; nthreads *= 2 )
+    {
+        memspy_bench_s b[ 8 ];
+        HANDLE h[ 8 ];
+
+        DWORD st = timeGetTime();
+        for ( int i = 0; i < nthreads; ++i )
+        {
+            b[ i ].iterations = total / nthreads;
+            h[ i ] = CreateThread( nullptr, 0, memspy_bench_thread, b + i, 0, nullptr );
+        }
+        WaitForMultipleObjects( nthreads, h, TRUE, INFINITE );
+        DWORD ms = timeGetTime() - st;
+        for ( int i = 0; i < nthreads; ++i )
+            CloseHandle( h[ i ] );
+
+        DMSG( "memspy stress, threads:" << nthreads << "allocs:" << total << "time:" << (int)ms << "ms" );
+    }
+
+    struct stat_s
+    {
+        int nums = 0;
+        size_t sz = 0;
+        static void cb( int typ, int num, size_t size, void *prm )
+        {
+            stat_s *s = (stat_s *)prm;
+            s->nums += num;
+            s->sz += size;
+        }
+    } stat;
+
+    DWORD st = timeGetTime();
+    mspy_getallocated_stat( stat_s::cb, &stat );
+    DMSG( "memspy stat merge:" << (int)( timeGetTime() - st ) << "ms, blocks:" << stat.nums << "bytes:" << (int)stat.sz );
+}
+
+void test_video_display()
+{
+    // 1080p incoming video at 60 fps goes through video_frame_decoder_c::post to 640x360 display, same way as frames from protocol
+    // frames arrived while worker renders are dropped by display mailbox (latest frame wins); render time is measured by worker itself
+    const ts::ivec2 srcsz( 1920, 1080 );
+    const ts::ivec2 dstsz( 640, 360 );
+    const int nframes = 300;
+    const int fps = 60;
+
+    const int testapid = 0xffff; // no such protocol: display of test does not collide with real calls
+    struct stub_notice_s : public video_display_owner_s {} notice; // decoder only checks display has owner
+
+    int cw = ( srcsz.x + 1 ) / 2, ch = ( srcsz.y + 1 ) / 2;
+    ts::buf_c frames[ 2 ];
+    frames[ 0 ].set_size( sizeof( incoming_video_frame_s ) + srcsz.x * srcsz.y * 4 );
+    frames[ 1 ].set_size( sizeof( incoming_video_frame_s ) + srcsz.x * srcsz.y + cw * ch * 2 );
+    for ( int pass = 0; pass < 2; ++pass )
+    {
+        incoming_video_frame_s *f = (incoming_video_frame_s *)frames[ pass ].data();
+        f->gid = contact_id_s();
+        f->cid = contact_id_s( contact_id_s::CONTACT, 1 );
+        f->sz = srcsz;
+        f->msmonotonic = 0;
+        f->fmt = pass == 0 ? VFMT_XRGB : VFMT_I420;
+        f->padding = 0;
+        ts::uint8 *d = f->data();
+        if ( pass == 0 )
+        {
+            for ( int y = 0; y < srcsz.y; ++y )
+                for ( int x = 0; x < srcsz.x; ++x, d += 4 )
+                    *(ts::TSCOLOR *)d = ts::ARGB( x & 255, y & 255, ( x + y ) & 255 );
+        } else
+        {
+            for ( int i = 0, c = (int)( frames[ pass ].size() - sizeof( incoming_video_frame_s ) ); i < c; ++i )
+                d[ i ] = (ts::uint8)( i * 7 );
+        }
+    }
+
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency( &freq );
+
+    for ( int pass = 0; pass < 2; ++pass )
+    {
+        incoming_video_frame_s *f = (incoming_video_frame_s *)frames[ pass ].data();
+        contact_key_s dkey( f->gid, f->cid, testapid );
+        vsb_display_c *display = g_app->video_displays.get( dkey );
+        display->notice = &notice;
+        display->set_desired_size( dstsz );
+        display->dropped = 0;
+        display->rendered = 0;
+        display->renderticks = 0;
+
+        DWORD st = timeGetTime();
+        for ( int i = 0; i < nframes; ++i )
+        {
+            for ( DWORD due = st + i * 1000 / fps; (int)( due - timeGetTime() ) > 0; )
+                Sleep( 1 );
+            video_frame_decoder_c::post( nullptr, g_app->video_displays.get( dkey ), f ); // no protocol: frame stays owned by test, so same read only frame is posted again and again
+        }
+
+        for ( ;; Sleep( 1 ) )
+        {
+            SIMPLELOCK( display->mbsync );
+            if ( nullptr == display->pending && display->rendered + display->dropped >= nframes )
+                break;
+        }
+        DWORD ms = timeGetTime() - st;
+
+        display->notice = nullptr;
+        {
+            SIMPLELOCK( display->mbsync );
+            if ( display->worker )
+                g_app->wake_task( display->worker ); // stops on next iterate
+        }
+        for ( ;; Sleep( 1 ) )
+        {
+            SIMPLELOCK( display->mbsync );
+            if ( nullptr == display->worker )
+                break;
+        }
+
+        int rendered = display->rendered;
+        int dropped = display->dropped;
+        int avgus = rendered ? (int)( display->renderticks * 1000000 / freq.QuadPart / rendered ) : 0;
+        g_app->video_displays.release( display );
+
+        DMSG( ( pass == 0 ? "XRGB lanczos" : "I420" ) << "1080p@60 -> 640x360, frames:" << nframes << "rendered:" << rendered << "dropped:" << dropped << "wall:" << (int)ms << "ms, render avg:" << avgus << "us" );
+    }
+}
+
+void test_frame_damage()
+{
+    // synthetic desktop frames; no real display needed
+    const ts::ivec2 fsz( 1920, 1080 );
+    ts::bitmap_c f[ 2 ];
+    f[ 0 ].create_ARGB( fsz );
+    f[ 0 ].fill( ts::ARGB( 30, 60, 90 ) );
+
+    frame_damage_s dmg;
+    dmg.detect( f[ 0 ].extbody(), ts::bmpcore_exbody_s() );
+    ASSERT( dmg.full && dmg.rects.size() == 1 && dmg.rects.get( 0 ) == ts::irect( ts::ivec2( 0 ), fsz ) );
+
+    f[ 1 ] = f[ 0 ].extbody();
+    dmg.detect( f[ 1 ].extbody(), f[ 0 ].extbody() );
+    ASSERT( !dmg.full && dmg.rects.size() == 0 ); // static frame
+
+    *(ts::TSCOLOR *)f[ 1 ].body( ts::ivec2( 100, 50 ) ) = ts::ARGB( 255, 0, 0 );
+    dmg.detect( f[ 1 ].extbody(), f[ 0 ].extbody() );
+    ASSERT( dmg.rects.size() == 1 && dmg.rects.get( 0 ) == ts::irect( 96, 32, 128, 64 ) );
+
+    f[ 1 ] = f[ 0 ].extbody();
+    f[ 1 ].fill( ts::ivec2( 40, 40 ), ts::ivec2( 100, 60 ), ts::ARGB( 0, 255, 0 ) ); // tiles merged to one rect
+    f[ 1 ].fill( ts::ivec2( 1900, 1070 ), ts::ivec2( 20, 10 ), ts::ARGB( 0, 0, 255 ) ); // partial tiles at right-bottom corner
+    dmg.detect( f[ 1 ].extbody(), f[ 0 ].extbody() );
+    ASSERT( dmg.rects.size() == 2 && dmg.rects.get( 0 ) == ts::irect( 32, 32, 160, 128 ) && dmg.rects.get( 1 ) == ts::irect( 1888, 1056, 1920, 1080 ) );
+
+    // timing: static frame (full compare) and moving window (early out on changed tiles)
+    const int nframes = 100;
+    DWORD st = timeGetTime();
+    for ( int i = 0; i < nframes; ++i )
+        dmg.detect( f[ 0 ].extbody(), f[ 0 ].extbody() );
+    int tstatic = (int)( timeGetTime() - st );
+
+    int nrects = 0;
+    st = timeGetTime();
+    for ( int i = 0; i < nframes; ++i )
+    {
+        int c = i & 1;
+        f[ c ] = f[ c ^ 1 ].extbody();
+        f[ c ].fill( ts::ivec2( 200 + i * 4, 200 ), ts::ivec2( 400, 300 ), ts::ARGB( i, 255 - i, 128 ) );
+        dmg.detect( f[ c ].extbody(), f[ c ^ 1 ].extbody() );
+        nrects += (int)dmg.rects.size();
+    }
+    int tmoving = (int)( timeGetTime() - st );
+
+    DMSG( "frame damage 1080p, static:" << tstatic * 1000 / nframes << "us/frame, moving window:" << tmoving * 1000 / nframes << "us/frame (with copy), rects:" << nrects / nframes << "per frame" );
+}
+
+void test_contact_resort()
+{
+    // 10k synthetic contacts; random status and activity updates between resorts
+    const int ncontacts = 10000;
+    const int nticks = 1000;
+    const int updates_per_tick = 20;
+    ts::random_modnar_c rnd( 1 );
+
+    struct contact_s
+    {
+        int state;
+        int activity;
+    };
+    ts::tbuf0_t<contact_s> cs;
+    cs.set_count( ncontacts );
+    int stamp = 0;
+    for ( contact_s &c : cs )
+        c.state = 1 + rnd.get_next( 3 ) * 25, c.activity = rnd.get_next( 4 ) == 0 ? ++stamp : -1;
+
+    auto key = [&]( ts::aint i )
+    {
+        clist_sort_key_s k;
+        k.item = true;
+        k.psf = (int)( i & 3 ); // 4 proto groups
+        k.power = cs.get( i ).state;
+        k.activity = cs.get( i ).activity;
+        k.id = (int)i;
+        return k;
+    };
+
+    ts::tbuf0_t<clist_sort_item_s> seq;
+    for ( int i = 0; i < ncontacts; ++i )
+    {
+        clist_sort_item_s &s = seq.add();
+        s.itm = (void *)(size_t)( i + 1 );
+        s.key = key( i );
+        s.changed = true;
+    }
+
+    DWORD st = timeGetTime();
+    clist_resort( seq );
+    int tfirst = (int)( timeGetTime() - st );
+
+    auto update = [&]()
+    {
+        for ( int u = 0; u < updates_per_tick; ++u )
+        {
+            contact_s &c = cs.get( rnd.get_next( ncontacts ) );
+            if ( rnd.get_next( 2 ) )
+                c.state = 1 + rnd.get_next( 3 ) * 25;
+            else
+                c.activity = ++stamp;
+        }
+    };
+
+    st = timeGetTime();
+    int moved = 0;
+    for ( int t = 0; t < nticks; ++t )
+    {
+        update();
+        for ( clist_sort_item_s &s : seq )
+        {
+            clist_sort_key_s k = key( (size_t)s.itm - 1 );
+            s.changed = !( s.key == k );
+            if ( s.changed ) ++moved;
+            s.key = k;
+        }
+        clist_resort( seq );
+    }
+    int tincremental = (int)( timeGetTime() - st );
+
+    for ( ts::aint i = 1; i < ncontacts; ++i )
+        ASSERT( seq.get( i - 1 ).key.compare( seq.get( i ).key ) < 0 );
+
+    // old way: insertion sort of every item on every resort
+    const int noldticks = 3;
+    st = timeGetTime();
+    for ( int t = 0; t < noldticks; ++t )
+    {
+        update();
+        ts::tbuf0_t<clist_sort_item_s> sorted;
+        for ( int i = 0; i < ncontacts; ++i )
+        {
+            clist_sort_item_s k;
+            k.key = key( i );
+            ts::aint z = 0;
+            for ( ts::aint c = sorted.count(); z < c; ++z )
+                if ( sorted.get( z ).key.compare( k.key ) > 0 )
+                    break;
+            sorted.insert( z, k );
+        }
+    }
+    int told = (int)( timeGetTime() - st );
+
+    DMSG( "contact resort, contacts:" << ncontacts << "first sort:" << tfirst << "ms, incremental:" << ( tincremental * 1000 / nticks ) << "us/tick (" << ( moved / nticks ) << "moved per tick), full insertion sort:" << ( told / noldticks ) << "ms/tick" );
+}
+
+void test_spellcheck_cache()
+{
+    // replay of typing a message char by char; every new complete word goes to spellchecker like spellchecker_s::check_text does
+    const char *text = "Hello, I have looked at the logs you sent yesterday and I think the problem is in the network settings. "
+        "Please check the proxy settings and try again; if the problem is still there, send me the logs again and I will look at them tomorrow. "
+        "By the way, the new version has a lot of fixes for the network code, so maybe it is better to update first and check the settings after that.";
+
+    if ( !g_app->spellchecker.is_enabled() )
+    {
+        DMSG( "spellcheck cache: no dictionaries loaded, skipped" );
+        return;
+    }
+
+    // results come from check_word_task of splchk_c::check (or right from check, if word is cached); editor is not needed to receive them
+    struct receiver_s : public spellchecker_s
+    {
+        bool in_check = false;
+        int nhits = 0;
+        /*virtual*/ void check_result( const ts::str_c &cw, bool is_valid, ts::astrings_c &&suggestions ) override
+        {
+            for ( chk_word_s &w : words )
+                if ( w.utf8.equals( cw ) )
+                {
+                    w.checked = true;
+                    if ( in_check ) ++nhits;
+                    break;
+                }
+        }
+    };
+
+    struct replay_s
+    {
+        int nwords = 0, nhits = 0, nundone = 0, nlost = 0;
+        int ms = 0;
+    };
+
+    auto replay = [&]( replay_s &r )
+    {
+        receiver_s rcv;
+        ts::str_c typed;
+        ts::aint wstart = 0;
+
+        DWORD st = timeGetTime();
+        for ( const char *c = text; *c; ++c )
+        {
+            typed.append_char( *c );
+            if ( ( *c >= 'a' && *c <= 'z' ) || ( *c >= 'A' && *c <= 'Z' ) )
+                continue;
+
+            // word just completed
+            ts::str_c w( typed.substr( wstart, typed.get_length() - 1 ) );
+            wstart = typed.get_length();
+            if ( w.get_length() < 2 )
+                continue;
+            bool seen = false;
+            for ( const spellchecker_s::chk_word_s &cw : rcv.words )
+                if ( cw.utf8.equals( w ) )
+                    seen = true;
+            if ( seen )
+                continue;
+
+            spellchecker_s::chk_word_s &cw = rcv.words.add();
+            cw.utf8 = w;
+            cw.check_started = true;
+            ++r.nwords;
+
+            ts::astrings_c checkwords;
+            checkwords.add( w );
+            checkwords.get( 0 ).clone(); // goes to worker thread
+            rcv.in_check = true;
+            g_app->spellchecker.check( std::move( checkwords ), &rcv );
+            rcv.in_check = false;
+        }
+
+        // wait for workers; results are delivered by executor tick of base thread
+        for ( ;; Sleep( 1 ) )
+        {
+            g_app->m_tasks_executor.tick();
+            int pending = 0;
+            for ( const spellchecker_s::chk_word_s &cw : rcv.words )
+                if ( cw.check_started && !cw.checked )
+                    ++pending;
+            if ( pending == 0 || ( timeGetTime() - st ) > 10000 )
+            {
+                r.nlost = pending;
+                break;
+            }
+        }
+        r.ms = (int)( timeGetTime() - st );
+
+        r.nhits = rcv.nhits;
+        for ( const spellchecker_s::chk_word_s &cw : rcv.words )
+            if ( !cw.check_started )
+                ++r.nundone; // dictionaries are (re)loading: check refused
+    };
+
+    replay_s cold, warm;
+    replay( cold );
+    replay( warm );
+
+    DMSG( "spellcheck typing replay, words:" << cold.nwords << "workers:" << (int)application_c::splchk_c::MAX_WORKERS
+        << "cold:" << cold.ms << "ms (" << cold.nhits << "hits," << cold.nundone << "refused," << cold.nlost << "lost), warm:"
+        << warm.ms << "ms (" << warm.nhits << "hits," << warm.nundone << "refused," << warm.nlost << "lost)" );
+}
+
+void test_gmsg_routing()
+{
+    // many receivers of same event (like folder share notices); every message is addressed to one of them
+    const int nreceivers = 1000;
+    const int nmessages = 10000;
+
+    struct rcv_s
+    {
+        uint64 utag = 0;
+        int got = 0;
+        bool on_update( gmsg<ISOGM_FOLDER_SHARE_UPDATE> &u )
+        {
+            if ( u.utag == utag ) ++got;
+            return false;
+        }
+    };
+
+    ts::tbuf0_t<rcv_s> rcvs;
+    rcvs.set_count( nreceivers );
+    for ( int i = 0; i < nreceivers; ++i )
+        rcvs.get( i ).utag = 0x100000000ull + i, rcvs.get( i ).got = 0;
+
+    auto run = [&]( bool keyed, int &fanout )
+    {
+        ts::array_del_t< gm_redirect_s<ISOGM_FOLDER_SHARE_UPDATE>, 0 > rs;
+        for ( rcv_s &r : rcvs )
+        {
+            gm_redirect_s<ISOGM_FOLDER_SHARE_UPDATE> *gr = TSNEW( gm_redirect_s<ISOGM_FOLDER_SHARE_UPDATE>, DELEGATE( &r, on_update ) );
+            if ( keyed ) gr->subscribe_key( ISOGM_FOLDER_SHARE_UPDATE, r.utag );
+            rs.add( gr );
+        }
+
+        gm_receiver_c::reset_counters();
+        DWORD st = timeGetTime();
+        for ( int m = 0; m < nmessages; ++m )
+            gmsg<ISOGM_FOLDER_SHARE_UPDATE>( 0x100000000ull + ( m % nreceivers ) ).send();
+        int t = (int)( timeGetTime() - st );
+
+        const gm_counters_s &c = gm_receiver_c::counters( ISOGM_FOLDER_SHARE_UPDATE );
+        fanout = c.deliveries / ts::tmax( 1, c.sends );
+        return t;
+    };
+
+    int fanout1, fanout2;
+    int tbroadcast = run( false, fanout1 );
+    int tkeyed = run( true, fanout2 );
+
+    for ( const rcv_s &r : rcvs )
+        ASSERT( r.got == 2 * nmessages / nreceivers );
+
+    DMSG( "gmsg routing, receivers:" << nreceivers << "broadcast:" << ( tbroadcast * 1000 / nmessages ) << "us/msg (fan-out" << fanout1 << "), keyed:" << ( tkeyed * 1000 / nmessages ) << "us/msg (fan-out" << fanout2 << ")" );
+}
+
+void test_jitter_buffer()
+{
+    // replays arrival traces through voice_jitter_c and a simulated device that reads 10 ms every 10 ms
+    // trace file jitter_trace.txt (if present): lines "arrival_ms [sender_ms]", 20 ms packets
+    s3::Format fmt;
+    fmt.sampleRate = 48000;
+    fmt.channels = 1;
+    fmt.bitsPerSample = 16;
+
+    const int packet_ms = 20;
+    const int npackets = 3000; // 1 minute
+    const int packet_samples = fmt.sampleRate * packet_ms / 1000;
+    const int read_ms = 10;
+
+    struct arrival_s
+    {
+        ts::uint64 arrival;
+        ts::uint64 sent;
+    };
+
+    auto simulate = [&]( const char *name, const ts::tbuf0_t<arrival_s> &trace )
+    {
+        voice_jitter_c jb;
+        ts::buf_c fifo, out;
+        ts::tbuf0_t<ts::int16> pcm;
+        pcm.set_count( packet_samples );
+        ts::buf_c chunk;
+        chunk.set_size( fmt.avgBytesPerMSecs( read_ms ) );
+
+        bool playing = false;
+        int glitches = 0;
+        ts::int64 latency_sum = 0;
+        int reads = 0;
+        ts::aint next = 0;
+        int phase = 0;
+        ts::uint64 end = trace.count() ? trace.get( trace.count() - 1 ).arrival + 1000 : 0;
+        for ( ts::uint64 now = trace.count() ? trace.get( 0 ).arrival : 0; now < end; now += read_ms )
+        {
+            for ( ; next < trace.count() && trace.get( next ).arrival <= now; ++next )
+            {
+                // voiced sound: 150 Hz with harmonics
+                for ( ts::int16 &smp : pcm )
+                {
+                    float t = (float)( phase++ ) / fmt.sampleRate;
+                    smp = (ts::int16)( 6000.0f * sinf( 2 * 3.1415926f * 150 * t ) + 3000.0f * sinf( 2 * 3.1415926f * 300 * t ) + 1500.0f * sinf( 2 * 3.1415926f * 450 * t ) );
+                }
+                out.clear();
+                jb.put( trace.get( next ).arrival, trace.get( next ).sent, fmt.bytesToMSec( (int)fifo.size() ), playing, fmt, pcm.begin(), pcm.size(), out );
+                fifo.append_buf( out );
+                if ( !playing && fmt.bytesToMSec( (int)fifo.size() ) >= jb.target() )
+                    playing = true;
+            }
+
+            if ( !playing )
+                continue;
+
+            latency_sum += fmt.bytesToMSec( (int)fifo.size() );
+            ++reads;
+
+            ts::aint a = ts::tmin( fifo.size(), chunk.size() );
+            memcpy( chunk.data(), fifo.data(), a );
+            fifo.cut( 0, a );
+            if ( a > 0 )
+                jb.played( fmt, (char *)chunk.data(), a );
+            if ( a < chunk.size() )
+            {
+                if ( a == 0 && !jb.can_conceal() )
+                    continue;
+                if ( a > 0 || jb.stats().concealed_ms == 0 ) ++glitches;
+                jb.conceal( fmt, (char *)chunk.data() + a, chunk.size() - a );
+            }
+        }
+
+        const voice_jitter_c::stats_s &st = jb.stats();
+        DMSG( "jitter buffer, trace:" << name << "packets:" << st.packets << "avg latency:" << ( reads ? latency_sum / reads : 0 ) << "ms, target:" << jb.target() << "ms, jitter:" << jb.jitter() << "ms, underruns:" << st.underruns << "concealed:" << st.concealed_ms << "ms, accelerated:" << st.accelerated << "expanded:" << st.expanded << "glitches:" << glitches );
+    };
+
+    ts::random_modnar_c rnd( 1 );
+    ts::tbuf0_t<arrival_s> trace;
+
+    auto make_trace = [&]( int jitter_ms, int burst_every, int burst_ms, int loss_percent, bool timestamps )
+    {
+        trace.clear();
+        ts::uint64 t0 = 1000;
+        for ( int i = 0; i < npackets; ++i )
+        {
+            if ( loss_percent && (int)rnd.get_next( 100 ) < loss_percent )
+                continue;
+            ts::uint64 sent = t0 + i * packet_ms;
+            ts::uint64 delay = 50 + ( jitter_ms ? rnd.get_next( jitter_ms ) : 0 );
+            if ( burst_every && ( i % burst_every ) < burst_ms / packet_ms )
+                delay += burst_ms - ( i % burst_every ) * packet_ms; // stall, then everything comes at once
+            arrival_s &a = trace.add();
+            a.arrival = sent + delay;
+            a.sent = timestamps ? sent : 0;
+        }
+        // arrival order
+        for ( ts::aint i = 1; i < trace.count(); ++i )
+            for ( ts::aint j = i; j > 0 && trace.get( j - 1 ).arrival > trace.get( j ).arrival; --j )
+                SWAP( trace.get( j - 1 ), trace.get( j ) );
+    };
+
+    make_trace( 2, 0, 0, 0, true ); simulate( "stable", trace );
+    make_trace( 60, 0, 0, 0, true ); simulate( "jitter 60ms", trace );
+    make_trace( 60, 0, 0, 0, false ); simulate( "jitter 60ms, no timestamps", trace );
+    make_trace( 10, 250, 300, 0, true ); simulate( "bursts", trace );
+    make_trace( 20, 0, 0, 5, true ); simulate( "loss 5%", trace );
+
+    if ( ts::blob_c b = ts::g_fileop->load( CONSTWSTR( "jitter_trace.txt" ) ) )
+    {
+        trace.clear();
+        for ( ts::token<char> ln( ts::asptr( (const char *)b.data(), (int)b.size() ), '\n' ); ln; ++ln )
+        {
+            ts::str_c l( ln->get_trimmed() );
+            ts::token<char> tt( l, ' ' );
+            if ( !tt ) continue;
+            arrival_s &a = trace.add();
+            a.arrival = tt->as_num<ts::uint64>();
+            ++tt;
+            a.sent = tt ? tt->as_num<ts::uint64>() : 0;
+        }
+        simulate( "jitter_trace.txt", trace );
+    }
+}
+
+void test_trace()
+{
+    // cost of span when tracing is off and on; dump keeps only last events of ring
+    const int n = 1000000;
+    bool was_on = ts::g_trace_on;
+
+    auto run = [&]()
+    {
+        DWORD st = timeGetTime();
+        for ( int i = 0; i < n; ++i )
+        {
+            TRACE_SPAN( "test.span" );
+            TRACE_COUNTER( "test.counter", i );
+        }
+        return (int)( timeGetTime() - st );
+    };
+
+    ts::trace_enable( false );
+    int toff = run();
+    ts::trace_enable( true );
+    int ton = run();
+    ts::trace_enable( was_on );
+
+    ts::str_c json;
+    ts::trace_json( json, CONSTASTR( "test" ) );
+    int spans = 0;
+    for ( int i = json.find_pos( CONSTASTR( "\"test.span\"" ) ); i >= 0; i = json.find_pos( i + 1, CONSTASTR( "\"test.span\"" ) ) )
+        ++spans;
+    ASSERT( spans > 0 && spans <= n );
+
+    DMSG( "trace: off " << toff << "ms on " << ton << "ms per " << n << " spans+counters; dumped spans " << spans << " json " << json.get_length() << " bytes" );
+}
+
 void dotests0()
 {
     //test_cairo();
@@ -210,6 +954,16 @@ void dotests()
 {
     //dotests0();
     //test_ipc();
+    //test_history_flush();
+    //test_hashmaps();
+    //test_memspy_mt();
+    //test_video_display();
+    //test_frame_damage();
+    //test_contact_resort();
+    //test_spellcheck_cache();
+    //test_gmsg_routing();
+    //test_jitter_buffer();
+    //test_trace();
 
     /*
     ts::bitmap_c basei; basei.load_from_file(L"1\\ava.png");
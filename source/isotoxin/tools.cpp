@@ -730,6 +730,7 @@ ipc::ipc_result_e isotoxin_ipc_s::processor_func(void *par, void *data, int data
         return ipc::IPCR_BREAK;
     isotoxin_ipc_s *me = (isotoxin_ipc_s *)par;
     ipcr r(data,datasize);
+    TRACE_SPAN( "ipc.recv" );
     if (ASSERT(me->datahandler))
         if (me->datahandler( r ))
             return ipc::IPCR_OK;
@@ -257,6 +257,7 @@ enum isogmsg_e
     ISOGM_CAMERA_TICK,
     ISOGM_PEER_STREAM_OPTIONS,
     ISOGM_EXPORT_PROTO_DATA,
+    ISOGM_TRACE_DATA,
     ISOGM_UPDATE_MESSAGE_NOTIFICATION,
     ISOGM_SUMMON_NOPROFILE_UI,
     ISOGM_GRABDESKTOPEVENT,
@@ -311,6 +312,12 @@ template<> struct gmsg<ISOGM_EXPORT_PROTO_DATA> : public gmsgbase
     ts::blob_c buf;
 };
 
+template<> struct gmsg<ISOGM_TRACE_DATA> : public gmsgbase
+{
+    gmsg() :gmsgbase(ISOGM_TRACE_DATA) {}
+    ts::str_c json; // comma separated chrome trace events of plghost and its plugin
+};
+
 template<> struct gmsg<ISOGM_DOWNLOADPROGRESS> : public gmsgbase
 {
     gmsg(int id, int d, int t) :gmsgbase(ISOGM_DOWNLOADPROGRESS), id(id), downloaded(d), total(t) {}
@@ -321,7 +328,7 @@ template<> struct gmsg<ISOGM_DOWNLOADPROGRESS> : public gmsgbase
 
 template<> struct gmsg<ISOGM_DELIVERED> : public gmsgbase
 {
-    gmsg(uint64 utag) :gmsgbase(ISOGM_DELIVERED), utag(utag) {}
+    gmsg(uint64 utag) :gmsgbase(ISOGM_DELIVERED, utag), utag(utag) {}
     uint64 utag;
 };
 
@@ -639,6 +646,7 @@ struct isotoxin_ipc_s
     static ipc::ipc_result_e wait_func( void * );
     void send( const ipcw &data )
     {
+        TRACE_SPAN( "ipc.send" );
         junct.send(data.data(), (int)data.size());
     }
 
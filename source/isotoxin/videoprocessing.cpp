@@ -1,6 +1,7 @@
 #include "isotoxin.h"
 
 #define GRAB_DESKTOP_FPS 15
+#define DESKTOP_STATIC_REFRESH_MS 1000 // unchanged desktop is sent again once per second (lost packets recovery)
 
 using namespace DShow;
 
@@ -154,6 +155,66 @@ ts::ivec2 vsb_c::fit_to_size( const ts::ivec2 &sz_ )
     return sz;
 }
 
+void frame_damage_s::detect( const ts::bmpcore_exbody_s &cur, const ts::bmpcore_exbody_s &prev )
+{
+    const ts::ivec2 &fsz = cur.info().sz;
+    rects.clear();
+
+    if ( prev() == nullptr || prev.info().sz != fsz )
+    {
+        full = true;
+        rects.add( ts::irect( ts::ivec2( 0 ), fsz ) );
+        return;
+    }
+    full = false;
+
+    auto changed = [&]( int x, int y, const ts::ivec2 &tsz )
+    {
+        return !ts::img_helper_same( cur() + y * cur.info().pitch + x * 4, cur.info().pitch, prev() + y * prev.info().pitch + x * 4, prev.info().pitch, tsz );
+    };
+
+    ts::aint prevrow = 0; // rects before this index can't touch current row of tiles
+    for ( int y = 0; y < fsz.y; y += TILE_SIZE )
+    {
+        int th = ts::tmin<int>( TILE_SIZE, fsz.y - y );
+        ts::aint currow = rects.size();
+
+        for ( int x = 0; x < fsz.x; )
+        {
+            int tw = ts::tmin<int>( TILE_SIZE, fsz.x - x );
+            if ( !changed( x, y, ts::ivec2( tw, th ) ) )
+            {
+                x += tw;
+                continue;
+            }
+
+            // run of changed tiles
+            ts::irect r( x, y, x + tw, y + th );
+            for ( x += tw; x < fsz.x; x += tw )
+            {
+                tw = ts::tmin<int>( TILE_SIZE, fsz.x - x );
+                if ( !changed( x, y, ts::ivec2( tw, th ) ) )
+                    break;
+                r.rb.x = x + tw;
+            }
+
+            // same columns changed at previous row? just extend that rect down
+            bool merged = false;
+            for ( ts::aint i = prevrow; i < currow && !merged; ++i )
+            {
+                ts::irect &pr = rects.get( i );
+                if ( pr.rb.y == r.lt.y && pr.lt.x == r.lt.x && pr.rb.x == r.rb.x )
+                    pr.rb.y = r.rb.y, merged = true;
+            }
+            if ( !merged )
+                rects.add( r );
+        }
+
+        while ( prevrow < rects.size() && rects.get( prevrow ).rb.y < y + th )
+            ++prevrow;
+    }
+}
+
 vsb_desktop_c::grab_desktop *vsb_desktop_c::grab_desktop::first = nullptr;
 vsb_desktop_c::grab_desktop *vsb_desktop_c::grab_desktop::last = nullptr;
 
@@ -229,12 +290,15 @@ void vsb_desktop_c::grab_desktop::remove_owner(vsb_desktop_c *owner)
 
 void vsb_desktop_c::grab_desktop::grab(const ts::irect &gr)
 {
-    if (gr.size() != grabbuff.info().sz)
-        grabbuff.create(gr.size(), monitor);
+    grabcur ^= 1;
+    ts::drawable_bitmap_c &gb = grabbuff[grabcur];
+    if (gr.size() != gb.info().sz)
+        gb.create(gr.size(), monitor);
 
-    grabbuff.grab_screen( gr, ts::ivec2(0) );
-    grabbuff.render_cursor(gr.lt, cursorcachedata);
+    gb.grab_screen( gr, ts::ivec2(0) );
+    gb.render_cursor(gr.lt, cursorcachedata);
 
+    damage.detect( gb.extbody(), grabbuff[grabcur ^ 1].extbody() );
 }
 
 /*virtual*/ int vsb_desktop_c::grab_desktop::iterate(ts::task_executor_c *e)
@@ -278,7 +342,7 @@ void vsb_desktop_c::grab_desktop::grab(const ts::irect &gr)
             owners_changed = false;
             spinlock::simple_unlock(sync);
 
-            c->grabcb(grabbuff);
+            c->grabcb(grabbuff[grabcur], damage);
 
             spinlock::simple_lock(sync);
             locked = nullptr;
@@ -296,36 +360,137 @@ void vsb_desktop_c::grab_desktop::grab(const ts::irect &gr)
     return stop_job ? R_CANCEL : 0;
 }
 
-void vsb_desktop_c::grabcb(ts::drawable_bitmap_c &gbmp)
+static int box_halvings( ts::ivec2 ssz, const ts::ivec2 &dsz )
+{
+    // number of 2x box shrinks FILTER_BOX_LANCZOS3 does before lanczos pass (see img_helper_resize)
+    int n = 0;
+    for ( ssz = ssz / 2; ssz >>= dsz; ssz = ssz / 2 )
+        ++n;
+    return n;
+}
+
+static int gcd( int a, int b )
+{
+    for ( ; b; ) { int t = a % b; a = b; b = t; }
+    return a;
+}
+
+bool vsb_desktop_c::update_scaled(const ts::bmpcore_exbody_s &gbmp, const ts::irect &r)
 {
+    // resize changed area with margin (filter kernel needs neighbour pixels), then copy only changed part
+    // source window must map to destination window with exactly same box shrinks, scale and phase as whole frame resize, otherwise seams appear
+    const ts::ivec2 &ssz = gbmp.info().sz;
+    const ts::ivec2 &dsz = scaled.info().sz;
+
+    int n = box_halvings( ssz, dsz );
+    ts::ivec2 hsz( ssz.x >> n, ssz.y >> n ); // frame size after box shrinks
+    int gx = gcd( hsz.x, dsz.x ), gy = gcd( hsz.y, dsz.y );
+    ts::ivec2 dp( dsz.x / gx, dsz.y / gy ); // dp destination pixels exactly cover hp shrunk pixels
+    ts::ivec2 hp( hsz.x / gx, hsz.y / gy );
+
+    ts::irect d( r.lt.x * dsz.x / ssz.x, r.lt.y * dsz.y / ssz.y, ( r.rb.x * dsz.x + ssz.x - 1 ) / ssz.x, ( r.rb.y * dsz.y + ssz.y - 1 ) / ssz.y );
+    d.lt.x &= ~1; d.lt.y &= ~1; // I420 chroma is 2x2 pixels
+    d.rb.x = ts::tmin( dsz.x, ( d.rb.x + 1 ) & ~1 );
+    d.rb.y = ts::tmin( dsz.y, ( d.rb.y + 1 ) & ~1 );
+
+    // lanczos3 reaches 3 shrunk pixels each side; on upscale it is more than 3 destination pixels
+    int mx = ts::tmax( 4, 1 + ( 3 * dsz.x + hsz.x - 1 ) / hsz.x );
+    int my = ts::tmax( 4, 1 + ( 3 * dsz.y + hsz.y - 1 ) / hsz.y );
+    ts::irect d2( ts::tmax( 0, d.lt.x - mx ), ts::tmax( 0, d.lt.y - my ), ts::tmin( dsz.x, d.rb.x + mx ), ts::tmin( dsz.y, d.rb.y + my ) );
+    if ( d2.width() < 16 ) // see img_helper_resize
+        d2.rb.x = ts::tmin( dsz.x, d2.lt.x + 16 ), d2.lt.x = ts::tmax( 0, d2.rb.x - 16 );
+    if ( d2.height() < 16 )
+        d2.rb.y = ts::tmin( dsz.y, d2.lt.y + 16 ), d2.lt.y = ts::tmax( 0, d2.rb.y - 16 );
+
+    // align to period (dsz is multiple of dp, so clamping keeps alignment)
+    d2.lt.x = d2.lt.x / dp.x * dp.x; d2.rb.x = ts::tmin( dsz.x, ( d2.rb.x + dp.x - 1 ) / dp.x * dp.x );
+    d2.lt.y = d2.lt.y / dp.y * dp.y; d2.rb.y = ts::tmin( dsz.y, ( d2.rb.y + dp.y - 1 ) / dp.y * dp.y );
+
+    if ( d2.area() * 2 > dsz.x * dsz.y )
+        return false; // too big window (or too coarse period): whole frame resize is cheaper
+
+    ts::irect s2( ( d2.lt.x / dp.x * hp.x ) << n, ( d2.lt.y / dp.y * hp.y ) << n, ( d2.rb.x / dp.x * hp.x ) << n, ( d2.rb.y / dp.y * hp.y ) << n );
+    if ( box_halvings( s2.size(), d2.size() ) != n )
+        return false; // window would be resized in other way than whole frame
+
+    ts::bitmap_c tmp; tmp.create_ARGB( d2.size() );
+    tmp.resize_from( ts::bmpcore_exbody_s( gbmp() + s2.lt.y * gbmp.info().pitch + s2.lt.x * 4, gbmp.info().chsize( s2.size() ) ), ts::FILTER_BOX_LANCZOS3 );
+    scaled.copy( d.lt, d.size(), tmp.extbody(), d.lt - d2.lt );
+
+    scaled_damage.add( d );
+    return true;
+}
+
+void vsb_desktop_c::grabcb(ts::drawable_bitmap_c &gbmp, const frame_damage_s &damage)
+{
+    ts::Time curt = ts::Time::current();
+    bool refresh = ( curt - last_publish ) >= DESKTOP_STATIC_REFRESH_MS;
+    if ( !dirty && !refresh && damage.rects.size() == 0 )
+        return; // static frame: nothing to resize, convert and encode
+
     ts::ivec2 dsz;
-    if (ts::drawable_bitmap_c *b = lockbuf(&dsz))
+    ts::drawable_bitmap_c *b = lockbuf( &dsz );
+    if ( !b )
     {
-        if (dsz == ts::ivec2(0))
-            dsz = rect.size();
+        dirty = true; // damage of this grab is lost
+        return;
+    }
 
-        if (dsz.x > maxsize.x && maxsize.x > 0)
-            dsz = maxsize;
+    if (dsz == ts::ivec2(0))
+        dsz = rect.size();
 
-        if (dsz == rect.size())
-        {
-            // just copy
-            if (b->info().sz != dsz)
-                b->create(dsz, monitor);
+    if (dsz.x > maxsize.x && maxsize.x > 0)
+        dsz = maxsize;
 
-            b->copy( ts::ivec2(0), dsz, gbmp.extbody(), ts::ivec2(0) );
-        }
-        else
+    bool whole = dirty || refresh || damage.full;
+    const ts::irect *dmg = nullptr;
+    ts::aint ndmg = 0;
+
+    if (dsz == rect.size())
+    {
+        // just copy
+        if (b->info().sz != dsz)
+            b->create(dsz, monitor);
+
+        b->copy( ts::ivec2(0), dsz, gbmp.extbody(), ts::ivec2(0) );
+
+        if ( !whole )
+            dmg = damage.rects.begin(), ndmg = damage.rects.size();
+    }
+    else
+    {
+        if ( scaled.info().sz != dsz )
         {
-            if (b->info().sz != dsz)
-                b->create(dsz);
+            scaled.create_ARGB( dsz );
+            whole = true;
+        }
 
-            b->resize_from(gbmp.extbody(), ts::FILTER_BOX_LANCZOS3);
+        if ( !whole )
+        {
+            scaled_damage.clear();
+            for ( const ts::irect &r : damage.rects )
+                if ( !update_scaled( gbmp.extbody(), r ) )
+                {
+                    whole = true;
+                    break;
+                }
+            if ( !whole )
+                dmg = scaled_damage.begin(), ndmg = scaled_damage.size();
         }
-        call_bmp_ready_handler(b->extbody());
-        unlock(b);
+
+        if ( whole )
+            scaled.resize_from( gbmp.extbody(), ts::FILTER_BOX_LANCZOS3 );
+
+        if (b->info().sz != dsz)
+            b->create(dsz);
+
+        b->copy( ts::ivec2( 0 ), dsz, scaled.extbody(), ts::ivec2( 0 ) );
     }
+    call_bmp_ready_handler(b->extbody(), dmg, ndmg);
+    unlock(b);
 
+    dirty = false;
+    last_publish = curt;
 }
 
 bool vsb_desktop_c::init(const vsb_descriptor_s &desc, const ts::wstrmap_c &dpar)
@@ -622,26 +787,28 @@ bool vsb_dshow_camera_c::init(const vsb_descriptor_s &desc_, const ts::wstrmap_c
     return true;
 }
 
-video_frame_decoder_c::video_frame_decoder_c(active_protocol_c *ap, incoming_video_frame_s *f_) :f(f_), ap(ap)
+video_frame_decoder_c::video_frame_decoder_c(active_protocol_c *ap, vsb_display_c *display) :ap(ap), display(display)
 {
-    videosize = f->sz;
-
-    display = g_app->video_displays.get( contact_key_s( f->gid, f->cid, ap->getid() ) );
-    if (nullptr == display->notice)
-    {
-        ap->unlock_video_frame(f);
-        f = nullptr;
-    }
-
-    g_app->add_task( this );
 }
 
 video_frame_decoder_c::~video_frame_decoder_c()
 {
-    if (f)
-        ap->unlock_video_frame(f);
     if (display)
     {
+        incoming_video_frame_s *f = nullptr;
+        {
+            SIMPLELOCK( display->mbsync );
+            if (display->worker == this)
+            {
+                // canceled; frame still in mailbox
+                f = display->pending;
+                display->pending = nullptr;
+                display->worker = nullptr;
+            }
+        }
+        if (f)
+            unlock( ap, f );
+
         if (g_app)
             g_app->video_displays.release(display);
         else
@@ -650,32 +817,112 @@ video_frame_decoder_c::~video_frame_decoder_c()
 
 };
 
+/*static*/ void video_frame_decoder_c::unlock( active_protocol_c *ap, incoming_video_frame_s *f )
+{
+    if (ap)
+        ap->unlock_video_frame(f);
+}
+
+/*static*/ void video_frame_decoder_c::post( active_protocol_c *ap, incoming_video_frame_s *f )
+{
+    post( ap, g_app->video_displays.get( contact_key_s( f->gid, f->cid, ap->getid() ) ), f );
+}
+
+/*static*/ void video_frame_decoder_c::post( active_protocol_c *ap, vsb_display_c *display, incoming_video_frame_s *f )
+{
+    if (nullptr == display->notice)
+    {
+        unlock( ap, f );
+        g_app->video_displays.release(display);
+        return;
+    }
+
+    incoming_video_frame_s *stale;
+    video_frame_decoder_c *newworker = nullptr;
+    {
+        SIMPLELOCK( display->mbsync );
+        stale = display->pending;
+        display->pending = f;
+        if (stale)
+            ++display->dropped;
+        if (nullptr == display->worker)
+            display->worker = newworker = TSNEW( video_frame_decoder_c, ap, display ); // worker keeps reference of display
+        else
+            g_app->wake_task( display->worker ); // under lock: worker can't finish while it is still set to display
+    }
+
+    if (stale)
+        unlock( ap, stale ); // renderer is late; newest frame wins
+
+    if (newworker)
+        g_app->add_task( newworker );
+    else
+        g_app->video_displays.release(display);
+}
+
 /*virtual*/ int video_frame_decoder_c::iterate(ts::task_executor_c *e)
 {
-    if (nullptr == f || nullptr == display->notice) return R_CANCEL;
-    if ( display->get_desired_size() == ts::ivec2(0) ) return R_CANCEL;
+    incoming_video_frame_s *f;
+    {
+        SIMPLELOCK( display->mbsync );
+        f = display->pending;
+        display->pending = nullptr;
 
+        if (nullptr == f)
+        {
+            int idlems = ts::Time::current() - lastframe;
+            if (idlems >= 1000 || nullptr == display->notice)
+            {
+                // no more frames; next post will start new worker
+                display->worker = nullptr;
+                return R_DONE;
+            }
+            return 1000 - idlems; // sleep; post wakes up
+        }
+    }
+    lastframe = ts::Time::current();
+
+    if (nullptr == display->notice || display->get_desired_size() == ts::ivec2(0))
+    {
+        unlock( ap, f );
+        return 0; // check mailbox again
+    }
 
+    videosize = f->sz;
+
+    TRACE_SPAN( "video.convert" );
     ts::ivec2 lsz;
     if (ts::drawable_bitmap_c *b = display->lockbuf(&lsz))
     {
+        uint64 t0 = ts::trace_ticks();
+
         if (lsz != b->info().sz)
             b->create(lsz);
 
-        b->resize_from(ts::bmpcore_exbody_s(f->data(), ts::imgdesc_s(f->sz, 32)), ts::FILTER_BOX_LANCZOS3);
+        if (VFMT_I420 == f->fmt)
+        {
+            // convert and scale planes directly into display buffer
+            int cw = (f->sz.x + 1) / 2;
+            int ch = (f->sz.y + 1) / 2;
+            const ts::uint8 *y = f->data();
+            const ts::uint8 *u = y + f->sz.x * f->sz.y;
+            const ts::uint8 *v = u + cw * ch;
+            ts::img_helper_i420_to_ARGB_scaled(b->body(), b->info(), y, f->sz.x, u, cw, v, cw, f->sz);
+        } else
+            b->resize_from(ts::bmpcore_exbody_s(f->data(), ts::imgdesc_s(f->sz, 32)), ts::FILTER_BOX_LANCZOS3); // filter tables are cached by sizes
 
+        display->renderticks += ts::trace_ticks() - t0;
+        ++display->rendered;
         display->unlock(b);
     }
 
-    return R_DONE;
-}
-/*virtual*/ void video_frame_decoder_c::done(bool canceled)
-{
-    gmsg<ISOGM_VIDEO_TICK>(videosize).send();
-    ts::task_c::done(canceled);
+    unlock( ap, f );
+
+    return R_RESULT;
 }
 /*virtual*/ void video_frame_decoder_c::result()
 {
+    gmsg<ISOGM_VIDEO_TICK>(videosize).send();
 }
 
 void vsb_display_c::release()
@@ -25,7 +25,20 @@ typedef ts::array_inplace_t< vsb_descriptor_s, 0 > vsb_list_t;
 
 void enum_video_capture_devices( vsb_list_t &list, bool add_desktop );
 
-typedef fastdelegate::FastDelegate< void( const ts::bmpcore_exbody_s &ebm ) > bmp_ready_handler_t;
+typedef fastdelegate::FastDelegate< void( const ts::bmpcore_exbody_s &ebm, const ts::irect *damage, ts::aint ndamage ) > bmp_ready_handler_t; // damage == nullptr - whole frame changed
+
+struct frame_damage_s // tile change detector: compares frame with previous one
+{
+    enum
+    {
+        TILE_SIZE = 32,
+    };
+
+    ts::tbuf0_t<ts::irect> rects; // changed areas of last detected frame (tiles merged); empty - frame not changed
+    bool full = true; // whole frame changed (first frame or size changed)
+
+    void detect( const ts::bmpcore_exbody_s &cur, const ts::bmpcore_exbody_s &prev );
+};
 
 class vsb_c // video streaming buffer
 {
@@ -74,7 +87,7 @@ public:
     }
 
     void set_bmp_ready_handler( bmp_ready_handler_t h ) { bmpready = h; }
-    void call_bmp_ready_handler( const ts::bmpcore_exbody_s &ebm ) { if (bmpready) bmpready(ebm); }
+    void call_bmp_ready_handler( const ts::bmpcore_exbody_s &ebm, const ts::irect *damage = nullptr, ts::aint ndamage = 0 ) { if (bmpready) bmpready(ebm, damage, ndamage); }
 
     const ts::ivec2 &get_video_size() const {return video_size;}
     const ts::ivec2 &get_desired_size() const {return desired_size;} // call only from base thread
@@ -228,7 +241,9 @@ class vsb_desktop_c : public vsb_c
     {
         spinlock::long3264 sync = 0;
         ts::buf_c cursorcachedata;
-        ts::drawable_bitmap_c grabbuff;
+        ts::drawable_bitmap_c grabbuff[2]; // current and previous grabs
+        int grabcur = 0;
+        frame_damage_s damage; // grabbuff[grabcur] vs previous grab
         ts::irect grabrect;
         int monitor;
         static grab_desktop *first;
@@ -260,7 +275,13 @@ class vsb_desktop_c : public vsb_c
     int monitor = -1;
     int grabtag = -1;
 
-    void grabcb(ts::drawable_bitmap_c &gbmp);
+    ts::bitmap_c scaled; // last grab, resized to desired size; only damaged areas are resized again
+    ts::tbuf0_t<ts::irect> scaled_damage;
+    ts::Time last_publish = ts::Time::past();
+    bool dirty = true; // next published frame must be whole
+
+    void grabcb(ts::drawable_bitmap_c &gbmp, const frame_damage_s &damage);
+    bool update_scaled(const ts::bmpcore_exbody_s &gbmp, const ts::irect &r); // false - can't be resized exactly, resize whole frame
 
 public:
     vsb_desktop_c() {}
@@ -269,10 +290,16 @@ public:
     bool init(const vsb_descriptor_s &desc, const ts::wstrmap_c &dpar);
 };
 
-class gui_notice_callinprogress_c;
+struct video_display_owner_s // shows display (call notice); decoder only checks presence of owner, so it is never used from other threads
+{
+};
+
+struct incoming_video_frame_s;
+class video_frame_decoder_c;
 class vsb_display_c : public vsb_c
 {
     friend class vsb_displays_pool_c;
+    friend class video_frame_decoder_c;
 
     DECLARE_DYNAMIC_BEGIN(vsb_display_c)
     vsb_display_c() {}
@@ -280,9 +307,17 @@ class vsb_display_c : public vsb_c
     DECLARE_DYNAMIC_END(public)
 
     contact_key_s avkey;
-    gui_notice_callinprogress_c* notice = nullptr; // pure pointer due it will be checked with nullptr in other thread
+    video_display_owner_s* notice = nullptr; // pure pointer due it will be checked with nullptr in other thread
     int ref = 1;
 
+    // mailbox: only latest incoming frame is waiting for render; older one unlocked immediately (dropped)
+    spinlock::long3264 mbsync = 0;
+    incoming_video_frame_s *pending = nullptr;
+    video_frame_decoder_c *worker = nullptr; // renders frames of this display while they come
+    int dropped = 0; // frames replaced in mailbox before render
+    int rendered = 0; // frames converted to display buffer by worker
+    uint64 renderticks = 0; // time spent by these conversions (ts::trace_ticks units)
+
     void addref() {++ref;}
     void release();
 
@@ -351,12 +386,13 @@ public:
 
 
 
-struct incoming_video_frame_s // XRGB always
+struct incoming_video_frame_s // XRGB or tightly packed I420 planes (see fmt)
 {
     contact_id_s gid, cid;
     ts::ivec2 sz;
     uint64 msmonotonic;
-    uint64 padding;
+    int fmt; // video_fmt_e
+    int padding;
 
     ts::uint8 *data() {  return (ts::uint8 *)(this + 1);}
 };
@@ -364,18 +400,23 @@ struct incoming_video_frame_s // XRGB always
 static_assert( sizeof( incoming_video_frame_s ) == VIDEO_FRAME_HEADER_SIZE, "size!" );
 
 class active_protocol_c;
-class video_frame_decoder_c : public ts::task_c
+class video_frame_decoder_c : public ts::task_c // one per display; lives while frames come
 {
     active_protocol_c *ap;
     ts::ivec2 videosize = ts::ivec2(640,480);
-    incoming_video_frame_s *f;
     vsb_display_c *display = nullptr;
+    ts::Time lastframe = ts::Time::current();
 
     /*virtual*/ int iterate(ts::task_executor_c *e) override;
-    /*virtual*/ void done(bool canceled) override;
+    /*virtual*/ int priority() const override { return PRI_HIGH; }
     /*virtual*/ void result() override;
+
+    static void unlock( active_protocol_c *ap, incoming_video_frame_s *f );
+
 public:
-    video_frame_decoder_c( active_protocol_c *ap, incoming_video_frame_s *f );
+    video_frame_decoder_c( active_protocol_c *ap, vsb_display_c *display ); // use post
     ~video_frame_decoder_c();
 
+    static void post( active_protocol_c *ap, incoming_video_frame_s *f ); // any thread; frame ownership goes to display mailbox
+    static void post( active_protocol_c *ap, vsb_display_c *display, incoming_video_frame_s *f ); // display - referenced by caller (reference goes to mailbox); ap == nullptr - frame is owned by caller, not ipc buffer (tests)
 };
@@ -10,7 +10,13 @@
 #endif // _NIX
 
 
-#define IPCVER 2
+#define IPCVER 3
+
+#ifdef _MSC_VER
+#define RING_BARRIER() _ReadWriteBarrier()
+#else
+#define RING_BARRIER() __sync_synchronize()
+#endif
 
 #ifndef __STR1__
 #define __STR2__(x) #x
@@ -36,6 +42,8 @@ enum datatype_e
     DATATYPE_CLEANUP_BUFFERS,
     DATATYPE_DATA_128k,
     DATATYPE_DATA_BIG,
+    DATATYPE_NEW_RING, // partner created its outgoing ring
+    DATATYPE_RING_SIGNAL, // new records in ring, which was empty
 };
 
 struct handshake_ask_s
@@ -65,6 +73,16 @@ struct new_xchg_buffer_s
     new_xchg_buffer_s(int alc):allocated(alc) {} //-V730
 };
 
+struct new_ring_s
+{
+    int datasize = sizeof(new_ring_s);
+    int datatype = DATATYPE_NEW_RING;
+    int allocated = RING_BUFFER_SIZE;
+    char ringname[ MAX_PATH ];
+
+    new_ring_s() {}; //-V730
+};
+
 template<datatype_e d> struct signal_s
 {
     int datasize = sizeof(signal_s);
@@ -116,6 +134,43 @@ inline void *xchg_buffer_header_s::getptr() const
 
 #define MAX_XCHG_BUFFERS 16
 
+// single-producer/single-consumer ring in shared memory
+// positions are never wrapped (only masked), so write_pos - read_pos is always used space
+struct ring_header_s
+{
+    volatile size_t write_pos; // written only by producer
+    char pad0[ 64 - sizeof(size_t) ];
+    volatile size_t read_pos; // written only by consumer
+    volatile spinlock::long3264 consumer_waiting; // consumer found ring empty; producer should send DATATYPE_RING_SIGNAL via pipe
+    char pad1[ 64 - sizeof(size_t) - sizeof(spinlock::long3264) ];
+    int size;
+
+    char *data() { return (char *)this + 256; }
+};
+
+struct ring_record_s
+{
+    enum rtype_e
+    {
+        RECORD_DATA,
+        RECORD_MARKER, // next pipe message should be processed here (keeps order of ring and pipe messages)
+        RECORD_WRAP, // rest of ring is unused, next record at begin of ring
+    };
+
+    int size;
+    int type;
+
+    static size_t full_size( int datasize ) { return (sizeof(ring_record_s) + datasize + 7) & (~7); }
+};
+
+namespace
+{
+    enum ring_e
+    {
+        RING_HDR_SIZE = 256,
+    };
+}
+
 struct ipc_data_s
 {
     spinlock::long3264 sync;
@@ -141,6 +196,21 @@ struct ipc_data_s
         }
 
     } xchg_buffers[MAX_XCHG_BUFFERS];
+
+    struct ring_s
+    {
+        HANDLE mapping;
+        ring_header_s *ptr;
+
+        void reset()
+        {
+            if (ptr) UnmapViewOfFile(ptr);
+            if (mapping) CloseHandle(mapping);
+            mapping = nullptr;
+            ptr = nullptr;
+        }
+    } ring_out, ring_in;
+
     int xchg_buffers_count;
     unsigned int xchg_buffer_tag;
 
@@ -167,23 +237,94 @@ struct ipc_data_s
         int datatype = DATATYPE_DATA_128k;
     };
 
-    bool send(const void *data, int datasize)
+    bool ring_write( int type, const void *data, int datasize )
     {
-        SIMPLELOCK(sync);
+#if defined _DEBUG && defined _WIN32
+        if (!sync)
+            __debugbreak(); // sync must be locked (only one producer)
+#endif // _DEBUG
 
-        uint32_t w = 0;
+        ring_header_s *h = ring_out.ptr;
+        size_t mask = (size_t)h->size - 1;
+        size_t need = ring_record_s::full_size( datasize );
+        if (need * 2 > (size_t)h->size)
+            return false; // too big for this ring; use pipe
+        size_t wp = h->write_pos;
+        size_t tail = (size_t)h->size - (wp & mask);
+        size_t total = tail < need ? tail + need : need;
+
+        for (int spin = 0; (size_t)h->size - (wp - h->read_pos) < total; ++spin)
+        {
+            // ring is full: wait for consumer
+            if (quit_quit_quit)
+                return false;
+            if (spin < 64) _mm_pause();
+            else Sleep(spin < 256 ? 0 : 1);
+        }
+        RING_BARRIER();
+
+        if (tail < need)
+        {
+            ring_record_s *wrap = (ring_record_s *)(h->data() + (wp & mask));
+            wrap->size = 0;
+            wrap->type = ring_record_s::RECORD_WRAP;
+            wp += tail;
+        }
+
+        ring_record_s *rec = (ring_record_s *)(h->data() + (wp & mask));
+        rec->size = datasize;
+        rec->type = type;
+        if (datasize) memcpy(rec + 1, data, datasize);
+
+        RING_BARRIER();
+        h->write_pos = wp + need;
+
+        // wake up consumer only if it is waiting; marker is always followed by pipe message, so no need to signal
+        if (ring_record_s::RECORD_MARKER != type && 1 == SLxInterlockedCompareExchange(&h->consumer_waiting, 0, 1))
+        {
+            signal_s<DATATYPE_RING_SIGNAL> rs;
+            uint32_t w = 0;
+            WriteFile(pipe_out, &rs, sizeof(rs), &w, nullptr);
+        }
+        return true;
+    }
+
+    void marker() // must be called before any pipe message (except DATATYPE_RING_SIGNAL)
+    {
+        if (ring_out.ptr)
+            ring_write( ring_record_s::RECORD_MARKER, nullptr, 0 );
+    }
+
+    void send_cleanup_signal()
+    {
         if (cleaup_buffers_signal)
         {
             signal_s<DATATYPE_CLEANUP_BUFFERS> cdb;
+            uint32_t w = 0;
+            marker();
             WriteFile(pipe_out, &cdb, sizeof(cdb), &w, nullptr);
             cleaup_buffers_signal = false;
         }
+    }
+
+    bool send(const void *data, int datasize)
+    {
+        SIMPLELOCK(sync);
+
+        send_cleanup_signal();
 
+        // fast way: copy to ring
+        if (ring_out.ptr && datasize <= BIG_DATA_SIZE)
+            if (ring_write( ring_record_s::RECORD_DATA, data, datasize ))
+                return true;
+
+        uint32_t w = 0;
         data_s dd; dd.datasize += datasize;
 
         if (datasize > BIG_DATA_SIZE)
             dd.datatype = DATATYPE_DATA_BIG;
 
+        marker();
         WriteFile(pipe_out, &dd, sizeof(data_s), &w, nullptr);
         if (w != sizeof(data_s)) return false;
 
@@ -197,16 +338,90 @@ struct ipc_data_s
     {
         SIMPLELOCK(sync);
 
+        send_cleanup_signal();
+
         uint32_t w = 0;
-        if (cleaup_buffers_signal)
+        marker();
+        WriteFile(pipe_out, &s, sizeof(s), &w, nullptr);
+        return w == sizeof(s);
+    }
+
+    void create_ring_out()
+    {
+        if (!RING_BUFFER_SIZE)
+            return;
+
+        new_ring_s nr;
+        sprintf_s(nr.ringname, sizeof(nr.ringname), "ipcr_" __STR1__(IPCVER) "_%u_%u", (unsigned)GetCurrentProcessId(), xchg_buffer_tag++);
+
+        ring_s rb;
+        rb.mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, RING_HDR_SIZE + RING_BUFFER_SIZE, nr.ringname);
+        if (!rb.mapping) return;
+        rb.ptr = (ring_header_s *)MapViewOfFile(rb.mapping, FILE_MAP_WRITE, 0, 0, RING_HDR_SIZE + RING_BUFFER_SIZE);
+        if (!rb.ptr)
         {
-            signal_s<DATATYPE_CLEANUP_BUFFERS> cdb;
-            WriteFile(pipe_out, &cdb, sizeof(cdb), &w, nullptr);
-            cleaup_buffers_signal = false;
+            CloseHandle(rb.mapping);
+            return;
         }
+        rb.ptr->write_pos = 0;
+        rb.ptr->read_pos = 0;
+        rb.ptr->consumer_waiting = 1;
+        rb.ptr->size = RING_BUFFER_SIZE;
 
-        WriteFile(pipe_out, &s, sizeof(s), &w, nullptr);
-        return w == sizeof(s);
+        if (!send(nr))
+        {
+            rb.reset();
+            return;
+        }
+
+        SIMPLELOCK(sync);
+        ring_out = rb; // from now all small data goes through ring
+    }
+
+    bool ring_read( bool till_marker ) // returns false if datahandler returns IPCR_BREAK
+    {
+        ring_header_s *h = ring_in.ptr;
+        size_t mask = (size_t)h->size - 1;
+
+        for (;;)
+        {
+            size_t rp = h->read_pos;
+            if (rp == h->write_pos)
+            {
+                if (till_marker)
+                    return true; // there is no marker for pipe message; it is possible only at end
+
+                // ring is empty: ask producer to signal via pipe, then check again to avoid lost wake up
+                SLxInterlockedCompareExchange(&h->consumer_waiting, 1, 0);
+                if (rp == h->write_pos)
+                    return true;
+                SLxInterlockedCompareExchange(&h->consumer_waiting, 0, 1); // if producer already reset flag, signal will come; it is ok
+                continue;
+            }
+            RING_BARRIER();
+
+            ring_record_s *rec = (ring_record_s *)(h->data() + (rp & mask));
+            if (ring_record_s::RECORD_WRAP == rec->type)
+            {
+                h->read_pos = rp + ((size_t)h->size - (rp & mask));
+                continue;
+            }
+            if (ring_record_s::RECORD_MARKER == rec->type)
+            {
+                if (till_marker)
+                {
+                    RING_BARRIER();
+                    h->read_pos = rp + ring_record_s::full_size(0);
+                }
+                return true; // process pipe message first
+            }
+
+            ipc_result_e rslt = datahandler(par_data, rec + 1, rec->size);
+            RING_BARRIER();
+            h->read_pos = rp + ring_record_s::full_size(rec->size);
+            if (IPCR_BREAK == rslt)
+                return false;
+        }
     }
 
     void insert_buffer( exchange_buffer_s *newexchb )
@@ -292,6 +507,30 @@ struct ipc_data_s
             OOPS;
         }
 
+        if (DATATYPE_RING_SIGNAL == d.datatype)
+        {
+            if (!ring_in.ptr || !ring_read(false))
+                OOPS;
+            return true;
+        }
+
+        // ring records sent before this pipe message
+        if (ring_in.ptr && !ring_read(true))
+            OOPS;
+
+        if (!tick_pipe(d))
+            return false;
+
+        // and records sent after
+        if (ring_in.ptr && !quit_quit_quit && !ring_read(false))
+            OOPS;
+
+        return true;
+    }
+
+    bool tick_pipe(const data_s &d)
+    {
+        uint32_t r;
         switch(d.datatype)
         {
         case DATATYPE_HANDSHAKE_ASK:
@@ -308,6 +547,7 @@ struct ipc_data_s
             }
 
             send( handshake_answer_s() );
+            create_ring_out();
             return true;
         case DATATYPE_IDLEJOB_ASK:
             send(signal_s<DATATYPE_IDLEJOB_ANSWER>());
@@ -360,6 +600,29 @@ struct ipc_data_s
                     bb.reset();
             }
             return true;
+        case DATATYPE_NEW_RING:
+            {
+                if (d.datasize != sizeof(new_ring_s) || ring_in.ptr)
+                    OOPS;
+
+                new_ring_s nr;
+                ReadFile(pipe_in, ((char *)&nr) + sizeof(d), sizeof(new_ring_s) - sizeof(d), &r, nullptr);
+                if (r != sizeof(new_ring_s) - sizeof(d) || nr.allocated <= 0 || (nr.allocated & (nr.allocated - 1)) != 0)
+                    OOPS;
+
+                ring_s rb;
+                rb.mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, RING_HDR_SIZE + nr.allocated, nr.ringname);
+                if (!rb.mapping)
+                    OOPS;
+                rb.ptr = (ring_header_s *)MapViewOfFile(rb.mapping, FILE_MAP_WRITE, 0, 0, (ptrdiff_t)(RING_HDR_SIZE + nr.allocated));
+                if (!rb.ptr)
+                {
+                    CloseHandle(rb.mapping);
+                    OOPS;
+                }
+                ring_in = rb;
+            }
+            return true;
         case DATATYPE_BUFFER_SENT:
             {
                 uint32_t pid = GetCurrentProcessId();
@@ -573,6 +836,10 @@ int ipc_junction_s::start( const char *junction_name )
     d.cleaup_buffers_signal = false;
     d.xchg_buffers_count = 0;
     d.xchg_buffer_tag = 0;
+    d.ring_out.mapping = nullptr;
+    d.ring_out.ptr = nullptr;
+    d.ring_in.mapping = nullptr;
+    d.ring_in.ptr = nullptr;
 
     if (is_client)
     {
@@ -606,6 +873,7 @@ int ipc_junction_s::start( const char *junction_name )
             goto byebye;
 
         d.other_pid = hsh.pid;
+        d.create_ring_out();
 
     }
 
@@ -668,6 +936,9 @@ void ipc_junction_s::stop()
     if (d.pipe_in) CloseHandle(d.pipe_in);
     if (d.pipe_out) CloseHandle(d.pipe_out);
 
+    d.ring_out.reset();
+    d.ring_in.reset();
+
     memset(buffer, 0, sizeof(buffer));
     stop_called = true;
 }
@@ -741,6 +1012,7 @@ void *ipc_junction_s::lock_buffer(int size)
     if (d.xchg_buffers_count == MAX_XCHG_BUFFERS) return nullptr;
     l.unlock();
 
+    size = (size + XCHG_BUFFER_GRANULARITY - 1) & ~(XCHG_BUFFER_GRANULARITY - 1); // creating mapping is expensive; round up to reuse buffer for next frames
     new_xchg_buffer_s buf(size);
     sprintf_s(buf.bufname, sizeof(buf.bufname), "ipcb_" __STR1__(IPCVER) "_%u_%u", pid, d.xchg_buffer_tag++);
 
@@ -854,15 +1126,8 @@ void ipc_junction_s::cleanup_buffers()
 
     SIMPLELOCK(d.sync);
 
-    if (d.cleaup_buffers_signal)
-    {
-        // DATATYPE_CLEANUP_BUFFERS must be called directly (not using send)
-        signal_s<DATATYPE_CLEANUP_BUFFERS> cdb;
-        DWORD  w;
-        WriteFile(d.pipe_out, &cdb, sizeof(cdb), &w, nullptr);
-        d.cleaup_buffers_signal = false;
-    }
-
+    // DATATYPE_CLEANUP_BUFFERS must be called directly (not using send)
+    d.send_cleanup_signal();
     d.cleanup_buffers();
 }
 
@@ -5,8 +5,10 @@
 #pragma once
 
 /*
-  WM_COPYDATA and shared-in-memory-file based Inter-Process Communication library
+  pipes and shared-in-memory-file based Inter-Process Communication library
   only point-to-point connection supported
+  small data goes through shared memory single-producer/single-consumer ring (one per direction);
+  pipe is used for control messages, big data and to wake up partner when its ring was empty
 */
 
 #pragma warning (disable:4091) // 'typedef ' : ignored on left of '' when no variable is declared
@@ -17,6 +19,8 @@ namespace ipc
     {
         BIG_DATA_SIZE = 65536 * 2, // big data (size > BIG_DATA_SIZE) received with multiple calls of processor_func
         XCHG_BUFFER_ADDITION_SPACE = 16,
+        XCHG_BUFFER_GRANULARITY = 65536, // exchange buffers allocated with this granularity to be reused for frames of slightly different size
+        RING_BUFFER_SIZE = 1024 * 1024, // power of 2; size of shared memory ring per direction; data up to BIG_DATA_SIZE sent through ring without syscalls; 0 - pipes only
 #ifdef _DEBUG
         XCHG_BUFFER_LOCK_TIMEOUT = 0,
 #else
@@ -37,9 +41,9 @@ namespace ipc
     struct ipc_junction_s
     {
 #if defined (_M_AMD64) || defined (WIN64) || defined (__LP64__)
-        enum { internal_data_size = 191 * 2 - 37 };
+        enum { internal_data_size = 191 * 2 - 37 + 48 };
 #else
-        enum { internal_data_size = 191 };
+        enum { internal_data_size = 191 + 24 };
 #endif
 
         char buffer[ internal_data_size ]; // internal data. ipc_junction_s must be allocated at your application. good news: no any new/malloc/delete/free memory routines called inside lib engine
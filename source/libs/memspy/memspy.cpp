@@ -18,7 +18,9 @@
 #define MEMSPY_SPY_SIZE 0                   // zero - spy every allocation, >0 - spy only allocations with given size
 #define MEMSPY_SPY_LINE 0                   // zero - spy every line, >0 - spy only allocations with given line
 #define MEMSPY_SPY_NUM 0
-#define MEMSPY_MAX_FREE_UNALLOCATED     (1024*1024)   // in bytes - how many bytes spy keep unfree (useful to detect twice free)
+#define MEMSPY_MAX_FREE_UNALLOCATED     (1024*1024)   // in bytes - how many bytes spy keep unfree (useful to detect twice free); per shard
+#define MEMSPY_SHARDS                   16            // power of 2; number of independent block lists (threads are spread over them)
+#define MEMSPY_MAX_TYPES                256           // per type accounting (see mspy_getallocated_stat); bigger types are accounted as last one
 #define MEMSPY_CORRUPT_CHECK_ZONE_BEGIN 32
 #define MEMSPY_CORRUPT_CHECK_ZONE_END   32
 #define MEMSPY_MEMLEAK_MESSAGEBOX       0
@@ -59,35 +61,36 @@ namespace
 {
 
 #pragma intrinsic (_InterlockedCompareExchange)
+#pragma intrinsic (_InterlockedIncrement)
 
-volatile long memspylock = 0;
-int numpool = 0;
-int freesize = 0;
+volatile long numpool = 0;
+volatile long shardpool = 0;
+__declspec(thread) int tls_shard = -1;
 
-void spylock()
+void spylock( volatile long &lock )
 {
     long myv = GetCurrentThreadId();
-    if (memspylock == myv)
+    if (lock == myv)
         __debugbreak();
     for (;;)
     {
-        long val = _InterlockedCompareExchange(&memspylock, myv, 0);
+        long val = _InterlockedCompareExchange(&lock, myv, 0);
         if (val == 0)
             break;
         if (val == myv)
             __debugbreak();
         _mm_pause();
     }
-    if (memspylock != myv)
+    if (lock != myv)
         __debugbreak();
 }
 
-void spyunlock()
+void spyunlock( volatile long &lock )
 {
     long myv = GetCurrentThreadId();
-    if (memspylock != myv)
+    if (lock != myv)
         __debugbreak();
-    long val = _InterlockedCompareExchange(&memspylock, 0, myv);
+    long val = _InterlockedCompareExchange(&lock, 0, myv);
     if (val != myv)
         __debugbreak();
 }
@@ -99,6 +102,8 @@ struct block_header_s
     int line;
     int num;
     int typ;
+    int shard;
+    int freed;
     block_header_s *prev;
     block_header_s *next;
 #if MEMSPY_CALL_STACK
@@ -200,10 +205,72 @@ enum
 };
 
 
-static block_header_s *first = nullptr;
-static block_header_s *last = nullptr;
-static block_header_s *first_free = nullptr;
-static block_header_s *last_free = nullptr;
+// every thread sticks to one shard, so threads almost never contend for same lock
+// block is always returned to shard it was allocated in (it can be freed by any thread)
+struct __declspec(align(64)) shard_s
+{
+    volatile long lock;
+    block_header_s *first;
+    block_header_s *last;
+    block_header_s *first_free;
+    block_header_s *last_free;
+    int freesize;
+    int nums[MEMSPY_MAX_TYPES];
+    size_t sizes[MEMSPY_MAX_TYPES];
+
+    void lock_it() { spylock(lock); }
+    void unlock_it() { spyunlock(lock); }
+
+    static int tindex(int typ) { return (unsigned)typ < MEMSPY_MAX_TYPES ? typ : MEMSPY_MAX_TYPES - 1; }
+    void account_add(const block_header_s *b) { int t = tindex(b->typ); ++nums[t]; sizes[t] += b->size; }
+    void account_sub(const block_header_s *b) { int t = tindex(b->typ); --nums[t]; sizes[t] -= b->size; }
+};
+
+static shard_s shards[MEMSPY_SHARDS]; // zero initialized
+
+shard_s &my_shard()
+{
+    if (tls_shard < 0)
+        tls_shard = (_InterlockedIncrement(&shardpool) - 1) & (MEMSPY_SHARDS - 1);
+    return shards[tls_shard];
+}
+
+// leak report requires all shards locked; always lock in same order
+void lock_all()
+{
+    for (int i = 0; i < MEMSPY_SHARDS; ++i)
+        shards[i].lock_it();
+}
+void unlock_all()
+{
+    for (int i = MEMSPY_SHARDS - 1; i >= 0; --i)
+        shards[i].unlock_it();
+}
+
+bool no_blocks() // all shards must be locked
+{
+    for (int i = 0; i < MEMSPY_SHARDS; ++i)
+        if (shards[i].first) return false;
+    return true;
+}
+
+// iterate blocks of all shards in allocation order; all shards must be locked
+template<typename F> void for_each_block( F f )
+{
+    block_header_s *cur[MEMSPY_SHARDS];
+    for (int i = 0; i < MEMSPY_SHARDS; ++i)
+        cur[i] = shards[i].first;
+    for (;;)
+    {
+        int best = -1;
+        for (int i = 0; i < MEMSPY_SHARDS; ++i)
+            if (cur[i] && (best < 0 || (unsigned)cur[i]->num < (unsigned)cur[best]->num))
+                best = i;
+        if (best < 0 || !f(cur[best]))
+            break;
+        cur[best] = cur[best]->next;
+    }
+}
 
 block_header_s *block_header_s::setup(const char *fn_, int line_, int typ_, unsigned int sz)
 {
@@ -216,21 +283,25 @@ block_header_s *block_header_s::setup(const char *fn_, int line_, int typ_, unsi
         __debugbreak();
 #endif
 
-    spylock();
 #if MEMSPY_SPY_SIZE && MEMSPY_SPY_LINE
-    if (MEMSPY_SPY_SIZE == sz && MEMSPY_SPY_LINE == line_) num = numpool++;
+    if (MEMSPY_SPY_SIZE == sz && MEMSPY_SPY_LINE == line_) num = _InterlockedIncrement(&numpool) - 1;
     else num = -1;
 #elif MEMSPY_SPY_SIZE
-    if (MEMSPY_SPY_SIZE == sz) num = numpool++;
+    if (MEMSPY_SPY_SIZE == sz) num = _InterlockedIncrement(&numpool) - 1;
     else num = -1;
 #elif MEMSPY_SPY_LINE
-    if (MEMSPY_SPY_LINE == line_) num = numpool++;
+    if (MEMSPY_SPY_LINE == line_) num = _InterlockedIncrement(&numpool) - 1;
     else num = -1;
 #else
-    num = numpool++;
+    num = _InterlockedIncrement(&numpool) - 1;
 #endif
-    LIST_ADD(this, first, last, prev, next);
-    spyunlock();
+    shard_s &sh = my_shard();
+    shard = (int)(&sh - shards);
+    freed = 0;
+    sh.lock_it();
+    LIST_ADD(this, sh.first, sh.last, prev, next);
+    sh.account_add(this);
+    sh.unlock_it();
 
 #if MEMSPY_SPY_NUM
     if (MEMSPY_SPY_NUM == num)
@@ -266,9 +337,13 @@ block_header_s *block_header_s::mr(const char *fn, int line, int typ, void *p, s
     if (p == nullptr) return ma(fn,line,typ,sz);
 
     block_header_s *me = (block_header_s *)((char *)p-sizeof(block_header_s));
-    spylock();
-    LIST_DEL( me, first, last, prev, next );
-    spyunlock();
+    if (me->freed || (unsigned)me->shard >= MEMSPY_SHARDS)
+        __debugbreak(); // resize of deleted block
+    shard_s &sh = shards[me->shard];
+    sh.lock_it();
+    LIST_DEL( me, sh.first, sh.last, prev, next );
+    sh.account_sub(me);
+    sh.unlock_it();
     me->check_corrupt();
 
     size_t real_alloc_size = sz + sizeof(block_header_s) + preblock_size + MEMSPY_CORRUPT_CHECK_ZONE_END;
@@ -293,24 +368,39 @@ void block_header_s::mf(void *p)
 
     block_header_s *me = (block_header_s *)((char *)p - sizeof(block_header_s));
     void *real_p = ((char *)me) - preblock_size;
-    spylock();
+    if (me->freed || (unsigned)me->shard >= MEMSPY_SHARDS)
+        __debugbreak(); // delete again
+
+    shard_s &sh = shards[me->shard];
+    sh.lock_it();
+    if (me->freed)
+        __debugbreak(); // delete again (concurrently)
 
-    for (block_header_s *b = first_free; b; b = b->next)
+    LIST_DEL(me, sh.first, sh.last, prev, next);
+    sh.account_sub(me);
+#if MEMSPY_MAX_FREE_UNALLOCATED
+    real_p = nullptr;
+    me->freed = 1;
+    LIST_ADD(me, sh.first_free, sh.last_free, prev, next);
+    sh.freesize += me->size;
+    block_header_s *evicted = nullptr;
+    while( sh.freesize > MEMSPY_MAX_FREE_UNALLOCATED && sh.first_free )
     {
-        if (b == me)
-            __debugbreak(); // delete again
+        block_header_s *x = sh.first_free;
+        sh.freesize -= x->size;
+        LIST_DEL(x, sh.first_free, sh.last_free, prev, next);
+        x->next = evicted;
+        evicted = x;
     }
+#endif
+    sh.unlock_it();
 
-    LIST_DEL(me, first, last, prev, next);
 #if MEMSPY_MAX_FREE_UNALLOCATED
-    real_p = nullptr;
-    LIST_ADD(me, first_free, last_free, prev, next);
-    freesize += me->size;
-    while( freesize > MEMSPY_MAX_FREE_UNALLOCATED && first_free )
+    // return evicted blocks to system outside of lock
+    for (; evicted;)
     {
-        block_header_s *x = first_free;
-        freesize -= x->size;
-        LIST_DEL(x, first_free, last_free, prev, next);
+        block_header_s *x = evicted;
+        evicted = x->next;
         void *real_x = ((char *)x) - preblock_size;
 #ifndef _DEBUG
         size_t my_size = x->size + sizeof(block_header_s) + preblock_size + MEMSPY_CORRUPT_CHECK_ZONE_END;
@@ -319,7 +409,6 @@ void block_header_s::mf(void *p)
         MEMSPY_SYS_FREE(real_x);
     }
 #endif
-    spyunlock();
     me->check_corrupt();
 
     if (real_p)
@@ -382,53 +471,84 @@ size_t mspy_size(void *p)
 bool mspy_getallocated_info( memcb *cb, void *prm )
 {
 #if !MEMSPY_DISABLE
-    spylock();
-    if ( first == nullptr )
-    {
-        spyunlock();
-        return false;
-    }
+    struct item_s { int typ; int num; size_t sz; };
+    const int maxitems = 256;
+    item_s items[maxitems];
+    bool any = false;
 
-    int i = 0;
-
-    for(;;)
+    // callback called without lock, so copy blocks info by portions
+    for (int s = 0; s < MEMSPY_SHARDS; ++s)
     {
-        int n = 0;
-        for ( block_header_s *b = first; b; b = b->next )
+        shard_s &sh = shards[s];
+        for (int skip = 0;; )
         {
-            if ( i == n )
+            int cnt = 0;
+            sh.lock_it();
+            int n = 0;
+            for (block_header_s *b = sh.first; b && cnt < maxitems; b = b->next, ++n)
             {
-                int typ = b->typ;
-                int num = b->num;
-                size_t sz = b->size;
-                spyunlock();
-                cb( typ, num, sz, prm );
-                spylock();
-                ++i;
-                n = -1;
-                break;
+                if (n < skip) continue;
+                items[cnt].typ = b->typ;
+                items[cnt].num = b->num;
+                items[cnt].sz = b->size;
+                ++cnt;
             }
-            ++n;
+            sh.unlock_it();
+
+            for (int i = 0; i < cnt; ++i)
+                cb(items[i].typ, items[i].num, items[i].sz, prm);
+
+            if (cnt) any = true;
+            if (cnt < maxitems) break;
+            skip += cnt;
         }
-        if (i>=n && n >= 0)
-            break;
     }
 
-    spyunlock();
+    return any;
+#else
+    return true;
 #endif
 
-    return true;
+}
 
+bool mspy_getallocated_stat( memcb *cb, void *prm )
+{
+#if !MEMSPY_DISABLE
+    int nums[MEMSPY_MAX_TYPES] = {};
+    size_t sizes[MEMSPY_MAX_TYPES] = {};
+
+    // merge per shard counters; each shard locked only for copying
+    for (int s = 0; s < MEMSPY_SHARDS; ++s)
+    {
+        shard_s &sh = shards[s];
+        sh.lock_it();
+        for (int t = 0; t < MEMSPY_MAX_TYPES; ++t)
+            nums[t] += sh.nums[t], sizes[t] += sh.sizes[t];
+        sh.unlock_it();
+    }
+
+    bool any = false;
+    for (int t = 0; t < MEMSPY_MAX_TYPES; ++t)
+        if (nums[t])
+        {
+            cb(t, nums[t], sizes[t], prm);
+            any = true;
+        }
+
+    return any;
+#else
+    return true;
+#endif
 }
 
 bool mspy_getallocated_info( char *buf, int bufsz )
 {
 #if !MEMSPY_DISABLE
     int curl = 0;
-    spylock();
-    if (first == nullptr)
+    lock_all();
+    if (no_blocks())
     {
-        spyunlock();
+        unlock_all();
         return false;
     }
 
@@ -448,14 +568,14 @@ bool mspy_getallocated_info( char *buf, int bufsz )
     SymInitialize(block_header_s::process, NULL, TRUE);
 #endif
 
-    for( block_header_s *b = first; b; b=b->next )
-    {
+    for_each_block([&]( block_header_s *b ) ->bool {
         int cs = b->getinfo(buf+curl,bufsz-curl);
-        if (cs < 0) break;
+        if (cs < 0) return false;
         curl += cs;
-    }
+        return true;
+    });
 
-    spyunlock();
+    unlock_all();
 #endif
 
     return true;
@@ -475,10 +595,11 @@ struct memleak_fin_s
         }
 #endif
 #if MEMSPY_MEMLEAK_DEBUGOUTPUT
-        spylock();
-        if (first == nullptr)
+        lock_all();
+        if (no_blocks())
         {
-            spyunlock();
+            unlock_all();
+            free_unallocated();
             return;
         }
 
@@ -489,20 +610,29 @@ struct memleak_fin_s
 #endif
         OutputDebugStringA("   -================[MEMORY LEAKS]================-\r\n");
 
-        for (block_header_s *b = first; b; b = b->next)
-        {
-            if (b->getinfo(buf, 2048) < 0) break;
+        for_each_block([&]( block_header_s *b ) ->bool {
+            if (b->getinfo(buf, 2048) < 0) return false;
             OutputDebugStringA(buf);
-        }
+            return true;
+        });
 
-        spyunlock();
+        unlock_all();
 #endif
-        for (;first_free; )
+        free_unallocated();
+    }
+
+    static void free_unallocated()
+    {
+        for (int s = 0; s < MEMSPY_SHARDS; ++s)
         {
-            block_header_s *x = first_free;
-            LIST_DEL(x, first_free, last_free, prev, next);
-            void *real_x = ((char *)x) - preblock_size;
-            MEMSPY_SYS_FREE(real_x);
+            shard_s &sh = shards[s];
+            for (; sh.first_free; )
+            {
+                block_header_s *x = sh.first_free;
+                LIST_DEL(x, sh.first_free, sh.last_free, prev, next);
+                void *real_x = ((char *)x) - preblock_size;
+                MEMSPY_SYS_FREE(real_x);
+            }
         }
     }
 
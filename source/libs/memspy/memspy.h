@@ -34,6 +34,7 @@ size_t mspy_size(void *p);
 
 typedef void memcb( int typ, int num, size_t size, void *prm );
 
-bool mspy_getallocated_info( memcb *cb, void *prm );
+bool mspy_getallocated_info( memcb *cb, void *prm ); // cb called for every allocated block
+bool mspy_getallocated_stat( memcb *cb, void *prm ); // cb called once per used type; num - number of blocks, size - total size (cheap, no blocks iteration)
 bool mspy_getallocated_info( char *buf, int bufsz ); // call at end of app to get allocated memory info (leaks)
 void reset_allocnum();
\ No newline at end of file
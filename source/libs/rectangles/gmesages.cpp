@@ -2,30 +2,38 @@
 
 namespace
 {
+struct keylst_s
+{
+    gm_receiver_c *_gmer_first = nullptr;
+    gm_receiver_c *_gmer_last = nullptr;
+};
+typedef ts::hashmap_t< ts::uint64, keylst_s > keymap_t;
+
 struct evlst_s
 {
     gm_receiver_c *_gmer_first;
     gm_receiver_c *_gmer_last;
     gm_receiver_c *_curnext;
+    keymap_t *keyed; // receivers bound to key
+    gm_counters_s counters;
 };
 
 struct evt_internals_s
 {
-#ifndef _FINAL
     int evs_count = 0;
-#endif // _FINAL
     evlst_s *evs = nullptr;
 
     ~evt_internals_s()
     {
-#ifndef _FINAL
-        evs_count = -1;
-#endif // _FINAL
         if (evs)
         {
+            for ( int i = 0; i < evs_count; ++i )
+                if ( evs[ i ].keyed )
+                    TSDEL( evs[ i ].keyed );
             MM_FREE(evs);
             evs = nullptr;
         }
+        evs_count = -1;
     }
     void prepare(int evcnt)
     {
@@ -33,9 +41,7 @@ struct evt_internals_s
         int sz = evcnt * sizeof(evlst_s);
         evs = (evlst_s *)MM_ALLOC_T(MEMT_GMES, sz);
         memset(evs, 0, sz);
-#ifndef _FINAL
         evs_count = evcnt;
-#endif // _FINAL
     }
     evlst_s & operator()(int ev)
     {
@@ -47,16 +53,65 @@ ts::static_setup<evt_internals_s, -2> internals;
 }
 
 gm_receiver_c::gm_receiver_c(int ev)
+{
+    link( ev );
+}
+
+void gm_receiver_c::link( int ev )
 {
     evlst_s &l = internals()(ev);
-    LIST_ADD(this, l._gmer_first, l._gmer_last, _gmer_prev, _gmer_next);
+    if ( 0 == _gmer_key )
+    {
+        LIST_ADD( this, l._gmer_first, l._gmer_last, _gmer_prev, _gmer_next );
+        return;
+    }
+
+    if ( !l.keyed )
+        l.keyed = TSNEW( keymap_t );
+    keylst_s &kl = l.keyed->add( _gmer_key ); // hashmap items never move, so kl can be kept by dispatcher
+    LIST_ADD( this, kl._gmer_first, kl._gmer_last, _gmer_prev, _gmer_next );
 }
 
-void gm_receiver_c::unsubscribe(int ev)
+void gm_receiver_c::unlink( int ev )
 {
     evlst_s &l = internals()(ev);
     if (l._curnext == this) l._curnext = _gmer_next;
-    LIST_DEL(this, l._gmer_first, l._gmer_last, _gmer_prev, _gmer_next);
+    if ( 0 == _gmer_key )
+    {
+        LIST_DEL( this, l._gmer_first, l._gmer_last, _gmer_prev, _gmer_next );
+        return;
+    }
+
+    keylst_s *kl = l.keyed->get( _gmer_key );
+    LIST_DEL( this, kl->_gmer_first, kl->_gmer_last, _gmer_prev, _gmer_next );
+    if ( nullptr == kl->_gmer_first )
+        l.keyed->remove( _gmer_key ); // dispatcher does not keep key list while iterating, so it can be removed right now
+}
+
+void gm_receiver_c::unsubscribe(int ev)
+{
+    unlink( ev );
+}
+
+void gm_receiver_c::subscribe_key( int ev, ts::uint64 key )
+{
+    if ( key == _gmer_key )
+        return;
+    unlink( ev );
+    _gmer_key = key;
+    link( ev );
+}
+
+const gm_counters_s &gm_receiver_c::counters( int ev )
+{
+    return internals()( ev ).counters;
+}
+
+void gm_receiver_c::reset_counters()
+{
+    evt_internals_s &i = internals();
+    for ( int ev = 0; ev < i.evs_count; ++ev )
+        i.evs[ ev ].counters = gm_counters_s();
 }
 
 void gm_receiver_c::prepare( int evcnt )
@@ -81,21 +136,52 @@ ts::uint32 gm_receiver_c::notify_receivers(int ev, gmsgbase &par)
     if (l._curnext)
         return GMRBIT_FAIL; // recursive ev call! NOT supported
 
-    for(;ASSERT(par.pass < 100, "100 iterations! vow vow");)
+    ++l.counters.sends;
+    if ( par.key )
+        ++l.counters.keyed_sends;
+
+    ts::uint32 bits;
+    auto notify_list = [&]( gm_receiver_c *f ) -> bool
     {
-        ts::uint32 bits = 0;
-        gm_receiver_c *f = l._gmer_first;
         for (; f;)
         {
             l._curnext = f->_gmer_next;
+            ++l.counters.deliveries;
             bits |= f->event_happens(par);
-            if (FLAG(bits, GMRBIT_ABORT)) 
+            if (FLAG(bits, GMRBIT_ABORT))
             {
                 l._curnext = nullptr;
-                return bits;
+                return false;
             }
             f = l._curnext;
         }
+        return true;
+    };
+
+    for(;ASSERT(par.pass < 100, "100 iterations! vow vow");)
+    {
+        bits = 0;
+        if ( !notify_list( l._gmer_first ) )
+            return bits;
+
+        if ( l.keyed && par.key )
+        {
+            if ( keylst_s *kl = l.keyed->get( par.key ) )
+                if ( !notify_list( kl->_gmer_first ) )
+                    return bits;
+
+        } else if ( l.keyed )
+        {
+            // message without key: receivers of all keys get it; key list may be removed by handler, so keys are copied
+            ts::tmp_tbuf_t< ts::uint64 > keys;
+            for ( auto it = l.keyed->begin(); it; ++it )
+                keys.add( it.key() );
+            for ( ts::uint64 k : keys )
+                if ( keylst_s *kl = l.keyed->get( k ) )
+                    if ( !notify_list( kl->_gmer_first ) )
+                        return bits;
+        }
+
         if (!FLAG(bits, GMRBIT_CALLAGAIN))
         {
             ASSERT( nullptr == l._curnext );
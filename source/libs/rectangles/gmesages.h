@@ -34,6 +34,22 @@ enum gmsg_e
 } UNIQIDLINE( m_##ev ); \
 	ts::uint32 gm_handler( gmsg<ev> &p )
 
+// same as GM_RECEIVER, but receiver can be bound to key by GM_KEY( ev, key ): then it gets only messages with same key or without key
+#define GM_RECEIVER_KEYED( parent, ev ) struct ev##keyedclazz : public gm_receiver_c \
+{ \
+    ev##keyedclazz():gm_receiver_c(ev) {} \
+    ~ ev##keyedclazz() { unsubscribe(ev); } \
+    void key( ts::uint64 k ) { subscribe_key( ev, k ); } \
+    virtual ts::uint32 event_happens( gmsgbase & __param ) override \
+    { \
+        parent *p = (parent *)( ((ts::uint8 *)this) - offsetof( parent, m_keyed_##ev ) ); \
+        return p->gm_handler( (gmsg<ev> &)__param ); \
+    } \
+} m_keyed_##ev; \
+	ts::uint32 gm_handler( gmsg<ev> &p )
+
+#define GM_KEY( ev, k ) m_keyed_##ev.key( k )
+
 
 #define GMRBIT_ABORT     (1<<0)
 #define GMRBIT_ACCEPTED  (1<<1)
@@ -41,7 +57,16 @@ enum gmsg_e
 #define GMRBIT_CALLAGAIN (1<<3)
 #define GMRBIT_REJECTED  (1<<4)
 
-struct gmsgbase { int m; int pass = 0; gmsgbase(int m) :m(m) {} virtual ~gmsgbase() {} ts::flags32_s send(); void send_to_main_thread(); };
+struct gmsgbase
+{
+    int m; int pass = 0;
+    ts::uint64 key = 0; // routing key; 0 - message goes to all receivers, otherwise to not keyed receivers and to receivers with same key only
+    gmsgbase(int m) :m(m) {}
+    gmsgbase(int m, ts::uint64 key) :m(m), key(key) {}
+    virtual ~gmsgbase() {}
+    ts::flags32_s send();
+    void send_to_main_thread();
+};
 template<int mid> struct gmsg : public gmsgbase { gmsg() :gmsgbase(mid) {} };
 template<> struct gmsg<GM_KILLPOPUPMENU_LEVEL> : public gmsgbase
 {
@@ -88,20 +113,34 @@ template<> struct gmsg<GM_DROPFILES> : public gmsgbase
     ts::wstr_c fn;
 };
 
+struct gm_counters_s
+{
+    int sends = 0; // messages sent
+    int keyed_sends = 0; // messages sent with routing key
+    int deliveries = 0; // event_happens calls; deliveries / sends is fan-out
+};
+
 class gm_receiver_c
 {
     gm_receiver_c *_gmer_next;
     gm_receiver_c *_gmer_prev;
+    ts::uint64 _gmer_key = 0;
+
+    void link( int ev );
+    void unlink( int ev );
 
 public:
 
     static ts::uint32 notify_receivers(int ev, gmsgbase &par);
     static void prepare( int ev_max );
     static bool in_progress( int ev );
+    static const gm_counters_s &counters( int ev );
+    static void reset_counters();
 
 
     gm_receiver_c(int ev);
     virtual void unsubscribe(int ev); // must be called by inherit class
+    void subscribe_key( int ev, ts::uint64 key ); // 0 - receive all messages
     virtual ts::uint32 event_happens(gmsgbase & param) = 0;
 
 };
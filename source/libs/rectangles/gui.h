@@ -386,6 +386,9 @@ public:
 
     virtual guirect_c * app_create_shade(const ts::irect &r) { return nullptr; }
 
+    virtual bool app_add_task( ts::task_c * ) { return false; } // false - no executor, caller does the job itself
+    virtual ts::wstr_c app_theme_cache_path( const ts::wsptr & ) { return ts::wstr_c(); } // empty - don't cache rasterized theme
+
     gui_c();
 	~gui_c();
 
@@ -2327,17 +2327,12 @@ void gui_vscrollgroup_c::children_repos()
         if (e == nullptr) { inf.h = 0; continue; }
         const guirect_c &r = e->getrect();
         int h = 0;
-        ts::ivec2 maxsz = r.get_max_size();
+        inf.maxw = 0;
         if ( r.getprops().is_visible() )
-        {
-            h = r.get_height_by_width( info.area.width() - sbwidth );
-            if ( h == 0 )
-                h = ts::CLAMP( height_need, r.get_min_size().y, maxsz.y );
-        }
+            h = child_height( r, info.area.width() - sbwidth, height_need, inf.maxw );
         e->__spec_set_outofbound(true);
 
         inf.h = h;
-        inf.maxw = maxsz.x;
         if (e == scroll_target)
         {
             scroll_target_y = vheight;
@@ -2453,6 +2448,16 @@ void gui_vscrollgroup_c::children_repos()
         scroll_target = nullptr;
 }
 
+/*virtual*/ int gui_vscrollgroup_c::child_height( const guirect_c &r, int width, int height_need, int &maxw ) const
+{
+    ts::ivec2 maxsz = r.get_max_size();
+    maxw = maxsz.x;
+    int h = r.get_height_by_width( width );
+    if ( h == 0 )
+        h = ts::CLAMP( height_need, r.get_min_size().y, maxsz.y );
+    return h;
+}
+
 void gui_vscrollgroup_c::on_add_child(RID id)
 {
     HOLD(id)().leech(this); // no we'll got all queries of child! MU HA HA HA
@@ -1446,6 +1446,7 @@ protected:
 
     /*virtual*/ void children_repos() override;
     /*virtual*/ void on_add_child(RID id) override;
+    virtual int child_height( const guirect_c &r, int width, int height_need, int &maxw ) const; // layout height of visible child
     gui_vscrollgroup_c() {}
 
     void nosb() {flags.clear(F_SBVISIBLE);};
@@ -4,6 +4,23 @@
 #define _alloca alloca
 #endif // _NIX
 
+static ts::uint64 redraw_time_us()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frq = {};
+    if ( 0 == frq.QuadPart )
+        QueryPerformanceFrequency( &frq );
+    LARGE_INTEGER t;
+    QueryPerformanceCounter( &t );
+    return (ts::uint64)t.QuadPart * 1000000 / frq.QuadPart;
+#endif // _WIN32
+#ifdef _NIX
+    timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return (ts::uint64)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+#endif // _NIX
+}
+
 INLINE bool insidelt(int v, int a, int asz)
 {
     return v >= a && v < (a + asz);
@@ -118,6 +135,31 @@ bool rectengine_c::children_sort( fastdelegate::FastDelegate< bool (rectengine_c
     return false;
 }
 
+bool rectengine_c::children_reorder( ts::aint from, rectengine_c * const *order, ts::aint cnt )
+{
+    cleanup_children_now( from );
+    if ( !ASSERT( children.size() - from == cnt ) )
+        return false;
+
+    bool changed = false;
+    for ( ts::aint i = 0; i < cnt; ++i )
+        if ( children.get( from + i ) != order[ i ] )
+        {
+            children.set( from + i, order[ i ] );
+            changed = true;
+        }
+
+    if ( changed )
+    {
+        for ( ts::aint i = 0; i < cnt; ++i )
+            order[ i ]->getrect().need_recalc_screenpos();
+
+        gui->dirty_hover_data();
+        redraw();
+    }
+    return changed;
+}
+
 void rectengine_c::child_move_to( ts::aint index, rectengine_c *e, ts::aint skipctl )
 {
     ts::aint i = children.find(e);
@@ -693,7 +735,7 @@ system_query_e me2sq( ts::mouse_event_e me )
 
 /*virtual*/ ts::irect rectengine_root_c::my_wnd_s::app_get_redraw_rect()
 {
-    return owner()->redraw_rect;
+    return owner()->present_rect;
 }
 
 void rectengine_root_c::my_wnd_s::kill()
@@ -717,7 +759,7 @@ void rectengine_root_c::my_wnd_s::kill()
 
 rectengine_root_c::rectengine_root_c( rect_sys_e sys)
 {
-    redraw_rect = ts::irect( maximum<int>::value, minimum<int>::value );
+    present_rect.make_empty();
     flags.init( F_TOOLRECT, 0 != (sys & RS_TOOL) );
     flags.init( F_TASKBAR, 0 != ( sys & RS_TASKBAR) );
     flags.init( F_INACTIVE, 0 != ( sys & RS_INACTIVE) );
@@ -928,11 +970,46 @@ rectengine_root_c::~rectengine_root_c()
     {
         DMSG("oops F_REDRAW_CHECKER");
     }
-    redraw_rect.combine( invalidate_rect ? *invalidate_rect : getrect().getprops().currentszrect() );
+    dirty.add( invalidate_rect ? *invalidate_rect : getrect().getprops().currentszrect() );
     drawcollector dch( this );
     ++drawtag;
 }
 
+void rectengine_root_c::dirty_rects_s::add( const ts::irect &ir )
+{
+    if ( !ir ) return;
+
+    ts::irect r( ir );
+    for ( ;; )
+    {
+        int m = -1, waste = maximum<int>::value;
+        for ( int i = 0; i < count; ++i )
+        {
+            if ( rects[ i ].intersected( r ) )
+            {
+                m = i; // overlapped rects always merged
+                waste = 0;
+                break;
+            }
+            ts::irect u( rects[ i ] );
+            u.combine( r );
+            int w = u.area() - rects[ i ].area() - r.area();
+            if ( w < waste ) m = i, waste = w;
+        }
+
+        // merge, if union is no more than 1/4 bigger then both rects, or if no free slot
+        if ( m < 0 || ( count < MAX_RECTS && waste * 4 > rects[ m ].area() + r.area() ) )
+        {
+            rects[ count++ ] = r;
+            return;
+        }
+
+        r.combine( rects[ m ] );
+        rects[ m ] = rects[ --count ];
+        // bigger rect can overlap other rects now; so add it again
+    }
+}
+
 void rectengine_root_c::redraw_now()
 {
     if (syswnd.wnd == nullptr || rect() == nullptr) return;
@@ -940,16 +1017,65 @@ void rectengine_root_c::redraw_now()
     //MEMT( MEMT_REDRAW );
 
     ASSERT(drawdata.size() == 0);
-    draw_data_s &dd = begin_draw();
-
-    ASSERT(dd.offset == ts::ivec2(0));
-    dd.size = getrect().getprops().currentsize();
-    dd.cliprect = redraw_rect;
-    redraw_rect = dd.cliprect.intersect( ts::irect(0, dd.size) );
-    evt_data_s d = evt_data_s::draw_s(drawtag);
-    sq_evt(SQ_DRAW, getrid(), d);
-    end_draw();
-    redraw_rect = ts::irect( maximum<int>::value, minimum<int>::value );
+
+    TRACE_SPAN( "redraw" );
+    ts::uint64 t0 = redraw_time_us();
+    ts::ivec2 sz = getrect().getprops().currentsize();
+    ts::irect wr( 0, sz );
+
+    dirty_rects_s regions;
+    ts::irect bound; bound.make_empty();
+    for ( int i = 0; i < dirty.count; ++i )
+    {
+        ts::irect r( dirty.rects[ i ] );
+        r.intersect( wr );
+        if ( !r ) continue;
+        bound.combine( r );
+        regions.add( r );
+    }
+    dirty.count = 0;
+    TRACE_COUNTER( "redraw.regions", regions.count );
+
+    if ( regions.count > 1 && syswnd.wnd->is_layered() )
+    {
+        // layered window presents whole surface anyway
+        regions.count = 1;
+        regions.rects[ 0 ] = bound;
+    }
+
+    int n = ts::tmax( 1, regions.count ); // nothing visible to redraw: single draw pass with empty clip rect, as before
+    if ( 0 == regions.count )
+        regions.rects[ 0 ].make_empty();
+
+    ts::uint64 area = 0;
+    for ( int i = 0; i < n; ++i )
+    {
+        if ( i > 0 ) ++drawtag; // each region is its own draw pass
+
+        draw_data_s &dd = begin_draw();
+
+        ASSERT(dd.offset == ts::ivec2(0));
+        dd.size = sz;
+        dd.cliprect = regions.rects[ i ];
+        present_rect = regions.rects[ i ];
+        if ( present_rect ) area += present_rect.area();
+        evt_data_s d = evt_data_s::draw_s(drawtag);
+        sq_evt(SQ_DRAW, getrid(), d);
+        end_draw();
+    }
+    present_rect.make_empty();
+
+    ++stats.frames;
+    stats.regions += regions.count;
+    stats.area += area;
+    if ( bound ) stats.bound_area += bound.area();
+    stats.window_area += wr.area();
+    stats.draw_us += redraw_time_us() - t0;
+
+#ifndef _FINAL
+    if ( 0 == ( stats.frames % 1000 ) && stats.window_area )
+        DMSG( "redraw stats: frames:" << stats.frames << "regions/frame:" << ( (float)stats.regions / stats.frames ) << "drawn:" << ( stats.area * 100 / stats.window_area ) << "% of window, single rect:" << ( stats.bound_area * 100 / stats.window_area ) << "% of window, us/frame:" << ( stats.draw_us / stats.frames ) );
+#endif // _FINAL
 }
 
 /*virtual*/ draw_data_s & rectengine_root_c::begin_draw()
@@ -137,6 +137,7 @@ public:
     void cleanup_children_now( ts::aint skipctl = 0 );
     void z_resort_children(); // resort children according to zindex
     bool children_sort( SWAP_TESTER swap_them ); // custom order of children
+    bool children_reorder( ts::aint from, rectengine_c * const *order, ts::aint cnt ); // children starting from [from] will be in given order; order must contain all of them
     void child_move_top( rectengine_c *e ) { child_move_to(0, e); }
     void child_move_to( ts::aint index, rectengine_c *e, ts::aint skipctl = 0 );
     
@@ -297,6 +298,16 @@ public:
     }
 };
 
+struct redraw_stats_s
+{
+    ts::uint64 frames = 0; // redraw_now calls
+    ts::uint64 regions = 0; // drawn dirty regions
+    ts::uint64 area = 0; // drawn pixels
+    ts::uint64 bound_area = 0; // pixels of bounding box of dirty regions (single dirty rect redraws them)
+    ts::uint64 window_area = 0; // pixels of whole window
+    ts::uint64 draw_us = 0; // time of draw and present
+};
+
 /*
 Only root engine knows system-specific gui machinery
 */
@@ -345,7 +356,16 @@ class rectengine_root_c : public rectengine_c
     } syswnd;
 
 
-    ts::irect redraw_rect;
+    struct dirty_rects_s
+    {
+        static const int MAX_RECTS = 4;
+        ts::irect rects[ MAX_RECTS ];
+        int count = 0;
+        void add( const ts::irect &r ); // keeps rects disjoint; merges them when merge adds little area or there is no free slot
+    } dirty;
+    ts::irect present_rect; // region drawn now; only it is flushed to screen
+    redraw_stats_s stats;
+
     ts::array_inplace_t<draw_data_s, 4> drawdata;
 
     ts::array_safe_t< guirect_c,1 > afocus;
@@ -406,6 +426,9 @@ public:
 
     int current_drawtag() const {return drawtag;}
 
+    const redraw_stats_s &get_redraw_stats() const { return stats; }
+    void reset_redraw_stats() { stats = redraw_stats_s(); }
+
     /*virtual*/ bool detect_hover(const ts::ivec2 & screenmousepos) const override { return getrect().getprops().is_visible() && syswnd.wnd && syswnd.wnd->is_hover( screenmousepos ); };
 
     /*virtual*/ void redraw(const ts::irect *invalidate_rect = nullptr) override;
@@ -361,8 +361,227 @@ static bool try_load_parent( ts::wstr_c &path, const wstr_c &parent, const wstr_
     return try_load_parent(path, to_wstr(pbp->as_string()), colorsdecl, bpc);
 }
 
+#define THEME_CACHE_VERSION 1
+
+namespace
+{
+    // image decodes and button generations of theme load; they are independent, so base thread and executor helpers take them by index
+    struct theme_load_jobs_s
+    {
+        struct job_s
+        {
+            wstr_c name;
+            blob_c file; // image to decode
+            const abp_c *gen = nullptr; // or generator of image/button
+            abp_c genbp; // own copy of generator: strings of theme bp are shared by merge_parents and their refs are not atomic
+            bool one_face = false;
+            bool taken = false;
+            bitmap_c bmp;
+            generated_button_data_s *g = nullptr;
+
+            ~job_s() { if (g) TSDEL(g); }
+
+            void doit(const colors_map_s &colsmap)
+            {
+                if (gen)
+                    g = generated_button_data_s::generate(&genbp, colsmap, one_face);
+                else if (!bmp.load_from_file(file.data(), file.size()))
+                    bmp.create_ARGB(ts::ivec2(128, 128)).fill(ARGB(255, 0, 255));
+                file.clear();
+            }
+        };
+
+        array_del_t<job_s, 32> jobs;
+        const colors_map_s &colsmap;
+        volatile spinlock::long3264 next = 0; // index of next job to take
+        volatile spinlock::long3264 done = 0;
+        volatile spinlock::long3264 refs = 1; // helper tasks can start after load is finished; they must not see dead jobs
+
+        theme_load_jobs_s(const colors_map_s &colsmap):colsmap(colsmap) {}
+
+        void release()
+        {
+            if (0 == spinlock::decrement(refs))
+                TSDEL(this);
+        }
+
+        bool work() // can be called from any thread
+        {
+            aint i = spinlock::increment(next) - 1;
+            if (i >= jobs.size())
+                return false;
+            jobs.get(i)->doit(colsmap);
+            spinlock::increment(done);
+            return true;
+        }
+
+        void run();
+
+        generated_button_data_s *take(const abp_c *gen, bool one_face)
+        {
+            for (job_s *j : jobs)
+                if (j->gen == gen && !j->taken)
+                {
+                    j->taken = true;
+                    generated_button_data_s *g = j->g;
+                    j->g = nullptr;
+                    return g;
+                }
+            return generated_button_data_s::generate(gen, colsmap, one_face);
+        }
+    };
+
+    struct theme_load_helper_s : public ts::task_c
+    {
+        theme_load_jobs_s *lj;
+        theme_load_helper_s(theme_load_jobs_s *lj):lj(lj) { spinlock::increment(lj->refs); }
+        ~theme_load_helper_s() { lj->release(); }
+
+        /*virtual*/ int iterate(ts::task_executor_c *) override
+        {
+            while (lj->work());
+            return R_DONE;
+        }
+        /*virtual*/ int priority() const override { return PRI_HIGH; }
+    };
+
+    void theme_load_jobs_s::run()
+    {
+        int nhelpers = ts::tmin(g_cpu_cores - 1, (int)jobs.size() - 1);
+        for (int i = 0; i < nhelpers; ++i)
+        {
+            theme_load_helper_s *h = TSNEW(theme_load_helper_s, this);
+            if (!gui->app_add_task(h))
+            {
+                TSDEL(h);
+                break;
+            }
+        }
+
+        while (work());
+        while (done < jobs.size())
+            Sleep(0); // last jobs are in progress on workers
+    }
+}
+
+static void clone_unshared(abp_c &dst, const abp_c &src) // deep copy that doesn't share string cores with src
+{
+    dst.clear();
+    if (!src.value_not_specified())
+        dst.set_value(src.as_string().as_sptr());
+    for (auto it = src.begin(); it; ++it)
+        clone_unshared(dst.add_block(str_c(it.name().as_sptr())), *it);
+}
+
+static void merge_parents(abp_c *block) // items inherit missing values from item named by value
+{
+    for (auto it = block->begin(); it; ++it)
+    {
+        str_c pn = it->as_string();
+        while (!pn.is_empty())
+        {
+            const abp_c *parnt = block->get(pn);
+            pn.clear();
+            if (parnt)
+            {
+                it->merge(*parnt, abp_c::SKIP_EXIST);
+                pn = parnt->as_string();
+            }
+        }
+    }
+}
+
+// cache file: header, then bitmaps with names; generated ones have number of states
+// all bitmaps are 32 bit, stored with corrections applied
+struct theme_cache_header_s
+{
+    int version;
+    uint8 key[16];
+    int count;
+};
+struct theme_cache_item_s
+{
+    int namelen;
+    ts::ivec2 sz;
+    int num_states;
+};
+
+static bool load_theme_cache(const wsptr &fn, const md5_c &key, hashmap_t<wstr_c, bitmap_c> &bitmaps, hashmap_t<wstr_c, int> &gens)
+{
+    blob_c c;
+    if (fn.l == 0 || !c.load_from_disk_file(fn))
+        return false;
+    const uint8 *d = c.data();
+    const uint8 *e = d + c.size();
+
+    if (c.size() < sizeof(theme_cache_header_s))
+        return false;
+    const theme_cache_header_s *h = (const theme_cache_header_s *)d;
+    if (h->version != THEME_CACHE_VERSION || !blk_cmp(h->key, key.result(), 16))
+        return false;
+    d += sizeof(theme_cache_header_s);
+
+    for (int i = 0; i < h->count; ++i)
+    {
+        const theme_cache_item_s *itm = (const theme_cache_item_s *)d;
+        d += sizeof(theme_cache_item_s);
+        if (d > e || itm->namelen < 0 || d + itm->namelen * sizeof(wchar) + itm->sz.x * itm->sz.y * 4 > e)
+        { // broken file
+            bitmaps.clear();
+            gens.clear();
+            return false;
+        }
+
+        wstr_c n(wsptr((const wchar *)d, itm->namelen));
+        d += itm->namelen * sizeof(wchar);
+
+        bitmap_c &b = bitmaps[n];
+        b.create_ARGB(itm->sz);
+        for (int y = 0; y < itm->sz.y; ++y, d += itm->sz.x * 4)
+            memcpy(b.body() + y * b.info().pitch, d, itm->sz.x * 4);
+
+        if (itm->num_states)
+            gens[n] = itm->num_states;
+    }
+    return true;
+}
+
+static void save_theme_cache(const wstr_c &fn, const md5_c &key, hashmap_t<wstr_c, bitmap_c> &bitmaps, const hashmap_t<wstr_c, int> &gens)
+{
+    buf_c c;
+    theme_cache_header_s &h = c.tappend<theme_cache_header_s>(theme_cache_header_s());
+    h.version = THEME_CACHE_VERSION;
+    memcpy(h.key, key.result(), 16);
+    int count = 0;
+
+    for (auto it = bitmaps.begin(); it; ++it)
+    {
+        const bitmap_c &b = it.value();
+        const int *ns = gens.get(it.key());
+        if (!b || b.info().bitpp != 32 || (!ns && it.key().get_last_char() == '?'))
+            continue; // animated generated images are not cached
+
+        theme_cache_item_s itm;
+        itm.namelen = it.key().get_length();
+        itm.sz = b.info().sz;
+        itm.num_states = ns ? *ns : 0;
+        c.tappend<theme_cache_item_s>(itm);
+        c.append_buf(it.key().cstr(), itm.namelen * sizeof(wchar));
+        for (int y = 0; y < itm.sz.y; ++y)
+            c.append_buf(b.body() + y * b.info().pitch, itm.sz.x * 4);
+        ++count;
+    }
+    ((theme_cache_header_s *)c.data())->count = count;
+
+    make_path(fn_get_path(fn), 0);
+    c.save_to_file(fn);
+}
+
 bool theme_c::load( const ts::wsptr &name, FONTPAR fp, bool summon_ch_signal)
 {
+    TRACE_SPAN( "theme.load" );
+    ts::Time loadstart = ts::Time::current();
+
     wstr_c colorsdecl;
     int dd = ts::pwstr_c(name).find_pos('@');
     if ( dd >= 0 )
@@ -440,9 +659,98 @@ bool theme_c::load( const ts::wsptr &name, FONTPAR fp, bool summon_ch_signal)
         }
     }
 
-    ts::tmp_pointers_t<ts::bitmap_c, 16> premultiply;
+    if (abp_c * rs = bp.get("rects"))
+        merge_parents(rs);
+    if (abp_c * btns = bp.get("buttons"))
+        merge_parents(btns);
+
+    // read all image files and schedule decodes and generators; then run them in parallel
+    // or, if theme content is the same as cached, take final bitmaps from cache
+    theme_load_jobs_s *lj = TSNEW(theme_load_jobs_s, colsmap);
+    hashmap_t<wstr_c, int> gens; // generated bitmap name -> number of states
+    hashmap_t<wstr_c> files;
+    md5_c key;
+    int ver = THEME_CACHE_VERSION;
+    key.update(&ver, sizeof(ver));
+    str_c bps = bp.store();
+    key.update(bps.cstr(), bps.get_length());
+
+    auto addfile = [&](const wsptr &fn)
+    {
+        bool added;
+        files.add(fn, added);
+        if (!added || fn.l == 0)
+            return;
+        if (blob_c b = load_image(fn))
+        {
+            key.update(fn.s, fn.l * sizeof(wchar));
+            key.update(b.data(), b.size());
+            theme_load_jobs_s::job_s *j = TSNEW(theme_load_jobs_s::job_s);
+            j->name = fn;
+            j->file = b;
+            lj->jobs.add(j);
+        }
+    };
+    auto addgen = [&](const abp_c *gen, const wstr_c &n, bool one_face)
+    {
+        theme_load_jobs_s::job_s *j = TSNEW(theme_load_jobs_s::job_s);
+        j->name = n;
+        j->gen = gen;
+        clone_unshared(j->genbp, *gen);
+        j->one_face = one_face;
+        lj->jobs.add(j);
+    };
 
     if (const abp_c * corrs = bp.get("corrections"))
+        for (auto it = corrs->begin(); it; ++it)
+            addfile(to_wstr(it.name()));
+    if (const abp_c * rs = bp.get("rects"))
+        for (auto it = rs->begin(); it; ++it)
+            addfile(to_wstr(it->get_string(CONSTASTR("src"))));
+    if (const abp_c * imgs = bp.get("images"))
+        for (auto it = imgs->begin(); it; ++it)
+        {
+            if (const abp_c *gen = it->get(CONSTASTR("gen")))
+                addgen(gen, to_wstr(it.name()).append_char('?'), true);
+            else
+            {
+                str_c src = it->get_string(CONSTASTR("src"));
+                token<char> t(src.as_sptr());
+                addfile(to_wstr(t->as_sptr()));
+            }
+        }
+    if (const abp_c * btns = bp.get("buttons"))
+        for (auto it = btns->begin(); it; ++it)
+        {
+            const abp_c *gen = it->get(CONSTASTR("gen"));
+            if (gen && !gen->as_string().equals(CONSTASTR("disable")))
+                addgen(gen, to_wstr(it.name()).append(CONSTWSTR("?btn?")), false);
+            else
+                addfile(to_wstr(it->get_string(CONSTASTR("src"))));
+        }
+
+    key.done();
+    wstr_c cachefn = gui->app_theme_cache_path(name);
+    bool warm = load_theme_cache(cachefn, key, bitmaps, gens);
+    if (warm)
+    {
+        // everything is in cache, except animated images
+        for (aint i = lj->jobs.size() - 1; i >= 0; --i)
+        {
+            const theme_load_jobs_s::job_s *j = lj->jobs.get(i);
+            if (j->gen ? gens.get(j->name) != nullptr : bitmaps.get(j->name) != nullptr)
+                lj->jobs.remove_fast(i);
+        }
+    }
+    lj->run();
+
+    for (theme_load_jobs_s::job_s *j : lj->jobs)
+        if (!j->gen)
+            bitmaps[j->name] = std::move(j->bmp);
+
+    ts::tmp_pointers_t<ts::bitmap_c, 16> premultiply;
+
+    if (const abp_c * corrs = warm ? nullptr : bp.get("corrections")) // cached bitmaps are already corrected
     {
         for (auto it = corrs->begin(); it; ++it)
         {
@@ -561,17 +869,6 @@ bool theme_c::load( const ts::wsptr &name, FONTPAR fp, bool summon_ch_signal)
 		for (auto it = rs->begin(); it; ++it)
 		{
 			shared_ptr<theme_rect_s> &r = rects[ it.name() ];
-            str_c bn = it->as_string();
-            while (!bn.is_empty())
-            {
-                const abp_c *parnt = rs->get(bn);
-                bn.clear();
-                if (parnt)
-                {
-                    it->merge(*parnt, abp_c::SKIP_EXIST);
-                    bn = parnt->as_string();
-                }
-            }
             const bitmap_c &dbmp = loadimage(to_wstr(it->get_string("src")));
 			r = TSNEW( theme_rect_s, dbmp, thc );
 
@@ -589,12 +886,20 @@ bool theme_c::load( const ts::wsptr &name, FONTPAR fp, bool summon_ch_signal)
             ts::ivec2 svgshift;
             if (ts::abp_c *gen = it->get(CONSTASTR("gen")))
             {
-                if (generated_button_data_s *bgenstuff = generated_button_data_s::generate(gen, colsmap, true))
+                wstr_c gn = to_wstr(it.name()).append_char('?');
+                if (gens.get(gn))
+                {
+                    dbmp = bitmaps.get(gn);
+                    r = irect(ivec2(0), dbmp->info().sz);
+                }
+                else if (generated_button_data_s *bgenstuff = lj->take(gen, true))
                 {
-                    bitmap_c &b = prepareimageplace(to_wstr(it.name()).append_char('?'));
+                    bitmap_c &b = prepareimageplace(gn);
                     b = bgenstuff->src;
                     dbmp = &b;
                     asvg = bgenstuff->get_svg(svgshift);
+                    if (!asvg)
+                        gens[gn] = bgenstuff->num_states;
                     TSDEL(bgenstuff);
                     r = irect(ivec2(0), dbmp->info().sz);
                 }
@@ -638,40 +943,40 @@ bool theme_c::load( const ts::wsptr &name, FONTPAR fp, bool summon_ch_signal)
             shared_ptr<button_desc_s> &bd = buttons[it.name()];
             if (bd) continue;
 
-            str_c par = it->as_string();
-            while (!par.is_empty())
-            {
-                const abp_c *parnt = btns->get(par);
-                par.clear();
-                if (parnt)
-                {
-                    it->merge(*parnt, abp_c::SKIP_EXIST);
-                    par = parnt->as_string();
-                }
-            }
-
             if (ts::abp_c *gen = it->get(CONSTASTR("gen")))
             {
                 if (!gen->as_string().equals(CONSTASTR("disable")))
-                if (generated_button_data_s *bgenstuff = generated_button_data_s::generate(gen, colsmap, false))
                 {
-                    bitmap_c &b = prepareimageplace(to_wstr(it.name()).append(CONSTWSTR("?btn?")));
-                    b = bgenstuff->src;
-                    bd = TSNEW(button_desc_s, b);
-
-                    int h = b.info().sz.y / bgenstuff->num_states;
-                    bd->size.x = b.info().sz.x;
-                    bd->size.y = h;
-                    for (int i = 0; i < bgenstuff->num_states; ++i)
+                    wstr_c gn = to_wstr(it.name()).append(CONSTWSTR("?btn?"));
+                    bitmap_c *b = nullptr;
+                    if (gens.get(gn))
+                        b = bitmaps.get(gn);
+                    else if (generated_button_data_s *bgenstuff = lj->take(gen, false))
                     {
-                        bd->rects[i].lt = ts::ivec2(0, h * i);
-                        bd->rects[i].rb = ts::ivec2(bd->size.x, h * i + h);
+                        b = &prepareimageplace(gn);
+                        *b = bgenstuff->src;
+                        gens[gn] = bgenstuff->num_states;
+                        TSDEL(bgenstuff);
                     }
-                    if (bgenstuff->num_states < button_desc_s::numstates)
-                        bd->rects[button_desc_s::DISABLED] = bd->rects[button_desc_s::NORMAL];
 
-                    bd->load_params(this, it, colsmap, false);
-                    TSDEL( bgenstuff );
+                    if (b)
+                    {
+                        int num_states = gens[gn];
+                        bd = TSNEW(button_desc_s, *b);
+
+                        int h = b->info().sz.y / num_states;
+                        bd->size.x = b->info().sz.x;
+                        bd->size.y = h;
+                        for (int i = 0; i < num_states; ++i)
+                        {
+                            bd->rects[i].lt = ts::ivec2(0, h * i);
+                            bd->rects[i].rb = ts::ivec2(bd->size.x, h * i + h);
+                        }
+                        if (num_states < button_desc_s::numstates)
+                            bd->rects[button_desc_s::DISABLED] = bd->rects[button_desc_s::NORMAL];
+
+                        bd->load_params(this, it, colsmap, false);
+                    }
                 }
             }
 
@@ -695,6 +1000,11 @@ bool theme_c::load( const ts::wsptr &name, FONTPAR fp, bool summon_ch_signal)
         }
     }
 
+    lj->release();
+    if (!warm && !cachefn.is_empty())
+        save_theme_cache(cachefn, key, bitmaps, gens);
+    load_ms[warm ? 1 : 0] = ts::Time::current() - loadstart;
+
 	m_name = name;
     if (iver > 0 && summon_ch_signal) // 1st load (iver == 0) is not change
         gmsg<GM_UI_EVENT>(UE_THEMECHANGED).send();
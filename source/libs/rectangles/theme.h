@@ -288,6 +288,7 @@ class theme_c
 	ts::wstr_c m_name;
     ts::abp_c m_conf;
     int iver = -1;
+    int load_ms[2] = { -1, -1 }; // last load time without and with cache
 
 	const ts::bitmap_c &loadimage( const ts::wsptr &name );
 
@@ -308,6 +309,7 @@ public:
     //void add_image( const ts::asptr & tag, ts::bitmap_c &bmp );
 
     int ver() const {return iver;}
+    int load_time( bool warm ) const { return load_ms[ warm ? 1 : 0 ]; } // ms; -1 if there was no such load
 
     template<typename FF> void font_params( const ts::asptr &fname, const FF &ff ) const
     {
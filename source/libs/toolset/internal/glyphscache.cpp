@@ -16,19 +16,210 @@
 namespace ts
 {
 
+struct glyph_slab_s
+{
+    font_c *font;
+    aint size; // of data
+    aint used;
+    uint last_use;
+    int users; // text_rect_c's that reference glyphs of slab
+    bool retired; // evicted, or font is dead; glyphs are not in font anymore
+
+    uint8 *data() { return (uint8 *)( this + 1 ); }
+    aint memsize() const { return sizeof( glyph_slab_s ) + size; }
+
+    template<typename F> void iterate( F f )
+    {
+        for ( aint offs = 0; offs < used; )
+        {
+            glyph_s *g = (glyph_s *)( data() + offs );
+            f( g );
+            offs += glyph_size( g->width, g->height );
+        }
+    }
+
+    static aint glyph_size( int pixelwidth, int rows )
+    {
+#if LCD_RENDER_MODE
+        aint sz = sizeof( glyph_s ) + pixelwidth * 4 * rows;
+#else
+        aint sz = sizeof( glyph_s ) + pixelwidth * rows;
+#endif
+        return ( sz + 7 ) & ~7;
+    }
+
+    void detach() // remove from font
+    {
+        unlink();
+        font->slabs.find_remove_slow( this );
+        font = nullptr;
+    }
+
+    void unlink()
+    {
+        iterate( [this]( glyph_s *g ) {
+            glyph_s **page = font->pages[ g->code >> 8 ];
+            ASSERT( page && page[ g->code & 255 ] == g );
+            page[ g->code & 255 ] = nullptr;
+        } );
+    }
+
+    void kill()
+    {
+        iterate( []( glyph_s *g ) {
+            if ( g->outlined ) MM_FREE( g->outlined );
+        } );
+        MM_FREE( this );
+    }
+};
+
+namespace
+{
+    static const aint glyph_slab_size = 32 * 1024;
+
+    struct glyphs_cache_s
+    {
+        glyphs_cache_stat_s stat;
+        aint limit = 8 * 1024 * 1024;
+        uint clock = 0;
+        tbuf_t<glyph_slab_s *> alive; // slabs of all fonts
+        tbuf_t<glyph_slab_s *> retired; // evicted, but can be used by text_rect_c
+        glyph_slabs_t *collector = nullptr; // slabs of text_rect_c being parsed
+
+        void use( glyph_slab_s *slab )
+        {
+            slab->last_use = ++clock;
+            if ( collector && collector->last( nullptr ) != slab && !collector->present( slab ) )
+            {
+                collector->add( slab );
+                ++slab->users;
+            }
+        }
+
+        void remove_alive( glyph_slab_s *slab )
+        {
+            alive.find_remove_fast( slab );
+            stat.memory -= slab->memsize();
+        }
+
+        void retire( glyph_slab_s *slab ) // slab is already removed from font
+        {
+            remove_alive( slab );
+            slab->retired = true;
+            retired.add( slab );
+            stat.retired_memory += slab->memsize();
+        }
+
+        void free_retired( bool all ) // not called while text is parsed: parser can hold unreferenced glyphs
+        {
+            for ( aint i = retired.count() - 1; i >= 0; --i )
+            {
+                glyph_slab_s *slab = retired.get( i );
+                if ( all || slab->users == 0 )
+                {
+                    stat.retired_memory -= slab->memsize();
+                    slab->kill();
+                    retired.remove_fast( i );
+                }
+            }
+        }
+
+        bool evict( glyph_slab_s *keep )
+        {
+            // unreferenced slabs first: no text becomes dirty
+            glyph_slab_s *lru = nullptr;
+            for ( glyph_slab_s *slab : alive )
+                if ( slab != keep && ( lru == nullptr || ( slab->users == 0 ) > ( lru->users == 0 ) || ( ( slab->users == 0 ) == ( lru->users == 0 ) && slab->last_use < lru->last_use ) ) )
+                    lru = slab;
+            if ( lru == nullptr )
+                return false;
+
+            lru->iterate( [this]( glyph_s * ) { ++stat.evicted; } );
+            lru->detach();
+
+            // text_rect_c's that reference slab can still use its glyphs; they become dirty
+            retire( lru );
+            return true;
+        }
+
+        ~glyphs_cache_s()
+        {
+            free_retired( true );
+        }
+    };
+}
+
+static glyphs_cache_s &gcache();
+
 font_c::~font_c()
 {
-	for (aint i=0; i<ARRAY_SIZE(glyphs); ++i)
-		if (glyphs[i])
-		{
-			if (glyphs[i]->outlined) MM_FREE(glyphs[i]->outlined);
-			MM_FREE(glyphs[i]);
-		}
+    glyphs_cache_s &gc = gcache();
+    for ( glyph_slab_s *slab : slabs )
+    {
+        if ( slab->users )
+        {
+            slab->font = nullptr;
+            gc.retire( slab );
+            continue;
+        }
+        gc.remove_alive( slab );
+        slab->kill();
+    }
+    for ( aint i = 0; i < ARRAY_SIZE( pages ); ++i )
+        if ( pages[ i ] )
+        {
+            MM_FREE( pages[ i ] );
+            gc.stat.memory -= sizeof( glyph_s * ) * 256;
+        }
+}
+
+glyph_s *font_c::alloc_glyph( aint size )
+{
+    glyphs_cache_s &gc = gcache();
+
+    glyph_slab_s *slab = slabs.count() ? slabs.get( slabs.count() - 1 ) : nullptr;
+    if ( slab == nullptr || slab->size - slab->used < size )
+    {
+        aint dsz = tmax( glyph_slab_size, size );
+        while ( gc.stat.memory + (aint)sizeof( glyph_slab_s ) + dsz > gc.limit && gc.evict( nullptr ) );
+
+        slab = (glyph_slab_s *)MM_ALLOC( sizeof( glyph_slab_s ) + dsz );
+        slab->font = this;
+        slab->size = dsz;
+        slab->used = 0;
+        slab->users = 0;
+        slab->retired = false;
+        slabs.add( slab );
+        gc.alive.add( slab );
+        gc.stat.memory += slab->memsize();
+    }
+
+    glyph_s *g = (glyph_s *)( slab->data() + slab->used );
+    slab->used += size;
+    gc.use( slab );
+    g->slab = slab;
+    return g;
 }
 
 glyph_s &font_c::operator[](wchar c)
 {
-	if (glyphs[c]) return *glyphs[c];
+    glyphs_cache_s &gc = gcache();
+    glyph_s **&page = pages[ c >> 8 ];
+    if ( page )
+    {
+        if ( glyph_s *g = page[ c & 255 ] )
+        {
+            ++gc.stat.hits;
+            gc.use( g->slab );
+            return *g;
+        }
+    } else
+    {
+        page = (glyph_s **)MM_ALLOC( sizeof( glyph_s * ) * 256 );
+        memset( page, 0, sizeof( glyph_s * ) * 256 );
+        gc.stat.memory += sizeof( glyph_s * ) * 256;
+    }
+    ++gc.stat.misses;
 
 	FT_Set_Pixel_Sizes( face, font_params.size.x, font_params.size.y );
 #if LCD_RENDER_MODE
@@ -43,7 +234,6 @@ glyph_s &font_c::operator[](wchar c)
 #if LCD_RENDER_MODE
     ASSERT(b.num_grays == 256 && b.pixel_mode == FT_PIXEL_MODE_LCD);
     int pixelwidth = b.width / 3;
-    int bytewidth = pixelwidth * 4;
 #else
     ASSERT(b.num_grays == 256 && b.pixel_mode == FT_PIXEL_MODE_GRAY);
     ASSERT((unsigned)b.pitch == b.width);//?
@@ -53,27 +243,29 @@ glyph_s &font_c::operator[](wchar c)
     ASSERT(b.pitch >= 0);
     ASSERT(face->glyph->format == FT_GLYPH_FORMAT_BITMAP);
 
-	glyphs[c] = (glyph_s*)MM_ALLOC(sizeof(glyph_s) + bytewidth*b.rows);
+	glyph_s *g = alloc_glyph( glyph_slab_s::glyph_size( pixelwidth, b.rows ) );
+    page[ c & 255 ] = g; // page is still valid: pages are never evicted
 
 	//fill glyph fields
-	glyphs[c]->left	   = face->glyph->bitmap_left;
-	glyphs[c]->top	   = face->glyph->bitmap_top;
-	glyphs[c]->advance = (face->glyph->advance.x + 32) >> 6; // +32 need to round integer number of pixels due glyph->advance is in fixed point 26.6
-	glyphs[c]->width   = pixelwidth;
-	glyphs[c]->height  = b.rows;
-	glyphs[c]->char_index = FT_Get_Char_Index(face, c);
-	glyphs[c]->outlined = nullptr;
+	g->left	   = face->glyph->bitmap_left;
+	g->top	   = face->glyph->bitmap_top;
+	g->advance = (face->glyph->advance.x + 32) >> 6; // +32 need to round integer number of pixels due glyph->advance is in fixed point 26.6
+	g->width   = pixelwidth;
+	g->height  = b.rows;
+	g->char_index = FT_Get_Char_Index(face, c);
+	g->outlined = nullptr;
+    g->code = c;
 
 #if LCD_RENDER_MODE
     const uint8 *src = (const uint8*)b.buffer;
-    uint8 *dst = (uint8*)(glyphs[c] + 1);
+    uint8 *dst = (uint8*)(g + 1);
     img_helper_copy(dst, src, imgdesc_s(ts::ivec2(pixelwidth, static_cast<int>(b.rows)), 32), imgdesc_s(ts::ivec2(pixelwidth, static_cast<int>(b.rows)), 24, static_cast<int16>(b.pitch)));
 #else
-    char *dst = (char*)(glyphs[c] + 1);
+    char *dst = (char*)(g + 1);
     memcpy( dst, b.buffer, bytewidth*b.rows );
 #endif
 
-	return *glyphs[c];
+	return *g;
 }
 
 inline unsigned calc_hash(const font_params_s& fp)
@@ -173,6 +365,7 @@ namespace
 	    wstrings_c fonts_dirs;
 	    wstrings_c images_dirs;
 	    int font_cache_sig;
+        glyphs_cache_s glyphs_cache;
 	    internal_data_s() :font_cache_sig(0)
         {
             //FreeType
@@ -196,6 +389,57 @@ namespace
 
 static_setup<internal_data_s> idata;
 
+static glyphs_cache_s &gcache()
+{
+    return idata().glyphs_cache;
+}
+
+void set_glyphs_cache_limit( aint bytes )
+{
+    glyphs_cache_s &gc = gcache();
+    gc.limit = bytes;
+    while ( gc.stat.memory > gc.limit && gc.evict( nullptr ) );
+    if ( !gc.collector )
+        gc.free_retired( false );
+}
+
+const glyphs_cache_stat_s &get_glyphs_cache_stat()
+{
+    return gcache().stat;
+}
+
+glyph_slabs_t *glyphs_cache_collect( glyph_slabs_t *slabs )
+{
+    glyphs_cache_s &gc = gcache();
+    glyph_slabs_t *prev = gc.collector;
+    gc.collector = slabs;
+    if ( !slabs && gc.retired.count() )
+        gc.free_retired( false );
+    return prev;
+}
+
+void glyphs_cache_release( glyph_slabs_t &slabs )
+{
+    if ( slabs.count() == 0 )
+        return;
+
+    glyphs_cache_s &gc = gcache();
+    for ( glyph_slab_s *slab : slabs )
+        --slab->users;
+    slabs.clear();
+
+    if ( !gc.collector && gc.retired.count() )
+        gc.free_retired( false );
+}
+
+bool glyphs_cache_evicted( const glyph_slabs_t &slabs )
+{
+    for ( const glyph_slab_s *slab : slabs )
+        if ( slab->retired )
+            return true;
+    return false;
+}
+
 void set_fonts_dir(const wsptr &dir, bool add)
 {
     if (!add)
@@ -350,7 +594,6 @@ font_c &font_c::buildfont(const str_c &fontname, const font_params_s&fprs)
 		f.underline_add_y  = ts::lround(design_to_device_K * f.face->underline_position);
 		f.uline_thickness = float(design_to_device_K * f.face->underline_thickness);
 
-		memset(f.glyphs, 0, sizeof(f.glyphs));
 	}
 
 	return f;
@@ -495,6 +738,8 @@ void clear_glyphs_cache()
 	for (auto it = idata().font_faces_cache.begin(); it; ++it)
 		it->fonts_cache.clear();
 
+    if ( !idata().glyphs_cache.collector )
+        idata().glyphs_cache.free_retired( false ); // slabs of dead fonts are kept while text_rect_c's reference them
 	idata().scaled_images_cache.clear(); // also clear images cache
 	idata().font_cache_sig++; // increment sig to invalidate all exist font_desc_c (avoid access to broken pointer to font)
 }
@@ -16,6 +16,8 @@ template <class T> T ui_scale(const T &v) // global scale. not used
 	return v; //T((v * global_scale + sign(v) * 50) / 100);
 }
 
+struct glyph_slab_s;
+
 struct glyph_s
 {
 	int advance,    // width of symbol in pixels
@@ -25,6 +27,8 @@ struct glyph_s
 		height,	    // glyph image height
 		char_index; // symbol index by FT_Get_Char_Index
 	uint8 *outlined;
+    glyph_slab_s *slab; // glyphs cache page of glyph; nullptr for glyphs not from cache
+    wchar code;
 	void get_outlined_glyph(struct glyph_image_s &gi, class font_c *font, const ivec2 &pos, TSCOLOR outlineColor);
 	// next bytes is glyph image with width*height size
 };
@@ -81,9 +85,13 @@ struct font_params_s //-V690
 
 class font_c // "parametrized" font
 {
+    friend struct glyph_slab_s;
+
     str_c fontname; // default or default.bold ... etc
 	FT_Face face;
-	glyph_s *glyphs[0xFFFF]; // cache itself
+	glyph_s **pages[256] = {}; // cache itself: two-level table by codepoint, pages of 256 glyphs allocated on demand
+    tbuf_t<glyph_slab_s *> slabs; // glyphs storage; last one is current
+    glyph_s *alloc_glyph( aint size );
 
 public:
 	font_params_s font_params;
@@ -135,6 +143,24 @@ void add_image(const wsptr&name, const uint8* data, const imgdesc_s &imgdesc, bo
 bmpcore_exbody_s get_image(const wsptr&name);
 void clear_glyphs_cache();
 
+// glyphs cache is limited by size, least recently used slabs of glyphs are evicted (unreferenced slabs first)
+// text_rect_c references slabs of glyphs it was parsed with; memory of evicted slab is kept until last reference released,
+// and only text_rect_c's that reference evicted slab become dirty
+struct glyphs_cache_stat_s
+{
+    uint64 hits = 0;
+    uint64 misses = 0;
+    uint64 evicted = 0; // glyphs
+    aint memory = 0; // bytes of alive slabs and page tables
+    aint retired_memory = 0; // bytes of evicted slabs still in use
+};
+void set_glyphs_cache_limit( aint bytes );
+const glyphs_cache_stat_s &get_glyphs_cache_stat();
+typedef tbuf_t<glyph_slab_s *> glyph_slabs_t;
+glyph_slabs_t *glyphs_cache_collect( glyph_slabs_t *slabs ); // slabs of glyphs taken from fonts are referenced and added to list (nullptr - stop); returns previous list
+void glyphs_cache_release( glyph_slabs_t &slabs ); // unreference slabs and clear list
+bool glyphs_cache_evicted( const glyph_slabs_t &slabs ); // some of slabs were evicted, so glyphs must be parsed again
+
 blob_c load_image( const wsptr&fn ); // try load image from one of image-paths
 
 } // namespace ts
@@ -1729,7 +1729,7 @@ Cleanup: /* CLEANUP */
         int filter_mode;
         //COLORREF	rgbColor;
 
-        VDPixmapResampler resampler;
+        VDPixmapResampler *resampler = nullptr;
 
         const uint8* src;
         imgdesc_s srcinfo;
@@ -1746,6 +1746,11 @@ Cleanup: /* CLEANUP */
         VDResizeFilterData(const uint8 *source, const imgdesc_s &souinfo, const bmpcore_exbody_s& dst) : src(source), srcinfo(souinfo), bdst(dst)
         {
         }
+        ~VDResizeFilterData()
+        {
+            if (resampler)
+                TSDEL(resampler);
+        }
 
     private:
         VDResizeFilterData(const VDResizeFilterData &) UNUSED;
@@ -1782,6 +1787,73 @@ Cleanup: /* CLEANUP */
         return pxm;
     }
 
+    // Init of table filters (lanczos, bicubic) builds coefficient tables for every output row and column.
+    // Video frames are resized with same source and target sizes again and again, so initialized resamplers are kept here.
+    // Resampler is taken from cache exclusively and returned back after use, so the same cache is safe for any thread.
+    static struct resampler_cache_s
+    {
+        struct entry_s
+        {
+            VDPixmapResampler *resampler = nullptr;
+            ivec2 sousz = ivec2(0);
+            ivec2 dstsz = ivec2(0);
+            int filter_mode = 0;
+            uint used = 0;
+        };
+
+        spinlock::long3264 sync = 0;
+        entry_s entries[ 8 ];
+        uint tick = 0;
+
+        ~resampler_cache_s()
+        {
+            for (entry_s &e : entries)
+                if (e.resampler)
+                    TSDEL(e.resampler);
+        }
+
+        VDPixmapResampler *take(const ivec2 &sousz, const ivec2 &dstsz, int filter_mode)
+        {
+            SIMPLELOCK(sync);
+            for (entry_s &e : entries)
+                if (e.resampler && e.filter_mode == filter_mode && e.sousz == sousz && e.dstsz == dstsz)
+                {
+                    VDPixmapResampler *r = e.resampler;
+                    e.resampler = nullptr;
+                    return r;
+                }
+            return nullptr;
+        }
+
+        void put(VDPixmapResampler *r, const ivec2 &sousz, const ivec2 &dstsz, int filter_mode)
+        {
+            VDPixmapResampler *evicted = nullptr;
+            {
+                SIMPLELOCK(sync);
+                entry_s *slot = entries;
+                for (entry_s &e : entries)
+                {
+                    if (!e.resampler)
+                    {
+                        slot = &e;
+                        break;
+                    }
+                    if (e.used < slot->used)
+                        slot = &e; // least recently used
+                }
+                evicted = slot->resampler;
+                slot->resampler = r;
+                slot->sousz = sousz;
+                slot->dstsz = dstsz;
+                slot->filter_mode = filter_mode;
+                slot->used = ++tick;
+            }
+            if (evicted)
+                TSDEL(evicted);
+        }
+
+    } resamplers;
+
     static int resize_run(VDResizeFilterData *mfd) 
     {
         VDPixmap pxdst(VDAsPixmap(mfd->bdst(), mfd->bdst.info()));
@@ -1793,7 +1865,7 @@ Cleanup: /* CLEANUP */
         double dx = (mfd->dst_w - dstw) * 0.5;
         double dy = (mfd->dst_h - dsth) * 0.5;
 
-        mfd->resampler.Process(pxdst, dx, dy, dx + mfd->new_x, dy + mfd->new_y, pxsrc, 0, 0);
+        mfd->resampler->Process(pxdst, dx, dy, dx + mfd->new_x, dy + mfd->new_y, pxsrc, 0, 0);
 
         return 0;
     }
@@ -1806,6 +1878,12 @@ Cleanup: /* CLEANUP */
         if (dstw<1 || dsth<1)
             return 1;
 
+        mfd->resampler = resamplers.take(mfd->srcinfo.sz, ivec2((int)dstw, (int)dsth), mfd->filter_mode);
+        if (mfd->resampler)
+            return 0; // filter tables already built
+
+        mfd->resampler = TSNEW(VDPixmapResampler);
+
         IVDPixmapResampler::FilterMode fmode = IVDPixmapResampler::kFilterPoint;
         bool bInterpolationOnly = true;
 
@@ -1821,19 +1899,19 @@ Cleanup: /* CLEANUP */
         fmode = IVDPixmapResampler::kFilterLinear;
         break;
     case FILTER_TABLEBICUBIC060:
-        mfd->resampler.SetSplineFactor(-0.60);
+        mfd->resampler->SetSplineFactor(-0.60);
         fmode = IVDPixmapResampler::kFilterCubic;
         bInterpolationOnly = false;
         break;
     case FILTER_TABLEBICUBIC075:
         bInterpolationOnly = false;
     case FILTER_BICUBIC:
-        mfd->resampler.SetSplineFactor(-0.75);
+        mfd->resampler->SetSplineFactor(-0.75);
         fmode = IVDPixmapResampler::kFilterCubic;
         break;
     case FILTER_TABLEBICUBIC100:
         bInterpolationOnly = false;
-        mfd->resampler.SetSplineFactor(-1.0);
+        mfd->resampler->SetSplineFactor(-1.0);
         fmode = IVDPixmapResampler::kFilterCubic;
         break;
     case FILTER_LANCZOS3:
@@ -1842,14 +1920,16 @@ Cleanup: /* CLEANUP */
         break;
         }
 
-        mfd->resampler.Init(dstw, dsth, nsVDPixmap::kPixFormat_XRGB8888, mfd->srcinfo.sz.x, mfd->srcinfo.sz.y, nsVDPixmap::kPixFormat_XRGB8888, fmode, fmode, bInterpolationOnly);
+        if (!mfd->resampler->Init(dstw, dsth, nsVDPixmap::kPixFormat_XRGB8888, mfd->srcinfo.sz.x, mfd->srcinfo.sz.y, nsVDPixmap::kPixFormat_XRGB8888, fmode, fmode, bInterpolationOnly))
+            return 1;
 
         return 0;
     }
 
     static int resize_stop(VDResizeFilterData *mfd) 
     {
-        //delete mfd->resampler;	mfd->resampler = nullptr;
+        resamplers.put(mfd->resampler, mfd->srcinfo.sz, ivec2((int)mfd->new_x, (int)mfd->new_y), mfd->filter_mode);
+        mfd->resampler = nullptr;
 
         return 0;
     }
@@ -226,6 +226,9 @@ struct text_parser_s
             g->width = w;
             g->height = h;
             g->char_index = -1;
+            g->outlined = nullptr;
+            g->slab = nullptr;
+            g->code = 0;
 
             uint8 *pixels = (uint8 *)(g + 1);
             for (; npix > 0; --npix, ++pixels)
@@ -116,6 +116,107 @@ void TSCALL img_helper_yuv2rgb(uint8 *des, const imgdesc_s &des_info, const uint
     }
 }
 
+static INLINE TSCOLOR yuv_pixel( int Y, int U, int V )
+{
+    int32 Y0 = (uint32)(Y * 0x0101 * YG) >> 16;
+
+    int prer = BR - (V * VR);
+    int preg = BG - (V * VG + U * UG);
+    int preb = BB - (U * UB);
+
+    return ts::ARGB<int>((prer + Y0) >> 6, (preg + Y0) >> 6, (preb + Y0) >> 6);
+}
+
+void TSCALL img_helper_i420_to_ARGB_scaled(uint8 *des, const imgdesc_s &des_info, const uint8* src_y, int src_stride_y, const uint8* src_u, int src_stride_u, const uint8* src_v, int src_stride_v, const ivec2 &src_sz)
+{
+    if (des_info.sz == src_sz)
+    {
+        img_helper_i420_to_ARGB(src_y, src_stride_y, src_u, src_stride_u, src_v, src_stride_v, des, des_info.pitch, src_sz.x, src_sz.y);
+        return;
+    }
+
+    if (des_info.sz.x <= 0 || des_info.sz.y <= 0 || src_sz.x <= 0 || src_sz.y <= 0)
+        return;
+
+    // 16.16 fixed point source step per destination pixel
+    int stepx = (src_sz.x << 16) / des_info.sz.x;
+    int stepy = (src_sz.y << 16) / des_info.sz.y;
+    int cw = (src_sz.x + 1) / 2;
+    int ch = (src_sz.y + 1) / 2;
+
+    if (stepx >= 0x20000 || stepy >= 0x20000)
+    {
+        // downscale 2x and more: box average of luma footprint; chroma of footprint center
+        int bw = tmax(1, stepx >> 16);
+        int bh = tmax(1, stepy >> 16);
+
+        for (int y = 0; y < des_info.sz.y; ++y, des += des_info.pitch)
+        {
+            int sy = (y * stepy) >> 16;
+            int ny = tmin(bh, src_sz.y - sy);
+            int cy = tmin((y * stepy + stepy / 2) >> 17, ch - 1);
+            const uint8 *yrow = src_y + sy * src_stride_y;
+            const uint8 *urow = src_u + cy * src_stride_u;
+            const uint8 *vrow = src_v + cy * src_stride_v;
+
+            TSCOLOR *dst = (TSCOLOR *)des;
+            for (int x = 0; x < des_info.sz.x; ++x)
+            {
+                int sx = (x * stepx) >> 16;
+                int nx = tmin(bw, src_sz.x - sx);
+
+                int sum = 0;
+                const uint8 *yy = yrow + sx;
+                for (int j = 0; j < ny; ++j, yy += src_stride_y)
+                    for (int i = 0; i < nx; ++i)
+                        sum += yy[i];
+
+                int cx = tmin((x * stepx + stepx / 2) >> 17, cw - 1);
+                dst[x] = yuv_pixel(sum / (nx * ny), urow[cx], vrow[cx]);
+            }
+        }
+        return;
+    }
+
+    // bilinear luma and chroma
+    auto pos = []( int i, int step, int maxi, int &i0, int &i1, int &w )
+    {
+        int f = i * step + step / 2 - 0x8000;
+        if (f < 0) f = 0;
+        i0 = f >> 16;
+        w = (f >> 8) & 255;
+        if (i0 >= maxi) i0 = maxi, w = 0;
+        i1 = tmin(i0 + 1, maxi);
+    };
+    auto blend = []( const uint8 *r0, const uint8 *r1, int x0, int x1, int wx, int wy ) -> int
+    {
+        int a = r0[x0] * (256 - wx) + r0[x1] * wx;
+        int b = r1[x0] * (256 - wx) + r1[x1] * wx;
+        return (a * (256 - wy) + b * wy) >> 16;
+    };
+
+    for (int y = 0; y < des_info.sz.y; ++y, des += des_info.pitch)
+    {
+        int y0, y1, wy, cy0, cy1, cwy;
+        pos(y, stepy, src_sz.y - 1, y0, y1, wy);
+        pos(y, stepy / 2, ch - 1, cy0, cy1, cwy);
+
+        const uint8 *yr0 = src_y + y0 * src_stride_y, *yr1 = src_y + y1 * src_stride_y;
+        const uint8 *ur0 = src_u + cy0 * src_stride_u, *ur1 = src_u + cy1 * src_stride_u;
+        const uint8 *vr0 = src_v + cy0 * src_stride_v, *vr1 = src_v + cy1 * src_stride_v;
+
+        TSCOLOR *dst = (TSCOLOR *)des;
+        for (int x = 0; x < des_info.sz.x; ++x)
+        {
+            int x0, x1, wx, cx0, cx1, cwx;
+            pos(x, stepx, src_sz.x - 1, x0, x1, wx);
+            pos(x, stepx / 2, cw - 1, cx0, cx1, cwx);
+
+            dst[x] = yuv_pixel(blend(yr0, yr1, x0, x1, wx, wy), blend(ur0, ur1, cx0, cx1, cwx, cwy), blend(vr0, vr1, cx0, cx1, cwx, cwy));
+        }
+    }
+}
+
 void TSCALL img_helper_mulcolor(uint8 *des, const imgdesc_s &des_info, TSCOLOR color)
 {
     int desnl = des_info.pitch - des_info.sz.x * 4;
@@ -599,6 +700,24 @@ void TSCALL img_helper_shrink_2x(uint8 *des, const uint8 *sou, const imgdesc_s &
 
 
 
+}
+
+bool TSCALL img_helper_same( const uint8 *sou1, int pitch1, const uint8 *sou2, int pitch2, const ivec2 &sz )
+{
+    aint bytes = sz.x * 4;
+    aint bytes16 = CCAPS( CPU_SSE2 ) ? ( bytes & ~15 ) : 0;
+    for ( int y = 0; y < sz.y; ++y, sou1 += pitch1, sou2 += pitch2 )
+    {
+        for ( aint x = 0; x < bytes16; x += 16 )
+        {
+            __m128i eq = _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)( sou1 + x ) ), _mm_loadu_si128( (const __m128i *)( sou2 + x ) ) );
+            if ( _mm_movemask_epi8( eq ) != 0xffff )
+                return false;
+        }
+        if ( bytes16 < bytes && 0 != memcmp( sou1 + bytes16, sou2 + bytes16, bytes - bytes16 ) )
+            return false;
+    }
+    return true;
 }
 
 void TSCALL img_helper_copy_components(uint8* des, const uint8* sou, const imgdesc_s &des_info, const imgdesc_s &sou_info, int num_comps)
@@ -259,9 +259,11 @@ void TSCALL img_helper_yuv2rgb(uint8 *des, const imgdesc_s &des_info, const uint
 void TSCALL img_helper_rgb2yuv(uint8 *dst, const imgdesc_s &src_info, const uint8 *sou, yuv_fmt_e yuvfmt);
 void TSCALL img_helper_alpha_blend_pm( uint8 *dst, int dst_pitch, const uint8 *sou, const imgdesc_s &src_info, uint8 alpha, bool guaranteed_premultiplied = true ); // only 32 bpp target and source
 bool TSCALL img_helper_resize( const bmpcore_exbody_s &extbody, const uint8 *sou, const imgdesc_s &souinfo, resize_filter_e filt_mode );
+bool TSCALL img_helper_same( const uint8 *sou1, int pitch1, const uint8 *sou2, int pitch2, const ivec2 &sz ); // only 32 bpp; true if all pixels of both blocks are equal
 
 // see convert.cpp
 void TSCALL img_helper_i420_to_ARGB(const uint8* src_y, int src_stride_y, const uint8* src_u, int src_stride_u, const uint8* src_v, int src_stride_v, uint8* dst_argb, int dst_stride_argb, int width, int height);
+void TSCALL img_helper_i420_to_ARGB_scaled(uint8 *des, const imgdesc_s &des_info, const uint8* src_y, int src_stride_y, const uint8* src_u, int src_stride_u, const uint8* src_v, int src_stride_v, const ivec2 &src_sz); // convert and resize to des_info.sz at once (bilinear or box)
 void TSCALL img_helper_ARGB_to_i420(const uint8* src_argb, int src_stride_argb, uint8* dst_y, int dst_stride_y, uint8* dst_u, int dst_stride_u, uint8* dst_v, int dst_stride_v, int width, int height);
 
 struct bmpcore_normal_s;
@@ -313,32 +313,210 @@ void dmsg(const char *str)
 }
 #endif
 
-#ifdef _DEBUG
-delta_time_profiler_s::delta_time_profiler_s(int n) :n(n)
+// tracing
+
+bool g_trace_on = false;
+
+namespace
+{
+    enum
+    {
+        TRACE_RING_EVENTS = 8192, // power of 2; 256k per traced thread
+    };
+
+    struct trace_event_s
+    {
+        const char *name;
+        uint64 ticks;
+        uint64 v; // duration (ticks) of span or value of counter
+        uint32 tid;
+        char ph;
+    };
+
+    struct trace_ring_s
+    {
+        trace_ring_s *next;
+        const char *tname;
+        uint32 tid;
+        volatile spinlock::long3264 owned;
+        volatile uint32 head; // events written since ring creation; only owner thread writes
+        trace_event_s ev[ TRACE_RING_EVENTS ];
+    };
+
+    // rings are never freed: dump can be requested at any time
+    trace_ring_s * volatile trace_rings = nullptr;
+    THREADLOCAL trace_ring_s *tls_trace_ring = nullptr;
+    THREADLOCAL const char *tls_trace_name = nullptr;
+
+#ifdef _MSC_VER
+#define TRACE_BARRIER() _ReadWriteBarrier()
+#else
+#define TRACE_BARRIER() __sync_synchronize()
+#endif
+
+    trace_ring_s *trace_ring()
+    {
+        if ( trace_ring_s *r = tls_trace_ring )
+            return r;
+
+        trace_ring_s *r = trace_rings;
+        for ( ; r; r = r->next )
+            if ( 0 == r->owned && 0 == SLxInterlockedCompareExchange( &r->owned, 1, 0 ) )
+                break;
+
+        if ( !r )
+        {
+            r = (trace_ring_s *)MM_ALLOC( sizeof( trace_ring_s ) );
+            memset( r, 0, sizeof( trace_ring_s ) );
+            r->owned = 1;
+            for ( ;; )
+            {
+                trace_ring_s *first = trace_rings;
+                r->next = first;
+                if ( (spinlock::long3264)first == SLxInterlockedCompareExchange( (volatile spinlock::long3264 *)&trace_rings, (spinlock::long3264)r, (spinlock::long3264)first ) )
+                    break;
+            }
+        }
+
+        r->tid = spinlock::pthread_self();
+        r->tname = tls_trace_name;
+        tls_trace_ring = r;
+        return r;
+    }
+
+    uint64 trace_freq()
+    {
+#ifdef _WIN32
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency( &f );
+        return f.QuadPart;
+#endif // _WIN32
+#ifdef _NIX
+        return 1000000000ull;
+#endif // _NIX
+    }
+
+    void trace_us( str_c &out, uint64 ticks, uint64 freq )
+    {
+        out.append_as_num<uint64>( ticks / freq * 1000000 + ( ticks % freq ) * 1000000 / freq );
+    }
+
+    void trace_head( str_c &out, const char *name, const char *ph, uint32 pid, uint32 tid )
+    {
+        if ( !out.is_empty() )
+            out.append( CONSTASTR( ",\n" ) );
+        out.append( CONSTASTR( "{\"name\":\"" ) ).append( asptr( name ) ).append( CONSTASTR( "\",\"ph\":\"" ) ).append( asptr( ph ) );
+        out.append( CONSTASTR( "\",\"pid\":" ) ).append_as_uint( pid ).append( CONSTASTR( ",\"tid\":" ) ).append_as_uint( tid );
+    }
+}
+
+void TSCALL trace_enable( bool on )
 {
-    entries = (entry_s *)MM_ALLOC( n*sizeof(entry_s) );
-    LARGE_INTEGER freq;
-    QueryPerformanceFrequency(&freq);
-    notfreq = 1000.0 / (double)freq.QuadPart;
-    QueryPerformanceCounter( ( LARGE_INTEGER * ) &prev);
+    g_trace_on = on;
 }
-delta_time_profiler_s::~delta_time_profiler_s()
+
+void TSCALL trace_thread_name( const char *name )
 {
-    MM_FREE(entries);
+    tls_trace_name = name;
+    if ( tls_trace_ring )
+        tls_trace_ring->tname = name;
 }
-void delta_time_profiler_s::operator()(int id)
+
+void TSCALL trace_thread_end()
 {
-    entries[index].id = id;
+    if ( trace_ring_s *r = tls_trace_ring )
+    {
+        tls_trace_ring = nullptr;
+        r->tname = nullptr;
+        r->owned = 0;
+    }
+    tls_trace_name = nullptr;
+}
 
-    LARGE_INTEGER cur;
-    QueryPerformanceCounter(&cur);
-    entries[index].deltams = (float)((double)(cur.QuadPart - prev) * notfreq);
-    prev = (uint64 &)cur;
-    ++index;
-    if (index >= n)
-        index = 0;
+uint64 TSCALL trace_ticks()
+{
+#ifdef _WIN32
+    LARGE_INTEGER t;
+    QueryPerformanceCounter( &t );
+    return t.QuadPart;
+#endif // _WIN32
+#ifdef _NIX
+    timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return (uint64)t.tv_sec * 1000000000ull + t.tv_nsec;
+#endif // _NIX
+}
 
+void TSCALL trace_put( const char *name, char ph, uint64 ticks, uint64 v )
+{
+    trace_ring_s *r = trace_ring();
+    uint32 h = r->head;
+    trace_event_s &e = r->ev[ h & ( TRACE_RING_EVENTS - 1 ) ];
+    e.name = name;
+    e.ticks = ticks;
+    e.v = v;
+    e.tid = r->tid;
+    e.ph = ph;
+    TRACE_BARRIER();
+    r->head = h + 1;
+}
+
+void TSCALL trace_json( str_c &out, const asptr &process_name )
+{
+    uint64 freq = trace_freq();
+#ifdef _WIN32
+    uint32 pid = GetCurrentProcessId();
+#endif // _WIN32
+#ifdef _NIX
+    uint32 pid = getpid();
+#endif // _NIX
+
+    if ( process_name.l )
+    {
+        trace_head( out, "process_name", "M", pid, 0 );
+        out.append( CONSTASTR( ",\"args\":{\"name\":\"" ) ).append( process_name ).append( CONSTASTR( "\"}}" ) );
+    }
+
+    tmp_tbuf_t<trace_event_s> snap;
+    for ( trace_ring_s *r = trace_rings; r; r = r->next )
+    {
+        if ( r->tname )
+        {
+            trace_head( out, "thread_name", "M", pid, r->tid );
+            out.append( CONSTASTR( ",\"args\":{\"name\":\"" ) ).append( asptr( r->tname ) ).append( CONSTASTR( "\"}}" ) );
+        }
+
+        // copy, then drop events overwritten by owner while copying
+        uint32 h = r->head;
+        TRACE_BARRIER();
+        uint32 n = tmin<uint32>( h, TRACE_RING_EVENTS );
+        snap.set_count( n, false );
+        for ( uint32 i = 0; i < n; ++i )
+            snap.begin()[ i ] = r->ev[ ( h - n + i ) & ( TRACE_RING_EVENTS - 1 ) ];
+        TRACE_BARRIER();
+        uint32 lost = r->head - h;
+        if ( lost > TRACE_RING_EVENTS - n )
+            lost -= TRACE_RING_EVENTS - n;
+        else
+            lost = 0;
+
+        for ( uint32 i = tmin( lost, n ); i < n; ++i )
+        {
+            const trace_event_s &e = snap.begin()[ i ];
+            if ( 'X' == e.ph )
+            {
+                trace_head( out, e.name, "X", pid, e.tid );
+                out.append( CONSTASTR( ",\"ts\":" ) ); trace_us( out, e.ticks, freq );
+                out.append( CONSTASTR( ",\"dur\":" ) ); trace_us( out, e.v, freq );
+                out.append_char( '}' );
+            } else
+            {
+                trace_head( out, e.name, "C", pid, e.tid );
+                out.append( CONSTASTR( ",\"ts\":" ) ); trace_us( out, e.ticks, freq );
+                out.append( CONSTASTR( ",\"args\":{\"value\":" ) ).append_as_num<uint64>( e.v ).append( CONSTASTR( "}}" ) );
+            }
+        }
+    }
 }
-#endif
 
 } // namespace ts
@@ -110,33 +110,32 @@ void TSCALL dmsg(const char *str);
 #else
 INLINE void TSCALL dmsg(const char *str) {}
 #define DMSG(expr, ...) (1,true)
+#endif
+}
+
 #endif
 
-#ifdef _DEBUG
-struct delta_time_profiler_s
+namespace ts
 {
-    double notfreq;
-    uint64 prev;
-    struct entry_s
+    // tracing works in all builds. spans and counters are written to per-thread rings without locks.
+    // when tracing is off, only g_trace_on is checked. names must be string literals: only pointers are stored
+    extern bool g_trace_on;
+
+    void TSCALL trace_enable( bool on );
+    void TSCALL trace_thread_name( const char *name ); // call at thread start
+    void TSCALL trace_thread_end(); // ring of finished thread is reused by next new thread
+    uint64 TSCALL trace_ticks();
+    void TSCALL trace_put( const char *name, char ph, uint64 ticks, uint64 v );
+    void TSCALL trace_json( str_c &out, const asptr &process_name ); // chrome trace events, comma separated, without [ ]; no process_name event, if name is empty
+
+    struct trace_span_s
     {
-        int id;
-        float deltams;
+        const char *name;
+        uint64 t0;
+        trace_span_s( const char *name ) :name( name ), t0( g_trace_on ? trace_ticks() : 0 ) {}
+        ~trace_span_s() { if ( t0 ) trace_put( name, 'X', t0, trace_ticks() - t0 ); }
     };
-    entry_s *entries = nullptr;
-    int index = 0;
-    int n = 0;
-    delta_time_profiler_s(int n);
-    ~delta_time_profiler_s();
-    void operator()(int id);
-};
-
-#define DELTA_TIME_PROFILER(name, n) ts::delta_time_profiler_s name(n)
-#define DELTA_TIME_CHECKPOINT(name) name(__LINE__)
-#else
-#define DELTA_TIME_PROFILER(n, nn) 
-#define DELTA_TIME_CHECKPOINT(n) 
-#endif
-
 }
 
-#endif
\ No newline at end of file
+#define TRACE_SPAN(name) ts::trace_span_s UNIQIDLINE(__trace_span)(name)
+#define TRACE_COUNTER(name, v) ( ts::g_trace_on ? ts::trace_put( name, 'C', ts::trace_ticks(), static_cast<ts::uint64>(v) ) : (void)0 )
@@ -10,12 +10,77 @@ namespace ts
     static const int f_result = 8;
     static const int f_exec_after_result = 16;
     static const int f_sleeping = 32;
+    static const int f_wakeup = 64;
 
     bool task_c::should_stop(task_executor_c *e)
     {
         return e->sync.lock_read()().worker_should_stop;
     }
 
+namespace
+{
+    struct deque_s // ring buffer; guarded by worker lock
+    {
+        task_c **items = nullptr;
+        int cap = 0;
+        int head = 0;
+        int count = 0;
+
+        ~deque_s()
+        {
+            if (items) MM_FREE(items);
+        }
+
+        void push_back(task_c *t)
+        {
+            if (count == cap)
+            {
+                int ncap = cap ? cap * 2 : 16;
+                task_c **n = (task_c **)MM_ALLOC(ncap * sizeof(task_c *));
+                for (int i = 0; i < count; ++i)
+                    n[i] = items[(head + i) & (cap - 1)];
+                if (items) MM_FREE(items);
+                items = n;
+                cap = ncap;
+                head = 0;
+            }
+            items[(head + count) & (cap - 1)] = t;
+            ++count;
+        }
+        bool pop_front(task_c *&t) // owner takes oldest task, so iterations of own tasks are round-robin
+        {
+            if (!count) return false;
+            t = items[head];
+            head = (head + 1) & (cap - 1);
+            --count;
+            return true;
+        }
+        bool pop_back(task_c *&t) // thief takes newest task
+        {
+            if (!count) return false;
+            --count;
+            t = items[(head + count) & (cap - 1)];
+            return true;
+        }
+    };
+
+    THREADLOCAL void *tls_worker = nullptr;
+}
+
+struct task_executor_c::worker_s
+{
+    spinlock::long3264 lock = 0;
+    volatile spinlock::long3264 busy = 0; // slot is used by worker thread
+    deque_s q[task_c::PRI_COUNT];
+    int picks = 0;
+
+    // stat; written only by owner
+    int executed = 0;
+    int stolen = 0;
+    int latency_max = 0;
+    int64 latency_sum = 0;
+};
+
 task_executor_c::task_executor_c()
 {
     base_thread_id = spinlock::pthread_self();
@@ -23,6 +88,12 @@ task_executor_c::task_executor_c()
     maximum_workers = g_cpu_cores - 1;
     if (maximum_workers < 1) maximum_workers = 1;
     if (maximum_workers == 1 && g_cpu_cores == 2) maximum_workers = 2;
+    if (maximum_workers > MAX_WORKERS) maximum_workers = MAX_WORKERS;
+
+    MEMT( MEMT_EXECUTOR );
+    wrks = (worker_s *)MM_ALLOC(sizeof(worker_s) * MAX_WORKERS);
+    for (int i = 0; i < MAX_WORKERS; ++i)
+        TSPLACENEW(wrks + i);
 }
 
 task_executor_c::~task_executor_c()
@@ -30,11 +101,7 @@ task_executor_c::~task_executor_c()
     task_c *t;
 
     // now cancel all tasks
-    while (executing.try_pop(t))
-    {
-        t->changeflag(f_executing, 0);
-        t->done(true);
-    }
+    cancel_ready();
 
     for (;;)
     {
@@ -51,11 +118,7 @@ task_executor_c::~task_executor_c()
     }
 
     // cancel all tasks again
-    while (executing.try_pop(t))
-    {
-        t->changeflag(f_executing, 0);
-        t->done(true);
-    }
+    cancel_ready();
 
     while (results.try_pop(t))
     {
@@ -74,17 +137,267 @@ task_executor_c::~task_executor_c()
         t->changeflag(f_canceled, 0);
         t->done(true);
     }
-    while ( sleeping.try_pop( t ) )
+
+    for ( const sleeper_s &s : sleeping )
     {
-        t->changeflag(f_sleeping, 0);
-        t->done( true );
+        s.t->changeflag(f_sleeping, 0);
+        s.t->done( true );
     }
+    sleeping.clear();
+
+    for (int i = 0; i < MAX_WORKERS; ++i)
+        wrks[i].~worker_s();
+    MM_FREE(wrks);
 
     CloseHandle((HANDLE)evt);
 }
 
+task_executor_c::worker_s *task_executor_c::current_worker() const
+{
+    worker_s *w = (worker_s *)tls_worker;
+    if (w >= wrks && w < wrks + MAX_WORKERS)
+        return w;
+    return nullptr;
+}
+
+void task_executor_c::push_ready( task_c *t, worker_s *w )
+{
+    int pri = CLAMP( t->priority(), task_c::PRI_LOW, task_c::PRI_HIGH );
+    t->__enqueue_time = timeGetTime();
+    t->changeflag(0, f_executing);
+
+    if (w)
+    {
+        SIMPLELOCK(w->lock);
+        w->q[pri].push_back(t);
+    } else
+        ready[pri].push(t);
+
+    // wake up idle worker: task from outside or more than one task waiting (someone can steal)
+    if (SLxInterlockedIncrement(&queued) > 1 || !w)
+        SetEvent((HANDLE)evt);
+}
+
+bool task_executor_c::pop_ready( task_c *&t, worker_s *w )
+{
+    // strict priority order, but every 8th pick lowest priority goes first, so long jobs are not starved completely
+    bool lowfirst = 0 == (++w->picks & 7);
+    int wi = (int)(w - wrks);
+
+    for (int i = 0; i < task_c::PRI_COUNT; ++i)
+    {
+        int pri = lowfirst ? (task_c::PRI_LOW + i) : (task_c::PRI_HIGH - i);
+
+        bool ok = false;
+        if (w->q[pri].count)
+        {
+            SIMPLELOCK(w->lock);
+            ok = w->q[pri].pop_front(t);
+        }
+
+        if (!ok)
+            ok = ready[pri].try_pop(t);
+
+        for (int j = 1; !ok && j < MAX_WORKERS; ++j)
+        {
+            worker_s &o = wrks[(wi + j) % MAX_WORKERS];
+            if (!o.q[pri].count) continue; // unsafe check is ok here
+            SIMPLELOCK(o.lock);
+            if (o.q[pri].pop_back(t))
+            {
+                ++w->stolen;
+                ok = true;
+            }
+        }
+
+        if (ok)
+        {
+            SLxInterlockedDecrement(&queued);
+            t->changeflag(f_executing, 0);
+
+            int latency = (int)(timeGetTime() - t->__enqueue_time);
+            ++w->executed;
+            w->latency_sum += latency;
+            if (latency > w->latency_max) w->latency_max = latency;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void task_executor_c::cancel_ready()
+{
+    task_c *t;
+    for (int pri = 0; pri < task_c::PRI_COUNT; ++pri)
+    {
+        for (;;)
+        {
+            bool ok = ready[pri].try_pop(t);
+            for (int i = 0; !ok && i < MAX_WORKERS; ++i)
+            {
+                SIMPLELOCK(wrks[i].lock);
+                ok = wrks[i].q[pri].pop_front(t);
+            }
+            if (!ok) break;
+
+            SLxInterlockedDecrement(&queued);
+            t->changeflag(f_executing, 0);
+            t->done(true);
+        }
+    }
+}
+
+void task_executor_c::sleep( task_c *t )
+{
+    {
+        SIMPLELOCK(sleepinglock);
+        if (!t->is_flag(f_wakeup))
+        {
+            t->changeflag(0, f_sleeping);
+
+            aint i = sleeping.count();
+            sleeping.set_count(i + 1);
+            sleeper_s *h = sleeping.begin();
+
+            // sift up
+            for (; i > 0;)
+            {
+                aint parent = (i - 1) / 2;
+                if ((int)(h[parent].wake_up_time - t->__wake_up_time) <= 0) break;
+                h[i] = h[parent];
+                i = parent;
+            }
+            h[i].wake_up_time = t->__wake_up_time;
+            h[i].t = t;
+            SLxInterlockedIncrement(&nsleepers);
+            return;
+        }
+        t->changeflag(f_wakeup, 0);
+    }
+
+    push_ready(t, current_worker()); // woken up while iterated
+}
+
+void task_executor_c::sift_sleepers( aint i )
+{
+    sleeper_s *h = sleeping.begin();
+    aint cnt = sleeping.count();
+    sleeper_s x = h[i];
+
+    // sift up
+    for (; i > 0;)
+    {
+        aint parent = (i - 1) / 2;
+        if ((int)(h[parent].wake_up_time - x.wake_up_time) <= 0) break;
+        h[i] = h[parent];
+        i = parent;
+    }
+
+    // sift down
+    for (;;)
+    {
+        aint c = i * 2 + 1;
+        if (c >= cnt) break;
+        if (c + 1 < cnt && (int)(h[c + 1].wake_up_time - h[c].wake_up_time) < 0) ++c;
+        if ((int)(x.wake_up_time - h[c].wake_up_time) <= 0) break;
+        h[i] = h[c];
+        i = c;
+    }
+    h[i] = x;
+}
+
+void task_executor_c::wake( task_c *t )
+{
+    {
+        SIMPLELOCK(sleepinglock);
+        aint i = -1;
+        if (t->is_flag(f_sleeping))
+            for (aint j = 0, cnt = sleeping.count(); j < cnt; ++j)
+                if (sleeping.get(j).t == t)
+                {
+                    i = j;
+                    break;
+                }
+
+        if (i < 0)
+        {
+            // not in heap (yet or already): next sleep() will not sleep
+            t->changeflag(0, f_wakeup);
+            return;
+        }
+
+        aint last = sleeping.count() - 1;
+        sleeping.get(i) = sleeping.get(last);
+        sleeping.set_count(last);
+        if (i < last)
+            sift_sleepers(i);
+        SLxInterlockedDecrement(&nsleepers);
+        t->changeflag(f_sleeping, 0);
+    }
+
+    push_ready(t, current_worker());
+}
+
+int task_executor_c::wake_sleepers()
+{
+    if (nsleepers == 0)
+        return -1;
+
+    tmp_pointers_t<task_c, 1> due;
+    int next = -1;
+    int curtime = timeGetTime();
+
+    {
+        SIMPLELOCK(sleepinglock);
+        while (sleeping.count())
+        {
+            sleeper_s *h = sleeping.begin();
+            int dt = (int)(h[0].wake_up_time - curtime);
+            if (dt > 0)
+            {
+                next = dt;
+                break;
+            }
+            due.add(h[0].t);
+
+            // pop top: move last to root and sift down
+            aint cnt = sleeping.count() - 1;
+            sleeper_s x = h[cnt];
+            aint i = 0;
+            for (;;)
+            {
+                aint c = i * 2 + 1;
+                if (c >= cnt) break;
+                if (c + 1 < cnt && (int)(h[c + 1].wake_up_time - h[c].wake_up_time) < 0) ++c;
+                if ((int)(x.wake_up_time - h[c].wake_up_time) <= 0) break;
+                h[i] = h[c];
+                i = c;
+            }
+            h[i] = x;
+            sleeping.set_count(cnt);
+            SLxInterlockedDecrement(&nsleepers);
+        }
+    }
+
+    for (task_c *t : due)
+    {
+        t->changeflag(f_sleeping, 0);
+        push_ready(t, nullptr);
+    }
+
+    return next;
+}
+
 void task_executor_c::work()
 {
+    worker_s *me = nullptr;
+    for (int i = 0; i < MAX_WORKERS && !me; ++i)
+        if (0 == SLxInterlockedCompareExchange(&wrks[i].busy, 1, 0))
+            me = wrks + i;
+    tls_worker = me;
+    trace_thread_name( "executor" );
+
     auto w = sync.lock_write();
     w().worker_started = false;
     ++w().workers;
@@ -94,23 +407,32 @@ void task_executor_c::work()
     {
         MEMT( MEMT_EXECUTOR );
 
-        bool timeout = WAIT_TIMEOUT == WaitForSingleObject((HANDLE)evt, 5000);
+        bool timeout = false;
+        int next_wake = wake_sleepers();
+        if (queued == 0)
+        {
+            // sleep until new task or nearest wake up of sleeping task
+            int ms = next_wake < 0 ? 5000 : tmin(next_wake, 5000);
+            timeout = WAIT_TIMEOUT == WaitForSingleObject((HANDLE)evt, ms) && next_wake < 0;
+            wake_sleepers();
+        }
 
         task_c *t;
-        while (executing.try_pop(t))
+        while (pop_ready(t, me))
         {
-            t->changeflag(f_executing, 0);
-
             timeout = false;
-            int r = t->call_iterate(this);
+            int r;
+            {
+                TRACE_SPAN( "executor.iterate" );
+                r = t->call_iterate( this );
+            }
 
             if ( sync.lock_read()( ).worker_should_stop && r != task_c::R_DONE )
                 r = task_c::R_CANCEL;
 
             if (r > 0)
             {
-                t->changeflag(0, f_sleeping);
-                sleeping.push(t);
+                sleep(t);
             } else if (r == task_c::R_DONE)
             {
                 t->changeflag(0, f_finished);
@@ -123,15 +445,13 @@ void task_executor_c::work()
 
             } else if (r == task_c::R_RESULT)
             {
-                t->changeflag(0, f_executing);
-
                 if (!t->is_flag(f_result))
                 {
                     t->changeflag(0, f_result);
                     results.push(t); // only one result
                 }
 
-                executing.push(t);
+                push_ready(t, me);
             } else if (r == task_c::R_RESULT_EXCLUSIVE)
             {
                 if (!t->is_flag(f_result))
@@ -139,20 +459,43 @@ void task_executor_c::work()
                     t->changeflag(0, f_exec_after_result | f_result);
                     results.push(t); // only one result
                 } else
-                    executing.push(t);
+                    push_ready(t, me);
 
             } else
             {
-                t->changeflag(0, f_executing);
-                executing.push(t); // next iteration
+                push_ready(t, me); // next iteration
             }
+
+            wake_sleepers();
         }
 
         if (timeout)
-            break;
+        {
+            // last worker stays alive while there are sleeping tasks, so they are waked up without tick
+            auto ww = sync.lock_write();
+            if (nsleepers == 0 || ww().workers > 1)
+                break;
+        }
 
     }
 
+    // give own tasks to others
+    task_c *t;
+    for (int pri = 0; pri < task_c::PRI_COUNT; ++pri)
+        for (;;)
+        {
+            bool ok;
+            {
+                SIMPLELOCK(me->lock);
+                ok = me->q[pri].pop_front(t);
+            }
+            if (!ok) break;
+            ready[pri].push(t);
+        }
+
+    tls_worker = nullptr;
+    trace_thread_end();
+    me->busy = 0;
     --sync.lock_write()().workers;
 }
 
@@ -181,8 +524,7 @@ void task_executor_c::add(task_c *task)
     ++w().tasks;
     w.unlock();
 
-    task->changeflag(0,f_executing);
-    executing.push(task);
+    push_ready(task, current_worker());
     SetEvent((HANDLE)evt);
 
     check_worker();
@@ -197,15 +539,17 @@ void task_executor_c::tick()
 
     if ( spinlock::pthread_self() == base_thread_id )
     {
+        TRACE_SPAN( "executor.tick" );
+        TRACE_COUNTER( "executor.queued", queued );
+
         while (results.try_pop(t))
         {
             t->changeflag(f_result, 0);
             t->result();
             if (t->is_flag(f_exec_after_result))
             {
-                t->changeflag( f_exec_after_result, f_executing);
-                executing.push(t); // next iteration
-                SetEvent((HANDLE)evt);
+                t->changeflag( f_exec_after_result, 0 );
+                push_ready(t, nullptr); // next iteration
             }
         }
 
@@ -223,44 +567,45 @@ void task_executor_c::tick()
             ++finished_tasks;
         }
 
-        tmp_pointers_t<task_c, 1> sltasks;
-        int curtime = timeGetTime();
-        while ( sleeping.try_pop( t ) )
-        {
-            t->changeflag(f_sleeping, 0);
-            if (curtime >= t->__wake_up_time)
-            {
-                t->changeflag(0,f_executing);
-                executing.push( t ); // next iteration
-                SetEvent( (HANDLE)evt );
-            } else
-            {
-                sltasks.add( t );
-            }
-        }
-        for( task_c *x : sltasks )
-        {
-            x->changeflag(0,f_sleeping);
-            sleeping.push(x);
-        }
+        wake_sleepers(); // just in case; workers wake up sleepers themselves
+
         if ( sync.lock_read()().reexec() )
         {
-            while ( executing.try_pop( t ) )
-            {
-                t->changeflag(f_executing, 0);
-                add( t );
-                break;
-            }
+            sync.lock_write()().worker_must = true;
+            check_worker();
         }
     }
 
     sync.lock_write()().tasks -= finished_tasks;
 }
 
+void task_executor_c::get_stat( stat_s &st )
+{
+    memset(&st, 0, sizeof(st));
+    st.queued = (int)queued;
+    st.sleeping = (int)nsleepers;
+    st.workers = sync.lock_read()().workers;
+
+    for (int i = 0; i < MAX_WORKERS; ++i)
+    {
+        worker_s &w = wrks[i];
+        worker_stat_s &ws = st.worker[i];
+        {
+            SIMPLELOCK(w.lock);
+            for (int pri = 0; pri < task_c::PRI_COUNT; ++pri)
+                ws.queue_depth += w.q[pri].count;
+        }
+        ws.executed = w.executed;
+        ws.stolen = w.stolen;
+        ws.latency_max = w.latency_max;
+        ws.latency_avg = w.executed ? (int)(w.latency_sum / w.executed) : 0;
+    }
+}
+
 void task_c::setup_wakeup( int t )
 {
     __wake_up_time = timeGetTime() + t;
 }
 
 
-} // namespace ts
\ No newline at end of file
+} // namespace ts
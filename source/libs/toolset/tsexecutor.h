@@ -8,6 +8,7 @@ class task_c
     friend class task_executor_c;
     spinlock::syncvar<int> queueflags;
     int __wake_up_time = 0;
+    int __enqueue_time = 0; // for latency statistics
     void changeflag(int clearbits, int setbits)
     {
         auto w = queueflags.lock_write();
@@ -31,6 +32,11 @@ public:
     static const int R_RESULT = -3; // call result and iterate again (simultaneously)
     static const int R_RESULT_EXCLUSIVE = -4; // call result in base thread and iterate strongly after result
 
+    static const int PRI_LOW = 0; // long background jobs (file transfers, indexing)
+    static const int PRI_NORMAL = 1;
+    static const int PRI_HIGH = 2; // interactive jobs (image decoding, searches)
+    static const int PRI_COUNT = 3;
+
     int call_iterate(task_executor_c *e)
     {
         int r = iterate(e);
@@ -40,6 +46,7 @@ public:
     }
 
     virtual int iterate(task_executor_c *e) { return R_DONE; }; // can be called from any thread
+    virtual int priority() const { return PRI_NORMAL; } // checked every time task is queued to execute
     virtual void done(bool canceled) { TSDEL(this); } // called only from base thread. task should kill self
     virtual void result() {} // called only from base thread
 
@@ -55,12 +62,49 @@ class task_executor_c
         static void mf(void *ptr) { MM_FREE(ptr); }
     };
 
-    spinlock::spinlock_queue_s<task_c *, slallocator> executing;
-    spinlock::spinlock_queue_s<task_c *, slallocator> sleeping;
+public:
+    enum
+    {
+        MAX_WORKERS = 32,
+    };
+
+    struct worker_stat_s
+    {
+        int queue_depth; // tasks in own deque now
+        int executed; // iterations done
+        int stolen; // iterations taken from other workers
+        int latency_avg; // ms, from queued to iterate
+        int latency_max; // ms
+    };
+
+    struct stat_s
+    {
+        int queued; // tasks ready to execute (shared queue and all deques)
+        int sleeping;
+        int workers;
+        worker_stat_s worker[ MAX_WORKERS ];
+    };
+
+private:
+
+    struct worker_s;
+    worker_s *wrks = nullptr; // MAX_WORKERS slots; every worker thread has own deques; idle workers steal from others
+
+    spinlock::spinlock_queue_s<task_c *, slallocator> ready[ task_c::PRI_COUNT ]; // tasks added from non-worker threads
     spinlock::spinlock_queue_s<task_c *, slallocator> finished;
     spinlock::spinlock_queue_s<task_c *, slallocator> canceled;
     spinlock::spinlock_queue_s<task_c *, slallocator> results;
 
+    struct sleeper_s : public movable_flag<true>
+    {
+        int wake_up_time;
+        task_c *t;
+    };
+    tbuf_t<sleeper_s> sleeping; // binary heap by wake_up_time
+    spinlock::long3264 sleepinglock = 0;
+    volatile spinlock::long3264 nsleepers = 0; // to check heap without lock
+    volatile spinlock::long3264 queued = 0; // tasks ready to execute (in any queue)
+
     struct sync_s
     {
         int tasks = 0;
@@ -86,6 +130,14 @@ class task_executor_c
 
     void check_worker();
 
+    worker_s *current_worker() const; // worker of current thread or nullptr
+    void push_ready( task_c *t, worker_s *w ); // w - current worker or nullptr
+    bool pop_ready( task_c *&t, worker_s *w );
+    void cancel_ready();
+    void sleep( task_c *t );
+    void sift_sleepers( aint i ); // restore heap after change of item i
+    int wake_sleepers(); // move due sleepers to ready queue; returns ms to next wake up or -1 if no sleepers
+
 public:
     task_executor_c();
     ~task_executor_c();
@@ -93,7 +145,10 @@ public:
     uint32 base_tid() const { return base_thread_id; }
 
     void add( task_c *task ); // can be called from any thread
+    void wake( task_c *task ); // can be called from any thread; sleeping task is iterated now; running or queued one will not sleep after current iteration
     void tick(); // can be called from any thread, but will do nothing, if called from non-base thread
+
+    void get_stat( stat_s &st ); // can be called from any thread; values are approximate
 };
 
 } // namespace ts
\ No newline at end of file
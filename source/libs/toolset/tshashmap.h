@@ -403,5 +403,365 @@ public:
 	}
 };
 
-} // namespace ts
+// open addressing (robin hood) variant of hashmap_t with same interface
+// all elements are stored in one table of power-of-two size, table grows automatically (load factor 7/8)
+// remove uses backward shift, so there are no tombstones
+// unlike hashmap_t, add and remove invalidate pointers to elements
+template <class KEYTYPE, class VALTYPE = Void> class flat_hashmap_t
+{
+public:
+    struct litm_s
+    {
+        KEYTYPE key;
+        VALTYPE value;
+        unsigned key_hash;
+    };
+private:
+    litm_s *table = nullptr;
+    uint8 *dist = nullptr; // 0 - empty slot, else 1 + distance from home slot
+    aint table_size = 0; // power of 2
+    aint used = 0;
+    int shift = 32;
+
+    static const uint8 max_dist = 255;
+
+    aint home( unsigned hash ) const
+    {
+        return (aint)( ( hash * 2654435769u ) >> shift ); // fibonacci hashing - also good for bad hash functions like calc_hash(int)
+    }
+    aint next( aint i ) const { return ( i + 1 ) & ( table_size - 1 ); }
+    bool wrapped( aint i ) const { return i < dist[ i ] - 1; } // home slot of element is at end of table
+
+    void alloc_table( aint size )
+    {
+        table = (litm_s *)MM_ALLOC( sizeof( litm_s ) * size );
+        dist = (uint8 *)MM_ALLOC( size );
+        for ( aint i = 0; i < size; ++i )
+            TSPLACENEW( table + i );
+        memset( dist, 0, size );
+        table_size = size;
+        shift = 32;
+        for ( aint sz = size; sz > 1; sz >>= 1 )
+            --shift;
+    }
+
+    void free_table()
+    {
+        if ( table )
+        {
+            for ( aint i = 0; i < table_size; ++i )
+                table[ i ].~litm_s();
+            MM_FREE( table );
+            MM_FREE( dist );
+            table = nullptr;
+            dist = nullptr;
+        }
+        table_size = 0;
+        used = 0;
+        shift = 32;
+    }
+
+    void rehash( aint size )
+    {
+        litm_s *otable = table;
+        uint8 *odist = dist;
+        aint osize = table_size;
+
+        alloc_table( size );
+        used = 0;
+
+        if ( otable )
+        {
+            for ( aint i = 0; i < osize; ++i )
+            {
+                if ( odist[ i ] )
+                    place( otable[ i ] );
+                otable[ i ].~litm_s();
+            }
+            MM_FREE( otable );
+            MM_FREE( odist );
+        }
+    }
+
+    // move itm into table; returns slot of itm or -1 if table was rehashed while placing
+    aint place( litm_s &itm )
+    {
+        ++used;
+        aint i = home( itm.key_hash ), rslt = -1;
+        uint8 d = 1;
+        for (;;)
+        {
+            if ( dist[ i ] == 0 )
+            {
+                table[ i ] = std::move( itm );
+                dist[ i ] = d;
+                return rslt < 0 ? i : rslt;
+            }
+            if ( dist[ i ] < d )
+            {
+                // robin hood: take slot of richer element
+                SWAP( table[ i ], itm );
+                SWAP( dist[ i ], d );
+                if ( rslt < 0 ) rslt = i;
+            }
+            i = next( i );
+            if ( ++d == max_dist )
+            {
+                // too long probe sequence - grow and place carried element again
+                --used;
+                rehash( table_size * 2 );
+                place( itm );
+                return -1;
+            }
+        }
+    }
+
+    void erase( aint i )
+    {
+        for ( aint j = next( i ); dist[ j ] > 1; i = j, j = next( j ) )
+        {
+            table[ i ] = std::move( table[ j ] );
+            dist[ i ] = dist[ j ] - 1;
+        }
+        table[ i ].key = KEYTYPE();
+        table[ i ].value = VALTYPE();
+        dist[ i ] = 0;
+        --used;
+    }
+
+    template<typename COMPARTIBLE_KEY> aint find_index( const COMPARTIBLE_KEY &key, unsigned hash ) const
+    {
+        if ( used == 0 ) return -1;
+        aint i = home( hash );
+        for ( uint8 d = 1; d <= dist[ i ]; ++d, i = next( i ) )
+            if ( table[ i ].key_hash == hash && table[ i ].key == key ) return i;
+        return -1;
+    }
+
+public:
+
+    // elements, which home slot is at end of table, but stored at begin, are iterated last,
+    // so remove() via iterator never moves not yet visited element to already visited slot
+    class iterator
+    {
+        const flat_hashmap_t *hashmap;
+        aint index; // [0..table_size) - not wrapped elements, [table_size..2*table_size) - wrapped ones
+
+        aint slot() const { return index < hashmap->table_size ? index : index - hashmap->table_size; }
+        bool valid() const
+        {
+            aint i = slot();
+            return hashmap->dist[ i ] && ( index < hashmap->table_size ) != hashmap->wrapped( i );
+        }
+        void skip()
+        {
+            for ( aint end = hashmap->table_size * 2; index < end && !valid(); ++index )
+                if ( index >= hashmap->table_size && !( hashmap->dist[ slot() ] && hashmap->wrapped( slot() ) ) )
+                {
+                    index = end;
+                    break;
+                }
+        }
+
+    public:
+        iterator( const flat_hashmap_t *hashmap, aint start_index ) : hashmap( hashmap ), index( start_index ) { skip(); }
+
+        const KEYTYPE &key() const { ASSERT( operator bool() ); return hashmap->table[ slot() ].key; }
+        VALTYPE &value() { return hashmap->table[ slot() ].value; }
+
+        VALTYPE &operator* () { return  hashmap->table[ slot() ].value; }
+        VALTYPE *operator->() { return &hashmap->table[ slot() ].value; }
+
+        explicit operator bool() const { return index < hashmap->table_size * 2; }
+
+        iterator &operator++()
+        {
+            ++index;
+            skip();
+            return *this;
+        }
+
+        iterator operator++( int )
+        {
+            iterator p = *this;
+            ++*this;
+            return p;
+        }
+
+        bool operator==( const iterator &i ) const
+        {
+            return hashmap == i.hashmap && index == i.index;
+        }
+
+        bool operator!=( const iterator &i ) const { return !operator==( i ); }
+
+        void remove() // remove current element and go to next element
+        {
+            if ( !ASSERT( operator bool() ) ) return;
+            const_cast<flat_hashmap_t*>( hashmap )->erase( slot() );
+            skip(); // next element could be shifted to current slot
+        }
+    };
+
+    iterator begin() const { return iterator( this, 0 ); }
+    iterator   end() const { return iterator( this, table_size * 2 ); }
+
+    flat_hashmap_t() {}
+    explicit flat_hashmap_t( aint size )
+    {
+        reserve( size );
+    }
+    flat_hashmap_t( const flat_hashmap_t &hm )
+    {
+        *this = hm;
+    }
+    flat_hashmap_t( flat_hashmap_t &&hm )
+    {
+        *this = std::move( hm );
+    }
+
+    ~flat_hashmap_t()
+    {
+        free_table();
+    }
+
+    void reserve( aint size ) // size - number of elements
+    {
+        aint need = 8;
+        while ( need - need / 8 < size ) need <<= 1;
+        if ( need > table_size )
+            rehash( need );
+    }
+
+    aint  size() const { return used; }
+    bool is_empty() const { return used == 0; }
+
+    void clear()
+    {
+        for ( aint i = 0; i < table_size; ++i )
+            if ( dist[ i ] )
+            {
+                table[ i ].key = KEYTYPE();
+                table[ i ].value = VALTYPE();
+                dist[ i ] = 0;
+            }
+        used = 0;
+    }
+
+    flat_hashmap_t &operator=( flat_hashmap_t &&hm )
+    {
+        SWAP( table, hm.table );
+        SWAP( dist, hm.dist );
+        SWAP( table_size, hm.table_size );
+        SWAP( used, hm.used );
+        SWAP( shift, hm.shift );
+
+        return *this;
+    }
+
+    flat_hashmap_t &operator=( const flat_hashmap_t &hm )
+    {
+        if ( &hm == this ) return *this;
+
+        free_table();
+        if ( hm.table )
+        {
+            alloc_table( hm.table_size );
+            used = hm.used;
+            for ( aint i = 0; i < table_size; ++i )
+                if ( hm.dist[ i ] )
+                {
+                    table[ i ] = hm.table[ i ];
+                    dist[ i ] = hm.dist[ i ];
+                }
+        }
+
+        return *this;
+    }
+
+    template<typename COMPARTIBLE_KEY> litm_s &add_get_item( const COMPARTIBLE_KEY &key, bool &added )
+    {
+        unsigned hash = calc_hash( key );
+        aint i = find_index( key, hash );
+        if ( i >= 0 )
+        {
+            added = false;
+            return table[ i ];
+        }
 
+        if ( ( used + 1 ) * 8 > table_size * 7 )
+            rehash( tmax( (aint)8, table_size * 2 ) );
+
+        added = true;
+        litm_s itm;
+        itm.key = key;
+        itm.key_hash = hash;
+        i = place( itm );
+        if ( i < 0 )
+            i = find_index( key, hash ); // table was rehashed
+        return table[ i ];
+    }
+    template<typename COMPARTIBLE_KEY> VALTYPE &add( const COMPARTIBLE_KEY &key, bool &added )
+    {
+        return add_get_item( key, added ).value;
+    }
+    template<typename COMPARTIBLE_KEY> VALTYPE &add( const COMPARTIBLE_KEY &key )
+    {
+        bool added;
+        return add_get_item( key, added ).value;
+    }
+
+    template<typename COMPARTIBLE_KEY> bool remove( const COMPARTIBLE_KEY &key )
+    {
+        aint i = find_index( key, calc_hash( key ) );
+        if ( i < 0 ) return false;
+        erase( i );
+        return true;
+    }
+
+    template<typename COMPARTIBLE_KEY, typename GETHANDLER> bool getremove( const COMPARTIBLE_KEY &key, GETHANDLER gh )
+    {
+        aint i = find_index( key, calc_hash( key ) );
+        if ( i < 0 ) return false;
+        gh( table[ i ].value );
+        erase( i );
+        return true;
+    }
+
+    template<typename COMPARTIBLE_KEY> const litm_s *find( const COMPARTIBLE_KEY &key ) const
+    {
+        aint i = find_index( key, calc_hash( key ) );
+        return i < 0 ? nullptr : table + i;
+    }
+    template<typename COMPARTIBLE_KEY> litm_s *find( const COMPARTIBLE_KEY &key )
+    {
+        return const_cast<litm_s*>( const_cast<const flat_hashmap_t*>( this )->find( key ) );
+    }
+
+    template<typename COMPARTIBLE_KEY> const VALTYPE *get( const COMPARTIBLE_KEY &key ) const
+    {
+        if ( const litm_s *li = find( key ) ) return &li->value;
+        return nullptr;
+    }
+
+    template<typename COMPARTIBLE_KEY> VALTYPE *get( const COMPARTIBLE_KEY &key )
+    {
+        if ( litm_s *li = find( key ) ) return &li->value;
+        return nullptr;
+    }
+
+    template<typename COMPARTIBLE_KEY> VALTYPE &operator[]( const COMPARTIBLE_KEY &key )
+    {
+        bool added;
+        return add( key, added );
+    }
+
+    template<typename COMPARTIBLE_KEY> const VALTYPE &operator[]( const COMPARTIBLE_KEY &key ) const
+    {
+        if ( const VALTYPE *val = get( key ) ) return *val;
+        static VALTYPE defValue;
+        return defValue;
+    }
+};
+
+} // namespace ts
@@ -50,11 +50,184 @@ struct getdacolumn
     }
 };
 
+
+// trigram tokenizer for fts5
+// text is lowercased and split into overlapping 3-char tokens, so phrase query of search word matches any substring (same as like override does)
+struct trigram_tokenizer_s
+{
+    typedef int xtoken_f( void *ctx, int tflags, const char *token, int ntoken, int istart, int iend );
+
+    static int xcreate( void *, const char **, int, Fts5Tokenizer **out )
+    {
+        static int dummy = 0;
+        *out = (Fts5Tokenizer *)&dummy; // stateless
+        return SQLITE_OK;
+    }
+    static void xdelete( Fts5Tokenizer * ) {}
+    static int xtokenize( Fts5Tokenizer *, void *ctx, int /*flags*/, const char *text, int textlen, xtoken_f *xtoken )
+    {
+        if ( textlen <= 0 ) return SQLITE_OK;
+
+        wstr_c w( from_utf8( asptr( text, textlen ) ) );
+        w.case_down();
+        aint l = w.get_length();
+        if ( l < 3 ) return SQLITE_OK;
+
+        // utf8 offset of each ucs2 char; chars beyond 0xffff are surrogate pairs
+        tmp_tbuf_t<int> offs;
+        for ( int i = 0; i < textlen && offs.count() < l;)
+        {
+            uint8 c = (uint8)text[ i ];
+            int n = c < 0x80 ? 1 : ( c < 0xe0 ? 2 : ( c < 0xf0 ? 3 : 4 ) );
+            offs.add( i );
+            if ( n == 4 ) offs.add( i );
+            i += n;
+        }
+        while ( offs.count() <= l )
+            offs.add( textlen );
+
+        for ( aint i = 0; i + 3 <= l; ++i )
+        {
+            str_c t( to_utf8( w.substr( i, i + 3 ) ) );
+            int rc = xtoken( ctx, 0, t.cstr(), (int)t.get_length(), offs.get( i ), tmin( offs.get( i + 3 ), textlen ) );
+            if ( rc != SQLITE_OK ) return rc;
+        }
+        return SQLITE_OK;
+    }
+};
+
 class sqlite3_c : public sqlitedb_c
 {
     sqlite3 *db = nullptr;
     int transaction_ref = 0;
     bool readonly = false;
+    bool fts = false; // fts5 with trigram tokenizer available
+    bool stmt_cache = true;
+
+    // prepared statements of insert and delrow; sql text of them depends only on table, operation and column set, so sql text is the key
+    hashmap_t<str_c, sqlite3_stmt *> stmts;
+    spinlock::long3264 stmtslock = 0;
+
+    sqlite3_stmt *get_stmt( const tmp_str_c &sql ) // stmtslock must be locked
+    {
+        sqlite3_stmt *stmt = nullptr;
+        if ( stmt_cache )
+        {
+            bool added;
+            sqlite3_stmt *&cstmt = stmts.add( sql, added );
+            if ( !added ) return cstmt;
+            if ( SQLITE_OK != sqlite3_prepare_v2( db, sql, (int)sql.get_length(), &stmt, nullptr ) )
+            {
+                stmts.remove( sql );
+                return nullptr;
+            }
+            cstmt = stmt;
+            return stmt;
+        }
+        if ( SQLITE_OK != sqlite3_prepare_v2( db, sql, (int)sql.get_length(), &stmt, nullptr ) )
+            return nullptr;
+        return stmt;
+    }
+
+    void release_stmt( sqlite3_stmt *stmt )
+    {
+        if ( stmt_cache )
+        {
+            sqlite3_reset( stmt );
+            sqlite3_clear_bindings( stmt ); // binded values are SQLITE_STATIC
+        } else
+            sqlite3_finalize( stmt );
+    }
+
+    void clear_stmts()
+    {
+        SIMPLELOCK( stmtslock );
+        for ( auto it = stmts.begin(); it; ++it )
+            sqlite3_finalize( *it );
+        stmts.clear();
+    }
+
+    static void bind( sqlite3_stmt *stmt, array_wrapper_c<const data_pair_s> fields )
+    {
+        aint cnt = fields.size();
+        for ( int i = 1; i <= cnt; ++i )
+        {
+            const data_pair_s &d = fields[ i - 1 ];
+
+            switch ( d.type_ )
+            {
+                case data_type_e::t_int:
+                    sqlite3_bind_int( stmt, i, (int)d.i );
+                    break;
+                case data_type_e::t_int64:
+                    sqlite3_bind_int64( stmt, i, d.i );
+                    break;
+                case data_type_e::t_str:
+                    sqlite3_bind_text( stmt, i, d.text.cstr(), (int)d.text.get_length(), SQLITE_STATIC );
+                    break;
+                case data_type_e::t_blob:
+                    sqlite3_bind_blob( stmt, i, d.blob.data(), (int)d.blob.size(), SQLITE_STATIC );
+                    break;
+                default:
+                    FORBIDDEN();
+                    break;
+            }
+        }
+    }
+
+    static void insert_sql( tmp_str_c &tstr, const asptr& tablename, array_wrapper_c<const data_pair_s> fields )
+    {
+        streamstr<tmp_str_c> sql( tstr );
+        sql << CONSTASTR( "insert or replace into \'" ) << tablename << CONSTASTR( "\' (" );
+        for ( const data_pair_s &d : fields )
+            sql << d.name << CONSTASTR( "," );
+        sql.buffer().trunc_length();
+        sql << CONSTASTR( ") values (" );
+        for ( int i = 0; i < fields.size(); ++i )
+            sql << CONSTASTR( "?," );
+        sql.buffer().trunc_length();
+        sql << CONSTASTR( ")" );
+    }
+
+    bool read_stmt( sqlite3_stmt *stmt, SQLITE_TABLEREADER reader )
+    {
+        getdacolumn c;
+        c.stmt = stmt;
+        auto getta = DELEGATE( &c, get_da_value );
+        for ( int row = 0; SQLITE_ROW == sqlite3_step( stmt ); ++row )
+            if ( !reader( row, getta ) ) break;
+        sqlite3_finalize( stmt );
+        return true;
+    }
+
+    int64 select_int( const tmp_str_c &sql )
+    {
+        int64 r = 0;
+        sqlite3_stmt *stmt;
+        if ( SQLITE_OK != sqlite3_prepare_v2( db, sql, (int)sql.get_length(), &stmt, nullptr ) ) return 0;
+        if ( SQLITE_ROW == sqlite3_step( stmt ) )
+            r = sqlite3_column_int64( stmt, 0 );
+        sqlite3_finalize( stmt );
+        return r;
+    }
+
+    void register_fts()
+    {
+        // sqlite 3.10 way to get fts5_api
+        fts5_api *api = nullptr;
+        sqlite3_stmt *stmt;
+        if ( SQLITE_OK != sqlite3_prepare_v2( db, "SELECT fts5()", -1, &stmt, nullptr ) ) return; // no fts5 compiled in
+        if ( SQLITE_ROW == sqlite3_step( stmt ) && sizeof( api ) == sqlite3_column_bytes( stmt, 0 ) )
+            memcpy( &api, sqlite3_column_blob( stmt, 0 ), sizeof( api ) );
+        sqlite3_finalize( stmt );
+
+        if ( api )
+        {
+            fts5_tokenizer t = { trigram_tokenizer_s::xcreate, trigram_tokenizer_s::xdelete, trigram_tokenizer_s::xtokenize };
+            fts = SQLITE_OK == api->xCreateTokenizer( api, "tstrigram", nullptr, &t, nullptr );
+        }
+    }
+
 public:
     sqlite3_c( bool readonly ):readonly(readonly) {}
     ts::wstr_c fn;
@@ -63,6 +236,7 @@ public:
     {
         if (ASSERT(db))
         {
+            clear_stmts();
             sqlite3_close(db);
             db = nullptr;
         }
@@ -273,6 +447,7 @@ public:
             if (recreate)
             {
                 if (readonly) return -1;
+                clear_stmts();
                 execsql(tmp_str_c(CONSTASTR("BEGIN")));
                 tbln.insert(0,CONSTASTR("new__"));
                 create_table(tbln,columns,norowid);
@@ -348,59 +523,80 @@ public:
 
         if (ASSERT(db))
         {
-            tmp_str_c tstr;
-            streamstr<tmp_str_c> sql(tstr);
-            sql << CONSTASTR("insert or replace into \'") << tablename << CONSTASTR("\' (");
-            for( const data_pair_s &d : fields )
-                sql << d.name << CONSTASTR(",");
-            sql.buffer().trunc_length();
-            sql << CONSTASTR(") values (");
-            for (int i=0;i<fields.size();++i)
-                sql << CONSTASTR("?,");
-            sql.buffer().trunc_length();
-            sql << CONSTASTR(")");
+            tmp_str_c sql;
+            insert_sql( sql, tablename, fields );
 
-            int lastid = 0;
-            sqlite3_stmt *insstmt = nullptr;
-            int prepr = sqlite3_prepare_v2(db, sql.buffer(), -1, &insstmt, nullptr);
-            if (!CHECK( SQLITE_OK == prepr, "" << sqlite3_extended_errcode(db) )) return 0;
-            aint cnt = fields.size();
-            ASSERT(cnt == sqlite3_bind_parameter_count(insstmt));
-            for(int i=1;i<=cnt;++i)
-            {
-                const data_pair_s &d = fields[i-1];
+            SIMPLELOCK( stmtslock );
 
-                switch (d.type_)
-                {
-                    case data_type_e::t_int:
-                        sqlite3_bind_int(insstmt, i, (int)d.i);
-                        break;
-                    case data_type_e::t_int64:
-                        sqlite3_bind_int64(insstmt, i, d.i);
-                        break;
-                    case data_type_e::t_str:
-                        sqlite3_bind_text(insstmt, i, d.text.cstr(), (int)d.text.get_length(), SQLITE_STATIC);
-                        break;
-                    case data_type_e::t_blob:
-                        sqlite3_bind_blob(insstmt, i, d.blob.data(), (int)d.blob.size(), SQLITE_STATIC);
-                        break;
-                    default:
-                        FORBIDDEN();
-                        break;
-                }
+            int lastid = 0;
+            sqlite3_stmt *insstmt = get_stmt( sql );
+            if (!CHECK( insstmt != nullptr, "" << sqlite3_extended_errcode(db) )) return 0;
+            ASSERT(fields.size() == sqlite3_bind_parameter_count(insstmt));
+            bind( insstmt, fields );
 
-            }
             int r =sqlite3_step(insstmt);
             if (CHECK(SQLITE_DONE == r, "" << sqlite3_extended_errcode(db)))
                 lastid = (int)sqlite3_last_insert_rowid(db);
 
-            sqlite3_finalize(insstmt);
+            release_stmt( insstmt );
 
             return lastid;
         }
         return 0;
     }
 
+    /*virtual*/ void insert_rows( const asptr& tablename, array_wrapper_c<const data_pair_s> fields, aint columns, int *newids ) override
+    {
+        aint nrows = columns > 0 ? fields.size() / columns : 0;
+        if (readonly || nrows == 0)
+        {
+            if (newids)
+                for (aint i = 0; i < nrows; ++i)
+                    newids[i] = readonly ? -1 : 0;
+            return;
+        }
+
+        if (ASSERT(db))
+        {
+            ASSERT( nrows * columns == fields.size() );
+
+            tmp_str_c sql;
+            insert_sql( sql, tablename, fields.subarray( 0, columns ) );
+
+            begin_transaction();
+            SIMPLELOCK( stmtslock );
+
+            sqlite3_stmt *insstmt = get_stmt( sql );
+            if (CHECK( insstmt != nullptr, "" << sqlite3_extended_errcode(db) ))
+            {
+                ASSERT(columns == sqlite3_bind_parameter_count(insstmt));
+                for ( aint row = 0; row < nrows; ++row )
+                {
+                    bind( insstmt, fields.subarray( row * columns, row * columns + columns ) );
+
+                    int lastid = 0;
+                    int r = sqlite3_step(insstmt);
+                    if (CHECK(SQLITE_DONE == r, "" << sqlite3_extended_errcode(db)))
+                        lastid = (int)sqlite3_last_insert_rowid(db);
+                    if (newids)
+                        newids[row] = lastid;
+
+                    sqlite3_reset( insstmt );
+                }
+                release_stmt( insstmt );
+            } else if ( newids )
+                memset( newids, 0, sizeof(int) * nrows );
+
+            end_transaction();
+        }
+    }
+
+    /*virtual*/ void set_stmt_cache( bool f ) override
+    {
+        if ( !f ) clear_stmts();
+        stmt_cache = f;
+    }
+
     /*virtual*/ void update(const asptr& tablename, array_wrapper_c<const data_pair_s> fields, const asptr& where_items) override
     {
         if (readonly) return;
@@ -417,32 +613,8 @@ public:
 
             sqlite3_stmt *updstmt = nullptr;
             if (!CHECK(SQLITE_OK == sqlite3_prepare_v2(db, sql.buffer(), -1, &updstmt, nullptr))) return;
-            aint cnt = fields.size();
-            ASSERT(cnt == sqlite3_bind_parameter_count(updstmt));
-            for (aint i = 1; i <= cnt; ++i)
-            {
-                const data_pair_s &d = fields[i - 1];
-
-                switch (d.type_)
-                {
-                    case data_type_e::t_int:
-                        sqlite3_bind_int(updstmt, (int)i, (int)d.i);
-                        break;
-                    case data_type_e::t_int64:
-                        sqlite3_bind_int64(updstmt, (int)i, d.i);
-                        break;
-                    case data_type_e::t_str:
-                        sqlite3_bind_text(updstmt, (int)i, d.text.cstr(), (int)d.text.get_length(), SQLITE_STATIC);
-                        break;
-                    case data_type_e::t_blob:
-                        sqlite3_bind_blob(updstmt, (int)i, d.blob.data(), (int)d.blob.size(), SQLITE_STATIC);
-                        break;
-                    default:
-                        FORBIDDEN();
-                        break;
-                }
-
-            }
+            ASSERT(fields.size() == sqlite3_bind_parameter_count(updstmt));
+            bind( updstmt, fields );
 
             for (; SQLITE_ROW == sqlite3_step(updstmt);) ;
             
@@ -458,9 +630,15 @@ public:
         {
             tmp_str_c tstr;
             streamstr<tmp_str_c> sql(tstr);
-            sql << CONSTASTR("delete from \'") << tablename << CONSTASTR("\' where id=") << id;
+            sql << CONSTASTR("delete from \'") << tablename << CONSTASTR("\' where id=?");
 
-            execsql( sql.buffer() );
+            SIMPLELOCK( stmtslock );
+            if (sqlite3_stmt *delstmt = get_stmt( sql.buffer() ))
+            {
+                sqlite3_bind_int( delstmt, 1, id );
+                sqlite3_step( delstmt );
+                release_stmt( delstmt );
+            }
         }
     }
 
@@ -538,6 +716,131 @@ public:
         return false;
     }
 
+    /*virtual*/ bool fts_prepare( const asptr& tablename, const asptr& column ) override
+    {
+        if ( !fts || !ASSERT( db ) ) return false;
+
+        tmp_str_c ftsn( tablename ); ftsn.append( CONSTASTR( "_fts" ) );
+        tmp_str_c staten( ftsn ); staten.append( CONSTASTR( "_state" ) );
+
+        tmp_str_c tstr;
+        streamstr<tmp_str_c> sql( tstr );
+
+        if ( !is_table_exist( ftsn ) )
+        {
+            if ( readonly ) return false;
+            execsql( tmp_str_c( CONSTASTR( "BEGIN" ) ) );
+
+            // rows with id <= top are indexed by fts_build; rows with id > top - by triggers
+            sql << CONSTASTR( "CREATE TABLE IF NOT EXISTS `" ) << staten << CONSTASTR( "` (built integer, top integer)" );
+            execsql( sql.buffer() );
+            execsql( tmp_str_c( CONSTASTR( "delete from `" ), staten ).append( CONSTASTR( "`" ) ) );
+            sql.buffer().clear();
+            sql << CONSTASTR( "INSERT INTO `" ) << staten << CONSTASTR( "` SELECT 0, ifnull(max(id),0) FROM `" ) << tablename << "`";
+            execsql( sql.buffer() );
+
+            sql.buffer().clear();
+            sql << CONSTASTR( "CREATE VIRTUAL TABLE `" ) << ftsn << CONSTASTR( "` USING fts5(" ) << column << CONSTASTR( ", content='" ) << tablename << CONSTASTR( "', content_rowid='id', tokenize='tstrigram')" );
+            execsql( sql.buffer() );
+            execsql( tmp_str_c( CONSTASTR( "COMMIT" ) ) );
+        }
+
+        if ( !readonly )
+        {
+            // insert or replace should fire delete trigger for replaced row
+            execsql( tmp_str_c( CONSTASTR( "PRAGMA recursive_triggers = 1" ) ) );
+
+            auto cond = [&]( const asptr &row )
+            {
+                sql << CONSTASTR( " WHEN (" ) << row << CONSTASTR( ".id > (SELECT top FROM `" ) << staten << CONSTASTR( "`) OR " );
+                sql << row << CONSTASTR( ".id <= (SELECT built FROM `" ) << staten << CONSTASTR( "`)) BEGIN " );
+            };
+            auto ins = [&]()
+            {
+                sql << CONSTASTR( "INSERT INTO `" ) << ftsn << CONSTASTR( "` (rowid, " ) << column << CONSTASTR( ") VALUES (new.id, new." ) << column << CONSTASTR( "); " );
+            };
+            auto del = [&]()
+            {
+                sql << CONSTASTR( "INSERT INTO `" ) << ftsn << CONSTASTR( "` (`" ) << ftsn << CONSTASTR( "`, rowid, " ) << column << CONSTASTR( ") VALUES ('delete', old.id, old." ) << column << CONSTASTR( "); " );
+            };
+
+            sql.buffer().clear();
+            sql << CONSTASTR( "CREATE TRIGGER IF NOT EXISTS `" ) << tmp_str_c( ftsn, CONSTASTR( "_ai" ) ) << CONSTASTR( "` AFTER INSERT ON `" ) << tablename << "`";
+            cond( CONSTASTR( "new" ) ); ins(); sql << CONSTASTR( "END" );
+            execsql( sql.buffer() );
+
+            sql.buffer().clear();
+            sql << CONSTASTR( "CREATE TRIGGER IF NOT EXISTS `" ) << tmp_str_c( ftsn, CONSTASTR( "_ad" ) ) << CONSTASTR( "` AFTER DELETE ON `" ) << tablename << "`";
+            cond( CONSTASTR( "old" ) ); del(); sql << CONSTASTR( "END" );
+            execsql( sql.buffer() );
+
+            sql.buffer().clear();
+            sql << CONSTASTR( "CREATE TRIGGER IF NOT EXISTS `" ) << tmp_str_c( ftsn, CONSTASTR( "_au" ) ) << CONSTASTR( "` AFTER UPDATE OF " ) << column << CONSTASTR( " ON `" ) << tablename << "`";
+            cond( CONSTASTR( "old" ) ); del(); ins(); sql << CONSTASTR( "END" );
+            execsql( sql.buffer() );
+        }
+
+        tstr.set( CONSTASTR( "SELECT built >= top FROM `" ) ).append( staten ).append_char( '`' );
+        return select_int( tstr ) != 0;
+    }
+
+    /*virtual*/ bool fts_build( const asptr& tablename, const asptr& column, int count ) override
+    {
+        if ( !fts || !ASSERT( db ) ) return true;
+        if ( readonly ) return false; // try later
+
+        tmp_str_c ftsn( tablename ); ftsn.append( CONSTASTR( "_fts" ) );
+        tmp_str_c staten( ftsn ); staten.append( CONSTASTR( "_state" ) );
+
+        tmp_str_c tstr;
+        tstr.set( CONSTASTR( "SELECT built FROM `" ) ).append( staten ).append_char( '`' );
+        int64 built = select_int( tstr );
+        tstr.set( CONSTASTR( "SELECT top FROM `" ) ).append( staten ).append_char( '`' );
+        int64 top = select_int( tstr );
+        if ( built >= top ) return true;
+
+        int64 next = tmin( built + count, top );
+
+        streamstr<tmp_str_c> sql( tstr );
+        sql.buffer().clear();
+        sql << CONSTASTR( "SAVEPOINT ftsbuild; INSERT INTO `" ) << ftsn << CONSTASTR( "` (rowid, " ) << column << CONSTASTR( ") SELECT id, " ) << column;
+        sql << CONSTASTR( " FROM `" ) << tablename << CONSTASTR( "` WHERE id > " ) << built << CONSTASTR( " AND id <= " ) << next;
+        sql << CONSTASTR( "; UPDATE `" ) << staten << CONSTASTR( "` SET built = " ) << next << CONSTASTR( "; RELEASE ftsbuild" );
+        execsql( sql.buffer() );
+
+        return next >= top;
+    }
+
+    /*virtual*/ bool fts_read_table( const asptr& tablename, SQLITE_TABLEREADER reader, const wstrings_c &words, const asptr& where_items ) override
+    {
+        if ( !fts || !ASSERT( db ) ) return false;
+
+        str_c match;
+        for ( const wstr_c &w : words )
+        {
+            if ( w.get_length() < 3 ) continue; // too short for trigram; caller's where_items should check it
+            str_c p( to_utf8( w ) );
+            p.replace_all( CONSTASTR( "\"" ), CONSTASTR( "\"\"" ) );
+            if ( match.get_length() ) match.append( CONSTASTR( " AND " ) );
+            match.append_char( '\"' ).append( p ).append_char( '\"' );
+        }
+        if ( match.is_empty() ) return false;
+
+        tmp_str_c ftsn( tablename ); ftsn.append( CONSTASTR( "_fts" ) );
+
+        tmp_str_c tstr;
+        streamstr<tmp_str_c> sql( tstr );
+        sql << CONSTASTR( "SELECT * FROM \'" ) << tablename << CONSTASTR( "\' where id in (SELECT rowid FROM `" ) << ftsn << CONSTASTR( "` WHERE `" ) << ftsn << CONSTASTR( "` MATCH ?)" );
+        if ( where_items.l )
+            sql << CONSTASTR( " and " ) << where_items;
+
+        sqlite3_stmt *stmt;
+        if ( SQLITE_OK != sqlite3_prepare_v2( db, sql.buffer(), (int)sql.buffer().get_length(), &stmt, nullptr ) )
+            return false;
+        sqlite3_bind_text( stmt, 1, match.cstr(), (int)match.get_length(), SQLITE_STATIC );
+        return read_stmt( stmt, reader );
+    }
+
     /*virtual*/ void rekey(const uint8 *k, SQLITE_ENCRYPT_PROCESS_CALLBACK cb) override
     {
         // only one rekey allowed
@@ -567,6 +870,7 @@ public:
         sqlite3_open_v2(utf8name, &db, SQLITE_OPEN_FULLMUTEX | (readonly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)), nullptr);
         if ( passhash )
             sqlite3_key(db, passhash, 48);
+        register_fts();
     }
 };
 
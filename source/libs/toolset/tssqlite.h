@@ -92,12 +92,20 @@ public:
     virtual bool unique_values( const asptr& tablename, SQLITE_UNIQUE_VALUES reader, const asptr& column ) = 0;
     virtual bool read_table( const asptr& tablename, SQLITE_TABLEREADER reader, const asptr& where_items = asptr() ) = 0;
     virtual int  insert( const asptr& tablename, array_wrapper_c<const data_pair_s> fields ) = 0;
+    virtual void insert_rows( const asptr& tablename, array_wrapper_c<const data_pair_s> fields, aint columns, int *newids ) = 0; // fields - rows of columns items with same names and order; one transaction; newids - nullptr or array of fields.size()/columns ids
     virtual void delrow( const asptr& tablename, int id ) = 0;
     virtual void delrows(const asptr& tablename, const asptr& where_items) = 0;
     virtual int  count( const asptr& tablename, const asptr& where_items ) = 0;
     virtual void update( const asptr& tablename, array_wrapper_c<const data_pair_s> fields, const asptr& where_items ) = 0;
     virtual int  find_free( const asptr& tablename, const asptr& id ) = 0;
-    
+
+    // full text (substring) index of text column; index table is [tablename]_fts, synced by triggers
+    virtual bool fts_prepare( const asptr& tablename, const asptr& column ) = 0; // create index if not exist; returns true if index is complete, else fts_build should be called
+    virtual bool fts_build( const asptr& tablename, const asptr& column, int count ) = 0; // index next count ids of rows, existed before fts_prepare; returns true when done; uses savepoint, so call it from thread that owns connection, between transactions
+    virtual bool fts_read_table( const asptr& tablename, SQLITE_TABLEREADER reader, const wstrings_c &words, const asptr& where_items ) = 0; // read rows containing all words (3+ chars); returns false if index can't be used
+
+    virtual void set_stmt_cache( bool f ) = 0; // prepared statements of insert/insert_rows/delrow are cached by default
+
     virtual void rekey( const uint8 *k, SQLITE_ENCRYPT_PROCESS_CALLBACK cb ) = 0; // k must be 48 bytes length (16 salt + 32 password hash, salt will be saved into file as header)
 
     static sqlitedb_c *connect( const wsptr &fn, const uint8 *k /* 48 bytes; see rekey; can be null - mean unencrypted */, bool readonly ); // will create file if not exist / returns already connected db
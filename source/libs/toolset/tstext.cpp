@@ -342,6 +342,7 @@ bool text_rect_c::draw_glyphs(uint8 *dst_, int width, int height, int pitch, con
 
 text_rect_c::~text_rect_c()
 {
+    glyphs_cache_release(glyphs_slabs);
 }
 
 void text_rect_c::update_rectangles( ts::ivec2 &offset, rectangle_update_s * updr )
@@ -440,10 +441,12 @@ bool text_rect_c::set_text(const wstr_c &text_, CUSTOM_TAG_PARSER ctp, bool do_p
 
 void text_rect_c::parse_and_render_texture(rectangle_update_s * updr, CUSTOM_TAG_PARSER ctp, bool do_render)
 {
-	glyphs().clear();
+	clear_glyphs();
 	int f = flags & (TO_WRAP_BREAK_WORD | TO_HCENTER | TO_LASTLINEADDH | TO_FORCE_SINGLELINE | TO_END_ELLIPSIS | TO_LINE_END_ELLIPSIS);
     flags.clear(F_INVALID_GLYPHS);
+    glyph_slabs_t *prevc = glyphs_cache_collect(&glyphs_slabs);
 	lastdrawsize = parse_text(text, size.x-ui_scale(margins_lt.x)-ui_scale(margin_right), ctp, &glyphs(), default_color, (*font), f, size.y - ui_scale(margins_lt.y));
+    glyphs_cache_collect(prevc);
 	text_height = lastdrawsize.y + ui_scale(margins_lt.y);
 	lastdrawsize.x += ui_scale(margins_lt.x) + ui_scale(margin_right);
     lastdrawsize.y = text_height;
@@ -26,6 +26,7 @@ protected:
     ts::ivec2 margins_lt = ts::ivec2(0);
     int margin_right = 0; // offset of text in texture
     int text_height;
+    glyph_slabs_t glyphs_slabs; // glyphs cache slabs referenced by glyphs
 
     virtual int prepare_textures( const ts::ivec2 &minsz) = 0;
     virtual void textures_no_need() = 0;
@@ -43,6 +44,7 @@ public:
 
     GLYPHS & glyphs() { return glyphs_internal; }
     const GLYPHS & glyphs() const { return glyphs_internal; }
+    void clear_glyphs() { glyphs_internal.clear(); glyphs_cache_release(glyphs_slabs); }
     void update_rectangles( ts::ivec2 &offset, rectangle_update_s * updr ); // internal
 
 public:
@@ -58,7 +60,7 @@ public:
         if (dirty_glyphs) flags.set(F_INVALID_GLYPHS);
         if (dirty_size) flags.set(F_INVALID_SIZE);
     }
-    bool is_dirty() const { return flags.is(F_DIRTY); }
+    bool is_dirty() const { return flags.is(F_DIRTY) || (glyphs_slabs.count() && glyphs_cache_evicted(glyphs_slabs)); } // glyphs could be evicted from cache
     bool is_invalid_size() const { return flags.is(F_INVALID_SIZE); }
     bool is_invalid_glyphs() const { return flags.is(F_INVALID_GLYPHS); }
     bool is_invalid_texture() const { return flags.is(F_INVALID_TEXTURE); }
@@ -119,6 +119,7 @@ protected:
 
 public:
 
+    bool is_layered() const { return flags.is(F_LAYERED); }
     bool is_infocuschangehandler() const { return flags.is(F_INFOCUSCHANGEHANDLER); }
     void set_infocuschangehandler( bool f ) { flags.init( F_INFOCUSCHANGEHANDLER, f ); }
 
@@ -330,6 +330,9 @@ enum telemetry_e
     TLM_VIDEO_RECV_BYTES,
     TLM_FILE_SEND_BYTES,
     TLM_FILE_RECV_BYTES,
+    TLM_VIDEO_ENCODE_TIME, // sz - average encode time of frame (microseconds), reported once per second
+    TLM_VIDEO_ENCODE_QUEUE, // sz - max depth of encoder queue
+    TLM_VIDEO_DROPPED_FRAMES, // sz - number of stale frames dropped before encoding
 
     TLM_COUNT,
 };
@@ -393,3 +396,4 @@ enum config_flags_e
 
 #define DEBUG_OPT_FULL_DUMP "full_dump"
 #define DEBUG_OPT_LOGGING   "logging"
+#define DEBUG_OPT_TRACE     "trace"
@@ -347,34 +347,175 @@ extern "C"
     u32 g_cpu_caps = cpu_detect::detect_cpu_caps();
 }
 
-#ifdef _DEBUG
-delta_time_profiler_s::delta_time_profiler_s(int n):n(n)
+namespace
 {
-    entries = new entry_s[ n ];
-    LARGE_INTEGER freq;
-    QueryPerformanceFrequency(&freq);
-    notfreq = 1000.0 / (double)freq.QuadPart;
-    QueryPerformanceCounter(&prev);
+    enum
+    {
+        TRACE_RING_EVENTS = 8192, // power of 2; 256k per traced thread
+    };
+
+    struct trace_event_s
+    {
+        const char *name;
+        u64 ticks;
+        u64 v; // duration (ticks) of span or value of counter
+        u32 tid;
+        char ph;
+    };
+
+    struct trace_ring_s
+    {
+        trace_ring_s *next;
+        const char *tname;
+        u32 tid;
+        volatile spinlock::long3264 owned;
+        volatile u32 head; // events written since ring creation; only owner thread writes
+        trace_event_s ev[ TRACE_RING_EVENTS ];
+    };
+
+    // rings are never freed: dump can be requested at any time
+    trace_ring_s * volatile trace_rings = nullptr;
+    __declspec( thread ) trace_ring_s *tls_trace_ring = nullptr;
+    __declspec( thread ) const char *tls_trace_name = nullptr;
+
+    trace_ring_s *trace_ring()
+    {
+        if ( trace_ring_s *r = tls_trace_ring )
+            return r;
+
+        trace_ring_s *r = trace_rings;
+        for ( ; r; r = r->next )
+            if ( 0 == r->owned && 0 == SLxInterlockedCompareExchange( &r->owned, 1, 0 ) )
+                break;
+
+        if ( !r )
+        {
+            r = (trace_ring_s *)dlmalloc( sizeof( trace_ring_s ) );
+            memset( r, 0, sizeof( trace_ring_s ) );
+            r->owned = 1;
+            for ( ;; )
+            {
+                trace_ring_s *first = trace_rings;
+                r->next = first;
+                if ( (spinlock::long3264)first == SLxInterlockedCompareExchange( (volatile spinlock::long3264 *)&trace_rings, (spinlock::long3264)r, (spinlock::long3264)first ) )
+                    break;
+            }
+        }
+
+        r->tid = GetCurrentThreadId();
+        r->tname = tls_trace_name;
+        tls_trace_ring = r;
+        return r;
+    }
+
+    void trace_us( std::str_c &out, u64 ticks, u64 freq )
+    {
+        out.append_as_num<u64>( ticks / freq * 1000000 + ( ticks % freq ) * 1000000 / freq );
+    }
+
+    void trace_head( std::str_c &out, const char *name, const char *ph, u32 pid, u32 tid )
+    {
+        if ( !out.is_empty() )
+            out.append( STD_ASTR( ",\n" ) );
+        out.append( STD_ASTR( "{\"name\":\"" ) ).append( std::asptr( name ) ).append( STD_ASTR( "\",\"ph\":\"" ) ).append( std::asptr( ph ) );
+        out.append( STD_ASTR( "\",\"pid\":" ) ).append_as_uint( pid ).append( STD_ASTR( ",\"tid\":" ) ).append_as_uint( tid );
+    }
+}
+
+void trace_thread_name( const char *name )
+{
+    tls_trace_name = name;
+    if ( tls_trace_ring )
+        tls_trace_ring->tname = name;
+}
+
+void trace_thread_end()
+{
+    if ( trace_ring_s *r = tls_trace_ring )
+    {
+        tls_trace_ring = nullptr;
+        r->tname = nullptr;
+        r->owned = 0;
+    }
+    tls_trace_name = nullptr;
 }
-delta_time_profiler_s::~delta_time_profiler_s()
+
+void trace_put( const char *name, char ph, u64 ticks, u64 v )
 {
-    delete[] entries;
+    trace_ring_s *r = trace_ring();
+    u32 h = r->head;
+    trace_event_s &e = r->ev[ h & ( TRACE_RING_EVENTS - 1 ) ];
+    e.name = name;
+    e.ticks = ticks;
+    e.v = v;
+    e.tid = r->tid;
+    e.ph = ph;
+    _ReadWriteBarrier();
+    r->head = h + 1;
 }
-void delta_time_profiler_s::operator()(int id)
+
+void trace_json( std::str_c &out, const std::asptr &process_name )
 {
-    entries[index].id = id;
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency( &f );
+    u64 freq = static_cast<u64>( f.QuadPart );
+    u32 pid = GetCurrentProcessId();
 
-    LARGE_INTEGER cur;
-    QueryPerformanceCounter(&cur);
-    entries[index].deltams = (float)((double)(cur.QuadPart - prev.QuadPart) * notfreq);
-    prev = cur;
-    ++index;
-    if (index >= n)
-        index = 0;
+    if ( process_name.l )
+    {
+        trace_head( out, "process_name", "M", pid, 0 );
+        out.append( STD_ASTR( ",\"args\":{\"name\":\"" ) ).append( process_name ).append( STD_ASTR( "\"}}" ) );
+    }
+
+    trace_event_s *snap = (trace_event_s *)dlmalloc( sizeof( trace_event_s ) * TRACE_RING_EVENTS );
+    for ( trace_ring_s *r = trace_rings; r; r = r->next )
+    {
+        if ( r->tname )
+        {
+            trace_head( out, "thread_name", "M", pid, r->tid );
+            out.append( STD_ASTR( ",\"args\":{\"name\":\"" ) ).append( std::asptr( r->tname ) ).append( STD_ASTR( "\"}}" ) );
+        }
 
+        // copy, then drop events overwritten by owner while copying
+        u32 h = r->head;
+        _ReadWriteBarrier();
+        u32 n = min( h, (u32)TRACE_RING_EVENTS );
+        for ( u32 i = 0; i < n; ++i )
+            snap[ i ] = r->ev[ ( h - n + i ) & ( TRACE_RING_EVENTS - 1 ) ];
+        _ReadWriteBarrier();
+        u32 lost = r->head - h;
+        if ( lost > TRACE_RING_EVENTS - n )
+            lost -= TRACE_RING_EVENTS - n;
+        else
+            lost = 0;
+
+        for ( u32 i = min( lost, n ); i < n; ++i )
+        {
+            const trace_event_s &e = snap[ i ];
+            if ( 'X' == e.ph )
+            {
+                trace_head( out, e.name, "X", pid, e.tid );
+                out.append( STD_ASTR( ",\"ts\":" ) ); trace_us( out, e.ticks, freq );
+                out.append( STD_ASTR( ",\"dur\":" ) ); trace_us( out, e.v, freq );
+                out.append_char( '}' );
+            } else
+            {
+                trace_head( out, e.name, "C", pid, e.tid );
+                out.append( STD_ASTR( ",\"ts\":" ) ); trace_us( out, e.ticks, freq );
+                out.append( STD_ASTR( ",\"args\":{\"value\":" ) ).append_as_num<u64>( e.v ).append( STD_ASTR( "}}" ) );
+            }
+        }
+    }
+    dlfree( snap );
 }
 
-#endif
+extern "C" void PROTOCALL api_trace_json( trace_out_pf out, void *prm )
+{
+    std::str_c json;
+    trace_json( json, std::asptr() );
+    if ( !json.is_empty() )
+        out( prm, json.cstr(), json.get_length() );
+}
 
 
 #pragma warning (disable:4559)
@@ -46,6 +46,7 @@ enum logging_flags_e
     LFLS_CLOSE = 1,
     LFLS_ESTBLSH = 2,
     LFLS_TIMEOUT = 4,
+    LFLS_TRACE = 8, // not logging: enables TRACE_SPAN / TRACE_COUNTER
 };
 
 extern unsigned int g_logging_flags;
@@ -184,33 +185,37 @@ typedef std::widechar WIDECHAR;
 
 #define SETBIT(x) (static_cast<size_t>(1)<<(x))
 
-#ifdef _DEBUG
+#include "proto_interface.h"
+
+// tracing: same events as ts::trace_* of toolset, dumped to chrome trace json (see AQ_TRACE_DUMP)
+// enabled by LFLS_TRACE logging flag; when off, only flag is checked. names must be string literals: only pointers are stored
+#define TRACE_ON (0 != (g_logging_flags & LFLS_TRACE))
+void trace_thread_name( const char *name ); // call at thread start
+void trace_thread_end(); // ring of finished thread is reused by next new thread
+void trace_put( const char *name, char ph, u64 ticks, u64 v );
+void trace_json( std::str_c &out, const std::asptr &process_name ); // comma separated events; no process_name event, if name is empty
+
+typedef void (PROTOCALL *trace_out_pf)( void *prm, const char *json, int len );
+extern "C" void PROTOCALL api_trace_json( trace_out_pf out, void *prm ); // exported by protocol plugins; plghost collects their events here
+typedef void (PROTOCALL *trace_json_pf)( trace_out_pf out, void *prm );
 
-struct delta_time_profiler_s
+inline u64 trace_ticks()
 {
-    double notfreq;
-    LARGE_INTEGER prev;
-    struct entry_s
-    {
-        int id;
-        float deltams;
-    };
-    entry_s *entries = nullptr;
-    int index = 0;
-    int n = 0;
-    delta_time_profiler_s(int n);
-    ~delta_time_profiler_s();
-    void operator()(int id);
-};
+    LARGE_INTEGER c;
+    QueryPerformanceCounter(&c);
+    return static_cast<u64>(c.QuadPart);
+}
 
-#define DELTA_TIME_PROFILER(name, n) delta_time_profiler_s name(n)
-#define DELTA_TIME_CHECKPOINT(name) name(__LINE__)
-#else
-#define DELTA_TIME_PROFILER(n, nn) 
-#define DELTA_TIME_CHECKPOINT(n) 
-#endif
+struct trace_span_s
+{
+    const char *name;
+    u64 t0;
+    trace_span_s( const char *name ) :name( name ), t0( TRACE_ON ? trace_ticks() : 0 ) {}
+    ~trace_span_s() { if ( t0 ) trace_put( name, 'X', t0, trace_ticks() - t0 ); }
+};
 
-#include "proto_interface.h"
+#define TRACE_SPAN(name) trace_span_s UNIQIDLINE(__trace_span)(name)
+#define TRACE_COUNTER(name, v) ( TRACE_ON ? trace_put( name, 'C', trace_ticks(), static_cast<u64>(v) ) : (void)0 )
 
 std::wstr_c get_exe_full_name();
 
@@ -630,6 +635,162 @@ public:
     size_t available()  const { return buf[readbuf].size() - readpos + buf[readbuf ^ 1].size(); }
 };
 
+// wakes media (encoder / sender) thread: producer calls signal() when it has enough data,
+// thread sleeps in wait() till signal or till nearest frame deadline
+class media_signal_c
+{
+    HANDLE evt;
+
+    media_signal_c(const media_signal_c &) = delete;
+    media_signal_c &operator=(const media_signal_c &) = delete;
+
+public:
+    media_signal_c() { evt = CreateEventW(nullptr, FALSE, FALSE, nullptr); }
+    ~media_signal_c() { CloseHandle(evt); }
+
+    void signal() { SetEvent(evt); }
+    bool wait(int ms) { return WAIT_OBJECT_0 == WaitForSingleObject(evt, ms > 0 ? (DWORD)ms : 0); } // true - signaled, false - deadline
+};
+
+inline int cpu_count()
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return static_cast<int>(si.dwNumberOfProcessors);
+}
+
+inline u64 time_us()
+{
+    static LARGE_INTEGER freq = {};
+    if (0 == freq.QuadPart) QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER c;
+    QueryPerformanceCounter(&c);
+    return static_cast<u64>(c.QuadPart / freq.QuadPart * 1000000 + (c.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+}
+
+// libvpx threads of one video encoder (g_threads); small frames are encoded faster in one thread
+inline int video_encoder_threads(int w, int h)
+{
+    int t = 1;
+    if (w * h >= 1280 * 720) t = 4;
+    else if (w * h >= 640 * 360) t = 2;
+    return min(t, cpu_count());
+}
+
+// log2 of vp9 tile columns for threads; tile can't be narrower than 256 pixels
+inline int video_encoder_tile_columns_log2(int w, int threads)
+{
+    int l = 0;
+    for (; (2 << l) <= threads && (w >> (l + 1)) >= 256; ++l);
+    return l;
+}
+
+// raw video frames of one call waiting for encoder pool
+// queue is bounded: when full, oldest (stale) frame is dropped, so encoder always gets fresh picture
+// frames of one call are encoded sequentially (encoding flag), different calls - in parallel
+struct video_frame_queue_s
+{
+    static const int capacity = 2;
+
+    struct frame_s
+    {
+        const void *data;
+        u64 msmonotonic;
+        int w, h;
+    };
+
+    struct tlm_s
+    {
+        int encode_us; // average encode time per frame
+        int depth; // max queue depth
+        int dropped; // stale frames dropped
+    };
+
+    spinlock::long3264 sync = 0;
+    frame_s frames[capacity];
+    int first = 0;
+    int count = 0;
+    bool encoding = false;
+
+    // telemetry, accumulated and reported once per second
+    u64 encode_us = 0;
+    int encoded = 0;
+    int maxdepth = 0;
+    int dropped = 0;
+    int next_report = 0;
+
+    const void *push(const void *data, u64 msmonotonic, int w, int h) // returns dropped frame (caller should free it) or nullptr
+    {
+        SIMPLELOCK(sync);
+        const void *stale = nullptr;
+        if (count == capacity)
+        {
+            stale = frames[first].data;
+            first = (first + 1) % capacity;
+            --count;
+            ++dropped;
+        }
+        frame_s &f = frames[(first + count) % capacity];
+        f.data = data;
+        f.msmonotonic = msmonotonic;
+        f.w = w;
+        f.h = h;
+        ++count;
+        return stale;
+    }
+
+    bool take(frame_s &f) // false - no frames or other worker is encoding this call now
+    {
+        SIMPLELOCK(sync);
+        if (encoding || 0 == count)
+            return false;
+        if (count > maxdepth) maxdepth = count;
+        f = frames[first];
+        first = (first + 1) % capacity;
+        --count;
+        encoding = true;
+        return true;
+    }
+
+    bool ready() const
+    {
+        return count > 0 && !encoding;
+    }
+
+    // frame taken by take() is encoded; more - call has another frame
+    // returns true and fills tlm when it is time to report telemetry
+    bool done(u64 us, tlm_s &tlm, bool &more)
+    {
+        SIMPLELOCK(sync);
+        encoding = false;
+        more = count > 0;
+        encode_us += us;
+        ++encoded;
+
+        int ct = time_ms();
+        if ((ct - next_report) < 0)
+            return false;
+        next_report = ct + 1000;
+
+        tlm.encode_us = static_cast<int>(encode_us / encoded);
+        tlm.depth = maxdepth;
+        tlm.dropped = dropped;
+        encode_us = 0;
+        encoded = 0;
+        maxdepth = 0;
+        dropped = 0;
+        return true;
+    }
+
+    template<typename FREEF> void clear(FREEF freef)
+    {
+        SIMPLELOCK(sync);
+        for (; count > 0; --count, first = (first + 1) % capacity)
+            freef(frames[first].data);
+        first = 0;
+    }
+};
+
 /*
 struct ranges_s
 {
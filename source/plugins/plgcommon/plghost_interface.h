@@ -6,7 +6,7 @@
 
 // typical scenario : AQ -> plghost, HA -> application
 
-#define PLGHOST_IPC_PROTOCOL_VERSION 21
+#define PLGHOST_IPC_PROTOCOL_VERSION 22
 
 enum commands_e
 {
@@ -91,6 +91,8 @@ enum commands_e
 
     HQ_TELEMETRY,
     AQ_DEBUG_SETTINGS,
+    AQ_TRACE_DUMP,          // plghost answers with HA_TRACE_DATA: trace events of plghost and plugin
+    HA_TRACE_DATA,
 
     MAX_COMMANDS
 };
@@ -78,6 +78,7 @@ struct protolib_s
     host_functions_s hostfunctions;
     HMODULE protolib;
     proto_functions_s *functions;
+    trace_json_pf trace_json; // optional export: plugin has own trace rings
 
     cmd_result_e load(const std::widechar *protolibname, proto_info_s& pi)
     {
@@ -94,6 +95,8 @@ struct protolib_s
 
             fix_pf( pi );
 
+            trace_json = (trace_json_pf)GetProcAddress(protolib, "api_trace_json");
+
             handshake_pf handshake = (handshake_pf)GetProcAddress(protolib, "api_handshake");
             if (handshake)
             {
@@ -157,6 +160,7 @@ struct protolib_s
     },
     nullptr, // protolib
     nullptr, // functions
+    nullptr, // trace_json
 
 };
 
@@ -370,6 +374,7 @@ ipc::ipc_result_e event_processor( void *dptr, void *data, int datasize )
         return ipc::IPCR_BREAK;
 
     bigdata_s *bd = (bigdata_s *)dptr;
+    TRACE_SPAN( "ipc.recv" );
 
     if (data == nullptr)
     {
@@ -428,8 +433,6 @@ ipc::ipc_result_e event_processor( void *dptr, void *data, int datasize )
 
 unsigned long exec_task( data_data_s *d, unsigned long flags );
 
-DELTA_TIME_PROFILER(x1, 1024);
-
 DWORD WINAPI worker(LPVOID nonzerothread)
 {
     UNSTABLE_CODE_PROLOG
@@ -438,14 +441,16 @@ DWORD WINAPI worker(LPVOID nonzerothread)
     ipcw *w;
 
     ++state.lock_write()().working;
+    trace_thread_name( "plghost worker" );
 
     int sleepvalue = nonzerothread ? 1 : 10;
     for(;!state.lock_read()().need_stop; )
     {
-        DELTA_TIME_CHECKPOINT( x1 );
-
         if (protolib.loaded() && !nonzerothread) // nonzerothread: tick is single-threaded, so i can be called only in one thread
+        {
+            TRACE_SPAN( "plghost.tick" );
             protolib.functions->tick(&sleepvalue);
+        }
         
         if (sleepvalue < 0)
         {
@@ -454,29 +459,26 @@ DWORD WINAPI worker(LPVOID nonzerothread)
             break;
         }
 
-        DELTA_TIME_CHECKPOINT( x1 );
-
         unsigned long flags = 0;
         while (tasks.try_pop(d))
+        {
+            TRACE_SPAN( "plghost.task" );
             flags = exec_task(d, flags);
-
-        DELTA_TIME_CHECKPOINT( x1 );
+        }
 
         while (sendbufs.try_pop(w))
         {
-             ipcj->send(w->data(), (int)w->size());
-             ipcwbuf.lock_write()().kill(w);
+            TRACE_SPAN( "ipc.send" );
+            ipcj->send(w->data(), (int)w->size());
+            ipcwbuf.lock_write()().kill(w);
         }
 
-        DELTA_TIME_CHECKPOINT( x1 );
-
         if (sleepvalue >= 0)
             Sleep(sleepvalue);
 
-        DELTA_TIME_CHECKPOINT( x1 );
-
     }
 
+    trace_thread_end();
     --state.lock_write()().working;
 
     UNSTABLE_CODE_EPILOG
@@ -1076,6 +1078,7 @@ unsigned long exec_task(data_data_s *d, unsigned long flags)
     case AQ_DEBUG_SETTINGS:
         {
             g_logging_flags = 0;
+            bool trace = false;
             if (protolib.functions) protolib.functions->logging_flags(0);
 #if defined _DEBUG || defined _CRASH_HANDLER
             MINIDUMP_TYPE dump_type = (MINIDUMP_TYPE)(MiniDumpWithDataSegs | MiniDumpWithHandleData);
@@ -1095,8 +1098,15 @@ unsigned long exec_task(data_data_s *d, unsigned long flags)
                 {
                     g_logging_flags = (unsigned)v.as_int();
                 }
+                else if (k.equals(STD_ASTR(DEBUG_OPT_TRACE)))
+                {
+                    trace = v.as_int() != 0;
+                }
             });
 
+            // logging value is -1 for all logs; trace bit is controlled by own option
+            g_logging_flags = (g_logging_flags & ~LFLS_TRACE) | (trace ? LFLS_TRACE : 0);
+
             if ( protolib.functions ) protolib.functions->logging_flags( g_logging_flags );
 
 #if defined _DEBUG || defined _CRASH_HANDLER
@@ -1105,6 +1115,28 @@ unsigned long exec_task(data_data_s *d, unsigned long flags)
 
         }
         break;
+    case AQ_TRACE_DUMP:
+        {
+            struct collect
+            {
+                static void PROTOCALL append(void *prm, const char *json, int len)
+                {
+                    std::str_c &out = *(std::str_c *)prm;
+                    if (!out.is_empty())
+                        out.append(STD_ASTR(",\n"));
+                    out.append(std::asptr(json, len));
+                }
+            };
+
+            ipcr r(d->get_reader());
+            std::str_c json;
+            trace_json(json, r.getastr().as_sptr());
+            if (protolib.trace_json)
+                protolib.trace_json(collect::append, &json);
+
+            IPCW(HA_TRACE_DATA) << bytes(json.cstr(), json.get_length());
+        }
+        break;
     }
 
     d->die();
@@ -1225,7 +1257,8 @@ static void PROTOCALL av_data(contact_id_s gid, contact_id_s cid, const media_da
         int w;
         int h;
         u64 msmonotonic;
-        u64 padding;
+        int fmt; // VFMT_XRGB or VFMT_I420
+        int padding;
     };
 
     static_assert( sizeof(inf_s) == VIDEO_FRAME_HEADER_SIZE, "size!" );
@@ -1249,6 +1282,8 @@ static void PROTOCALL av_data(contact_id_s gid, contact_id_s cid, const media_da
                 d2s->w = data->vfmt.width;
                 d2s->h = data->vfmt.height;
                 d2s->msmonotonic = data->msmonotonic;
+                d2s->fmt = VFMT_XRGB;
+                d2s->padding = 0;
 
                 byte *body = (byte *)(d2s + 1);
 
@@ -1272,26 +1307,45 @@ static void PROTOCALL av_data(contact_id_s gid, contact_id_s cid, const media_da
             break;
         case VFMT_I420:
             {
-                int xrgb_sz = data->vfmt.width * data->vfmt.height * 4 + sizeof( data_header_s ) + sizeof(inf_s);
-                data_header_s *dh = (data_header_s *)ipcj->lock_buffer(xrgb_sz);
+                // planes are sent as is (tightly packed); application converts them directly to display size
+                int w = data->vfmt.width;
+                int h = data->vfmt.height;
+                int cw = (w + 1) / 2;
+                int ch = (h + 1) / 2;
+                int i420_sz = w * h + cw * ch * 2 + sizeof( data_header_s ) + sizeof(inf_s);
+                data_header_s *dh = (data_header_s *)ipcj->lock_buffer(i420_sz);
                 if (!dh) return;
                 inf_s *d2s = (inf_s *)(dh+1);
                 dh->cmd = HQ_VIDEO;
 
                 d2s->gid = gid;
                 d2s->cid = cid;
-                d2s->w = data->vfmt.width;
-                d2s->h = data->vfmt.height;
+                d2s->w = w;
+                d2s->h = h;
                 d2s->msmonotonic = data->msmonotonic;
+                d2s->fmt = VFMT_I420;
+                d2s->padding = 0;
 
                 byte *body = (byte *)(d2s + 1);
 
-                img_helper_i420_to_ARGB((const byte *)data->video_frame[0], data->vfmt.pitch[0],
-                                        (const byte *)data->video_frame[1], data->vfmt.pitch[1], 
-                                        (const byte *)data->video_frame[2], data->vfmt.pitch[2], 
-                                        body, data->vfmt.width * 4, data->vfmt.width, data->vfmt.height);
+                auto copy_plane = [&]( const void *plane, int pitch, int pw, int ph )
+                {
+                    const byte *dfrom = (const byte *)plane;
+                    if (pitch == pw)
+                    {
+                        memcpy(body, dfrom, pw * ph);
+                        body += pw * ph;
+                        return;
+                    }
+                    for (int t = 0; t < ph; ++t, body += pw, dfrom += pitch)
+                        memcpy(body, dfrom, pw);
+                };
+
+                copy_plane(data->video_frame[0], data->vfmt.pitch[0], w, h);
+                copy_plane(data->video_frame[1], data->vfmt.pitch[1], cw, ch);
+                copy_plane(data->video_frame[2], data->vfmt.pitch[2], cw, ch);
 
-                ipcj->unlock_send_buffer(dh, xrgb_sz);
+                ipcj->unlock_send_buffer(dh, i420_sz);
             }
             break;
         }
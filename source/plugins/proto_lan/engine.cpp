@@ -26,24 +26,35 @@ namespace
         // list of call-in-progress descriptos
         lan_engine::media_stuff_s *first = nullptr;
         lan_engine::media_stuff_s *last = nullptr;
+        int ncalls = 0;
 
-        bool video_encoder = false;
+        int video_encoders = 0; // running workers of video encoder pool
         bool video_encoder_heartbeat = false;
         volatile bool shutdown = false;
 
         bool senders() const
         {
-            return video_encoder;
+            return video_encoders > 0;
         }
 
         bool allow_run_video_encoder() const
         {
-            return !video_encoder && !shutdown;
+            // one worker per call; each call is encoded by one worker at a time
+            return video_encoders < min( ncalls, max( 1, cpu_count() - 1 ) ) && !shutdown;
+        }
+
+        bool in_list( const lan_engine::media_stuff_s *d ) const
+        {
+            for ( const lan_engine::media_stuff_s *dd = first; dd; dd = dd->next )
+                if ( dd == d )
+                    return true;
+            return false;
         }
     };
 }
 
 static spinlock::syncvar<av_sender_state_s> callstate;
+static media_signal_c video_signal; // new raw video frame to encode
 
 lan_engine::media_stuff_s::media_stuff_s( contact_s *owner ) :owner( owner )
 {
@@ -55,12 +66,14 @@ lan_engine::media_stuff_s::media_stuff_s( contact_s *owner ) :owner( owner )
 
     auto w = callstate.lock_write();
     LIST_ADD( this, w().first, w().last, prev, next );
+    ++w().ncalls;
 }
 
 lan_engine::media_stuff_s::~media_stuff_s()
 {
     auto w = callstate.lock_write();
     LIST_DEL( this, w().first, w().last, prev, next );
+    --w().ncalls;
 
     while ( locked > 0 ) // waiting unlock
     {
@@ -76,8 +89,7 @@ lan_engine::media_stuff_s::~media_stuff_s()
     if (audio_decoder)
         opus_decoder_destroy(audio_decoder);
 
-    if ( video_data )
-        engine->hf->free_video_data( video_data );
+    vqueue.clear( []( const void *vd ) { engine->hf->free_video_data( vd ); } );
 
     if ( enc_cfg.g_w ) vpx_codec_destroy( &v_encoder );
     if ( decoder ) vpx_codec_destroy( &v_decoder );
@@ -173,6 +185,7 @@ void lan_engine::media_stuff_s::encode_video_and_send( u64 msmonotonic, const by
         vcodec = engine->use_vcodec;
         enc_cfg.g_w = video_w;
         enc_cfg.g_h = video_h;
+        enc_cfg.g_threads = video_encoder_threads( video_w, video_h );
         enc_cfg.rc_target_bitrate = (vbitrate ? vbitrate : DEFAULT_VIDEO_BITRATE);
 
         if ( vpx_codec_enc_init( &v_encoder, vcodec == vc_vp8 ? VIDEO_CODEC_ENCODER_INTERFACE_VP8 : VIDEO_CODEC_ENCODER_INTERFACE_VP9, &enc_cfg, 0 ) != VPX_CODEC_OK )
@@ -180,6 +193,14 @@ void lan_engine::media_stuff_s::encode_video_and_send( u64 msmonotonic, const by
             enc_cfg.g_w = 0;
             return;
         }
+
+        if ( vcodec != vc_vp8 && enc_cfg.g_threads > 1 )
+        {
+            vpx_codec_control( &v_encoder, VP9E_SET_TILE_COLUMNS, video_encoder_tile_columns_log2( video_w, enc_cfg.g_threads ) );
+#ifdef VPX_CTRL_VP9E_SET_ROW_MT
+            vpx_codec_control( &v_encoder, VP9E_SET_ROW_MT, 1 );
+#endif
+        }
     }
 
     if ( vquality != engine->use_vquality )
@@ -222,7 +243,11 @@ void lan_engine::media_stuff_s::encode_video_and_send( u64 msmonotonic, const by
         video_w, video_h, 8, video_w, video_h, 0, 0, 1, 1,
         (byte *)y, (byte *)u, (byte *)v, nullptr, (int)video_w, (int)video_w / 2, (int)video_w / 2, (int)video_w, 12 };
 
-    int vrc = vpx_codec_encode( &v_encoder, &img, frame_counter, 1, 0, /*MAX_ENCODE_TIME_US*/ 0 );
+    int vrc;
+    {
+        TRACE_SPAN( "video.encode" );
+        vrc = vpx_codec_encode( &v_encoder, &img, frame_counter, 1, 0, /*MAX_ENCODE_TIME_US*/ 0 );
+    }
     if ( vrc != VPX_CODEC_OK ) return;
 
     vpx_codec_iter_t iter = nullptr;
@@ -258,6 +283,7 @@ void lan_engine::media_stuff_s::video_frame( u64 msmonotonic, int /*framen*/, co
         decoder = true;
     }
 
+    TRACE_SPAN( "video.decode" );
     if ( VPX_CODEC_OK == vpx_codec_decode( &v_decoder, frame_data, framesize, nullptr, 0 ) )
     {
         vpx_codec_iter_t iter = nullptr;
@@ -337,6 +363,7 @@ void lan_engine::media_stuff_s::add_audio( u64 msmonotonic, const void *data, in
 
 int lan_engine::media_stuff_s::encode_audio(byte *dest, aint dest_max, const void *uncompressed_frame, aint frame_size)
 {
+    TRACE_SPAN( "audio.encode" );
     if (audio_encoder)
         return opus_encode(audio_encoder, (opus_int16 *)uncompressed_frame, (int)frame_size, dest, (int)dest_max);
 
@@ -404,7 +431,10 @@ int lan_engine::media_stuff_s::decode_audio( const void *data, int datasize )
     int dec_size = frames * AUDIO_CHANNELS * AUDIO_BITS / 8;
     if ((int)uncompressed.size() < dec_size) uncompressed.resize(dec_size);
 
-    rc = opus_decode(audio_decoder, (const byte *)data, datasize, (opus_int16 *)uncompressed.data(), frames, 0);
+    {
+        TRACE_SPAN( "audio.decode" );
+        rc = opus_decode(audio_decoder, (const byte *)data, datasize, (opus_int16 *)uncompressed.data(), frames, 0);
+    }
     if (rc > 0)
     {
         return rc * AUDIO_CHANNELS * AUDIO_BITS / 8;
@@ -957,19 +987,17 @@ void datablock_s::die()
     dlfree(this);
 }
 
-void lan_engine::video_encoder()
+void lan_engine::video_encoder() // worker of video encoder pool; see contact_s::start_media
 {
-    callstate.lock_write()( ).video_encoder = true;
-
-    int sleepms = 100;
+    int waitms = 100;
     int timeoutcountdown = 50; // 5 sec
-    for ( ;; Sleep( sleepms ) )
+    for ( ;; video_signal.wait( waitms ) )
     {
         auto w = callstate.lock_write();
         w().video_encoder_heartbeat = true;
         if ( w().shutdown )
         {
-            w().video_encoder = false;
+            --w().video_encoders;
             return;
         }
         if ( nullptr == w().first )
@@ -977,49 +1005,80 @@ void lan_engine::video_encoder()
             --timeoutcountdown;
             if ( timeoutcountdown <= 0 )
             {
-                w().video_encoder = false;
+                --w().video_encoders;
                 return;
             }
-            sleepms = 100;
+            waitms = 100;
             continue;
         }
+        if ( w().video_encoders > w().ncalls )
+        {
+            // too many workers for current calls
+            --w().video_encoders;
+            w.unlock();
+            video_signal.signal(); // pass wakeup to other worker
+            return;
+        }
+        w.unlock();
         timeoutcountdown = 50;
-        sleepms = 1;
-        for ( lan_engine::media_stuff_s *d = w().first; d; d = d->next )
+        waitms = 100; // sleep till new frame
+
+        auto r = callstate.lock_read();
+        for ( lan_engine::media_stuff_s *d = r().first; d; d = d->next )
         {
-            if ( nullptr == d->video_data )
+            video_frame_queue_s::frame_s f;
+            if ( !d->vqueue.take( f ) )
                 continue;
 
-            u64 timelabel = d->v_msmonotonic;
-            const uint8_t *y = (const uint8_t *)d->video_data;
-            d->video_data = nullptr;
-            d->v_msmonotonic = 0;
+            // other calls have frames too? wake up another worker to encode them in parallel
+            for ( const media_stuff_s *dd = d->next; dd; dd = dd->next )
+                if ( dd->vqueue.ready() )
+                {
+                    video_signal.signal();
+                    break;
+                }
 
-            ++d->locked;
-            w.unlock(); // no need lock anymore
+            spinlock::increment( d->locked );
+            r.unlock(); // no need lock anymore
 
-                        // encoding here
-            int ysz = d->video_w * d->video_h;
-                
-            d->encode_video_and_send( timelabel, y, y + ysz, y + ( ysz + ysz / 4 ) );
+            u64 t0 = time_us();
+
+            // encoding here
+            const uint8_t *y = (const uint8_t *)f.data;
+            int ysz = f.w * f.h;
+            d->video_w = f.w;
+            d->video_h = f.h;
+            d->encode_video_and_send( f.msmonotonic, y, y + ysz, y + ( ysz + ysz / 4 ) );
             engine->hf->free_video_data( y );
 
-            w = callstate.lock_write();
-            --d->locked;
-            if ( w().shutdown )
-                return;
+            video_frame_queue_s::tlm_s tlm;
+            bool more;
+            if ( d->vqueue.done( time_us() - t0, tlm, more ) )
+            {
+                tlm_data_s d1 = { static_cast<u64>( d->owner->id.id ), static_cast<u64>( tlm.encode_us ) };
+                if ( IS_TLM( TLM_VIDEO_ENCODE_TIME ) )
+                    engine->hf->telemetry( TLM_VIDEO_ENCODE_TIME, &d1, sizeof( d1 ) );
+                d1.sz = static_cast<u64>( tlm.depth );
+                if ( IS_TLM( TLM_VIDEO_ENCODE_QUEUE ) )
+                    engine->hf->telemetry( TLM_VIDEO_ENCODE_QUEUE, &d1, sizeof( d1 ) );
+                d1.sz = static_cast<u64>( tlm.dropped );
+                if ( IS_TLM( TLM_VIDEO_DROPPED_FRAMES ) )
+                    engine->hf->telemetry( TLM_VIDEO_DROPPED_FRAMES, &d1, sizeof( d1 ) );
+            }
+            if ( more )
+                waitms = 0; // next frame of this call is already here
 
-            bool ok = false;
-            for ( media_stuff_s *dd = w().first; dd; dd = dd->next )
-                if ( dd == d )
-                {
-                    ok = true;
-                    break;
-                }
-            if ( !ok ) break;
+            r = callstate.lock_read();
+            spinlock::decrement( d->locked );
+            if ( r().shutdown )
+                break;
 
+            if ( !r().in_list( d ) )
+            {
+                waitms = 0; // call list changed; rescan
+                break;
+            }
         }
-        if ( w.is_locked() ) w.unlock();
     }
 }
 
@@ -1966,6 +2025,7 @@ void lan_engine::stop_encoder()
     while ( callstate.lock_read()( ).senders() )
     {
         callstate.lock_write()( ).shutdown = true;
+        video_signal.signal();
 
         Sleep( 1 );
 
@@ -1976,7 +2036,7 @@ void lan_engine::stop_encoder()
             auto w = callstate.lock_write();
 
             if ( !w().video_encoder_heartbeat )
-                w().video_encoder = false, fatal_error = true;
+                w().video_encoders = 0, fatal_error = true;
             w().video_encoder_heartbeat = false;
 
             st = time_ms();
@@ -2650,14 +2710,10 @@ int lan_engine::send_av(contact_id_s id, const call_prm_s * ci)
 
         if ( 0 != ( c->media->remote_so.options & SO_RECEIVING_VIDEO ) )
         {
-            if ( c->media->video_data )
-                engine->hf->free_video_data( c->media->video_data );
-
-            c->media->video_w = ci->w;
-            c->media->video_h = ci->h;
-            c->media->video_data = ci->video_data;
-            c->media->v_msmonotonic = ci->ms_monotonic;
+            if ( const void *stale = c->media->vqueue.push( ci->video_data, ci->ms_monotonic, ci->w, ci->h ) )
+                engine->hf->free_video_data( stale );
 
+            video_signal.signal();
             return SEND_AV_KEEP_VIDEO_DATA;
         }
 
@@ -2778,9 +2834,11 @@ void lan_engine::contact_s::online_tick(int ct, int nexttime)
 
 static DWORD WINAPI video_encoder_thread( LPVOID )
 {
+    trace_thread_name( "lan video encoder" );
     UNSTABLE_CODE_PROLOG
     lan_engine::get()->video_encoder();
     UNSTABLE_CODE_EPILOG
+    trace_thread_end(); // workers come and go with calls; ring goes to next thread
     return 0;
 }
 
@@ -2796,10 +2854,22 @@ void lan_engine::contact_s::start_media()
 
     send_block( BT_STREAM_OPTIONS, 0, &so2s, sizeof( so2s ) );
 
-    if ( callstate.lock_read()( ).allow_run_video_encoder() )
+    // grow video encoder pool up to number of calls
+    for (;;)
     {
-        CloseHandle( CreateThread( nullptr, 0, video_encoder_thread, nullptr, 0, nullptr ) );
-        for ( ; !callstate.lock_read()( ).video_encoder; Sleep( 1 ) ); // wait video encoder start
+        auto w = callstate.lock_write();
+        if ( !w().allow_run_video_encoder() )
+            break;
+        ++w().video_encoders; // worker slot reserved here, worker releases it on exit
+        w.unlock();
+
+        HANDLE h = CreateThread( nullptr, 0, video_encoder_thread, nullptr, 0, nullptr );
+        if ( !h )
+        {
+            --callstate.lock_write()( ).video_encoders;
+            break;
+        }
+        CloseHandle( h );
     }
 
 }
@@ -3599,8 +3669,6 @@ lan_engine::transmitting_file_s::transmitting_file_s(contact_s *to_contact, u64
         engine->hf->file_control(utag, FIC_UNPAUSE);
 }
 
-DELTA_TIME_PROFILER(xxx, 1024);
-
 bool lan_engine::transmitting_file_s::ready_chunk_s::set(const file_portion_prm_s *fp)
 {
     if (nullptr == buf && fp->offset == offset)
@@ -3661,8 +3729,6 @@ bool lan_engine::transmitting_file_s::fresh_file_portion(const file_portion_prm_
     {
         if (c->state == contact_s::ONLINE)
         {
-            DELTA_TIME_CHECKPOINT(xxx);
-
             ASSERT( fp->size == FILE_TRANSFER_CHUNK || (fp->offset + fp->size) == fsz );
 
             if ( rch[0].set(fp) )
@@ -384,10 +384,9 @@ public:
         u64 sblock = 0;
         datablock_s *nblock = nullptr;
 
-        u64 v_msmonotonic = 0; // current video frame
         u64 a_msmonotonic = 0; // at begining of fifo buffer
         u64 a_msmonotonic_compressed = 0;
-        const void *video_data = nullptr;
+        video_frame_queue_s vqueue; // raw frames for encoder pool
         OpusDecoder *audio_decoder = nullptr;
         OpusEncoder *audio_encoder = nullptr;
         fifo_stream_c enc_fifo;
@@ -401,13 +400,13 @@ public:
         vpx_codec_enc_cfg_t enc_cfg;
         vpx_codec_dec_cfg_t cfg_dec;
 
-        int locked = 0; // locked in encoder
+        spinlock::long3264 locked = 0; // number of encoder pool workers working with it
 
         video_codec_e vcodec = vc_vp8;
         video_codec_e vdecodec = vc_vp8;
         int vbitrate = 0;
         int vquality = -1;
-        uint32_t video_w = 0;
+        uint32_t video_w = 0; // size of frame being encoded
         uint32_t video_h = 0;
         uint32_t frame_counter = 0;
 
@@ -210,6 +210,7 @@ void xxx::leave_conference(contact_id_s gid, int keep_leave)
 }
 void xxx::logging_flags(unsigned int f)
 {
+    g_logging_flags = f;
 }
 void xxx::proto_file(i32, const file_portion_prm_s *)
 {
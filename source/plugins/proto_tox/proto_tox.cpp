@@ -111,9 +111,10 @@
     ASI( video_bitrate ) \
     ASI( video_quality ) \
     ASI( video_limit ) \
+    ASI( video_telemetry ) \
 
 
-#define ADVSETSTRING "listen_port:int:0/allow_hole_punch:bool:1/allow_local_discovery:bool:1/restart_on_zero_online:bool:0/nodes_list_file:file/pinned_list_file:file/disable_video_ex:bool:0/video_codec:enum(vp8,vp9):0/video_bitrate:int:0/video_quality:int:0/video_limit:int:0"
+#define ADVSETSTRING "listen_port:int:0/allow_hole_punch:bool:1/allow_local_discovery:bool:1/restart_on_zero_online:bool:0/nodes_list_file:file/pinned_list_file:file/disable_video_ex:bool:0/video_codec:enum(vp8,vp9):0/video_bitrate:int:0/video_quality:int:0/video_limit:int:0/video_telemetry:bool:0"
 
 enum advset_e
 {
@@ -158,6 +159,7 @@ enum chunks_e // HARD ORDER!!! DO NOT MODIFY EXIST VALUES!!!
     chunk_nodes_list_fn,
     chunk_pinned_list_fn,
     chunk_video_limit,
+    chunk_video_telemetry,
 
 
     chunk_nodes = 101,
@@ -662,8 +664,10 @@ struct av_sender_state_s
     // list of call-in-progress descriptors
     contact_descriptor_s *first = nullptr;
     contact_descriptor_s *last = nullptr;
+    int ncalls = 0;
 
-    bool video_encoder = false;
+    int video_encoders = 0; // running workers of video encoder pool
+    int video_encoders_gen = 0; // workers of older generation are abandoned by watchdog and do not touch video_encoders
     bool audio_encoder = false;
     bool av_sender = false;
     bool video_encoder_heartbeat = false;
@@ -673,7 +677,7 @@ struct av_sender_state_s
 
     bool senders() const
     {
-        return audio_encoder || audio_encoder || av_sender;
+        return audio_encoder || video_encoders > 0 || av_sender;
     }
 
     bool allow_run_audio_encoder() const
@@ -682,16 +686,19 @@ struct av_sender_state_s
     }
     bool allow_run_video_encoder() const
     {
-        return !video_encoder && !shutdown;
+        // one worker per call; each call is encoded by one worker at a time
+        return video_encoders < min(ncalls, max(1, cpu_count() - 1)) && !shutdown;
     }
     bool allow_run_av_sender() const
     {
         return !av_sender && !shutdown;
     }
+
+    bool in_list(const contact_descriptor_s *d) const;
 };
 
 static void audio_encoder();
-static void video_encoder();
+static void video_encoder(int gen);
 static void av_sender();
 static void delete_all_descs();
 
@@ -733,27 +740,34 @@ class tox_c
         other_typing_s(fid_s fid, int time) :fid(fid), time(time), totaltime(time) {}
     };
 
+    // media threads are created per call, so they must release trace ring at exit
     static DWORD WINAPI audio_encoder_thread(LPVOID)
     {
+        trace_thread_name( "tox audio encoder" );
         UNSTABLE_CODE_PROLOG
             audio_encoder();
         UNSTABLE_CODE_EPILOG
+            trace_thread_end();
             return 0;
     }
 
-    static DWORD WINAPI video_encoder_thread(LPVOID)
+    static DWORD WINAPI video_encoder_thread(LPVOID gen)
     {
+        trace_thread_name( "tox video encoder" );
         UNSTABLE_CODE_PROLOG
-            video_encoder();
+            video_encoder(static_cast<int>(reinterpret_cast<size_t>(gen)));
         UNSTABLE_CODE_EPILOG
+            trace_thread_end();
             return 0;
     }
 
     static DWORD WINAPI av_sender_thread(LPVOID)
     {
+        trace_thread_name( "tox av sender" );
         UNSTABLE_CODE_PROLOG
             av_sender();
         UNSTABLE_CODE_EPILOG
+            trace_thread_end();
             return 0;
     }
 
@@ -885,6 +899,11 @@ public:
 
     spinlock::syncvar<av_sender_state_s> callstate;
 
+    // media threads sleep on these signals instead of polling call list
+    media_signal_c audio_signal; // some call's fifo has full audio frame
+    media_signal_c video_signal; // new raw video frame to encode
+    media_signal_c sender_signal; // encoded audio packet or video frame ready to send
+
     std::vector<other_typing_s> other_typing;
     std::vector<tox3dns_s> pinnedservs;
 
@@ -906,6 +925,8 @@ public:
     int video_bitrate = 0;
     int video_quality = 0;
     int video_limit = 0; // in bytes per second
+    int tlmflags = 0;
+#define IS_TLM( t ) (0!=(cl.tlmflags & ( 1 << t )))
 
     int next_check_accept_nodes_time = 0;
     int accepted_nodes = 0;
@@ -1047,12 +1068,6 @@ public:
             for (; !callstate.lock_read()().audio_encoder; Sleep(1)); // wait audio sender start
         }
 
-        if (callstate.lock_read()().allow_run_video_encoder())
-        {
-            CloseHandle(CreateThread(nullptr, 0, video_encoder_thread, nullptr, 0, nullptr));
-            for (; !callstate.lock_read()().video_encoder; Sleep(1)); // wait video encoder start
-        }
-
         if (callstate.lock_read()().allow_run_av_sender())
         {
             CloseHandle(CreateThread(nullptr, 0, av_sender_thread, nullptr, 0, nullptr));
@@ -1060,6 +1075,29 @@ public:
         }
     }
 
+    void run_video_encoders() // grow video encoder pool up to number of calls
+    {
+        for (;;)
+        {
+            auto w = callstate.lock_write();
+            if (!w().allow_run_video_encoder())
+                break;
+            ++w().video_encoders; // worker slot reserved here, worker releases it on exit
+            int gen = w().video_encoders_gen;
+            w.unlock();
+
+            HANDLE h = CreateThread(nullptr, 0, video_encoder_thread, reinterpret_cast<LPVOID>(static_cast<size_t>(gen)), 0, nullptr);
+            if (!h)
+            {
+                auto wf = callstate.lock_write();
+                if (wf().video_encoders_gen == gen)
+                    --wf().video_encoders;
+                break;
+            }
+            CloseHandle(h);
+        }
+    }
+
     void stop_senders()
     {
         int st = time_ms();
@@ -1073,6 +1111,9 @@ public:
         while (callstate.lock_read()().senders())
         {
             callstate.lock_write()().shutdown = true;
+            audio_signal.signal();
+            video_signal.signal();
+            sender_signal.signal();
 
             Sleep(1);
 
@@ -1086,7 +1127,10 @@ public:
                 w().audio_encoder_heartbeat = false;
 
                 if (!w().video_encoder_heartbeat)
-                    w().video_encoder = false, restart_module = true;
+                {
+                    // hung workers can't be killed; abandon them: they exit without touching new pool counter
+                    w().video_encoders = 0, ++w().video_encoders_gen, restart_module = true;
+                }
                 w().video_encoder_heartbeat = false;
 
                 if (!w().av_sender_heartbeat)
@@ -1445,6 +1489,16 @@ public:
         ADVCHANGE(video_limit, val.as_int());
     }
 
+    std::string adv_get_video_telemetry()
+    {
+        std::string s(tlmflags ? STD_ASTR("1") : STD_ASTR("0"));
+        return s;
+    }
+    void adv_set_video_telemetry(const std::pstr_c &val)
+    {
+        ADVCHANGE(tlmflags, val.as_int() != 0 ? -1 : 0);
+    }
+
     void send_configurable()
     {
         static const int copts = 4;
@@ -1583,14 +1637,43 @@ void tox_address_c::setup_public_key(fid_s fid)
 struct stream_settings_s : public audio_format_s
 {
     fifo_stream_c fifo;
-    int next_time_send = 0;
-    int video_w = 0, video_h = 0;
-    const void *video_data = nullptr;
+    int next_time_send = 0; // audio frame deadline; frames are sent at fixed rate regardless of thread wakeup time
+    video_frame_queue_s vqueue; // raw frames for encoder pool
     u64 audio_timestamp = 0; // ms timestamp of begin of fifo
-    u64 video_timestamp = 0;
-    int locked = 0;
+    spinlock::long3264 sync = 0; // fifo; callstate lock is not required to access it
+    spinlock::long3264 locked = 0; // number of media threads working with call outside callstate lock
     bool processing = false;
 
+    // true - audio frame should be sent right now
+    // false - not yet; waitms decreased to time of frame deadline (if frame is ready)
+    bool audio_frame_due(aint avsize, int ct, int &waitms)
+    {
+        if (avsize == 0)
+        {
+            processing = false;
+            return false;
+        }
+
+        int req_frame_size = avgBytesPerMSecs(AUDIO_FRAME_DURATION);
+        if (req_frame_size > avsize)
+            return false; // not yet; producer will signal
+
+        if (!processing && (req_frame_size * 3) > avsize)
+            return false; // prebuffering
+
+        int till = next_time_send - ct;
+        if (till > 0 && till <= AUDIO_FRAME_DURATION)
+        {
+            if (till < waitms) waitms = till;
+            return false;
+        }
+
+        processing = true;
+        next_time_send += AUDIO_FRAME_DURATION;
+        if ((next_time_send - ct) < 0) next_time_send = ct + AUDIO_FRAME_DURATION / 2;
+        return true;
+    }
+
     stream_settings_s()
     {
     }
@@ -3013,6 +3096,7 @@ public:
 
             uint8_t *dest = (uint8_t *)(fd + 1);
 
+            TRACE_SPAN( "audio.encode" );
             fd->plen = opus_encode(a_encoder, (opus_int16 *)pcm, (int)sample_count, dest+headersize, TOX_MAX_CUSTOM_PACKET_SIZE - headersize) + headersize;
             *dest = PACKETID_AUDIO_EX;
             for (int i = 1; i < headersize; ++i) // TODO msmonotonic
@@ -3026,6 +3110,7 @@ public:
                     free(fd);
                 readypacketscount = 0; // drop all pakets
             }
+            cl.sender_signal.signal();
         }
 
         void isotoxin_video_send_frame(u64 timestamp, int fid, unsigned int width, unsigned int height, const byte *y, const byte *u, const byte *v)
@@ -3089,6 +3174,7 @@ public:
                 encoder_vp8 = !cl.use_vp9_codec;
                 enc_cfg.g_w = width;
                 enc_cfg.g_h = height;
+                enc_cfg.g_threads = video_encoder_threads(width, height);
                 enc_cfg.rc_target_bitrate = (vbitrate ? vbitrate : DEFAULT_VIDEO_BITRATE);
 
                 if (vpx_codec_enc_init(&v_encoder, encoder_vp8 ? VIDEO_CODEC_ENCODER_INTERFACE_VP8 : VIDEO_CODEC_ENCODER_INTERFACE_VP9, &enc_cfg, 0) != VPX_CODEC_OK)
@@ -3096,6 +3182,14 @@ public:
                     enc_cfg.g_w = 0;
                     return;
                 }
+
+                if (!encoder_vp8 && enc_cfg.g_threads > 1)
+                {
+                    vpx_codec_control(&v_encoder, VP9E_SET_TILE_COLUMNS, video_encoder_tile_columns_log2(width, enc_cfg.g_threads));
+#ifdef VPX_CTRL_VP9E_SET_ROW_MT
+                    vpx_codec_control(&v_encoder, VP9E_SET_ROW_MT, 1);
+#endif
+                }
             }
 
             if (vquality != cl.video_quality)
@@ -3134,7 +3228,11 @@ public:
                 width, height, 8, width, height, 0, 0, 1, 1,
                 (byte *)y, (byte *)u, (byte *)v, nullptr, (int)width, (int)width / 2, (int)width / 2, (int)width, 12 };
 
-            int vrc = vpx_codec_encode(&v_encoder, &img, frame_counter, 1, 0, /*MAX_ENCODE_TIME_US*/ 0);
+            int vrc;
+            {
+                TRACE_SPAN( "video.encode" );
+                vrc = vpx_codec_encode(&v_encoder, &img, frame_counter, 1, 0, /*MAX_ENCODE_TIME_US*/ 0);
+            }
             if (vrc != VPX_CODEC_OK) return;
 
             vpx_codec_iter_t iter = nullptr;
@@ -3237,6 +3335,8 @@ public:
 
             if (VPX_FRAME_IS_INVISIBLE & f)
                 __debugbreak();
+
+            cl.sender_signal.signal();
         }
 
         int current_recv_frame = -1;
@@ -3255,7 +3355,10 @@ public:
 
             const int headersize = sizeof(uint64_t);
 
-            rc = opus_decode(a_decoder, (const byte *)d + headersize, (int)dsz - headersize, (opus_int16 *)buffer, 60 * 48, 0);
+            {
+                TRACE_SPAN( "audio.decode" );
+                rc = opus_decode(a_decoder, (const byte *)d + headersize, (int)dsz - headersize, (opus_int16 *)buffer, 60 * 48, 0);
+            }
             if (rc > 0)
             {
                 media_data_s mdt;
@@ -3352,6 +3455,7 @@ public:
                 is_v_decoder = true;
             }
 
+            TRACE_SPAN( "video.decode" );
             if (VPX_CODEC_OK == vpx_codec_decode(&v_decoder, framebody.data(), static_cast<unsigned int>(framebody.size()), nullptr, 0))
             {
                 vpx_codec_iter_t iter = nullptr;
@@ -3401,6 +3505,7 @@ public:
         {
             auto w = cl.callstate.lock_write();
             LIST_DEL(this, w().first, w().last, prev_call, next_call);
+            --w().ncalls;
 
             while(cip->local_settings.locked > 0) // waiting unlock
             {
@@ -3409,8 +3514,7 @@ public:
                 w = cl.callstate.lock_write();
             }
 
-            if (cip->local_settings.video_data)
-                cl.hf->free_video_data(cip->local_settings.video_data);
+            cip->local_settings.vqueue.clear([](const void *vd) { cl.hf->free_video_data(vd); });
 
             delete cip;
             cip = nullptr;
@@ -3754,6 +3858,18 @@ void tox_c::add_to_callstate(contact_descriptor_s *d)
 {
     auto w = callstate.lock_write();
     LIST_ADD(d, w().first, w().last, prev_call, next_call);
+    ++w().ncalls;
+    w.unlock();
+
+    run_video_encoders();
+}
+
+bool av_sender_state_s::in_list(const contact_descriptor_s *d) const
+{
+    for (const contact_descriptor_s *dd = first; dd; dd = dd->next_call)
+        if (dd == d)
+            return true;
+    return false;
 }
 
 
@@ -3907,6 +4023,8 @@ void contact_descriptor_s::die()
     {
         auto w = cl.callstate.lock_write();
         LIST_DEL(this, w().first, w().last, prev_call, next_call);
+        --w().ncalls;
+        cip->local_settings.vqueue.clear([](const void *vd) { cl.hf->free_video_data(vd); });
         delete cip;
         cip = nullptr;
         if (cl.tox && !is_conference())
@@ -5179,19 +5297,20 @@ static void cb_toxav_video(ToxAV *av, uint32_t tox_fid, uint16_t width,
 static void audio_encoder()
 {
     cl.callstate.lock_write()().audio_encoder = true;
+    timeBeginPeriod(1); // frame deadlines need ms precision of waits
 
     byte_buffer prebuffer; // just ones allocated buffer for raw audio
-    
-    int sleepms = 100;
+
+    int waitms = 100;
     int timeoutcountdown = 50; // 5 sec
-    for( ;; Sleep(sleepms))
+    for (;; cl.audio_signal.wait(waitms))
     {
         auto w = cl.callstate.lock_write();
         w().audio_encoder_heartbeat = true;
         if (w().shutdown)
         {
             w().audio_encoder = false;
-            return;
+            break;
         }
         if (nullptr == w().first)
         {
@@ -5199,52 +5318,44 @@ static void audio_encoder()
             if (timeoutcountdown <= 0)
             {
                 w().audio_encoder = false;
-                return;
+                break;
             }
-            sleepms = 100;
+            waitms = 100;
             continue;
         }
+        w.unlock();
         timeoutcountdown = 50;
-        sleepms = 1;
+        waitms = 100; // nothing ready - sleep till fifo signal
+
+        auto r = cl.callstate.lock_read();
         int ct = time_ms();
 
-        for(contact_descriptor_s *d = w().first;d;d=d->next_call)
+        for (contact_descriptor_s *d = r().first; d; d = d->next_call)
         {
-            bool audio_ex = d->cip->is_audio_ex();
-
             stream_settings_s &ss = d->cip->local_settings;
-            aint avsize = ss.fifo.available();
-            if (avsize == 0)
-            {
-                ss.processing = false;
-                continue;
-            }
-
-            if ((ss.next_time_send - ct) > 0 && (ss.next_time_send - ct) <= AUDIO_FRAME_DURATION)
-                continue;
-
             audio_format_s fmt = ss;
             int req_frame_size = fmt.avgBytesPerMSecs(AUDIO_FRAME_DURATION);
-            if (req_frame_size > avsize) 
-                continue; // not yet
+            aint samples;
+            {
+                SIMPLELOCK(ss.sync);
+                if (!ss.audio_frame_due(ss.fifo.available(), ct, waitms))
+                    continue;
 
-            if (!ss.processing && (req_frame_size * 3) > avsize)
-                continue;
+                if (req_frame_size > (int)prebuffer.size()) prebuffer.resize(req_frame_size);
+                samples = ss.fifo.read_data(prebuffer.data(), req_frame_size) / fmt.sampleSize();
+            }
 
-            ss.processing = true;
-            ss.next_time_send += AUDIO_FRAME_DURATION;
-            if ((ss.next_time_send - ct) < 0) ss.next_time_send = ct + AUDIO_FRAME_DURATION /2;
+            int till = ss.next_time_send - ct;
+            if (till < waitms) waitms = till; // next frame of this call may be ready already
 
-            if (req_frame_size >(int)prebuffer.size()) prebuffer.resize(req_frame_size);
-            aint samples = ss.fifo.read_data(prebuffer.data(), req_frame_size) / fmt.sampleSize();
             int remote_so = d->cip->remote_so.options;
-
             if (0 == (remote_so & SO_RECEIVING_AUDIO))
                 continue;
 
+            bool audio_ex = d->cip->is_audio_ex();
             fid_s fid = d->get_fid();
-            ++ss.locked;
-            w.unlock(); // no need lock anymore
+            spinlock::increment(ss.locked);
+            r.unlock(); // no need lock anymore
 
             ASSERT( fmt.bits == 16 );
 
@@ -5263,42 +5374,40 @@ static void audio_encoder()
                 else
                 {
 
+                    TRACE_SPAN( "toxav.audio_send" );
                     toxav_audio_send_frame(cl.toxav, fid.normal(), (int16_t *)prebuffer.data(), (int)samples, (byte)fmt.channels, fmt.sample_rate, nullptr);
                 }
 
             }
-            w = cl.callstate.lock_write();
-            --ss.locked;
-            if (w().shutdown)
-                return;
-
-            bool ok = false;
-            for (contact_descriptor_s *dd = w().first; dd; dd = dd->next_call)
-                if (dd == d)
-                {
-                    ok = true;
-                    break;
-                }
-            if (!ok) break;
+            r = cl.callstate.lock_read();
+            spinlock::decrement(ss.locked);
+            if (r().shutdown)
+                break;
 
+            if (!r().in_list(d))
+            {
+                waitms = 0; // call list changed; rescan
+                break;
+            }
         }
-        if (w.is_locked()) w.unlock();
     }
+
+    timeEndPeriod(1);
 }
 
-static void video_encoder()
+static void video_encoder(int gen) // worker of video encoder pool; see tox_c::run_video_encoders
 {
-    cl.callstate.lock_write()().video_encoder = true;
-
-    int sleepms = 100;
+    int waitms = 100;
     int timeoutcountdown = 50; // 5 sec
-    for (;; Sleep(sleepms))
+    for (;; cl.video_signal.wait(waitms))
     {
         auto w = cl.callstate.lock_write();
+        if (w().video_encoders_gen != gen)
+            return; // abandoned by watchdog (see tox_c::stop_senders); slot is already released
         w().video_encoder_heartbeat = true;
         if (w().shutdown)
         {
-            w().video_encoder = false;
+            --w().video_encoders;
             return;
         }
         if (nullptr == w().first)
@@ -5306,236 +5415,370 @@ static void video_encoder()
             --timeoutcountdown;
             if (timeoutcountdown <= 0)
             {
-                w().video_encoder = false;
+                --w().video_encoders;
                 return;
             }
-            sleepms = 100;
+            waitms = 100;
             continue;
         }
+        if (w().video_encoders > w().ncalls)
+        {
+            // too many workers for current calls
+            --w().video_encoders;
+            w.unlock();
+            cl.video_signal.signal(); // pass wakeup to other worker
+            return;
+        }
+        w.unlock();
         timeoutcountdown = 50;
-        sleepms = 1;
-        for (contact_descriptor_s *d = w().first; d; d = d->next_call)
+        waitms = 100; // sleep till new frame
+
+        auto r = cl.callstate.lock_read();
+        for (contact_descriptor_s *d = r().first; d; d = d->next_call)
         {
             stream_settings_s &ss = d->cip->local_settings;
-            
-            if (nullptr == ss.video_data)
+
+            video_frame_queue_s::frame_s f;
+            if (!ss.vqueue.take(f))
                 continue;
 
+            // other calls have frames too? wake up another worker to encode them in parallel
+            for (const contact_descriptor_s *dd = d->next_call; dd; dd = dd->next_call)
+                if (dd->cip->local_settings.vqueue.ready())
+                {
+                    cl.video_signal.signal();
+                    break;
+                }
+
             bool video_ex = d->cip->is_video_ex();
             fid_s fid = d->get_fid();
-            const uint8_t *y = (const uint8_t *)ss.video_data;
-            u64 timestamp = ss.video_timestamp;
-            ss.video_data = nullptr;
-            ss.video_timestamp = 0;
+            contact_id_s cid = d->get_id(true);
+
+            spinlock::increment(ss.locked);
+            r.unlock(); // no need lock anymore
 
-            ++ss.locked;
-            w.unlock(); // no need lock anymore
+            u64 t0 = time_us();
 
             // encoding here
-            int ysz = ss.video_w * ss.video_h;
+            const uint8_t *y = (const uint8_t *)f.data;
+            int ysz = f.w * f.h;
             if (video_ex && d->cip->vquality >= 0)
             {
                 // isotoxin video ex transfer
-                d->cip->isotoxin_video_send_frame(timestamp, fid.normal(), ss.video_w, ss.video_h, y, y + ysz, y + (ysz + ysz / 4));
-            
+                d->cip->isotoxin_video_send_frame(f.msmonotonic, fid.normal(), f.w, f.h, y, y + ysz, y + (ysz + ysz / 4));
+
             } else
             {
                 // toxcore video transfer
-                toxav_video_send_frame(cl.toxav, fid.normal(), (uint16_t)ss.video_w, (uint16_t)ss.video_h, y, y + ysz, y + (ysz + ysz / 4), nullptr);
+                TRACE_SPAN( "toxav.video_send" ); // encodes
+                toxav_video_send_frame(cl.toxav, fid.normal(), (uint16_t)f.w, (uint16_t)f.h, y, y + ysz, y + (ysz + ysz / 4), nullptr);
                 d->cip->vquality = cl.video_quality;
             }
             cl.hf->free_video_data(y);
 
-            w = cl.callstate.lock_write();
-            --ss.locked;
-            if (w().shutdown)
-                return;
+            video_frame_queue_s::tlm_s tlm;
+            bool more;
+            if (ss.vqueue.done(time_us() - t0, tlm, more))
+            {
+                tlm_data_s d1 = { static_cast<u64>(cid.id), static_cast<u64>(tlm.encode_us) };
+                if (IS_TLM(TLM_VIDEO_ENCODE_TIME))
+                    cl.hf->telemetry(TLM_VIDEO_ENCODE_TIME, &d1, sizeof(d1));
+                d1.sz = static_cast<u64>(tlm.depth);
+                if (IS_TLM(TLM_VIDEO_ENCODE_QUEUE))
+                    cl.hf->telemetry(TLM_VIDEO_ENCODE_QUEUE, &d1, sizeof(d1));
+                d1.sz = static_cast<u64>(tlm.dropped);
+                if (IS_TLM(TLM_VIDEO_DROPPED_FRAMES))
+                    cl.hf->telemetry(TLM_VIDEO_DROPPED_FRAMES, &d1, sizeof(d1));
+            }
+            if (more)
+                waitms = 0; // next frame of this call is already here
 
-            bool ok = false;
-            for (contact_descriptor_s *dd = w().first; dd; dd = dd->next_call)
-                if (dd == d)
-                {
-                    ok = true;
-                    break;
-                }
-            if (!ok) break;
+            r = cl.callstate.lock_read();
+            spinlock::decrement(ss.locked);
+            if (r().shutdown || r().video_encoders_gen != gen)
+                break;
 
+            if (!r().in_list(d))
+            {
+                waitms = 0; // call list changed; rescan
+                break;
+            }
         }
-        if (w.is_locked()) w.unlock();
     }
 }
 
-static void av_sender()
+// one send operation of call (audio packet or part of video frame); call must be locked (see stream_settings_s::locked)
+// returns true if something was sent and there may be more data
+static bool av_send_next(contact_descriptor_s::call_in_progress_s *cip, uint32_t fid, int &waitms)
 {
-    cl.callstate.lock_write()().av_sender = true;
-
-    int sleepms = 100;
-    int timeoutcountdown = 50; // 5 sec
-    for (;; Sleep(sleepms))
+    contact_descriptor_s::call_in_progress_s::audio_packet_s *ap = cip->nspacket;
+    if (ap)
     {
-        auto w = cl.callstate.lock_write();
-        w().av_sender_heartbeat = true;
-        if (w().shutdown)
+        if (!tox_friend_send_lossless_packet(cl.tox, fid, (uint8_t *)(ap + 1), ap->plen, nullptr))
         {
-            w().av_sender = false;
-            return;
+            waitms = min(waitms, 1); // tox queue is full; retry soon
+            return false;
         }
-        if (nullptr == w().first)
+        cip->nspacket = nullptr;
+        cip->freepackets.push(ap);
+        return true;
+    }
+
+    if (cip->readypackets.try_pop(ap))
+    {
+        spinlock::decrement(cip->readypacketscount);
+
+        if (!tox_friend_send_lossless_packet(cl.tox, fid, (uint8_t *)(ap+1), ap->plen, nullptr))
         {
-            --timeoutcountdown;
-            if (timeoutcountdown <= 0)
-            {
-                w().av_sender = false;
-                return;
-            }
-            sleepms = 100;
-            continue;
+            cip->nspacket = ap;
+            waitms = min(waitms, 1);
+            return false;
         }
-        timeoutcountdown = 50;
-        sleepms = 1;
-        for (contact_descriptor_s *d = w().first; d; d = d->next_call)
-        {
-            stream_settings_s &ss = d->cip->local_settings;
+        cip->freepackets.push(ap);
+        return true;
+    }
 
-            bool ex = d->cip->is_audio_ex() || (d->cip->is_video_ex() && d->cip->current != nullptr);
+    if (cip->current == nullptr)
+        return false;
 
-            if (!ex)
-                continue;
+    spinlock::simple_lock(cip->sync_frame);
 
-            if (false)
-            {
-            cont:
+    if (cip->current->is_done())
+    {
+        auto *t = cip->current;
+        cip->current = cip->next;
+        cip->next = t;
+    }
 
-                w = cl.callstate.lock_write();
-                --ss.locked;
-                if (w().shutdown)
-                    return;
+    if (nullptr == cip->current || cip->current->is_done())
+    {
+        cip->current_busy = false;
+        spinlock::simple_unlock(cip->sync_frame);
+        return false;
+    }
 
-                bool ok = false;
-                for (contact_descriptor_s *dd = w().first; dd; dd = dd->next_call)
-                    if (dd == d)
-                    {
-                        ok = true;
-                        break;
-                    }
-                if (!ok) break;
+    cip->current_busy = true;
+    spinlock::simple_unlock(cip->sync_frame);
 
-            }
+    int current_video_budget = cip->current_video_budget;
+    int next_budget_up_time = cip->next_budget_up_time;
 
-            contact_descriptor_s::call_in_progress_s::audio_packet_s *ap = d->cip->nspacket;
-            if (ap)
-            {
-                fid_s fid = d->get_fid();
+    // send video ex data
 
-                ++ss.locked;
-                w.unlock(); // no need lock anymore
+    contact_descriptor_s::call_in_progress_s::sending_video_frame_s * f = cip->current;
+    f->dummy_int = (PACKETID_VIDEO_EX<<24) | (PACKETID_VIDEO_EX << 16) | (PACKETID_VIDEO_EX << 8) | (PACKETID_VIDEO_EX << 0);
+    f->sframe = htonl( f->frame );
+    f->soffset = htonl( f->offset ? f->offset : (-f->size) );
 
+    int d1sz = sizeof(int) * 2 + 1;
+    if (cip->is_video_support_timestamp())
+    {
+        f->stimestamp = my_ntohll(f->timestamp);
+        d1sz += sizeof(u64);
+    }
 
-                if (tox_friend_send_lossless_packet(cl.tox, fid.normal(), (uint8_t *)(ap + 1), ap->plen, nullptr))
-                    d->cip->nspacket = nullptr;
-
-                goto cont;
-            }
+    const uint8_t *d1 = f->dummy_byte + (sizeof(int) - 1);
+    const uint8_t *d2 = ((const uint8_t *)(f+1)) + f->offset;
+    int d2sz = f->size - f->offset;
+    if (d2sz > TOX_MAX_CUSTOM_PACKET_SIZE - d1sz) d2sz = TOX_MAX_CUSTOM_PACKET_SIZE - d1sz;
 
-            if (d->cip->readypackets.try_pop(ap))
-            {
-                spinlock::decrement(d->cip->readypacketscount);
+    bool allow_send = cl.video_limit == 0;
+    if (!allow_send)
+    {
+        int ct = time_ms();
+        if ((ct - next_budget_up_time) > 0)
+        {
+            next_budget_up_time = ct + 1000;
+            current_video_budget = cl.video_limit;
+        }
+        if (current_video_budget >= 0)
+            allow_send = true;
+        else
+        {
+            current_video_budget = -1;
+            waitms = min(waitms, next_budget_up_time - ct); // budget is over; wait next second
+        }
 
-                fid_s fid = d->get_fid();
+    }
 
-                ++ss.locked;
-                w.unlock(); // no need lock anymore
+    bool sent = false;
+    if (allow_send)
+    {
+        if (tox_friend_send_lossless_packet2(cl.tox, fid, d1, d1sz, d2, d2sz))
+        {
+            f->offset += d2sz;
+            current_video_budget -= (d1sz + d2sz);
+            sent = true;
+        } else
+            waitms = min(waitms, 1);
+    }
 
-                if (!tox_friend_send_lossless_packet(cl.tox, fid.normal(), (uint8_t *)(ap+1), ap->plen, nullptr))
-                    d->cip->nspacket = ap;
+    if (f->is_done())
+        cip->current_busy = false; // safe to reset this flag without locking due busy means exclusive access
 
-                goto cont;
-            }
+    // its safe to modify these values due this is only one place of modification here
+    cip->current_video_budget = current_video_budget;
+    cip->next_budget_up_time = next_budget_up_time;
 
-            if (d->cip->current == nullptr)
-                continue;
+    return sent;
+}
 
-            spinlock::simple_lock(d->cip->sync_frame);
+static void av_sender()
+{
+    cl.callstate.lock_write()().av_sender = true;
 
-            if (d->cip->current->is_done())
+    int waitms = 100;
+    int timeoutcountdown = 50; // 5 sec
+    for (;; cl.sender_signal.wait(waitms))
+    {
+        auto w = cl.callstate.lock_write();
+        w().av_sender_heartbeat = true;
+        if (w().shutdown)
+        {
+            w().av_sender = false;
+            return;
+        }
+        if (nullptr == w().first)
+        {
+            --timeoutcountdown;
+            if (timeoutcountdown <= 0)
             {
-                auto *t = d->cip->current;
-                d->cip->current = d->cip->next;
-                d->cip->next = t;
+                w().av_sender = false;
+                return;
             }
+            waitms = 100;
+            continue;
+        }
+        w.unlock();
+        timeoutcountdown = 50;
+        waitms = 100; // sleep till encoders signal
 
-            if (nullptr == d->cip->current || d->cip->current->is_done())
-            {
-                d->cip->current_busy = false;
-                spinlock::simple_unlock(d->cip->sync_frame);
-                continue;
-            }
+        auto r = cl.callstate.lock_read();
+        for (contact_descriptor_s *d = r().first; d; d = d->next_call)
+        {
+            contact_descriptor_s::call_in_progress_s *cip = d->cip;
+            bool ex = cip->is_audio_ex() || (cip->is_video_ex() && cip->current != nullptr);
 
-            d->cip->current_busy = true;
-            spinlock::simple_unlock(d->cip->sync_frame);
+            if (!ex)
+                continue;
 
+            stream_settings_s &ss = cip->local_settings;
             fid_s fid = d->get_fid();
 
-            int current_video_budget = d->cip->current_video_budget;
-            int next_budget_up_time = d->cip->next_budget_up_time;
-
-            ++ss.locked;
-            w.unlock(); // no need lock anymore
+            spinlock::increment(ss.locked);
+            r.unlock(); // no need lock anymore
 
-            // send video ex data
+            for (int n = 0; av_send_next(cip, fid.normal(), waitms); ++n)
+                if (n >= 64 && cl.callstate.lock_read()().shutdown)
+                    break;
 
-            contact_descriptor_s::call_in_progress_s::sending_video_frame_s * f = d->cip->current;
-            f->dummy_int = (PACKETID_VIDEO_EX<<24) | (PACKETID_VIDEO_EX << 16) | (PACKETID_VIDEO_EX << 8) | (PACKETID_VIDEO_EX << 0);
-            f->sframe = htonl( f->frame );
-            f->soffset = htonl( f->offset ? f->offset : (-f->size) );
+            r = cl.callstate.lock_read();
+            spinlock::decrement(ss.locked);
+            if (r().shutdown)
+                break;
 
-            int d1sz = sizeof(int) * 2 + 1;
-            if (d->cip->is_video_support_timestamp())
+            if (!r().in_list(d))
             {
-                f->stimestamp = my_ntohll(f->timestamp);
-                d1sz += sizeof(u64);
+                waitms = 0; // call list changed; rescan
+                break;
             }
+        }
+    }
+}
 
-            const uint8_t *d1 = f->dummy_byte + (sizeof(int) - 1);
-            const uint8_t *d2 = ((const uint8_t *)(f+1)) + f->offset;
-            int d2sz = f->size - f->offset;
-            if (d2sz > TOX_MAX_CUSTOM_PACKET_SIZE - d1sz) d2sz = TOX_MAX_CUSTOM_PACKET_SIZE - d1sz;
-
-            bool allow_send = cl.video_limit == 0;
-            if (!allow_send)
+#ifdef _DEBUG
+// simulation of N concurrent calls: host thread pushes 20ms audio chunks, audio encoder thread sends 60ms frames by deadlines
+// reports send interval jitter and cpu time of encoder thread
+static void av_pipeline_bench(int ncalls)
+{
+    struct bench_s
+    {
+        stream_settings_s ss[32];
+        media_signal_c signal;
+        int ncalls;
+        int frames = 0;
+        int lastsend[32];
+        int maxjitter = 0;
+        u64 sumjitter = 0;
+        volatile bool stop = false;
+
+        static DWORD WINAPI encoder(LPVOID p)
+        {
+            bench_s &b = *(bench_s *)p;
+            timeBeginPeriod(1);
+            byte_buffer prebuffer;
+            int waitms = 100;
+            for (; !b.stop; b.signal.wait(waitms))
             {
+                waitms = 100;
                 int ct = time_ms();
-                if ((ct - next_budget_up_time) > 0)
+                for (int i = 0; i < b.ncalls; ++i)
                 {
-                    next_budget_up_time = ct + 1000;
-                    current_video_budget = cl.video_limit;
-                }
-                if (current_video_budget >= 0)
-                    allow_send = true;
-                else
-                    current_video_budget = -1;
-
-            }
+                    stream_settings_s &ss = b.ss[i];
+                    int req_frame_size = ss.avgBytesPerMSecs(AUDIO_FRAME_DURATION);
+                    {
+                        SIMPLELOCK(ss.sync);
+                        if (!ss.audio_frame_due(ss.fifo.available(), ct, waitms))
+                            continue;
+                        if (req_frame_size > (int)prebuffer.size()) prebuffer.resize(req_frame_size);
+                        ss.fifo.read_data(prebuffer.data(), req_frame_size);
+                    }
+                    if (ss.next_time_send - ct < waitms) waitms = ss.next_time_send - ct;
 
-            if (allow_send && tox_friend_send_lossless_packet2(cl.tox, fid.normal(), d1, d1sz, d2, d2sz))
-            {
-                f->offset += d2sz;
-                current_video_budget -= (d1sz + d2sz);
+                    if (b.lastsend[i])
+                    {
+                        int j = abs(ct - b.lastsend[i] - AUDIO_FRAME_DURATION);
+                        b.sumjitter += j;
+                        if (j > b.maxjitter) b.maxjitter = j;
+                        ++b.frames;
+                    }
+                    b.lastsend[i] = ct;
+                }
             }
+            timeEndPeriod(1);
+            return 0;
+        }
+    };
 
-            if (f->is_done())
-                d->cip->current_busy = false; // safe to reset this flag without locking due busy means exclusive access
+    bench_s *b = new bench_s;
+    b->ncalls = min(max(ncalls, 1), 32);
+    memset(b->lastsend, 0, sizeof(b->lastsend));
 
-            // its safe to modify these values due this is only one place of modification here
-            d->cip->current_video_budget = current_video_budget;
-            d->cip->next_budget_up_time = next_budget_up_time;
+    HANDLE th = CreateThread(nullptr, 0, bench_s::encoder, b, 0, nullptr);
 
-            goto cont;
+    byte_buffer chunk;
+    chunk.resize(b->ss[0].avgBytesPerMSecs(20));
+    memset(chunk.data(), 0, chunk.size());
 
+    int st = time_ms();
+    for (int t = st; (time_ms() - st) < 10000; t += 20)
+    {
+        for (; (t - time_ms()) > 0; Sleep(1));
+        for (int i = 0; i < b->ncalls; ++i)
+        {
+            stream_settings_s &ss = b->ss[i];
+            SIMPLELOCK(ss.sync);
+            ss.fifo.add_data(chunk.data(), chunk.size());
+            if ((int)ss.fifo.available() >= ss.avgBytesPerMSecs(AUDIO_FRAME_DURATION))
+                b->signal.signal();
         }
-        if (w.is_locked()) w.unlock();
     }
+
+    b->stop = true;
+    b->signal.signal();
+    WaitForSingleObject(th, INFINITE);
+
+    FILETIME ct, et, kt, ut;
+    GetThreadTimes(th, &ct, &et, &kt, &ut);
+    CloseHandle(th);
+    u64 cpu100ns = ((u64)kt.dwHighDateTime << 32 | kt.dwLowDateTime) + ((u64)ut.dwHighDateTime << 32 | ut.dwLowDateTime);
+
+    Log("avbench: calls %i, frames %i, jitter avg %i ms, max %i ms, encoder cpu %i ms per 10 sec", b->ncalls, b->frames,
+        b->frames ? (int)(b->sumjitter / b->frames) : 0, b->maxjitter, (int)(cpu100ns / 10000));
+
+    delete b;
 }
+#endif // _DEBUG
 
 void tox_c::tick(int *sleep_time_ms)
 {
@@ -5686,6 +5929,7 @@ void tox_c::tick(int *sleep_time_ms)
 
         if ((curt - nexttav) > 0)
         {
+            TRACE_SPAN( "toxav.iterate" ); // decodes received audio and video
             toxav_iterate(toxav);
             nexttav = curt + toxav_iteration_interval(toxav);
 
@@ -6109,6 +6353,9 @@ void tox_c::set_config(const void*idata, int iisz)
         if (ldr(chunk_video_limit, false))
             video_limit = ldr.get_i32();
 
+        if (ldr(chunk_video_telemetry, false))
+            tlmflags = ldr.get_i32();
+
         if (int sz = ldr(chunk_toxid))
         {
             loader l(ldr.chunkdata(), sz);
@@ -6451,6 +6698,7 @@ void tox_c::save_current_stuff( savebuffer &b )
     chunk(b, chunk_disable_video_ex) << static_cast<i32>(disabled_video_ex ? 1 : 0);
     chunk(b, chunk_nodes_list_fn) << nodes_fn;
     chunk(b, chunk_video_limit) << static_cast<i32>(video_limit);
+    chunk(b, chunk_video_telemetry) << static_cast<i32>(tlmflags);
     
     chunk(b, chunk_toxid) << lastmypubid.as_bytes();
 
@@ -6755,6 +7003,15 @@ void tox_c::send_message(contact_id_s id, const message_s *msg)
         hf->delivered( msg->utag );
         return;
     }
+    if (std::pstr_c(std::asptr(msg->message, msg->message_len)).begins(STD_ASTR("/avbench")))
+    {
+        std::str_c x(std::asptr(msg->message, msg->message_len));
+        x.cut( 0, 8 );
+        x.trim();
+        av_pipeline_bench(x.as_int());
+        hf->delivered( msg->utag );
+        return;
+    }
 #endif // _DEBUG
 
     if (tox)
@@ -6864,12 +7121,11 @@ int tox_c::send_av(contact_id_s id, const call_prm_s * ci)
 
         if (nullptr != cd->cip)
         {
-            auto w = callstate.lock_write();
-
             if (ci->audio_data)
             {
                 stream_settings_s &ss = cd->cip->local_settings;
-            
+                SIMPLELOCK(ss.sync);
+
                 if (ci->ms_monotonic)
                 {
                     ss.audio_timestamp = ci->ms_monotonic - ss.bytesToMSec(ss.fifo.available()); // new data timestamp minus current fifo size = begin of fifo timestamp
@@ -6884,19 +7140,17 @@ int tox_c::send_av(contact_id_s id, const call_prm_s * ci)
                     if (ss.audio_timestamp)
                         ss.audio_timestamp += ss.bytesToMSec(overbuf);
                 }
+
+                if ((int)ss.fifo.available() >= ss.avgBytesPerMSecs(AUDIO_FRAME_DURATION))
+                    audio_signal.signal();
             }
 
             if (ci->video_data && ci->fmt == VFMT_I420 && 0 != (cd->cip->remote_so.options & SO_RECEIVING_VIDEO))
             {
-                stream_settings_s &ss = cd->cip->local_settings;
-                
-                if (ss.video_data)
-                    hf->free_video_data(ss.video_data);
-
-                ss.video_w = ci->w;
-                ss.video_h = ci->h;
-                ss.video_data = ci->video_data;
-                ss.video_timestamp = ci->ms_monotonic;
+                if (const void *stale = cd->cip->local_settings.vqueue.push(ci->video_data, ci->ms_monotonic, ci->w, ci->h))
+                    hf->free_video_data(stale);
+
+                video_signal.signal();
                 return SEND_AV_KEEP_VIDEO_DATA;
             }
         }
@@ -16,9 +16,56 @@
 
 #include <cstdlib>
 
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ ) /* isotoxin.im */
+# include <emmintrin.h>
+# define GLOOX_SCAN_SSE2
+# ifdef _MSC_VER
+#  include <intrin.h>
+# endif
+#endif
+
 namespace gloox
 {
 
+  /* isotoxin.im */
+  // returns position of the first of c0..c3 in data[pos, count) or count; text runs between markup
+  // are appended in one go instead of char by char (base64 avatars, long messages)
+  static std::string::size_type scanTo( const std::string& data, std::string::size_type pos,
+                                        std::string::size_type count, char c0, char c1, char c2, char c3 )
+  {
+    const char* d = data.data();
+#ifdef GLOOX_SCAN_SSE2
+    const __m128i v0 = _mm_set1_epi8( c0 );
+    const __m128i v1 = _mm_set1_epi8( c1 );
+    const __m128i v2 = _mm_set1_epi8( c2 );
+    const __m128i v3 = _mm_set1_epi8( c3 );
+    for( ; pos + 16 <= count; pos += 16 )
+    {
+      const __m128i x = _mm_loadu_si128( reinterpret_cast<const __m128i*>( d + pos ) );
+      const __m128i m = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( x, v0 ), _mm_cmpeq_epi8( x, v1 ) ),
+                                      _mm_or_si128( _mm_cmpeq_epi8( x, v2 ), _mm_cmpeq_epi8( x, v3 ) ) );
+      const int mask = _mm_movemask_epi8( m );
+      if( mask )
+      {
+# ifdef _MSC_VER
+        unsigned long bit;
+        _BitScanForward( &bit, static_cast<unsigned long>( mask ) );
+        return pos + bit;
+# else
+        return pos + __builtin_ctz( static_cast<unsigned>( mask ) );
+# endif
+      }
+    }
+#endif
+    for( ; pos < count; ++pos )
+    {
+      const char c = d[pos];
+      if( c == c0 || c == c1 || c == c2 || c == c3 )
+        break;
+    }
+    return pos;
+  }
+
   Parser::Parser( TagHandler* ph, bool deleteRoot )
     : m_tagHandler( ph ), m_current( 0 ), m_root( 0 ), m_xmlnss( 0 ), m_state( Initial ),
       m_preamble( 0 ), m_quote( false ), m_haveTagPrefix( false ), m_haveAttribPrefix( false ),
@@ -287,8 +334,12 @@ namespace gloox
               }
               break;
             default:
-              m_cdata += c;
+            {
+              const std::string::size_type e = scanTo( data, i + 1, count, ']', ']', ']', ']' ); /* isotoxin.im */
+              m_cdata.append( data, i, e - i );
+              i = e - 1;
               break;
+            }
           }
           break;
         case TagNameCollect:          // we're collecting the tag's name, we have at least one octet already
@@ -356,8 +407,12 @@ namespace gloox
               }
               break;
             default:
-              m_cdata += c;
+            {
+              const std::string::size_type e = scanTo( data, i + 1, count, '<', '&', '<', '&' ); /* isotoxin.im */
+              m_cdata.append( data, i, e - i );
+              i = e - 1;
               break;
+            }
           }
           break;
         case TagOpeningSlash:         // a slash in an opening tag has been found, initing close of the tag
@@ -593,7 +648,11 @@ namespace gloox
               break;
             case '>':
             default:
-              m_value += c;
+            {
+              const std::string::size_type e = scanTo( data, i + 1, count, '<', '&', '"', '\'' ); /* isotoxin.im */
+              m_value.append( data, i, e - i );
+              i = e - 1;
+            }
           }
           break;
         case TagNameAlmostComplete:
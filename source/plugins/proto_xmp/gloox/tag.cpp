@@ -22,6 +22,63 @@
 namespace gloox
 {
 
+  /* isotoxin.im */
+  // Every element, attribute and text node of an incoming stanza is a separate object, created by the
+  // parser and deleted right after dispatch. Free lists carved from slabs replace the general heap for
+  // them; slabs are never released, so the pool stays at the size of the largest tree alive at once.
+  // Free lists are per thread, so there is no lock: object deleted by other thread just joins free list of
+  // that thread (items of one kind are interchangeable). Parser and session run on one thread anyway.
+  namespace
+  {
+    enum { PoolTag, PoolAttribute, PoolNode, PoolCount };
+    static const int SlabItems = 256;
+
+    __declspec( thread ) void* tls_free[PoolCount];
+    __declspec( thread ) bool tls_heap = false; // see Tag::setPooled
+
+    template<typename T, int K> void* poolAlloc( size_t sz )
+    {
+      if( sz != sizeof( T ) || tls_heap )
+        return ::operator new( sz );
+
+      void*& f = tls_free[K];
+      if( !f )
+      {
+        char* slab = static_cast<char*>( ::operator new( sizeof( T ) * SlabItems ) );
+        for( int k = SlabItems - 1; k >= 0; --k )
+        {
+          void* i = slab + k * sizeof( T );
+          *static_cast<void**>( i ) = f;
+          f = i;
+        }
+      }
+      void* i = f;
+      f = *static_cast<void**>( i );
+      return i;
+    }
+
+    template<typename T, int K> void poolRelease( void* p, size_t sz )
+    {
+      if( !p )
+        return;
+      if( sz != sizeof( T ) || tls_heap )
+      {
+        ::operator delete( p );
+        return;
+      }
+      *static_cast<void**>( p ) = tls_free[K];
+      tls_free[K] = p;
+    }
+  }
+
+  void Tag::setPooled( bool pooled ) { tls_heap = !pooled; }
+  void* Tag::operator new( size_t sz ) { return poolAlloc<Tag, PoolTag>( sz ); }
+  void Tag::operator delete( void* p, size_t sz ) { poolRelease<Tag, PoolTag>( p, sz ); }
+  void* Tag::Attribute::operator new( size_t sz ) { return poolAlloc<Attribute, PoolAttribute>( sz ); }
+  void Tag::Attribute::operator delete( void* p, size_t sz ) { poolRelease<Attribute, PoolAttribute>( p, sz ); }
+  void* Tag::Node::operator new( size_t sz ) { return poolAlloc<Node, PoolNode>( sz ); }
+  void Tag::Node::operator delete( void* p, size_t sz ) { poolRelease<Node, PoolNode>( p, sz ); }
+
   // ---- Tag::Attribute ----
   Tag::Attribute::Attribute( Tag* parent, const std::string& name, const std::string& value,
                              const std::string& xmlns )
@@ -97,6 +97,10 @@ namespace gloox
            */
           virtual ~Attribute() {}
 
+          /* isotoxin.im */
+          static void* operator new( size_t sz );
+          static void operator delete( void* p, size_t sz );
+
           /**
            * Returns the attribute's name.
            * @return The attribute's name.
@@ -225,6 +229,13 @@ namespace gloox
        */
       virtual ~Tag();
 
+      /* isotoxin.im */
+      // Tags, attributes and nodes of every incoming stanza are recycled via slab pools (see tag.cpp)
+      static void* operator new( size_t sz );
+      static void operator delete( void* p, size_t sz );
+      // false - plain heap for tags of calling thread (to compare in benchmark); switch only when thread has no tags alive
+      static void setPooled( bool pooled );
+
       /**
        * This function can be used to retrieve the complete XML of a tag as a string.
        * It includes all the attributes, child nodes and character data.
@@ -616,6 +627,9 @@ namespace gloox
         Node( NodeType _type, std::string* _str ) : type( _type ), str( _str ) {}
         ~Node() {}
 
+        static void* operator new( size_t sz ); /* isotoxin.im */
+        static void operator delete( void* p, size_t sz );
+
         NodeType type;
         union
         {
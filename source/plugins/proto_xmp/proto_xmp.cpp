@@ -31,6 +31,7 @@
 #include <gloox/error.h>
 #include <gloox/softwareversion.h>
 #include <gloox/socks5bytestream.h>
+#include <gloox/parser.h>
 #include "memory"
 
 #pragma warning(push)
@@ -2834,8 +2835,87 @@ int xmpp::add_contact(const char* public_id, const char* invite_message_utf8)
     return CR_OK;
 }
 
+#ifdef _DEBUG
+// replays captured incoming stream (raw xml, as received from server) through gloox parser in 4k chunks, like socket does
+// reports parse speed; tags are built and destroyed as in real session
+static void xml_parser_bench( const std::str_c &fn )
+{
+    struct counter_s : public gloox::TagHandler
+    {
+        int stanzas = 0;
+        void handleTag( gloox::Tag* ) override { ++stanzas; }
+    } cnt;
+
+    HANDLE f = CreateFileA( fn.cstr(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr );
+    if ( INVALID_HANDLE_VALUE == f )
+    {
+        Log( "xmlbench: can't open %s", fn.cstr() );
+        return;
+    }
+    std::string stream( GetFileSize( f, nullptr ), 0 );
+    DWORD rb = 0;
+    if ( !stream.empty() ) ReadFile( f, &stream[ 0 ], (DWORD)stream.size(), &rb, nullptr );
+    CloseHandle( f );
+    stream.resize( rb );
+
+    // same stream through plain heap and through tag pools; several rounds of each to even out cache and heap warmup
+    const int passes = 20;
+    const char *names[] = { "heap", "pool" };
+    u64 dt[ 2 ] = {};
+    int stanzas = 0;
+    for ( int round = 0; round < 3; ++round )
+        for ( int mode = 0; mode < 2; ++mode )
+        {
+            gloox::Tag::setPooled( mode == 1 ); // no tags alive here: parsers of previous pass are gone
+            cnt.stanzas = 0;
+            u64 t0 = time_us();
+            int err = -1;
+            size_t i = 0;
+            for ( int pass = 0; pass < passes && err < 0; ++pass )
+            {
+                gloox::Parser parser( &cnt );
+                for ( i = 0; i < stream.size() && err < 0; i += 4096 )
+                {
+                    std::string chunk( stream, i, 4096 );
+                    err = parser.feed( chunk );
+                }
+            }
+            if ( err >= 0 )
+            {
+                gloox::Tag::setPooled( true ); // parser with its tags is already gone
+                Log( "xmlbench: parse error at %i of chunk %i", err, (int)( i / 4096 ) - 1 );
+                return;
+            }
+            dt[ mode ] += time_us() - t0;
+            stanzas = cnt.stanzas;
+        }
+    gloox::Tag::setPooled( true );
+
+    for ( int mode = 0; mode < 2; ++mode )
+    {
+        u64 t = dt[ mode ] / 3;
+        if ( 0 == t ) t = 1;
+        Log( "xmlbench (%s): %i bytes x %i, stanzas %i, %i ms, %i stanzas/sec, %i kb/sec", names[ mode ], (int)stream.size(), passes, stanzas, (int)(t / 1000),
+            (int)( (u64)stanzas * 1000000 / t ), (int)( (u64)stream.size() * passes * 1000000 / 1024 / t ) );
+    }
+    Log( "xmlbench: pool time %i%% of heap", (int)( dt[ 1 ] * 100 / ( dt[ 0 ] ? dt[ 0 ] : 1 ) ) );
+}
+#endif // _DEBUG
+
 void xmpp::send_message(contact_id_s id, const message_s *msg)
 {
+#ifdef _DEBUG
+    if ( std::pstr_c( std::asptr( msg->message, msg->message_len ) ).begins( STD_ASTR( "/xmlbench " ) ) )
+    {
+        std::str_c x( std::asptr( msg->message, msg->message_len ) );
+        x.cut( 0, 10 );
+        x.trim();
+        xml_parser_bench( x );
+        hf->delivered( msg->utag );
+        return;
+    }
+#endif // _DEBUG
+
     if ( contact_descriptor_s *c = find( id ) )
         c->send( this, msg );
 }
@@ -2992,8 +3072,9 @@ void xmpp::enter_conference( const char *conference_id )
 void xmpp::leave_conference(contact_id_s /*gid*/, int /*keep_leave*/ )
 {
 }
-void xmpp::logging_flags(unsigned int /*f*/)
+void xmpp::logging_flags(unsigned int f)
 {
+    g_logging_flags = f;
 }
 void xmpp::proto_file(i32, const file_portion_prm_s *)
 {